@@ -0,0 +1,188 @@
+#include <benchmark/benchmark.h>
+#include "OrderBook.h"
+#include "OrderPool.h"
+#include <random>
+#include <vector>
+
+using namespace MatchingEngine;
+
+namespace {
+
+constexpr Price BASE_PRICE = 1000000;   // 100.00
+constexpr Price TICK = 100;             // 0.01
+constexpr Quantity DEEP_QUANTITY = Quantity(1) << 40;  // Never traded out
+
+// Book plus the pool its orders live in, wired the way the engine does it:
+// an order goes back to the pool when the book retires it
+struct BenchBook {
+    OrderPool pool;
+    OrderBook book;
+    std::vector<Trade> trades;
+    OrderId nextId = 1;
+
+    explicit BenchBook(PriceLadderType ladder)
+        : book("BENCH", config(ladder)) {
+        book.setRetireHandler([this](Order& order) { pool.release(&order); });
+        trades.reserve(4096);
+    }
+
+    static OrderBookConfig config(PriceLadderType ladder) {
+        OrderBookConfig config;
+        config.ladderType = ladder;
+        config.tickSize = TICK;
+        config.synchronized = false;
+        config.orderCapacity = 1 << 16;
+        return config;
+    }
+
+    OrderHandle make(Side side, OrderType type, Price price, Quantity quantity) {
+        return pool.acquire(nextId++, book.getSymbolId(), side, type, price, quantity);
+    }
+
+    // Submit the way MatchingEngineCore does: match, and recycle the order
+    // unless it came to rest
+    void submit(Side side, OrderType type, Price price, Quantity quantity) {
+        OrderHandle order = make(side, type, price, quantity);
+        trades.clear();
+        if (!book.matchOrder(order, trades)) {
+            pool.release(order);
+        }
+    }
+};
+
+PriceLadderType ladderArg(const benchmark::State& state, int index) {
+    return state.range(index) == 0 ? PriceLadderType::MAP : PriceLadderType::ARRAY;
+}
+
+void ladderLabel(benchmark::State& state, int index) {
+    state.SetLabel(state.range(index) == 0 ? "map" : "array");
+}
+
+} // namespace
+
+// Queue N orders at one level, then take them out again: half from the
+// middle (cancels), half from the front (fills)
+static void BM_PriceLevelPushRemove(benchmark::State& state) {
+    const auto orders = static_cast<size_t>(state.range(0));
+    Order order(1, SymbolId(0), Side::BUY, OrderType::LIMIT, BASE_PRICE, 100);
+    OrderSlab slab(orders);
+    std::vector<OrderSlot> slots;
+    for (size_t i = 0; i < orders; ++i) {
+        slots.push_back(slab.allocate(&order));
+    }
+
+    PriceLevel level(BASE_PRICE);
+    for (auto _ : state) {
+        for (OrderSlot slot : slots) {
+            level.pushBack(slab, slot);
+        }
+        for (size_t i = 1; i < orders; i += 2) {
+            level.remove(slab, slots[i]);
+        }
+        while (!level.isEmpty()) {
+            level.popFront(slab);
+        }
+        benchmark::DoNotOptimize(level.getTotalQuantity());
+    }
+    state.SetItemsProcessed(state.iterations() * orders * 2);
+}
+BENCHMARK(BM_PriceLevelPushRemove)->Arg(8)->Arg(64)->Arg(1024);
+
+// One aggressive buy of type T per iteration against ten deep ask levels.
+// The resting orders are too large to trade out, so every iteration takes
+// the same path: one fill at the best level.
+template <OrderType T>
+static void BM_MatchOrder(benchmark::State& state) {
+    BenchBook bench(ladderArg(state, 0));
+    for (int level = 0; level < 10; ++level) {
+        bench.submit(Side::SELL, OrderType::LIMIT, BASE_PRICE + level * TICK, DEEP_QUANTITY);
+        bench.submit(Side::BUY, OrderType::LIMIT, BASE_PRICE - (level + 1) * TICK, DEEP_QUANTITY);
+    }
+
+    Price limit = T == OrderType::MARKET ? 0 : BASE_PRICE + 5 * TICK;
+    for (auto _ : state) {
+        bench.submit(Side::BUY, T, limit, 100);
+        benchmark::DoNotOptimize(bench.trades.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    ladderLabel(state, 0);
+}
+BENCHMARK_TEMPLATE(BM_MatchOrder, OrderType::LIMIT)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_MatchOrder, OrderType::MARKET)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_MatchOrder, OrderType::IOC)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_MatchOrder, OrderType::FOK)->Arg(0)->Arg(1);
+
+// Limit order that rests without crossing - the add path of a quote
+static void BM_RestOrder(benchmark::State& state) {
+    BenchBook bench(ladderArg(state, 0));
+    std::vector<OrderId> resting;
+    resting.reserve(1024);
+    int level = 0;
+    for (auto _ : state) {
+        OrderId id = bench.nextId;
+        bench.submit(Side::BUY, OrderType::LIMIT, BASE_PRICE - (level + 1) * TICK, 100);
+        resting.push_back(id);
+        level = (level + 1) % 32;
+        if (resting.size() == resting.capacity()) {
+            state.PauseTiming();
+            for (OrderId restingId : resting) {
+                bench.book.cancelOrder(restingId);
+            }
+            resting.clear();
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    ladderLabel(state, 0);
+}
+BENCHMARK(BM_RestOrder)->Arg(0)->Arg(1);
+
+// Quote churn: keep N orders resting over 32 bid levels, and per iteration
+// cancel a random one and enter a replacement
+static void BM_CancelReplace(benchmark::State& state) {
+    BenchBook bench(ladderArg(state, 1));
+    const auto depth = static_cast<size_t>(state.range(0));
+    std::mt19937 random(42);
+    std::vector<OrderId> live;
+    for (size_t i = 0; i < depth; ++i) {
+        live.push_back(bench.nextId);
+        bench.submit(Side::BUY, OrderType::LIMIT, BASE_PRICE - Price(random() % 32 + 1) * TICK, 100);
+    }
+
+    for (auto _ : state) {
+        size_t victim = random() % live.size();
+        bench.book.cancelOrder(live[victim]);
+        live[victim] = bench.nextId;
+        bench.submit(Side::BUY, OrderType::LIMIT, BASE_PRICE - Price(random() % 32 + 1) * TICK, 100);
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    ladderLabel(state, 1);
+}
+BENCHMARK(BM_CancelReplace)
+    ->Args({1000, 0})->Args({1000, 1})
+    ->Args({50000, 0})->Args({50000, 1});
+
+// Market order that sweeps N ask levels of four orders each. Building the
+// book is not timed.
+static void BM_DeepBookSweep(benchmark::State& state) {
+    BenchBook bench(ladderArg(state, 1));
+    const auto levels = static_cast<Price>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (Price level = 0; level < levels; ++level) {
+            for (int i = 0; i < 4; ++i) {
+                bench.submit(Side::SELL, OrderType::LIMIT, BASE_PRICE + level * TICK, 25);
+            }
+        }
+        state.ResumeTiming();
+
+        bench.submit(Side::BUY, OrderType::MARKET, 0, Quantity(levels) * 100);
+        benchmark::DoNotOptimize(bench.trades.data());
+    }
+    state.SetItemsProcessed(state.iterations() * levels * 4);  // Fills
+    ladderLabel(state, 1);
+}
+BENCHMARK(BM_DeepBookSweep)
+    ->Args({16, 0})->Args({16, 1})
+    ->Args({256, 0})->Args({256, 1})
+    ->Args({2048, 0})->Args({2048, 1});
@@ -0,0 +1,264 @@
+#include <benchmark/benchmark.h>
+#include "LatencyHistogram.h"
+#include "MatchingEngine.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace MatchingEngine;
+
+namespace {
+
+// End-to-end harness: replays a generated order flow through
+// MatchingEngineCore and reports per-command latency percentiles.
+//
+//   matching_engine_bench --flow [--commands N] [--symbols N] [--seed N]
+//                                [--ladder map|array] [--synchronized]
+//
+// Without --flow the binary runs the Google Benchmark suite.
+
+enum class CommandKind { PASSIVE, AGGRESSIVE, IOC, MARKET, FOK, CANCEL, MODIFY, COUNT };
+
+const char* kindName(CommandKind kind) {
+    switch (kind) {
+        case CommandKind::PASSIVE: return "passive limit";
+        case CommandKind::AGGRESSIVE: return "crossing limit";
+        case CommandKind::IOC: return "ioc";
+        case CommandKind::MARKET: return "market";
+        case CommandKind::FOK: return "fok";
+        case CommandKind::CANCEL: return "cancel";
+        case CommandKind::MODIFY: return "modify";
+        default: return "?";
+    }
+}
+
+struct FlowConfig {
+    size_t commands = 1000000;
+    size_t symbols = 8;
+    uint32_t seed = 1;
+    PriceLadderType ladder = PriceLadderType::MAP;
+    bool synchronized = false;
+};
+
+// Generated ahead of the run so the random number generator isn't timed.
+// Cancels and modifies pick their target at run time: target is reduced
+// modulo the orders the symbol has resting by then.
+struct FlowCommand {
+    CommandKind kind;
+    uint16_t symbol;
+    Side side;
+    int32_t ticks;  // Price offset from the symbol's mid
+    Quantity quantity;
+    uint32_t target;
+};
+
+constexpr Price TICK = 100;  // 0.01
+constexpr Price START_PRICE = 1000000;
+constexpr size_t MAX_LIVE = 2000;  // Per symbol, past which cancels take over
+
+// Mix by weight, roughly a lit equity book: most messages are quotes and
+// cancels, few of them trade
+std::vector<FlowCommand> generateFlow(const FlowConfig& config) {
+    std::mt19937 random(config.seed);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<int> depth(1, 10);
+    std::uniform_int_distribution<Quantity> lots(1, 5);
+
+    std::vector<FlowCommand> flow;
+    flow.reserve(config.commands);
+    for (size_t i = 0; i < config.commands; ++i) {
+        FlowCommand command{};
+        command.symbol = static_cast<uint16_t>(random() % config.symbols);
+        command.side = random() & 1 ? Side::BUY : Side::SELL;
+        command.quantity = lots(random) * 100;
+        command.target = static_cast<uint32_t>(random());
+
+        int roll = percent(random);
+        if (roll < 50) {
+            command.kind = CommandKind::PASSIVE;
+            command.ticks = depth(random);
+        } else if (roll < 80) {
+            command.kind = CommandKind::CANCEL;
+        } else if (roll < 88) {
+            command.kind = CommandKind::MODIFY;
+            command.ticks = depth(random);
+        } else if (roll < 95) {
+            command.kind = CommandKind::AGGRESSIVE;
+            command.ticks = -(depth(random) / 4);
+        } else if (roll < 98) {
+            command.kind = CommandKind::IOC;
+            command.ticks = -1;
+        } else if (roll < 99) {
+            command.kind = CommandKind::MARKET;
+        } else {
+            command.kind = CommandKind::FOK;
+            command.ticks = -2;
+            command.quantity *= 4;
+        }
+        flow.push_back(command);
+    }
+    return flow;
+}
+
+// Price ticks away from mid on the command's own side; negative ticks cross
+Price priceFor(Price mid, const FlowCommand& command) {
+    Price offset = command.ticks * TICK;
+    return command.side == Side::BUY ? mid - offset : mid + offset;
+}
+
+OrderType typeFor(CommandKind kind) {
+    switch (kind) {
+        case CommandKind::IOC: return OrderType::IOC;
+        case CommandKind::MARKET: return OrderType::MARKET;
+        case CommandKind::FOK: return OrderType::FOK;
+        default: return OrderType::LIMIT;
+    }
+}
+
+int runFlow(const FlowConfig& config) {
+    EngineConfig engineConfig;
+    engineConfig.synchronized = config.synchronized;
+    MatchingEngineCore engine(engineConfig);
+
+    OrderBookConfig bookConfig;
+    bookConfig.ladderType = config.ladder;
+    bookConfig.tickSize = TICK;
+    bookConfig.synchronized = config.synchronized;
+    engine.setDefaultBookConfig(bookConfig);
+
+    std::vector<std::string> symbols;
+    for (size_t i = 0; i < config.symbols; ++i) {
+        symbols.push_back("SYM" + std::to_string(i));
+    }
+    std::vector<Price> mids(config.symbols, START_PRICE);
+    std::vector<std::vector<OrderId>> live(config.symbols);
+
+    std::vector<FlowCommand> flow = generateFlow(config);
+    const size_t warmup = flow.size() / 10;
+
+    LatencyHistogram overall;
+    std::vector<LatencyHistogram> byKind(static_cast<size_t>(CommandKind::COUNT));
+    uint64_t mutations = 0;
+
+    auto started = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < flow.size(); ++i) {
+        const FlowCommand& command = flow[i];
+        std::vector<OrderId>& orders = live[command.symbol];
+        Price& mid = mids[command.symbol];
+
+        // Cancels need something to cancel; a full book gets one instead
+        CommandKind kind = command.kind;
+        if ((kind == CommandKind::CANCEL || kind == CommandKind::MODIFY) && orders.empty()) {
+            kind = CommandKind::PASSIVE;
+        } else if (kind == CommandKind::PASSIVE && orders.size() >= MAX_LIVE) {
+            kind = CommandKind::CANCEL;
+        }
+        size_t target = orders.empty() ? 0 : command.target % orders.size();
+        bool drop = kind == CommandKind::CANCEL;
+
+        auto begin = std::chrono::steady_clock::now();
+        switch (kind) {
+            case CommandKind::CANCEL:
+                engine.cancelOrder(orders[target]);
+                break;
+            case CommandKind::MODIFY:
+                if (!engine.modifyOrder(orders[target], priceFor(mid, command), command.quantity)) {
+                    drop = true;  // Target had traded out
+                }
+                break;
+            default: {
+                Price price = kind == CommandKind::MARKET ? 0 : priceFor(mid, command);
+                OrderId id = engine.submitOrder(symbols[command.symbol], command.side,
+                                                typeFor(kind), price, command.quantity);
+                if (kind == CommandKind::PASSIVE || kind == CommandKind::AGGRESSIVE) {
+                    orders.push_back(id);  // May have traded; a later cancel finds out
+                }
+                break;
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        if (drop) {
+            orders[target] = orders.back();
+            orders.pop_back();
+        }
+        // Trades move the mid a tick in the aggressor's direction
+        if (kind != CommandKind::PASSIVE && kind != CommandKind::CANCEL &&
+            kind != CommandKind::MODIFY && (++mutations & 7) == 0) {
+            mid += command.side == Side::BUY ? TICK : -TICK;
+        }
+
+        if (i >= warmup) {
+            auto nanos = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+            overall.record(nanos);
+            byKind[static_cast<size_t>(kind)].record(nanos);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::cout << "Order flow: " << flow.size() << " commands over " << config.symbols
+              << " symbols (" << (config.ladder == PriceLadderType::MAP ? "map" : "array")
+              << " ladder, " << (config.synchronized ? "synchronized" : "unsynchronized")
+              << "), first " << warmup << " not recorded" << std::endl;
+    std::cout << "Throughput: " << static_cast<uint64_t>(flow.size() / seconds)
+              << " commands/s, " << engine.getTotalTrades() << " trades, "
+              << engine.getLiveOrders() << " orders resting" << std::endl;
+    std::cout << "  all            " << overall.summary() << std::endl;
+    for (size_t k = 0; k < byKind.size(); ++k) {
+        if (byKind[k].count() == 0) {
+            continue;
+        }
+        std::string name = kindName(static_cast<CommandKind>(k));
+        name.resize(15, ' ');
+        std::cout << "  " << name << byKind[k].summary() << std::endl;
+    }
+    return 0;
+}
+
+bool parseFlowArgs(int argc, char** argv, FlowConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--flow") {
+            continue;
+        } else if (arg == "--commands" && hasValue) {
+            config.commands = std::stoul(argv[++i]);
+        } else if (arg == "--symbols" && hasValue) {
+            config.symbols = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--seed" && hasValue) {
+            config.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--ladder" && hasValue) {
+            std::string ladder = argv[++i];
+            config.ladder = ladder == "array" ? PriceLadderType::ARRAY : PriceLadderType::MAP;
+        } else if (arg == "--synchronized") {
+            config.synchronized = true;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--flow") == 0) {
+            FlowConfig config;
+            return parseFlowArgs(argc, argv, config) ? runFlow(config) : 1;
+        }
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
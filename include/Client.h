@@ -2,7 +2,16 @@
 
 #include "Common.h"
 #include "Message.h"
+#include "FrameBuffer.h"
+#include "ProtocolV2.h"
+#include "Transport.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <atomic>
 #include <thread>
 #include <functional>
@@ -30,6 +39,72 @@ using OrderAckCallback = std::function<void(const OrderAckMessage&)>;
 using OrderRejectCallback = std::function<void(const OrderRejectMessage&)>;
 using ExecutionReportCallback = std::function<void(const ExecutionReportMessage&)>;
 using MarketDataCallback = std::function<void(const MarketDataMessage&)>;
+using BookUpdateCallback = std::function<void(const BookUpdateMessage&)>;
+using BatchAckCallback = std::function<void(const ProtocolV2::BatchAck&)>;
+using MassCancelAckCallback = std::function<void(const ProtocolV2::MassCancelAck&)>;
+
+class Client;
+
+// One reply to an order, handed back in batches by Client::pollCompletions.
+// clientOrderId is the handle the pipeline returned for the order, resolved
+// through its ack for replies that carry only the server's order id; it is
+// 0 for orders this connection never saw acknowledged, or acknowledged
+// longer ago than setTrackedOrderLimit() reaches.
+struct OrderCompletion {
+    enum class Kind : uint8_t { ACK, REJECT, EXECUTION };
+
+    Kind kind = Kind::ACK;
+    OrderId clientOrderId = 0;
+    OrderId orderId = 0;
+    OrderStatus status = OrderStatus::PENDING;
+    RejectReason reason = RejectReason::NONE;  // Protocol v2 only
+    Price price = 0;                           // Executions only, from here on
+    Quantity quantity = 0;
+    Quantity remaining = 0;
+    uint64_t tradeId = 0;
+};
+
+// Non-blocking order entry for one thread. Messages are encoded into the
+// pipeline's own buffer and written in one send when it is flushed - by
+// flush(), by filling up, or by the client's flush timer once the oldest
+// has waited the flush interval - so senders on different threads never
+// meet on a lock per order. Replies come back through pollCompletions().
+class OrderPipeline {
+public:
+    // The order's client order id, its completion handle; 0 if not queued
+    OrderId submitOrder(const std::string& symbol,
+                        Side side,
+                        OrderType type,
+                        Price price,
+                        Quantity quantity,
+                        Price stopPrice = 0,
+                        TimeInForce timeInForce = TimeInForce::GTC,
+                        uint64_t expireTime = 0);
+    bool cancelOrder(OrderId orderId);
+    bool modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity);
+
+    // Send everything queued; false if the connection is gone, in which
+    // case the queued messages are dropped
+    bool flush();
+
+    size_t pendingBytes() const;
+
+private:
+    friend class Client;
+    explicit OrderPipeline(Client& client) : client_(client) {}
+
+    template <typename Encode>
+    bool queue(Encode encode);
+    bool flushLocked();
+    bool flushIfOlderThan(std::chrono::steady_clock::time_point cutoff);
+
+    Client& client_;
+    mutable std::mutex mutex_;  // The owning thread and the flush timer
+    std::vector<char> buffer_;
+    std::chrono::steady_clock::time_point oldest_;
+    OrderId nextId_ = 0;  // Ids are reserved from the client a block at a time
+    OrderId endId_ = 0;
+};
 
 class Client {
 public:
@@ -41,55 +116,181 @@ public:
     void disconnect();
     bool isConnected() const { return connected_; }
 
-    // Order operations
+    // Order operations. A GTD order lapses at expireTime (nanoseconds since
+    // the epoch, see timestampToNanos), a DAY order at the server's session
+    // close; the server cancels either once it does
     OrderId submitOrder(const std::string& symbol,
                        Side side,
                        OrderType type,
                        Price price,
                        Quantity quantity,
-                       Price stopPrice = 0);
+                       Price stopPrice = 0,
+                       TimeInForce timeInForce = TimeInForce::GTC,
+                       uint64_t expireTime = 0);
+
+    // Submit under a client order id drawn with reserveClientOrderId(), for
+    // callers that must know the id before the reply can arrive
+    OrderId reserveClientOrderId() { return nextClientOrderId_++; }
+    bool submitOrder(OrderId clientOrderId,
+                     const std::string& symbol,
+                     Side side,
+                     OrderType type,
+                     Price price,
+                     Quantity quantity,
+                     Price stopPrice = 0,
+                     TimeInForce timeInForce = TimeInForce::GTC,
+                     uint64_t expireTime = 0);
     
     bool cancelOrder(OrderId orderId);
     bool modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity);
 
+    // Modify whose ORDER_ACK carries the returned reference as its client
+    // order id (protocol v2); 0 if nothing was sent
+    OrderId replaceOrder(OrderId orderId, Price newPrice, Quantity newQuantity);
+
+    // Batches of up to ProtocolV2::MAX_BATCH members and mass cancel need
+    // protocol v2. Each returns the request's reference, echoed in the one
+    // BATCH_ACK / MASS_CANCEL_ACK that answers it, or 0 if nothing was sent.
+    OrderId submitOrderBatch(const std::string& symbol,
+                             const std::vector<ProtocolV2::NewOrderBatch::Entry>& orders);
+    OrderId cancelOrders(const std::vector<OrderId>& orderIds);
+    OrderId modifyOrders(const std::vector<ProtocolV2::ModifyBatch::Entry>& modifications);
+
+    // Cancel this client's orders - in symbol, unless it is "", and on one
+    // side, if given
+    OrderId massCancel(const std::string& symbol = "");
+    OrderId massCancel(const std::string& symbol, Side side);
+
+    // A pipeline for the calling thread to submit through, owned by the
+    // client and good for its lifetime. Once one is open, order acks,
+    // rejects and execution reports are queued for pollCompletions()
+    // instead of going to their callbacks.
+    OrderPipeline& openPipeline();
+
+    // Move the replies queued since the last call into completions (whose
+    // previous contents are dropped), waiting up to wait for the first;
+    // returns how many there are
+    size_t pollCompletions(std::vector<OrderCompletion>& completions,
+                           std::chrono::microseconds wait = std::chrono::microseconds(0));
+
+    // Pipelines flush once queued messages have waited this long (0 leaves
+    // it to flush() and full buffers), and once this many bytes are queued.
+    // Set before connect().
+    void setFlushInterval(std::chrono::microseconds interval) { flushInterval_ = interval; }
+    void setFlushBytes(size_t bytes) { flushBytes_ = bytes; }
+
+    // Replies that name only the server's order id resolve to the handle
+    // through the acks of the last this many orders; older ones come back
+    // with clientOrderId 0. The server reports nothing more about an order
+    // that rests and later fills, expires or is mass-cancelled, so this is
+    // what bounds the lookup. Set before connect().
+    void setTrackedOrderLimit(size_t limit) { trackedOrderLimit_ = limit; }
+
+    // Incremental L2 updates for symbol ("" for every symbol), delivered to
+    // the book update callback starting with the current levels
+    bool subscribeMarketData(const std::string& symbol = "");
+
     // Callbacks
     void setOrderAckCallback(OrderAckCallback callback) { orderAckCallback_ = callback; }
     void setOrderRejectCallback(OrderRejectCallback callback) { orderRejectCallback_ = callback; }
     void setExecutionReportCallback(ExecutionReportCallback callback) { executionReportCallback_ = callback; }
     void setMarketDataCallback(MarketDataCallback callback) { marketDataCallback_ = callback; }
+    void setBookUpdateCallback(BookUpdateCallback callback) { bookUpdateCallback_ = callback; }
+    void setBatchAckCallback(BatchAckCallback callback) { batchAckCallback_ = callback; }
+    void setMassCancelAckCallback(MassCancelAckCallback callback) { massCancelAckCallback_ = callback; }
 
-    // Client ID
+    // Client ID - sent at logon, so set it before connect()
     void setClientId(const std::string& clientId) { clientId_ = clientId; }
     const std::string& getClientId() const { return clientId_; }
 
+    // Highest wire protocol version to propose at logon (before connect()),
+    // and the version agreed for the current connection
+    void setProtocolVersion(uint8_t version) { preferredProtocolVersion_ = version; }
+    uint8_t getProtocolVersion() const { return protocolVersion_; }
+
+    // Print each order sent and reply received (default on)
+    void setVerbose(bool verbose) { verbose_ = verbose; }
+
+    // Socket backend and tuning, before connect(). In low-latency mode the
+    // receive thread's reads busy-poll (see LowLatencyOptions).
+    void setTransport(TransportType type, const LowLatencyOptions& options = LowLatencyOptions());
+
 private:
+    friend class OrderPipeline;
+
     std::string serverHost_;
     uint16_t serverPort_;
+    std::unique_ptr<Transport> transport_;
     SocketType socket_;
     std::atomic<bool> connected_;
     std::atomic<OrderId> nextClientOrderId_;
     std::string clientId_;
+    uint8_t preferredProtocolVersion_;
+    uint8_t protocolVersion_;
+    bool verbose_;
     
     std::thread receiveThread_;
+    FrameBuffer input_;  // Receive thread only, once connected
     
     // Callbacks
     OrderAckCallback orderAckCallback_;
     OrderRejectCallback orderRejectCallback_;
     ExecutionReportCallback executionReportCallback_;
     MarketDataCallback marketDataCallback_;
+    BookUpdateCallback bookUpdateCallback_;
+    BatchAckCallback batchAckCallback_;
+    MassCancelAckCallback massCancelAckCallback_;
     
     std::mutex sendMutex_;
 
+    // Pipelines and their flush timer
+    std::vector<std::unique_ptr<OrderPipeline>> pipelines_;
+    std::mutex pipelinesMutex_;
+    std::chrono::microseconds flushInterval_;
+    size_t flushBytes_;
+    std::thread flushThread_;
+    std::mutex flushMutex_;
+    std::condition_variable flushWake_;
+    bool flushStopping_ = false;
+
+    // Replies for pollCompletions(): gathered by the receive thread over
+    // each read, then handed over under the lock together
+    std::atomic<bool> queueCompletions_;
+    std::unordered_map<OrderId, OrderId> clientOrderIds_;  // Server id -> client id; receive thread only
+    std::deque<OrderId> trackedOrders_;                    // Their server ids, oldest ack first
+    size_t trackedOrderLimit_;
+    std::vector<OrderCompletion> arrived_;                 // Receive thread only
+    std::vector<OrderCompletion> completions_;
+    std::mutex completionsMutex_;
+    std::condition_variable completionsReady_;
+
     // Network operations
+    bool logon();
     void receiveMessages();
     bool sendMessage(const void* data, size_t length);
-    bool receiveMessage(void* buffer, size_t length);
+    void handleFrame(const Frame& frame);
+    void handleFrameV2(const Frame& frame);
+    void runFlushTimer();
+    void publishCompletions();
+    void addCompletion(OrderCompletion completion);
+    bool canSendBatch(size_t count, const char* what) const;
+    OrderId sendMassCancel(const std::string& symbol, uint8_t side);
+    template <typename Message>
+    OrderId sendBatch(Message& msg, const char* what);
+    
+    // Each message in the agreed protocol version, into out; the length
+    size_t encodeNewOrder(char* out, OrderId clientOrderId, const std::string& symbol, Side side,
+                          OrderType type, Price price, Quantity quantity, Price stopPrice,
+                          TimeInForce timeInForce, uint64_t expireTime) const;
+    size_t encodeCancel(char* out, OrderId orderId) const;
+    size_t encodeModify(char* out, OrderId orderId, Price newPrice, Quantity newQuantity) const;
     
     // Message handlers
-    void handleOrderAck(const OrderAckMessage& msg);
-    void handleOrderReject(const OrderRejectMessage& msg);
+    void handleOrderAck(const OrderAckMessage& msg, RejectReason reason = RejectReason::NONE);
+    void handleOrderReject(const OrderRejectMessage& msg, RejectReason reason = RejectReason::NONE);
     void handleExecutionReport(const ExecutionReportMessage& msg);
     void handleMarketData(const MarketDataMessage& msg);
+    void handleBookUpdate(const BookUpdateMessage& msg);
     
     void initializeSocket();
     void cleanupSocket();
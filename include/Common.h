@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <chrono>
@@ -10,8 +11,12 @@ namespace MatchingEngine {
 using OrderId = uint64_t;
 using Price = int64_t;  // Using fixed-point arithmetic (price * 10000 for 4 decimal places)
 using Quantity = uint64_t;
+using SymbolId = uint32_t;   // Interned symbol
+using ClientKey = uint32_t;  // Interned client id
 using Timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>;
 
+constexpr size_t CACHE_LINE_SIZE = 64;
+
 // Order side
 enum class Side {
     BUY,
@@ -28,6 +33,13 @@ enum class OrderType {
     FOK          // Fill or Kill - execute completely or cancel entirely
 };
 
+// How long an order that rests may stay in the book
+enum class TimeInForce : uint8_t {
+    GTC,  // Good till cancelled
+    DAY,  // Until the session close after it was entered (see ExpiryConfig)
+    GTD   // Good till date - until the time the order names
+};
+
 // Order status
 enum class OrderStatus {
     PENDING,
@@ -46,7 +58,36 @@ enum class MessageType {
     ORDER_REJECT,
     EXECUTION_REPORT,
     MARKET_DATA,
-    HEARTBEAT
+    HEARTBEAT,
+    LOGON,       // Opens a session and proposes a protocol version
+    LOGON_ACK,   // Protocol version the server will speak
+    MARKET_DATA_SUBSCRIBE,  // Start incremental L2 updates for a symbol
+    BOOK_UPDATE,            // One price level's new aggregate
+    NEW_ORDER_BATCH,        // Several orders in one symbol, acknowledged together (v2)
+    CANCEL_BATCH,           // Several cancels, acknowledged together (v2)
+    MODIFY_BATCH,           // Several cancel/replaces, acknowledged together (v2)
+    MASS_CANCEL,            // Every order of the session's client, by symbol and side (v2)
+    BATCH_ACK,              // One status per member of a batch (v2)
+    MASS_CANCEL_ACK,        // How many orders a mass cancel pulled (v2)
+    CANCEL_REPLACE,         // Modify acknowledged under the sender's reference (v2)
+    LINK_COMMAND,           // Gateway to engine node: one resolved command (v2, internal)
+    LINK_RESULT             // Engine node to gateway: what became of it (v2, internal)
+};
+
+// Why an order or request was refused - sent as a code instead of text
+enum class RejectReason : uint8_t {
+    NONE,
+    ORDER_NOT_FOUND,
+    MODIFY_REJECTED,
+    INVALID_MESSAGE,
+    // Refused by the pre-trade risk stage - see RiskCheck
+    RISK_ORDER_SIZE,
+    RISK_ORDER_NOTIONAL,
+    RISK_OPEN_NOTIONAL,
+    RISK_POSITION,
+    RISK_ORDER_RATE,
+    RISK_PRICE_BAND,
+    NODE_UNAVAILABLE  // A gateway's link to the owning engine node is down
 };
 
 // Constants
@@ -72,6 +113,15 @@ inline std::string orderTypeToString(OrderType type) {
     }
 }
 
+inline std::string timeInForceToString(TimeInForce timeInForce) {
+    switch (timeInForce) {
+        case TimeInForce::GTC: return "GTC";
+        case TimeInForce::DAY: return "DAY";
+        case TimeInForce::GTD: return "GTD";
+        default: return "UNKNOWN";
+    }
+}
+
 inline std::string orderStatusToString(OrderStatus status) {
     switch (status) {
         case OrderStatus::PENDING: return "PENDING";
@@ -83,11 +133,40 @@ inline std::string orderStatusToString(OrderStatus status) {
     }
 }
 
+inline std::string rejectReasonToString(RejectReason reason) {
+    switch (reason) {
+        case RejectReason::NONE: return "";
+        case RejectReason::ORDER_NOT_FOUND: return "Order not found";
+        case RejectReason::MODIFY_REJECTED: return "Failed to modify order";
+        case RejectReason::INVALID_MESSAGE: return "Invalid message";
+        case RejectReason::RISK_ORDER_SIZE: return "Order quantity over limit";
+        case RejectReason::RISK_ORDER_NOTIONAL: return "Order notional over limit";
+        case RejectReason::RISK_OPEN_NOTIONAL: return "Open notional over limit";
+        case RejectReason::RISK_POSITION: return "Position over limit";
+        case RejectReason::RISK_ORDER_RATE: return "Order rate over limit";
+        case RejectReason::RISK_PRICE_BAND: return "Price outside band";
+        case RejectReason::NODE_UNAVAILABLE: return "Engine node unavailable";
+        default: return "Rejected";
+    }
+}
+
 // Helper to get current timestamp
 inline Timestamp getCurrentTimestamp() {
     return std::chrono::high_resolution_clock::now();
 }
 
+// Timestamps as nanoseconds since the clock's epoch, for commands and the
+// journal. 0 stands for "not stamped".
+inline uint64_t timestampToNanos(Timestamp timestamp) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch()).count());
+}
+
+inline Timestamp nanosToTimestamp(uint64_t nanos) {
+    return Timestamp(std::chrono::duration_cast<Timestamp::duration>(
+        std::chrono::nanoseconds(nanos)));
+}
+
 // Convert price to readable format (divide by 10000)
 inline double priceToDouble(Price price) {
     return static_cast<double>(price) / 10000.0;
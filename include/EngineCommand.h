@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Common.h"
+#include <type_traits>
+
+namespace MatchingEngine {
+
+enum class CommandType : uint8_t {
+    NEW_ORDER,
+    CANCEL_ORDER,
+    MODIFY_ORDER,
+    MASS_CANCEL
+};
+
+// Which fields of a MASS_CANCEL narrow it; with none set it pulls every order
+enum MassCancelScope : uint8_t {
+    MASS_CANCEL_BY_SYMBOL = 1 << 0,  // symbolId
+    MASS_CANCEL_BY_SIDE = 1 << 1,    // side
+    MASS_CANCEL_BY_CLIENT = 1 << 2   // clientKey
+};
+
+// One engine input with ids already resolved. Fixed-size and trivially
+// copyable so it can be handed between threads by value.
+struct EngineCommand {
+    CommandType type = CommandType::NEW_ORDER;
+    Side side = Side::BUY;
+    OrderType orderType = OrderType::LIMIT;
+    uint8_t scope = 0;  // MASS_CANCEL: MassCancelScope bits
+    RejectReason reject = RejectReason::NONE;  // NEW_ORDER/MODIFY_ORDER: set if the risk stage refused it
+    TimeInForce timeInForce = TimeInForce::GTC;  // NEW_ORDER
+    SymbolId symbolId = 0;
+    ClientKey clientKey = 0;
+    // Members of a batch share sessionId and clientOrderId (the batch's
+    // reference) and are acknowledged together once all batchSize are done
+    uint16_t batchIndex = 0;
+    uint16_t batchSize = 0;  // 0 outside a batch
+    OrderId orderId = 0;    // Id to assign (NEW_ORDER) or to act on; MASS_CANCEL: shard
+    Price price = 0;
+    Quantity quantity = 0;  // MASS_CANCEL: set to the orders cancelled once applied
+    Price stopPrice = 0;
+    uint64_t expireTime = 0;    // NEW_ORDER, GTD: when it lapses (see timestampToNanos)
+    uint64_t sessionId = 0;     // Originator, echoed back with the result
+    OrderId clientOrderId = 0;  // Originator's reference, echoed back with the result
+    uint64_t receivedAt = 0;    // readTsc() when decoded, 0 if untimed; not journaled
+    // Sequencer time (see timestampToNanos), stamped once when the engine
+    // records the command. The order and its trades carry it, so replaying
+    // the same commands reproduces them exactly.
+    uint64_t timestamp = 0;
+
+    static EngineCommand newOrder(OrderId orderId, SymbolId symbolId, Side side, OrderType type,
+                                  Price price, Quantity quantity, ClientKey clientKey = 0,
+                                  Price stopPrice = 0) {
+        EngineCommand command;
+        command.type = CommandType::NEW_ORDER;
+        command.side = side;
+        command.orderType = type;
+        command.symbolId = symbolId;
+        command.clientKey = clientKey;
+        command.orderId = orderId;
+        command.price = price;
+        command.quantity = quantity;
+        command.stopPrice = stopPrice;
+        return command;
+    }
+
+    static EngineCommand cancel(OrderId orderId) {
+        EngineCommand command;
+        command.type = CommandType::CANCEL_ORDER;
+        command.orderId = orderId;
+        return command;
+    }
+
+    static EngineCommand modify(OrderId orderId, Price newPrice, Quantity newQuantity) {
+        EngineCommand command;
+        command.type = CommandType::MODIFY_ORDER;
+        command.orderId = orderId;
+        command.price = newPrice;
+        command.quantity = newQuantity;
+        return command;
+    }
+
+    // Unset filters (see MassCancelScope) match every order
+    static EngineCommand massCancel(uint8_t scope, SymbolId symbolId = 0, Side side = Side::BUY,
+                                    ClientKey clientKey = 0) {
+        EngineCommand command;
+        command.type = CommandType::MASS_CANCEL;
+        command.scope = scope;
+        command.symbolId = symbolId;
+        command.side = side;
+        command.clientKey = clientKey;
+        return command;
+    }
+
+    bool inBatch() const { return batchSize != 0; }
+};
+
+static_assert(std::is_trivially_copyable<EngineCommand>::value,
+              "EngineCommand is passed through rings by value");
+
+} // namespace MatchingEngine
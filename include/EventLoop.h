@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+namespace MatchingEngine {
+
+// Readiness bits reported by a Poller
+constexpr uint32_t IO_READ = 1;
+constexpr uint32_t IO_WRITE = 2;
+constexpr uint32_t IO_CLOSED = 4;  // Hang-up or error - the fd should be dropped
+
+struct IoReady {
+    int fd;
+    uint32_t events;
+};
+
+enum class PollerType {
+    EPOLL,
+    IO_URING  // Poll requests through an io_uring; needs liburing at build time
+};
+
+// Level-triggered readiness poller over non-blocking fds. One poller is
+// driven by one thread; only wake() may be called from elsewhere.
+class Poller {
+public:
+    virtual ~Poller() = default;
+
+    virtual bool add(int fd, uint32_t events) = 0;
+    virtual bool modify(int fd, uint32_t events) = 0;
+    virtual void remove(int fd) = 0;
+
+    // Block up to timeoutMs (-1 = forever) and fill ready; returns the count
+    // (0 on timeout or wakeup). Wakeups are consumed internally.
+    virtual int wait(IoReady* ready, int maxEvents, int timeoutMs) = 0;
+
+    // Interrupt a wait() in progress from any thread
+    virtual void wake() = 0;
+
+    // nullptr if the backend isn't available on this build or kernel
+    static std::unique_ptr<Poller> create(PollerType type);
+};
+
+// Put a socket into non-blocking mode
+bool setNonBlocking(int fd);
+
+} // namespace MatchingEngine
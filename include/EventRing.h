@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Common.h"
+#include "RingBuffer.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace MatchingEngine {
+
+class Order;
+class Trade;
+
+enum class EventType : uint8_t {
+    TRADE,
+    ORDER,  // Order state at the end of matching a new order
+    LEVEL   // New aggregate of one price level; quantity 0 removes it
+};
+
+// Fixed-size engine output event. Symbols and clients travel as interned
+// ids; consumers resolve names only when they actually need them.
+struct EngineEvent {
+    EventType type;
+    uint8_t side;       // ORDER, LEVEL: Side
+    uint8_t orderType;  // ORDER: OrderType
+    uint8_t status;     // ORDER: OrderStatus
+    SymbolId symbolId;
+    OrderId orderId;       // TRADE: buy order
+    OrderId otherOrderId;  // TRADE: sell order
+    Price price;
+    Quantity quantity;     // TRADE: fill size; ORDER: original size; LEVEL: total
+    Quantity remaining;    // ORDER only
+    ClientKey clientKey;   // ORDER only
+    uint32_t orderCount;   // LEVEL only
+    Timestamp timestamp;
+
+    static EngineEvent fromTrade(const Trade& trade);
+    static EngineEvent fromOrder(const Order& order);
+    static EngineEvent levelUpdate(SymbolId symbolId, Side side, Price price,
+                                   Quantity quantity, uint32_t orderCount);
+
+    std::string toString() const;
+};
+
+static_assert(std::is_trivially_copyable<EngineEvent>::value, "events are copied through the ring");
+
+// Batch of events handed to a consumer; valid only during the call
+using EventHandler = std::function<void(const EngineEvent* events, size_t count)>;
+
+// Broadcast ring between the engine and its downstream consumers (logging,
+// drop copy, market data, risk). Any number of engine threads publish;
+// every consumer sees every event in publish order on its own thread, in
+// batches. Publishers claim slots with one fetch_add and only wait when the
+// slowest consumer is a full ring behind.
+class EventRing {
+public:
+    explicit EventRing(size_t capacity = 65536, size_t batchSize = 256);
+    ~EventRing();
+
+    EventRing(const EventRing&) = delete;
+    EventRing& operator=(const EventRing&) = delete;
+
+    // Register before start()
+    void addConsumer(EventHandler handler);
+
+    // Events are only accepted while running. stop() returns once every
+    // consumer has seen everything published before it.
+    void start();
+    void stop();
+    bool isRunning() const { return running_; }
+
+    void publish(const EngineEvent& event);
+
+    uint64_t getPublished() const { return claimed_.load(std::memory_order_acquire); }
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Cell {
+        std::atomic<uint64_t> sequence;  // position + 1 once the event has landed
+        EngineEvent event;
+    };
+
+    struct Consumer {
+        EventHandler handler;
+        std::thread thread;
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> cursor{0};  // Next position to read
+        std::atomic<bool> finished{false};  // No longer gates publishers
+    };
+
+    const size_t capacity_;
+    const size_t mask_;
+    const size_t batchSize_;
+    std::unique_ptr<Cell[]> cells_;
+    std::vector<std::unique_ptr<Consumer>> consumers_;
+    std::atomic<bool> running_;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> claimed_{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> gate_{0};  // Cached slowest cursor
+
+    void runConsumer(Consumer& consumer);
+    size_t consume(Consumer& consumer, std::vector<EngineEvent>& batch);
+    uint64_t slowestCursor() const;
+};
+
+} // namespace MatchingEngine
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Common.h"
+#include "ProtocolV2.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MatchingEngine {
+
+// Datagram layout of the UDP market data feed. Every datagram is one packet,
+// little-endian like ProtocolV2:
+//
+//   uint8  kind        INCREMENTAL or SNAPSHOT
+//   uint8  flags       0
+//   uint16 entries     level entries that follow
+//   uint64 sequence    incremental: this packet's number, 1, 2, 3...
+//                      snapshot: last incremental packet the image includes
+//   uint16 part        snapshot: index of this packet in its cycle
+//   uint16 parts       snapshot: packets in the cycle (incremental: 0 of 1)
+//
+// followed by the entries, each the new aggregate at one price level of one
+// symbol (quantity 0 removes the level):
+//
+//   char[16] symbol  uint8 side  int64 price  uint64 quantity  uint32 orders
+//
+// Incremental packets go out on one channel as levels change; the snapshot
+// channel repeats the whole book image on a timer. A receiver that misses an
+// incremental packet waits for the next complete snapshot cycle and resumes
+// from the incremental packet after its sequence.
+namespace FeedProtocol {
+
+enum class PacketKind : uint8_t {
+    INCREMENTAL = 1,
+    SNAPSHOT = 2
+};
+
+constexpr size_t HEADER_SIZE = 1 + 1 + 2 + 8 + 2 + 2;
+constexpr size_t ENTRY_SIZE = ProtocolV2::SYMBOL_SIZE + 1 + 8 + 8 + 4;
+// Fits an Ethernet MTU with room for IP/UDP headers, so nothing fragments
+constexpr size_t MAX_PACKET_SIZE = 1400;
+constexpr size_t MAX_ENTRIES = (MAX_PACKET_SIZE - HEADER_SIZE) / ENTRY_SIZE;
+
+struct PacketHeader {
+    PacketKind kind = PacketKind::INCREMENTAL;
+    uint16_t entries = 0;
+    uint64_t sequence = 0;
+    uint16_t part = 0;
+    uint16_t parts = 1;
+};
+
+struct Entry {
+    char symbol[ProtocolV2::SYMBOL_SIZE] = {};
+    Side side = Side::BUY;
+    Price price = 0;
+    Quantity quantity = 0;
+    uint32_t orderCount = 0;
+};
+
+inline size_t packetSize(size_t entries) {
+    return HEADER_SIZE + entries * ENTRY_SIZE;
+}
+
+// Writes header and entries to out, which must hold packetSize(count)
+inline size_t encode(char* out, const PacketHeader& header, const Entry* entries, size_t count) {
+    ProtocolV2::Writer writer(out);
+    writer.u8(static_cast<uint8_t>(header.kind));
+    writer.u8(0);
+    writer.u16(static_cast<uint16_t>(count));
+    writer.u64(header.sequence);
+    writer.u16(header.part);
+    writer.u16(header.parts);
+    for (size_t i = 0; i < count; ++i) {
+        writer.bytes(entries[i].symbol, ProtocolV2::SYMBOL_SIZE);
+        writer.u8(static_cast<uint8_t>(entries[i].side));
+        writer.i64(entries[i].price);
+        writer.u64(entries[i].quantity);
+        writer.u32(entries[i].orderCount);
+    }
+    return writer.size();
+}
+
+// Validates sizes and fields; entries is replaced with the packet's
+inline bool decode(const char* data, size_t length, PacketHeader& header,
+                   std::vector<Entry>& entries) {
+    if (length < HEADER_SIZE) {
+        return false;
+    }
+    ProtocolV2::Reader reader(data);
+    uint8_t kind = reader.u8();
+    reader.u8();
+    header.entries = reader.u16();
+    header.sequence = reader.u64();
+    header.part = reader.u16();
+    header.parts = reader.u16();
+    if ((kind != static_cast<uint8_t>(PacketKind::INCREMENTAL) &&
+         kind != static_cast<uint8_t>(PacketKind::SNAPSHOT)) ||
+        length != packetSize(header.entries) || header.part >= header.parts) {
+        return false;
+    }
+    header.kind = static_cast<PacketKind>(kind);
+
+    entries.resize(header.entries);
+    for (Entry& entry : entries) {
+        reader.bytes(entry.symbol, ProtocolV2::SYMBOL_SIZE);
+        uint8_t side = reader.u8();
+        if (side > static_cast<uint8_t>(Side::SELL)) {
+            return false;
+        }
+        entry.side = static_cast<Side>(side);
+        entry.price = reader.i64();
+        entry.quantity = reader.u64();
+        entry.orderCount = reader.u32();
+    }
+    return true;
+}
+
+} // namespace FeedProtocol
+
+// Where the two feed channels go. Multicast groups normally - every receiver
+// on the network then costs the publisher nothing - but unicast addresses
+// work too, for one receiver or for tests on loopback.
+struct FeedConfig {
+    std::string incrementalAddress = "239.255.0.1";
+    uint16_t incrementalPort = 15000;  // Receiver: 0 picks a free port
+    std::string snapshotAddress = "239.255.0.2";
+    uint16_t snapshotPort = 15001;
+    std::string interfaceAddress;      // Local interface for multicast; empty for the default
+    uint8_t ttl = 1;                   // Multicast hops; 1 keeps the feed on the local subnet
+    uint32_t snapshotIntervalMs = 1000;
+};
+
+} // namespace MatchingEngine
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Common.h"
+#include "EventRing.h"
+#include "FeedProtocol.h"
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketType;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int SocketType;
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define closesocket close
+#endif
+
+namespace MatchingEngine {
+
+// Sends the books' LEVEL events as a sequenced UDP feed (see FeedProtocol).
+// Each event batch from the ring becomes as few incremental packets as fit,
+// sent once however many receivers have joined the group. A second thread
+// multicasts the full book image on the snapshot channel every interval, so
+// receivers can join late or recover from a gap without asking for anything.
+class FeedPublisher {
+public:
+    // Registers as a consumer, so construct before events.start()
+    FeedPublisher(EventRing& events, const FeedConfig& config);
+    ~FeedPublisher();
+
+    FeedPublisher(const FeedPublisher&) = delete;
+    FeedPublisher& operator=(const FeedPublisher&) = delete;
+
+    // Opens the socket and starts the snapshot cycle. Call before the ring
+    // starts; until then level changes only update the image.
+    bool start();
+    void stop();
+
+    // Last incremental sequence number sent
+    uint64_t getSequence() const;
+    uint64_t getSnapshotCycles() const { return snapshotCycles_; }
+
+private:
+    struct Level {
+        Quantity quantity;
+        uint32_t orderCount;
+    };
+    struct Book {
+        std::map<Price, Level, std::greater<Price>> bids;
+        std::map<Price, Level> asks;
+    };
+
+    FeedConfig config_;
+    SocketType socket_;
+    sockaddr_in incrementalAddr_;
+    sockaddr_in snapshotAddr_;
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> snapshotCycles_;
+
+    // Image and sequence change together, so a snapshot names exactly the
+    // incremental packets it includes
+    mutable std::mutex mutex_;
+    std::unordered_map<SymbolId, Book> books_;
+    uint64_t sequence_;
+
+    // Ring consumer thread only
+    std::vector<FeedProtocol::Entry> entries_;
+    std::vector<char> packets_;
+    std::vector<size_t> packetSizes_;
+
+    std::thread snapshotThread_;
+    std::mutex stopMutex_;
+    std::condition_variable stopSignal_;
+
+    void onEvents(const EngineEvent* events, size_t count);
+    void runSnapshots();
+    void sendSnapshot();
+    void send(const sockaddr_in& address, const char* data, size_t length);
+};
+
+} // namespace MatchingEngine
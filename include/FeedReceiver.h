@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Common.h"
+#include "FeedProtocol.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketType;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int SocketType;
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define closesocket close
+#endif
+
+namespace MatchingEngine {
+
+// Builds a local replica of every book from the UDP market data feed.
+//
+// The replica starts unsynced and waits for a complete snapshot cycle, then
+// applies incremental packets in sequence. A missing packet marks it
+// unsynced again: later packets are held back until the next snapshot that
+// covers the gap, after which they are replayed and the replica resumes.
+class FeedReceiver {
+public:
+    struct Level {
+        Price price;
+        Quantity quantity;
+        uint32_t orderCount;
+    };
+
+    explicit FeedReceiver(const FeedConfig& config);
+    ~FeedReceiver();
+
+    FeedReceiver(const FeedReceiver&) = delete;
+    FeedReceiver& operator=(const FeedReceiver&) = delete;
+
+    // Binds both channels, joining them if they are multicast groups, and
+    // starts the receive thread
+    bool start();
+    void stop();
+
+    // Ports actually bound; a config port of 0 picks a free one
+    uint16_t getIncrementalPort() const { return incrementalPort_; }
+    uint16_t getSnapshotPort() const { return snapshotPort_; }
+
+    // Applies one datagram from either channel - what the receive thread does
+    // with everything it reads
+    void onPacket(const char* data, size_t length);
+
+    // True while the replica matches the feed as of getSequence()
+    bool isSynced() const;
+    uint64_t getSequence() const;
+    uint64_t getGaps() const;
+
+    // Replica levels, best first
+    std::vector<Level> getDepth(const std::string& symbol, Side side, size_t levels = 10) const;
+
+private:
+    struct Book {
+        std::map<Price, Level, std::greater<Price>> bids;
+        std::map<Price, Level> asks;
+    };
+    using Books = std::unordered_map<std::string, Book>;
+
+    FeedConfig config_;
+    SocketType incrementalSocket_;
+    SocketType snapshotSocket_;
+    uint16_t incrementalPort_;
+    uint16_t snapshotPort_;
+    std::atomic<bool> running_;
+    std::thread receiveThread_;
+
+    mutable std::mutex mutex_;
+    Books books_;
+    bool synced_;
+    uint64_t sequence_;  // Last incremental packet applied
+    uint64_t gaps_;
+
+    // Recovery: incremental packets past the gap, and the snapshot cycle
+    // being collected
+    std::map<uint64_t, std::vector<FeedProtocol::Entry>> pending_;
+    Books image_;
+    uint64_t imageSequence_;
+    uint16_t imageNextPart_;  // 0 when no cycle is being collected
+
+    std::vector<FeedProtocol::Entry> entries_;  // Decode scratch, under mutex_
+
+    bool openChannel(const std::string& host, uint16_t port, SocketType& out, uint16_t& bound);
+    void receiveLoop();
+    void onIncremental(uint64_t sequence, std::vector<FeedProtocol::Entry>& entries);
+    void onSnapshot(const FeedProtocol::PacketHeader& header,
+                    const std::vector<FeedProtocol::Entry>& entries);
+    void drainPending();
+    static void apply(Books& books, const FeedProtocol::Entry& entry);
+};
+
+} // namespace MatchingEngine
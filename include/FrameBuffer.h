@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Common.h"
+#include "Message.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace MatchingEngine {
+
+// One complete message inside a FrameBuffer. data points at the header and
+// stays valid until the buffer is next written to.
+struct Frame {
+    MessageType type;
+    uint32_t length;
+    const char* data;
+    uint8_t version;  // Protocol version the frame was read under
+};
+
+// Receive buffer that frames messages in place. The socket reads straight
+// into the free space after the unconsumed bytes, and complete frames are
+// handed out as pointers into the buffer, so a burst of pipelined messages
+// costs one recv and no copies. Only a trailing partial frame is ever
+// moved, back to the front when space runs low.
+class FrameBuffer {
+public:
+    explicit FrameBuffer(size_t capacity = 64 * 1024);
+
+    // Free space for the next read; compacts first if the tail is short, so
+    // call it before writable()
+    char* writePtr();
+    size_t writable() const { return capacity_ - writePos_; }
+    void commit(size_t bytes) { writePos_ += bytes; }
+
+    // Next complete frame, if one is buffered. Returns false when more bytes
+    // are needed or the stream is malformed (see malformed()).
+    bool nextFrame(Frame& frame);
+    bool malformed() const { return malformed_; }
+
+    // Header layout for frames not yet read: 1 = MessageHeader,
+    // 2 = the packed ProtocolV2 header
+    void setProtocolVersion(uint8_t version) { version_ = version; }
+    uint8_t getProtocolVersion() const { return version_; }
+
+    size_t buffered() const { return writePos_ - readPos_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    size_t capacity_;
+    std::unique_ptr<uint64_t[]> storage_;  // uint64_t keeps frame starts 8-byte aligned
+    size_t readPos_;
+    size_t writePos_;
+    bool malformed_;
+    uint8_t version_;
+
+    char* data() { return reinterpret_cast<char*>(storage_.get()); }
+};
+
+// Storage for a copy of T when a frame can't be viewed in place
+template<typename T>
+struct MessageScratch {
+    alignas(T) char bytes[sizeof(T)];
+};
+
+// View a frame as message T - in place when aligned, otherwise via a copy
+// into scratch. nullptr if the frame isn't exactly a T.
+template<typename T>
+const T* viewMessage(const Frame& frame, MessageScratch<T>& scratch) {
+    if (frame.length != sizeof(T)) {
+        return nullptr;
+    }
+    if (reinterpret_cast<uintptr_t>(frame.data) % alignof(T) == 0) {
+        return reinterpret_cast<const T*>(frame.data);
+    }
+    std::memcpy(scratch.bytes, frame.data, sizeof(T));
+    return reinterpret_cast<const T*>(scratch.bytes);
+}
+
+// As viewMessage, but also takes the older, shorter form of T that ends at
+// shortSize; the fields past it read as zero
+template<typename T>
+const T* viewMessage(const Frame& frame, MessageScratch<T>& scratch, size_t shortSize) {
+    if (frame.length != shortSize) {
+        return viewMessage(frame, scratch);
+    }
+    std::memset(scratch.bytes, 0, sizeof(T));
+    std::memcpy(scratch.bytes, frame.data, shortSize);
+    return reinterpret_cast<const T*>(scratch.bytes);
+}
+
+} // namespace MatchingEngine
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Common.h"
+#include "EngineCommand.h"
+#include "FrameBuffer.h"
+#include "ShardedEngine.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketType;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int SocketType;
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define closesocket close
+#endif
+
+namespace MatchingEngine {
+
+// An engine node: a matching_server in an event loop mode, started with
+// its position in the gateway's node list as its node id
+struct GatewayNode {
+    std::string host = "127.0.0.1";
+    uint16_t port = SERVER_PORT;
+};
+
+struct GatewayConfig {
+    std::vector<GatewayNode> nodes;
+    SymbolHash symbolHash;  // Defaults to std::hash<std::string>
+};
+
+// Scales matching out past one process. Symbols are partitioned across
+// engine nodes the way ShardedEngine partitions them across shards, and the
+// gateway forwards each command to the node that owns it over one
+// persistent link per node. New orders go by symbol, cancels and modifies
+// by the node id in the top bits of the order id, so the gateway keeps no
+// order state. Commands queued while a link is writing go out together in
+// its next send.
+//
+// Stands in for ShardedEngine behind the server's event loops: submit()
+// returns once the command is queued on the link, and the callback fires on
+// the link's reader thread with the original command, its assigned id and
+// the node's result - as if a local shard had applied it.
+class Gateway {
+public:
+    explicit Gateway(const GatewayConfig& config);
+    ~Gateway();
+
+    Gateway(const Gateway&) = delete;
+    Gateway& operator=(const Gateway&) = delete;
+
+    // Connect and log on to every node; false (and nothing left running) if
+    // any of them can't be reached
+    bool start();
+    void stop();  // Results still outstanding are dropped
+    bool isRunning() const { return running_; }
+
+    // Forward a resolved command; false, with command.reject set, if its
+    // node is unknown or its link is down. A MASS_CANCEL without
+    // MASS_CANCEL_BY_SYMBOL goes to every node as a batch of getNodeCount()
+    // members, each reporting what it pulled in quantity.
+    bool submit(EngineCommand& command);
+
+    // Forward a batch's members one by one. A member that can't be forwarded
+    // is failed through the callback straight away, so the batch still
+    // completes; returns false if any was.
+    bool submitBatch(EngineCommand* commands, size_t count);
+
+    void setCommandCallback(CommandCallback callback) { commandCallback_ = std::move(callback); }
+
+    // Routing
+    size_t nodeFor(const std::string& symbol) const;
+    static size_t nodeOf(OrderId orderId) { return ShardedEngine::nodeOf(orderId); }
+    size_t getNodeCount() const { return links_.size(); }
+
+    // New orders the nodes accepted
+    size_t getTotalOrders() const { return totalOrders_; }
+
+private:
+    // One node's connection. Producers append encoded commands to output
+    // and register them in pending; the writer thread sends output, the
+    // reader thread matches results to pending by tag.
+    struct Link {
+        size_t index = 0;
+        GatewayNode node;
+        SocketType socket = INVALID_SOCKET;
+        FrameBuffer input;
+        std::thread writer;
+        std::thread reader;
+        std::atomic<bool> up{false};
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<char> output;
+        std::unordered_map<uint64_t, EngineCommand> pending;
+    };
+
+    GatewayConfig config_;
+    std::vector<std::unique_ptr<Link>> links_;
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> nextTag_;
+    std::atomic<size_t> totalOrders_;
+    CommandCallback commandCallback_;
+
+    bool connect(Link& link);
+    Link* route(const EngineCommand& command) const;
+    bool forward(Link& link, const EngineCommand& command);
+    void runWriter(Link& link);
+    void runReader(Link& link);
+    void complete(Link& link, const Frame& frame);
+    void fail(Link& link);
+};
+
+} // namespace MatchingEngine
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Common.h"
+#include "OrderBook.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace MatchingEngine {
+
+// What one row of an order file does
+enum class OrderAction : uint8_t {
+    NEW,
+    CANCEL,
+    MODIFY  // price and quantity are the new ones
+};
+
+// Historical order flow on disk, one column per field so a pass reads only
+// the fields it needs. The file is a 64-byte header, symbolCount 16-byte
+// names, then the columns below in order, each starting on a 64-byte
+// boundary. Every row names its symbol - cancels and modifies too - so rows
+// partition by symbol without resolving order ids, and rows are in time
+// order within each symbol.
+struct OrderFileHeader {
+    static constexpr char MAGIC[8] = {'M', 'E', 'O', 'R', 'D', 'E', 'R', 'S'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t SYMBOL_SIZE = 16;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t symbolCount;
+    uint64_t rowCount;
+    uint8_t reserved[40];
+};
+
+static_assert(sizeof(OrderFileHeader) == 64, "OrderFileHeader is a fixed on-disk layout");
+
+// Pointers into a mapped order file, rowCount entries each
+struct OrderColumns {
+    const uint64_t* timestamp = nullptr;  // Nanoseconds (see timestampToNanos); never 0
+    const OrderId* orderId = nullptr;
+    const Price* price = nullptr;
+    const Quantity* quantity = nullptr;
+    const Price* stopPrice = nullptr;
+    const uint32_t* symbol = nullptr;     // Index into the symbol table
+    const uint8_t* action = nullptr;      // OrderAction
+    const uint8_t* side = nullptr;        // Side
+    const uint8_t* orderType = nullptr;   // OrderType
+};
+
+// Read-only memory mapping of an order file
+class OrderFile {
+public:
+    OrderFile() = default;
+    ~OrderFile();
+
+    OrderFile(const OrderFile&) = delete;
+    OrderFile& operator=(const OrderFile&) = delete;
+
+    // Map path and check its header and size; error says why not
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    size_t rows() const { return rows_; }
+    const std::vector<std::string>& symbols() const { return symbols_; }
+    const OrderColumns& columns() const { return columns_; }
+
+private:
+    void* mapping_ = nullptr;
+    size_t mappedBytes_ = 0;
+    size_t rows_ = 0;
+    std::vector<std::string> symbols_;
+    OrderColumns columns_;
+};
+
+// Builds an order file in memory, e.g. from a journal or a vendor feed
+class OrderFileWriter {
+public:
+    void addOrder(uint64_t timestamp, const std::string& symbol, OrderId orderId, Side side,
+                  OrderType type, Price price, Quantity quantity, Price stopPrice = 0);
+    void addCancel(uint64_t timestamp, const std::string& symbol, OrderId orderId);
+    void addModify(uint64_t timestamp, const std::string& symbol, OrderId orderId,
+                   Price newPrice, Quantity newQuantity);
+
+    size_t rows() const { return timestamp_.size(); }
+    bool write(const std::string& path, std::string& error) const;
+
+private:
+    void addRow(uint64_t timestamp, const std::string& symbol, OrderAction action,
+                OrderId orderId, Side side, OrderType type, Price price, Quantity quantity,
+                Price stopPrice);
+
+    std::vector<std::string> symbols_;
+    std::unordered_map<std::string, uint32_t> symbolIndex_;
+    std::vector<uint64_t> timestamp_;
+    std::vector<OrderId> orderId_;
+    std::vector<Price> price_;
+    std::vector<Quantity> quantity_;
+    std::vector<Price> stopPrice_;
+    std::vector<uint32_t> symbol_;
+    std::vector<uint8_t> action_;
+    std::vector<uint8_t> side_;
+    std::vector<uint8_t> orderType_;
+};
+
+// One trade of a replay. A fill file is a FillFileHeader, the replayed
+// file's symbol table, then the fills: grouped by symbol in symbol table
+// order and in trade order within each.
+struct FillRecord {
+    uint64_t timestamp;  // Of the order that traded on arrival
+    OrderId buyOrderId;
+    OrderId sellOrderId;
+    Price price;
+    Quantity quantity;
+    uint32_t symbol;  // Index into the symbol table
+    uint32_t reserved;
+};
+
+static_assert(sizeof(FillRecord) == 48, "FillRecord is a fixed on-disk layout");
+
+struct FillFileHeader {
+    static constexpr char MAGIC[8] = {'M', 'E', 'F', 'I', 'L', 'L', 'S', '\0'};
+    static constexpr uint32_t VERSION = 1;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t symbolCount;
+    uint64_t fillCount;
+    uint8_t reserved[40];
+};
+
+static_assert(sizeof(FillFileHeader) == 64, "FillFileHeader is a fixed on-disk layout");
+
+// Read a whole fill file back
+bool readFillFile(const std::string& path, std::vector<std::string>& symbols,
+                  std::vector<FillRecord>& fills, std::string& error);
+
+struct ReplayConfig {
+    size_t threads = 0;          // 0 = one per hardware thread
+    OrderBookConfig bookConfig;  // For every book; each is driven by one thread only
+};
+
+struct ReplayReport {
+    uint64_t orders = 0;
+    uint64_t cancels = 0;
+    uint64_t modifies = 0;
+    uint64_t unmatched = 0;  // Cancels and modifies of orders no longer in the book
+    uint64_t fills = 0;
+    size_t partitions = 0;   // Symbols with any rows
+    size_t threads = 0;
+    double seconds = 0;
+};
+
+// Backtests recorded flow through the production matching logic. Rows are
+// partitioned by symbol and each partition is replayed, start to finish,
+// into its own unsynchronized engine and books, with the file's timestamps
+// in place of the clock - so a replay is deterministic whatever the thread
+// count. Partitions go to a work-stealing pool, largest first; a worker
+// that runs out takes from the back of another's queue.
+class HistoricalReplay {
+public:
+    explicit HistoricalReplay(const ReplayConfig& config = ReplayConfig());
+
+    // Replay every row of input and write its fills to fillPath
+    bool run(const OrderFile& input, const std::string& fillPath, ReplayReport& report,
+             std::string& error);
+
+    const ReplayConfig& getConfig() const { return config_; }
+
+private:
+    ReplayConfig config_;
+};
+
+} // namespace MatchingEngine
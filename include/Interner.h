@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Common.h"
+#include <cstring>
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <shared_mutex>
+
+namespace MatchingEngine {
+
+// Maps strings to dense integer ids. Ids are never reused and names stay
+// at a stable address, so orders can carry 4-byte ids instead of strings.
+class StringInterner {
+public:
+    StringInterner();
+
+    // Id for name, assigning the next one on first sight
+    uint32_t intern(const std::string& name);
+
+    // Id for name if it has been interned, else 0 - queries don't grow the table
+    uint32_t find(const std::string& name) const;
+
+    // Name for a previously interned id
+    const std::string& name(uint32_t id) const;
+
+    size_t size() const;
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, uint32_t> ids_;
+    std::deque<std::string> names_;
+};
+
+// Process-wide tables shared by every engine instance. Id 0 is the empty
+// string in both.
+StringInterner& symbolInterner();
+StringInterner& clientInterner();
+
+// Resolves the fixed 16-byte symbol field of a wire message straight to its
+// SymbolId, keyed on the raw bytes so decoding an order builds no string.
+// Symbols are interned on first sight (or up front by load()), after which
+// a lookup hashes two words.
+class SymbolDirectory {
+public:
+    static constexpr size_t WIDTH = 16;
+
+    SymbolId lookup(const char (&symbol)[WIDTH]);
+
+    // Registers reference data ahead of the first order for each symbol
+    SymbolId load(const std::string& symbol);
+
+    size_t size() const;
+
+private:
+    struct Key {
+        uint64_t words[2];
+        bool operator==(const Key& other) const {
+            return words[0] == other.words[0] && words[1] == other.words[1];
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            uint64_t h = (key.words[0] ^ (key.words[1] * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+            return static_cast<size_t>(h ^ (h >> 32));
+        }
+    };
+
+    // Bytes after the name's terminator are zeroed, so padding a client
+    // left dirty still finds the same entry
+    static Key keyOf(const char* symbol, size_t length);
+    SymbolId insert(const Key& key, const std::string& name);
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<Key, SymbolId, KeyHash> ids_;
+};
+
+SymbolDirectory& symbolDirectory();
+
+} // namespace MatchingEngine
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Common.h"
+#include "EngineCommand.h"
+#include "RingBuffer.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace MatchingEngine {
+
+// When the journal writer forces appended records to disk. A server holds
+// each reply until every command journaled before it is durable, except
+// under ASYNC, where replies never wait for the disk.
+enum class FsyncPolicy {
+    PER_BATCH,  // After every batch drained from the queue (group commit)
+    INTERVAL,   // At most once per fsyncIntervalMicros
+    ASYNC       // Never explicitly; the kernel writes the mapping back
+};
+
+struct JournalConfig {
+    std::string directory;                      // Empty disables journaling
+    size_t segmentSize = 64 * 1024 * 1024;      // Pre-allocated per segment file
+    FsyncPolicy fsyncPolicy = FsyncPolicy::PER_BATCH;
+    uint32_t fsyncIntervalMicros = 1000;        // INTERVAL only
+    size_t queueCapacity = 16384;               // Records between engine and writer
+};
+
+// One journaled command as stored on disk. Names are stored instead of
+// interned ids, which only mean something inside one process.
+struct JournalRecord {
+    static constexpr size_t SYMBOL_SIZE = 16;
+    static constexpr size_t CLIENT_SIZE = 32;
+
+    uint64_t sequence;  // 0 marks the unused tail of a segment
+    uint32_t checksum;  // Over every byte after this field
+    uint8_t type;       // CommandType
+    uint8_t side;       // Side
+    uint8_t orderType;  // OrderType
+    uint8_t scope;      // MASS_CANCEL: MassCancelScope
+    OrderId orderId;
+    Price price;
+    Quantity quantity;
+    Price stopPrice;
+    char symbol[SYMBOL_SIZE];
+    char clientId[CLIENT_SIZE];
+    uint64_t timestamp;  // EngineCommand::timestamp; 0 in records from before it was kept
+    uint64_t expireTime;  // NEW_ORDER, GTD
+    uint8_t timeInForce;  // NEW_ORDER; 0 (GTC) in records from before it was kept
+    uint8_t padding[15];
+
+    // Unsequenced record; the writer stamps it in queue order
+    static JournalRecord fromCommand(const EngineCommand& command);
+    void stamp(uint64_t sequenceNumber) {
+        sequence = sequenceNumber;
+        checksum = computeChecksum();
+    }
+
+    // Command with names interned into this process; false if damaged
+    bool toCommand(EngineCommand& command) const;
+    uint32_t computeChecksum() const;
+};
+
+static_assert(sizeof(JournalRecord) == 128, "JournalRecord is a fixed on-disk layout");
+
+// Append-only journal of engine commands. append() only copies the command
+// into a lock-free queue; a dedicated writer thread drains it in batches
+// into memory-mapped, pre-allocated segment files and syncs each batch
+// with one msync according to the fsync policy, so one disk flush covers
+// every command queued meanwhile.
+class Journal {
+public:
+    explicit Journal(const JournalConfig& config);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Continue after the last record already in the directory - or after
+    // resumeAfter, if a snapshot went further - and start the writer
+    bool open(uint64_t resumeAfter = 0);
+    // Write out and sync everything appended, then stop the writer
+    void close();
+    bool isOpen() const { return running_; }
+    // A write or sync failed; nothing from then on is written or reported
+    // durable
+    bool hasFailed() const { return failed_; }
+
+    // Queue the command and return its sequence; blocks only while the
+    // queue is full. Sequences follow queue order, so they are gap-free and
+    // ascending on disk even with several appending threads.
+    uint64_t append(const EngineCommand& command);
+
+    // Highest sequence append() has handed out, last written to the
+    // mapping, and last known durable
+    uint64_t getAppendedSequence() const { return appendedSequence_; }
+    uint64_t getWrittenSequence() const { return writtenSequence_; }
+    uint64_t getDurableSequence() const { return durableSequence_; }
+
+    // Block until sequence is durable, or the journal closes or fails;
+    // true if it is durable
+    bool waitDurable(uint64_t sequence);
+
+    // Fired on the writer thread each time the durable sequence moves on,
+    // and once if the journal fails. Set before open().
+    using DurableCallback = std::function<void(uint64_t durableSequence)>;
+    void setDurableCallback(DurableCallback callback) { durableCallback_ = std::move(callback); }
+
+    // Delete segments holding nothing after throughSequence (e.g. once a
+    // snapshot covers them). The segment being written is always kept.
+    void truncate(uint64_t throughSequence);
+
+    // Read every intact record with a sequence above afterSequence, in file
+    // order. Returns false if the directory can't be read.
+    using RecordHandler = std::function<void(uint64_t sequence, const EngineCommand& command)>;
+    static bool read(const std::string& directory, uint64_t afterSequence,
+                     const RecordHandler& handler);
+
+    const JournalConfig& getConfig() const { return config_; }
+
+private:
+    JournalConfig config_;
+    MpscRing<JournalRecord> queue_;
+    std::thread writer_;
+    std::atomic<bool> running_;
+    std::atomic<bool> failed_;
+    uint64_t firstSequence_;  // Sequence of the record at queue position 0
+    std::atomic<uint64_t> appendedSequence_;
+    std::atomic<uint64_t> writtenSequence_;
+    std::atomic<uint64_t> durableSequence_;
+    DurableCallback durableCallback_;
+
+    std::mutex durableMutex_;
+    std::condition_variable durableChanged_;
+
+    // Writer thread only
+    int fd_;
+    char* mapping_;
+    size_t segmentRecords_;
+    size_t writeIndex_;
+    size_t syncedIndex_;
+    uint64_t popped_;  // Records taken off the queue over the journal's lifetime
+
+    void runWriter();
+    bool writeRecord(const JournalRecord& record);
+    bool openSegment(uint64_t firstSequence);
+    void closeSegment();
+    void sync(bool force);
+    void markDurable(uint64_t sequence);
+    void fail(const char* what, uint64_t sequence);
+};
+
+} // namespace MatchingEngine
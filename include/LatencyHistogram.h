@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MatchingEngine {
+
+// Fixed-memory latency histogram with HdrHistogram-style buckets: values
+// below 2^precisionBits are counted exactly, and each power-of-two range
+// above that is split into 2^(precisionBits-1) equal buckets, so a
+// percentile is reported to within 2^-(precisionBits-1) of the true value
+// (under 1% at the default 8 bits). Recording is a shift and an increment.
+// Units are whatever the caller records - nanoseconds, cycles.
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(unsigned precisionBits = 8);
+
+    void record(uint64_t value);
+    void record(uint64_t value, uint64_t count);  // count samples of value
+    void merge(const LatencyHistogram& other);  // Must share precisionBits
+    void reset();
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+    // Highest value in the bucket holding the sample at percentile
+    // (0-100], clamped to max(); 0 when empty
+    uint64_t percentile(double percentile) const;
+
+    // "count=... p50=... p99=... p99.9=... max=..." with unit appended to
+    // each value
+    std::string summary(const std::string& unit = "ns") const;
+
+    // Bucket layout at a precision, for counts kept outside a histogram
+    // (e.g. one thread's atomic counters) and folded into one later
+    static constexpr size_t bucketCount(unsigned precisionBits) {
+        return (size_t(1) << precisionBits) + (64 - precisionBits) * (size_t(1) << (precisionBits - 1));
+    }
+    static size_t bucketOf(uint64_t value, unsigned precisionBits);
+    static uint64_t highestIn(size_t bucket, unsigned precisionBits);
+
+private:
+    unsigned precisionBits_;
+    std::vector<uint64_t> counts_;
+    uint64_t count_;
+    uint64_t min_;
+    uint64_t max_;
+    uint64_t sum_;
+};
+
+} // namespace MatchingEngine
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Client.h"
+#include "LatencyHistogram.h"
+#include <chrono>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MatchingEngine {
+
+// Synthetic order flow, in percent of messages; the rest are limit orders
+struct FlowMix {
+    unsigned marketPercent = 5;
+    unsigned cancelPercent = 25;
+    unsigned modifyPercent = 10;
+};
+
+struct LoadConfig {
+    std::string host = "127.0.0.1";
+    uint16_t port = SERVER_PORT;
+    size_t connections = 4;
+    double ratePerConnection = 1000;  // Messages per second on each connection
+    double durationSeconds = 10;
+    double warmupSeconds = 1;         // Sent at full rate but not recorded
+    double drainSeconds = 2;          // Longest wait for replies after the last send
+    LowLatencyOptions lowLatency;     // For every connection's socket
+
+    // Synthetic flow. Limit prices sit up to priceLevels ticks behind mid on
+    // their own side, or one tick through it.
+    FlowMix mix;
+    size_t symbols = 8;
+    double symbolSkew = 1.0;  // Zipf exponent over the symbols; 0 is uniform
+    Price midPrice = doubleToPrice(100.0);
+    Price tickSize = doubleToPrice(0.01);
+    unsigned priceLevels = 5;
+    Quantity maxQuantity = 500;
+    uint32_t seed = 1;
+};
+
+// One message of a flow. target is the client order id a cancel or modify
+// refers to - in a replay file, the ordinal of the order line it names.
+struct FlowStep {
+    enum class Kind : uint8_t { NEW_ORDER, CANCEL, MODIFY };
+
+    Kind kind = Kind::NEW_ORDER;
+    uint32_t symbol = 0;  // Index into the flow's symbol table
+    Side side = Side::BUY;
+    OrderType type = OrderType::LIMIT;
+    Price price = 0;
+    Quantity quantity = 0;
+    OrderId target = 0;
+};
+
+// Recorded flow, replayed on every connection (from the start again when
+// it runs out) at the configured rate
+struct ReplayFlow {
+    std::vector<std::string> symbols;
+    std::vector<FlowStep> steps;
+    size_t orders = 0;  // NEW_ORDER steps, to number orders across passes
+
+    // The interactive client's commands, one per line: buy/sell <symbol>
+    // <qty> <price>, market-buy/market-sell <symbol> <qty>, cancel <n>,
+    // modify <n> <price> <qty>, where n counts the file's order lines from
+    // 1. Blank lines and # comments are skipped.
+    bool parse(std::istream& in, std::string& error);
+    bool load(const std::string& path, std::string& error);
+};
+
+// Latencies are wire-to-wire in nanoseconds, measured from when each
+// message was due to be sent rather than when it left. A stall that delays
+// sending therefore shows up in every message it held back, instead of
+// being hidden by a sender that waited for it (coordinated omission).
+struct LoadReport {
+    LatencyHistogram newOrderAck;  // Ack or reject of a new order
+    LatencyHistogram cancelAck;
+    LatencyHistogram modifyAck;
+    LatencyHistogram firstFill;    // First execution report of an order that traded on entry
+    LatencyHistogram sendLag;      // How late messages left against the schedule
+
+    uint64_t sent = 0;
+    uint64_t answered = 0;
+    uint64_t rejected = 0;    // New orders rejected, cancels/modifies that found nothing
+    uint64_t skipped = 0;     // Cancels/modifies with no live order to name
+    uint64_t unanswered = 0;  // Still outstanding when the drain ran out
+    size_t connected = 0;
+    double sendSeconds = 0;
+
+    void merge(const LoadReport& other);
+};
+
+// Open-loop load generator over N Client connections. Each connection's
+// sender thread keeps to a fixed schedule whatever the replies do; replies
+// are matched back to their messages by client order id (new orders) or
+// server order id (cancels, modifies).
+class LoadGenerator {
+public:
+    explicit LoadGenerator(const LoadConfig& config);
+    ~LoadGenerator();
+
+    // Replay this flow instead of generating one
+    void setReplay(ReplayFlow replay) { replay_ = std::move(replay); }
+
+    // Connect, drive the flow for the configured duration, wait for the
+    // replies and disconnect. False if no connection could be opened.
+    bool run(LoadReport& report);
+
+private:
+    struct Connection;
+    using Clock = std::chrono::steady_clock;
+
+    LoadConfig config_;
+    ReplayFlow replay_;
+    std::vector<std::string> symbols_;
+    std::vector<std::unique_ptr<Connection>> connections_;
+    Clock::time_point recordFrom_;
+
+    void attach(Connection& connection);
+    void sendLoop(Connection& connection, Clock::time_point start, Clock::time_point end);
+    bool nextStep(Connection& connection, uint64_t index, FlowStep& step);
+    void send(Connection& connection, const FlowStep& step, Clock::time_point due);
+    // Count a reply to a message due at due, if it fell in the recorded window
+    void record(LoadReport& report, LatencyHistogram& histogram, Clock::time_point due,
+                Clock::time_point now) const;
+};
+
+} // namespace MatchingEngine
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Common.h"
+#include "EventRing.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace MatchingEngine {
+
+// One incremental L2 update: the new aggregate at a price. Quantity 0 means
+// the level is gone.
+struct LevelUpdate {
+    SymbolId symbolId;
+    Side side;
+    Price price;
+    Quantity quantity;
+    uint32_t orderCount;
+};
+
+// Turns the books' LEVEL events into per-subscriber incremental L2 feeds.
+// It consumes the event ring on the ring's consumer thread and keeps its own
+// copy of every book's levels, so a new subscriber starts from a full image
+// of the book and nothing ever queries the matching engine.
+//
+// Updates queue per subscriber until it polls. While a subscriber has not
+// taken its queue, further updates to a level it already has queued replace
+// the queued one in place (conflation), so a slow subscriber costs at most
+// one entry per level and never holds up the ring or the matcher.
+class MarketDataPublisher {
+public:
+    using SubscriptionId = uint64_t;
+    // Called when a subscription's queue goes from empty to non-empty - on
+    // the publisher thread, or inside subscribe() for the initial image.
+    // poll() from anywhere afterwards.
+    using ReadyCallback = std::function<void(SubscriptionId)>;
+
+    // Registers as a consumer, so construct before events.start()
+    explicit MarketDataPublisher(EventRing& events);
+
+    MarketDataPublisher(const MarketDataPublisher&) = delete;
+    MarketDataPublisher& operator=(const MarketDataPublisher&) = delete;
+
+    // symbolId 0 subscribes to every symbol. The current levels are queued
+    // first, before any update that follows them.
+    SubscriptionId subscribe(SymbolId symbolId, ReadyCallback onReady);
+    void unsubscribe(SubscriptionId id);
+
+    // Append the subscription's queued updates to out and clear its queue.
+    // Returns false if the subscription doesn't exist.
+    bool poll(SubscriptionId id, std::vector<LevelUpdate>& out);
+
+    // Levels from the publisher's image of a book, best first
+    std::vector<LevelUpdate> getDepth(SymbolId symbolId, Side side, size_t levels = 10) const;
+
+    // Updates replaced in some subscriber's queue before it polled them
+    uint64_t getConflated() const;
+
+private:
+    struct LevelKey {
+        SymbolId symbolId;
+        Side side;
+        Price price;
+        bool operator==(const LevelKey& other) const {
+            return symbolId == other.symbolId && side == other.side && price == other.price;
+        }
+    };
+    struct LevelKeyHash {
+        size_t operator()(const LevelKey& key) const {
+            uint64_t hash = static_cast<uint64_t>(key.price) * 0x9e3779b97f4a7c15ULL;
+            hash ^= (static_cast<uint64_t>(key.symbolId) << 1) | static_cast<uint64_t>(key.side);
+            return static_cast<size_t>(hash ^ (hash >> 29));
+        }
+    };
+
+    struct Subscription {
+        SymbolId symbolId;
+        ReadyCallback onReady;
+        std::mutex mutex;  // Publisher thread vs. poll()
+        std::vector<LevelUpdate> queue;
+        std::unordered_map<LevelKey, size_t, LevelKeyHash> queued;  // Position in queue
+    };
+
+    struct Level {
+        Quantity quantity;
+        uint32_t orderCount;
+    };
+    struct Book {
+        std::map<Price, Level, std::greater<Price>> bids;
+        std::map<Price, Level> asks;
+    };
+
+    // Book image and subscription list; taken once per event batch
+    mutable std::mutex mutex_;
+    std::unordered_map<SymbolId, Book> books_;
+    std::unordered_map<SubscriptionId, std::shared_ptr<Subscription>> subscriptions_;
+    SubscriptionId nextSubscriptionId_;
+    uint64_t conflated_;
+
+    void onEvents(const EngineEvent* events, size_t count);
+    void applyLevel(const LevelUpdate& update);
+    void enqueue(Subscription& subscription, const LevelUpdate& update);
+    void enqueueBook(Subscription& subscription, SymbolId symbolId, const Book& book);
+};
+
+} // namespace MatchingEngine
@@ -2,8 +2,16 @@
 
 #include "Common.h"
 #include "Order.h"
+#include "OrderPool.h"
+#include "OrderIndex.h"
 #include "Trade.h"
 #include "OrderBook.h"
+#include "EngineCommand.h"
+#include "OptionalMutex.h"
+#include "Snapshot.h"
+#include "EventRing.h"
+#include "RiskCheck.h"
+#include "TimingWheel.h"
 #include <unordered_map>
 #include <memory>
 #include <mutex>
@@ -13,15 +21,36 @@
 namespace MatchingEngine {
 
 // Callback types for notifications
-using OrderCallback = std::function<void(const OrderPtr&)>;
+using OrderCallback = std::function<void(const Order&)>;
 using TradeCallback = std::function<void(const Trade&)>;
 
+// Sees every inbound command, resolved, before it is applied - e.g. to
+// journal it. Runs on the calling thread and returns the journal sequence
+// the command was recorded under (0 if none).
+using CommandHook = std::function<uint64_t(const EngineCommand&)>;
+
+// When resting DAY and GTD orders lapse
+struct ExpiryConfig {
+    uint64_t tickNanos = 1000000;  // Wheel resolution; orders leave within a tick of their time
+    // Session close DAY orders lapse at, as nanoseconds after midnight UTC;
+    // an order entered at or after one lives until the next day's
+    uint64_t sessionCloseNanos = 0;
+};
+
+// Engine-wide configuration
+struct EngineConfig {
+    // false when a single thread drives the engine (e.g. one shard of a
+    // ShardedEngine); the engine and its books then take no locks
+    bool synchronized = true;
+    ExpiryConfig expiry;
+};
+
 class MatchingEngineCore {
 public:
-    MatchingEngineCore();
+    explicit MatchingEngineCore(const EngineConfig& config = EngineConfig());
     ~MatchingEngineCore() = default;
 
-    // Order operations
+    // Order operations. submitOrder returns 0 if pre-trade risk refused it.
     OrderId submitOrder(const std::string& symbol,
                        Side side,
                        OrderType type,
@@ -32,9 +61,67 @@ public:
     
     bool cancelOrder(OrderId orderId);
     bool modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity);
+
+    // Pull every resting and parked order a MASS_CANCEL selects (see
+    // MassCancelScope), each book under one lock; returns how many
+    size_t massCancel(const EngineCommand& command);
+
+    // Apply a resolved command. NEW_ORDER uses the id carried in the command
+    // instead of drawing one, and fills report (if given) with the order's
+    // state at the end of matching. Returns false if a cancel/modify found
+    // nothing; a MASS_CANCEL always succeeds - use massCancel() for the count.
+    bool execute(const EngineCommand& command, Order* report = nullptr);
+
+    // Pre-trade risk stage for a fresh NEW_ORDER or MODIFY_ORDER, in front
+    // of execute(): NONE lets it through; otherwise the command must go no
+    // further. It is not part of execute() so that journaled commands,
+    // accepted once, replay without being checked again. submitOrder() and
+    // modifyOrder() run it themselves.
+    RejectReason checkRisk(const EngineCommand& command);
+    RiskCheck& getRiskCheck() { return risk_; }
+
+    // Expiry. A DAY or GTD order that comes to rest (or parks, for a stop)
+    // is scheduled on a timing wheel. expireOrders() cancels up to limit of
+    // those whose time has passed by now, grouped by book through its batch
+    // cancel. Each is journaled as a CANCEL_ORDER stamped now and reported
+    // through the order callback and ring as CANCELLED, so recovery and
+    // standbys replay expiries like any other cancel, without a clock. The
+    // engine has no timer of its own: whoever drives it calls this between
+    // commands once now reaches nextExpiryCheck(), and a limit keeps one
+    // call at the session close from holding matching up.
+    size_t expireOrders(uint64_t now, size_t limit = SIZE_MAX);
+    uint64_t nextExpiryCheck() const {  // UINT64_MAX while nothing is scheduled
+        return nextExpiryCheck_.load(std::memory_order_relaxed);
+    }
+    size_t getScheduledExpiries() const;
+    // When a NEW_ORDER would lapse (see ExpiryConfig); 0 for GTC
+    uint64_t expiryTimeOf(const EngineCommand& command) const;
+
+    // Draw the next order id, for a NEW_ORDER passed to execute()
+    OrderId reserveOrderId() { return nextOrderId_++; }
+
+    // Persistence. captureSnapshot copies the resting orders under each
+    // book's lock; it is only consistent with getJournalSequence() while no
+    // other thread is submitting. loadSnapshot bulk-rests the orders
+    // without matching and expects an empty engine. replay applies a
+    // journaled command without journaling it again or firing callbacks.
+    void captureSnapshot(EngineSnapshot& snapshot) const;
+    bool loadSnapshot(const EngineSnapshot& snapshot);
+    bool replay(const EngineCommand& command, uint64_t journalSequence);
+
+    // Load snapshotPath (if it exists) and replay the journal after it
+    bool recover(const std::string& snapshotPath, const std::string& journalDirectory);
+
+    // Highest journal sequence applied, and the id reserveOrderId() draws next
+    uint64_t getJournalSequence() const { return journalSequence_; }
+    OrderId getNextOrderId() const { return nextOrderId_; }
+
+    // Copy of a live order, or nullptr once it has left the book
     OrderPtr getOrder(OrderId orderId);
 
-    // Market data
+    // Market data - read from each book's published top of book (see
+    // OrderBook), so none of these wait for matching
+    BookTop getTop(const std::string& symbol);  // Both sides from one publish
     Price getBestBid(const std::string& symbol);
     Price getBestAsk(const std::string& symbol);
     std::vector<std::pair<Price, Quantity>> getBidDepth(const std::string& symbol, size_t levels = 10);
@@ -43,33 +130,87 @@ public:
     // Display
     void printOrderBook(const std::string& symbol, size_t levels = 5);
 
-    // Callbacks
+    // Book configuration - applies to books created after the call
+    void setDefaultBookConfig(const OrderBookConfig& config) { defaultBookConfig_ = config; }
+    void setBookConfig(const std::string& symbol, const OrderBookConfig& config);
+
+    // Output. Events go to the ring (if set) as fixed-size records for
+    // consumers on other threads - trades, order updates, and the books'
+    // level deltas; the callbacks run inline on the matching thread and suit
+    // tests and embedding.
+    void setEventRing(EventRing* events);
     void setOrderCallback(OrderCallback callback) { orderCallback_ = callback; }
     void setTradeCallback(TradeCallback callback) { tradeCallback_ = callback; }
+    void setCommandHook(CommandHook hook) { commandHook_ = hook; }
 
     // Statistics
     size_t getTotalOrders() const { return totalOrders_; }
     size_t getTotalTrades() const { return totalTrades_; }
+    size_t getLiveOrders() const;
+    size_t getOrderCapacity() const;  // Order records the pool has allocated
+    size_t getBookCount() const;
+
+    const EngineConfig& getConfig() const { return config_; }
 
 private:
-    std::unordered_map<std::string, std::unique_ptr<OrderBook>> orderBooks_;
-    std::unordered_map<OrderId, std::string> orderToSymbol_;  // Track which symbol each order belongs to
+    EngineConfig config_;
+
+    // Books indexed by interned symbol id (null where this engine has none);
+    // guarded by booksMutex_ since books are created on first use while
+    // other threads look them up
+    std::vector<std::unique_ptr<OrderBook>> books_;
+    size_t bookCount_;
+    mutable OptionalSharedMutex booksMutex_;
+
+    OrderIdMap<OrderBook*> orderToBook_;  // Book each live order rests in
+    std::unordered_map<std::string, OrderBookConfig> bookConfigs_;  // Per-symbol overrides
+    OrderBookConfig defaultBookConfig_;
+    
+    // Storage for every live order; guarded by mutex_ together with orderToBook_
+    OrderPool orderPool_;
     
     std::atomic<OrderId> nextOrderId_;
+    std::atomic<uint64_t> journalSequence_;
     std::atomic<size_t> totalOrders_;
     std::atomic<size_t> totalTrades_;
     
-    mutable std::mutex mutex_;
+    mutable OptionalMutex mutex_;
+
+    RiskCheck risk_;  // Own lock; matching only queues retires to it
 
-    // Callbacks
+    TimingWheel expiries_;  // Guarded by mutex_
+    std::atomic<uint64_t> nextExpiryCheck_;
+
+    // Output
+    EventRing* events_;
     OrderCallback orderCallback_;
     TradeCallback tradeCallback_;
+    CommandHook commandHook_;
 
     // Helper methods
-    OrderBook* getOrCreateOrderBook(const std::string& symbol);
-    void notifyOrder(const OrderPtr& order);
+    OrderId processNewOrder(const EngineCommand& command, Order* report = nullptr,
+                            bool notify = true);
+    bool apply(const EngineCommand& command, Order* report, bool notify);
+    bool applyCancel(OrderId orderId);
+    bool applyModify(OrderId orderId, Price newPrice, Quantity newQuantity);
+    size_t applyMassCancel(const EngineCommand& command);
+    void recordCommand(EngineCommand& command) {
+        if (!command.timestamp) {
+            command.timestamp = timestampToNanos(getCurrentTimestamp());
+        }
+        if (commandHook_) {
+            noteJournalSequence(commandHook_(command));
+        }
+    }
+    void noteJournalSequence(uint64_t sequence);
+    void noteOrderId(OrderId orderId);
+    OrderBook* getOrCreateOrderBook(SymbolId symbolId);
+    OrderBook* findBook(const std::string& symbol) const;
+    OrderBook* findBook(OrderId orderId) const;
+    void retireOrder(Order& order);
+    void scheduleExpiry(OrderId orderId, uint64_t expireTime);
+    void notifyOrder(const Order& order);
     void notifyTrade(const Trade& trade);
 };
 
 } // namespace MatchingEngine
-
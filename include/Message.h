@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Common.h"
+#include <cstddef>
 #include <string>
 #include <cstring>
 #include <vector>
@@ -18,7 +19,9 @@ struct MessageHeader {
         : type(t), length(len), timestamp(0) {}
 };
 
-// New order request
+// New order request. The time in force fields came later: a message that
+// stops at GTC_SIZE (header.length says so) is a GTC order, and is the
+// form to send one in so that older servers still take it.
 struct NewOrderMessage {
     MessageHeader header;
     OrderId clientOrderId;  // Client-generated ID
@@ -29,6 +32,11 @@ struct NewOrderMessage {
     Quantity quantity;
     Price stopPrice;
     char clientId[32];
+    TimeInForce timeInForce;
+    uint8_t reserved[7];
+    uint64_t expireTime;  // GTD: nanoseconds since the epoch (see timestampToNanos)
+    
+    static constexpr size_t GTC_SIZE = 104;  // Up to and including clientId
     
     NewOrderMessage() {
         header.type = MessageType::NEW_ORDER;
@@ -41,6 +49,9 @@ struct NewOrderMessage {
         quantity = 0;
         stopPrice = 0;
         std::memset(clientId, 0, sizeof(clientId));
+        timeInForce = TimeInForce::GTC;
+        std::memset(reserved, 0, sizeof(reserved));
+        expireTime = 0;
     }
     
     void setSymbol(const std::string& s) {
@@ -60,6 +71,9 @@ struct NewOrderMessage {
     }
 };
 
+static_assert(offsetof(NewOrderMessage, timeInForce) == NewOrderMessage::GTC_SIZE,
+              "a GTC order message ends where the time in force starts");
+
 // Cancel order request
 struct CancelOrderMessage {
     MessageHeader header;
@@ -230,6 +244,90 @@ struct HeartbeatMessage {
     }
 };
 
+// Session logon - first message on a connection. Always sent in this
+// (version 1) layout; both sides switch to the agreed version after the ack.
+struct LogonMessage {
+    MessageHeader header;
+    uint32_t protocolVersion;  // Highest version the client speaks
+    char clientId[32];         // Applies to every order on the session
+    
+    LogonMessage() {
+        header.type = MessageType::LOGON;
+        header.length = sizeof(LogonMessage);
+        protocolVersion = 1;
+        std::memset(clientId, 0, sizeof(clientId));
+    }
+    
+    void setClientId(const std::string& id) {
+        std::strncpy(clientId, id.c_str(), sizeof(clientId) - 1);
+    }
+    
+    std::string getClientId() const {
+        return std::string(clientId, strnlen(clientId, sizeof(clientId)));
+    }
+};
+
+struct LogonAckMessage {
+    MessageHeader header;
+    uint32_t protocolVersion;  // Version used from the next message on
+    
+    LogonAckMessage() {
+        header.type = MessageType::LOGON_ACK;
+        header.length = sizeof(LogonAckMessage);
+        protocolVersion = 1;
+    }
+};
+
+// Subscribe to incremental L2 updates. An empty symbol subscribes to every
+// symbol. The current levels arrive first as ordinary updates.
+struct MarketDataSubscribeMessage {
+    MessageHeader header;
+    char symbol[16];
+    
+    MarketDataSubscribeMessage() {
+        header.type = MessageType::MARKET_DATA_SUBSCRIBE;
+        header.length = sizeof(MarketDataSubscribeMessage);
+        std::memset(symbol, 0, sizeof(symbol));
+    }
+    
+    void setSymbol(const std::string& s) {
+        std::strncpy(symbol, s.c_str(), sizeof(symbol) - 1);
+    }
+    
+    std::string getSymbol() const {
+        return std::string(symbol, strnlen(symbol, sizeof(symbol)));
+    }
+};
+
+// Incremental L2 update - the new aggregate at one price; quantity 0 means
+// the level is gone. A slow subscriber only gets the latest per level.
+struct BookUpdateMessage {
+    MessageHeader header;
+    char symbol[16];
+    Side side;
+    Price price;
+    Quantity quantity;
+    uint32_t orderCount;
+    
+    BookUpdateMessage() {
+        header.type = MessageType::BOOK_UPDATE;
+        header.length = sizeof(BookUpdateMessage);
+        std::memset(symbol, 0, sizeof(symbol));
+        side = Side::BUY;
+        price = 0;
+        quantity = 0;
+        orderCount = 0;
+    }
+    
+    void setSymbol(const std::string& s) {
+        std::strncpy(symbol, s.c_str(), sizeof(symbol) - 1);
+    }
+    
+    std::string getSymbol() const {
+        return std::string(symbol, strnlen(symbol, sizeof(symbol)));
+    }
+};
+
 // Helper functions for serialization
 class MessageSerializer {
 public:
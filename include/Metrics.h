@@ -0,0 +1,212 @@
+#pragma once
+
+#include "LatencyHistogram.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace MatchingEngine {
+
+// Stages of the order path, each timed separately
+enum class Stage : uint8_t {
+    RECEIVE,      // recv() that returned data on a client socket
+    DECODE,       // One frame into an EngineCommand
+    QUEUE,        // Decoded on an I/O thread until a shard picked it up
+    RISK,         // Pre-trade risk check of a new order
+    BOOK_LOOKUP,  // Finding the order's book
+    MATCH,        // Matching, cancelling or amending in the book
+    DISPATCH,     // Publishing events and running result callbacks
+    SEND,         // send() of a batch of replies
+    COUNT
+};
+
+// Monotonic per-thread totals
+enum class Counter : uint8_t {
+    FRAMES,          // Frames decoded
+    COMMANDS,        // Commands applied
+    BYTES_RECEIVED,
+    BYTES_SENT,
+    COUNT
+};
+
+// Latest value a thread reported
+enum class Gauge : uint8_t {
+    QUEUE_DEPTH,     // Commands waiting for a shard
+    RESTING_ORDERS,  // Orders live in a shard's books
+    BOOKS,           // Books a shard has created
+    ORDER_CAPACITY,  // Order records a shard's pool has allocated
+    COUNT
+};
+
+const char* stageName(Stage stage);
+const char* counterName(Counter counter);
+const char* gaugeName(Gauge gauge);
+
+// Cycle counter for stage timing - rdtsc on x86, a monotonic clock in
+// nanoseconds elsewhere. Invariant TSCs agree across cores, so a stamp
+// taken on one thread can be closed on another.
+inline uint64_t readTsc() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// One thread's stage histograms, counters and gauges. Only the owning
+// thread writes; the exporter reads concurrently. Every field is an atomic
+// updated with relaxed loads and stores, never a read-modify-write, so
+// recording costs what a plain increment does and shares no cache line
+// with other threads.
+class ThreadMetrics {
+public:
+    static constexpr unsigned PRECISION_BITS = 6;  // About 3% per bucket
+    static constexpr size_t BUCKETS = LatencyHistogram::bucketCount(PRECISION_BITS);
+
+    explicit ThreadMetrics(std::string name);
+
+    void record(Stage stage, uint64_t ticks) {
+        bump(buckets_[static_cast<size_t>(stage)][LatencyHistogram::bucketOf(ticks, PRECISION_BITS)], 1);
+    }
+    void add(Counter counter, uint64_t amount) { bump(counters_[static_cast<size_t>(counter)], amount); }
+    void set(Gauge gauge, int64_t value) {
+        gauges_[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+        gaugesSet_[static_cast<size_t>(gauge)].store(true, std::memory_order_relaxed);
+    }
+
+    std::string name() const;
+    void setName(std::string name);
+
+private:
+    friend class MetricsRegistry;
+
+    std::string name_;
+    mutable std::mutex nameMutex_;  // Rename vs export - never on the hot path
+    std::atomic<uint64_t> buckets_[static_cast<size_t>(Stage::COUNT)][BUCKETS];
+    std::atomic<uint64_t> counters_[static_cast<size_t>(Counter::COUNT)];
+    std::atomic<int64_t> gauges_[static_cast<size_t>(Gauge::COUNT)];
+    std::atomic<bool> gaugesSet_[static_cast<size_t>(Gauge::COUNT)];
+
+    static void bump(std::atomic<uint64_t>& value, uint64_t amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+};
+
+// Point-in-time copy of every thread's metrics, latencies in nanoseconds
+struct MetricsSnapshot {
+    struct Thread {
+        std::string name;
+        std::vector<LatencyHistogram> stages;  // By Stage
+        std::array<uint64_t, static_cast<size_t>(Counter::COUNT)> counters{};
+        std::array<int64_t, static_cast<size_t>(Gauge::COUNT)> gauges{};
+        std::array<bool, static_cast<size_t>(Gauge::COUNT)> hasGauge{};
+    };
+
+    std::vector<Thread> threads;  // Live threads, then one entry for those that exited
+    double ticksPerNanosecond = 1.0;
+
+    // Every thread's samples of one stage together
+    LatencyHistogram stage(Stage stage) const;
+    uint64_t counter(Counter counter) const;
+
+    // Aligned table of stage percentiles plus the totals, for a console
+    std::string toText() const;
+
+    // Prometheus text exposition: a summary per thread and stage, then
+    // counters and gauges labelled by thread
+    std::string toPrometheus() const;
+};
+
+// Process-wide registry of ThreadMetrics. Recording is off until enabled;
+// when off each instrumentation point costs one relaxed load.
+class MetricsRegistry {
+public:
+    MetricsRegistry();
+
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // Calling thread's metrics, registered on first use. Its samples are
+    // kept when the thread exits.
+    ThreadMetrics& local();
+    void nameThread(const std::string& name) { local().setName(name); }
+
+    MetricsSnapshot snapshot() const;
+
+    // Drop every sample (tests, or between runs)
+    void reset();
+
+    double ticksPerNanosecond() const;
+
+private:
+    struct Holder;
+
+    std::atomic<bool> enabled_;
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<ThreadMetrics>> threads_;
+    std::shared_ptr<ThreadMetrics> exited_;  // Samples of threads that have gone
+    std::chrono::steady_clock::time_point calibrationTime_;
+    uint64_t calibrationTicks_;
+
+    void retire(const std::shared_ptr<ThreadMetrics>& metrics);
+    static void fold(const ThreadMetrics& from, ThreadMetrics& into);
+    void copy(const ThreadMetrics& from, MetricsSnapshot::Thread& to, double ticksPerNs) const;
+};
+
+MetricsRegistry& metrics();
+
+// Start of a timed stage: 0 when metrics are off, so the matching stageEnd
+// records nothing. stageEnd returns its own stamp, so back-to-back stages
+// cost one rdtsc each.
+inline uint64_t stageStart() {
+    return metrics().isEnabled() ? readTsc() : 0;
+}
+
+inline uint64_t stageEnd(Stage stage, uint64_t start) {
+    if (start == 0) {
+        return 0;
+    }
+    uint64_t now = readTsc();
+    metrics().local().record(stage, now > start ? now - start : 0);
+    return now;
+}
+
+// Times the enclosing scope as one stage
+class StageTimer {
+public:
+    explicit StageTimer(Stage stage) : stage_(stage), start_(stageStart()) {}
+    ~StageTimer() { stageEnd(stage_, start_); }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    Stage stage_;
+    uint64_t start_;
+};
+
+inline void countMetric(Counter counter, uint64_t amount) {
+    if (metrics().isEnabled()) {
+        metrics().local().add(counter, amount);
+    }
+}
+
+inline void setMetric(Gauge gauge, int64_t value) {
+    if (metrics().isEnabled()) {
+        metrics().local().set(gauge, value);
+    }
+}
+
+} // namespace MatchingEngine
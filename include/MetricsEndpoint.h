@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketType;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int SocketType;
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define closesocket close
+#endif
+
+namespace MatchingEngine {
+
+// Serves metrics().snapshot() in Prometheus text format over plain HTTP, so
+// a scraper or curl can read the hot-path metrics without touching the
+// order path. One request per connection, answered from its own thread.
+class MetricsEndpoint {
+public:
+    MetricsEndpoint() = default;
+    ~MetricsEndpoint();
+
+    MetricsEndpoint(const MetricsEndpoint&) = delete;
+    MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+
+    // Listens on port (0 picks a free one - see getPort())
+    bool start(uint16_t port);
+    void stop();
+
+    uint16_t getPort() const { return port_; }
+
+private:
+    SocketType socket_ = INVALID_SOCKET;
+    uint16_t port_ = 0;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    void serve();
+    void answer(SocketType client);
+};
+
+} // namespace MatchingEngine
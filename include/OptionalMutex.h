@@ -0,0 +1,60 @@
+#pragma once
+
+#include <mutex>
+#include <shared_mutex>
+
+namespace MatchingEngine {
+
+// Mutex that can be switched off for structures owned by a single thread.
+// Satisfies Lockable (and SharedLockable over a shared mutex), so the usual
+// std::lock_guard / std::shared_lock work unchanged; when disabled every
+// call is a predictable branch.
+template<typename Mutex>
+class BasicOptionalMutex {
+public:
+    explicit BasicOptionalMutex(bool enabled = true) : enabled_(enabled) {}
+
+    BasicOptionalMutex(const BasicOptionalMutex&) = delete;
+    BasicOptionalMutex& operator=(const BasicOptionalMutex&) = delete;
+
+    void lock() {
+        if (enabled_) {
+            mutex_.lock();
+        }
+    }
+
+    bool try_lock() { return !enabled_ || mutex_.try_lock(); }
+
+    void unlock() {
+        if (enabled_) {
+            mutex_.unlock();
+        }
+    }
+
+    void lock_shared() {
+        if (enabled_) {
+            mutex_.lock_shared();
+        }
+    }
+
+    bool try_lock_shared() { return !enabled_ || mutex_.try_lock_shared(); }
+
+    void unlock_shared() {
+        if (enabled_) {
+            mutex_.unlock_shared();
+        }
+    }
+
+    // Only call while no other thread can be holding the lock
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+    bool isEnabled() const { return enabled_; }
+
+private:
+    Mutex mutex_;
+    bool enabled_;
+};
+
+using OptionalMutex = BasicOptionalMutex<std::mutex>;
+using OptionalSharedMutex = BasicOptionalMutex<std::shared_mutex>;
+
+} // namespace MatchingEngine
@@ -6,7 +6,12 @@
 
 namespace MatchingEngine {
 
-class Order {
+// An order is one cache line, aligned so a pooled order never straddles
+// two. Its fields fill all but the last few bytes of the line, so the
+// alignment adds no size.
+// A sweep loads the RestingOrder's links and then this line for every order
+// it fills, since filling and retiring an order touch most of it anyway.
+class alignas(CACHE_LINE_SIZE) Order {
 public:
     Order(OrderId orderId, 
           const std::string& symbol,
@@ -16,34 +21,56 @@ public:
           Quantity quantity,
           Price stopPrice = 0);
 
+    Order(OrderId orderId,
+          SymbolId symbolId,
+          Side side,
+          OrderType type,
+          Price price,
+          Quantity quantity,
+          Price stopPrice = 0,
+          ClientKey clientKey = 0,
+          Timestamp timestamp = getCurrentTimestamp());
+
     // Getters
     OrderId getOrderId() const { return orderId_; }
-    const std::string& getSymbol() const { return symbol_; }
-    Side getSide() const { return side_; }
-    OrderType getType() const { return type_; }
+    const std::string& getSymbol() const;
+    SymbolId getSymbolId() const { return symbolId_; }
+    Side getSide() const { return static_cast<Side>(side_); }
+    OrderType getType() const { return static_cast<OrderType>(type_); }
     Price getPrice() const { return price_; }
     Quantity getQuantity() const { return quantity_; }
     Quantity getRemainingQuantity() const { return remainingQuantity_; }
     Quantity getFilledQuantity() const { return quantity_ - remainingQuantity_; }
     Price getStopPrice() const { return stopPrice_; }
-    OrderStatus getStatus() const { return status_; }
+    OrderStatus getStatus() const { return static_cast<OrderStatus>(status_); }
     Timestamp getTimestamp() const { return timestamp_; }
-    const std::string& getClientId() const { return clientId_; }
+    const std::string& getClientId() const;
+    ClientKey getClientKey() const { return clientKey_; }
+    TimeInForce getTimeInForce() const { return static_cast<TimeInForce>(timeInForce_); }
 
     // Setters
     void setPrice(Price price) { price_ = price; }
+    void setType(OrderType type) { type_ = static_cast<uint8_t>(type); }
     void setQuantity(Quantity quantity) { 
         quantity_ = quantity; 
         remainingQuantity_ = quantity;
     }
-    void setStatus(OrderStatus status) { status_ = status; }
-    void setClientId(const std::string& clientId) { clientId_ = clientId; }
+    // New open quantity for an amend; what has already filled stays filled
+    void amend(Quantity remaining) {
+        quantity_ = getFilledQuantity() + remaining;
+        remainingQuantity_ = remaining;
+    }
+    void setStatus(OrderStatus status) { status_ = static_cast<uint8_t>(status); }
+    void setClientId(const std::string& clientId);
+    void setClientKey(ClientKey clientKey) { clientKey_ = clientKey; }
+    void setTimestamp(Timestamp timestamp) { timestamp_ = timestamp; }
+    void setTimeInForce(TimeInForce timeInForce) { timeInForce_ = static_cast<uint8_t>(timeInForce); }
 
     // Operations
     void fill(Quantity quantity);
     bool isFilled() const { return remainingQuantity_ == 0; }
     bool isActive() const { 
-        return status_ == OrderStatus::PENDING || status_ == OrderStatus::PARTIAL_FILL; 
+        return getStatus() == OrderStatus::PENDING || getStatus() == OrderStatus::PARTIAL_FILL;
     }
 
     // For stop orders - check if should be triggered
@@ -54,19 +81,24 @@ public:
 
 private:
     OrderId orderId_;
-    std::string symbol_;
-    Side side_;
-    OrderType type_;
     Price price_;
-    Quantity quantity_;
     Quantity remainingQuantity_;
+    uint8_t side_;    // Side
+    uint8_t type_;    // OrderType
+    uint8_t status_;  // OrderStatus
+    SymbolId symbolId_;
+
+    Quantity quantity_;
     Price stopPrice_;  // For stop orders
-    OrderStatus status_;
     Timestamp timestamp_;
-    std::string clientId_;
+    ClientKey clientKey_;
+    uint8_t timeInForce_;  // TimeInForce; the expiry time itself is kept by the engine
 };
 
 using OrderPtr = std::shared_ptr<Order>;
 
-} // namespace MatchingEngine
+// Non-owning handle to an order. Inside the engine orders live in an
+// OrderPool and are passed around by handle, never by shared_ptr.
+using OrderHandle = Order*;
 
+} // namespace MatchingEngine
@@ -3,60 +3,124 @@
 #include "Common.h"
 #include "Order.h"
 #include "Trade.h"
-#include <map>
-#include <list>
-#include <unordered_map>
+#include "PriceLadder.h"
+#include "OrderSlab.h"
+#include "OrderIndex.h"
+#include "OptionalMutex.h"
+#include "EventRing.h"
+#include "TopOfBook.h"
 #include <vector>
 #include <mutex>
 #include <memory>
+#include <functional>
+#include <map>
 
 namespace MatchingEngine {
 
-// Price level - maintains orders at a specific price
-class PriceLevel {
-public:
-    explicit PriceLevel(Price price) : price_(price), totalQuantity_(0) {}
+// Price level storage used by a book
+enum class PriceLadderType {
+    MAP,    // std::map per side - any price, O(log n) level access
+    ARRAY   // Contiguous tick-indexed window - O(1) level access, narrow tick bands
+};
 
-    void addOrder(OrderPtr order);
-    void removeOrder(OrderId orderId);
-    OrderPtr getOrder(OrderId orderId);
-    
-    Price getPrice() const { return price_; }
-    Quantity getTotalQuantity() const { return totalQuantity_; }
-    size_t getOrderCount() const { return orders_.size(); }
-    bool isEmpty() const { return orders_.empty(); }
-    
-    const std::list<OrderPtr>& getOrders() const { return orders_; }
-    std::list<OrderPtr>& getOrders() { return orders_; }
+// Per-symbol book configuration
+struct OrderBookConfig {
+    PriceLadderType ladderType = PriceLadderType::MAP;
+    Price tickSize = 1;          // Prices must be multiples of this
+    size_t ladderLevels = 4096;  // Initial window width in ticks (ARRAY only)
+    size_t ladderMaxLevels = size_t(1) << 20;  // Widest it may grow; orders beyond are refused
+    size_t orderCapacity = 1024; // Resting order records preallocated per book
+    bool synchronized = true;    // false when a single thread owns the book
+};
 
-private:
-    Price price_;
-    Quantity totalQuantity_;
-    std::list<OrderPtr> orders_;  // FIFO queue for price-time priority
-    std::unordered_map<OrderId, std::list<OrderPtr>::iterator> orderMap_;  // Fast lookup
+// Selects orders for a bulk cancel; unset fields match every order
+struct OrderFilter {
+    bool bySide = false;
+    Side side = Side::BUY;
+    bool byClient = false;
+    ClientKey clientKey = 0;
+
+    bool matches(const Order& order) const {
+        return (!bySide || order.getSide() == side) &&
+               (!byClient || order.getClientKey() == clientKey);
+    }
 };
 
-// Order book for a single symbol
+// Invoked (under the book lock) when a resting order leaves the book
+// because it was filled or cancelled
+using OrderRetireHandler = std::function<void(Order&)>;
+
+// Invoked (under the book lock) for each stop order a trade released, once
+// it has been matched, with its state at that point. An order that did not
+// come to rest is retired right after.
+using StopTriggerHandler = std::function<void(const Order&)>;
+
+// Order book for a single symbol. The book does not own orders: it links
+// handles to them into its levels, and reports through the retire handler
+// when it lets go of one.
+//
+// Stop orders are parked in per-side trigger books keyed by stop price, off
+// the price levels. A stop is elected by the first trade at or through its
+// stop price after it was parked; only the stops crossed by a match's trades
+// are visited. Elected stops become MARKET (STOP_LOSS) or LIMIT (STOP_LIMIT)
+// orders and are matched right away, in stop price order, and any stops
+// their own trades cross follow in the same call.
 class OrderBook {
 public:
-    explicit OrderBook(const std::string& symbol);
+    explicit OrderBook(const std::string& symbol,
+                       const OrderBookConfig& config = OrderBookConfig());
 
     // Order operations
-    void addOrder(OrderPtr order);
+    void addOrder(OrderHandle order);
     bool cancelOrder(OrderId orderId);
-    bool modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity);
-    OrderPtr getOrder(OrderId orderId);
+    size_t cancelOrders(const OrderFilter& filter);  // Resting and parked; one lock for all
+    // Those of count orders still here, under one lock and one top of book
+    // publish; each one cancelled is copied to cancelled (if given)
+    size_t cancelOrders(const OrderId* orderIds, size_t count,
+                        std::vector<Order>* cancelled = nullptr);
+    // newQuantity is the quantity left open; fills so far are kept. Reducing
+    // it at the same price keeps the order's place in its queue, while a new
+    // price or more quantity sends it to the back of the level. report (if
+    // given) receives the amended order.
+    bool modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity,
+                     Order* report = nullptr);
+    OrderHandle getOrder(OrderId orderId);
+    OrderPtr getOrderCopy(OrderId orderId) const;
+    bool copyOrder(OrderId orderId, Order& copy) const;  // Without allocating
+
+    // Matching - trades are appended to the caller's buffer. Returns true if
+    // the order came to rest; report (if given) receives its state as of the
+    // end of matching, copied before other threads can touch a resting order.
+    bool matchOrder(OrderHandle order, std::vector<Trade>& trades, Order* report = nullptr);
+    std::vector<Trade> matchOrder(OrderHandle order);
+
+    // Convenience overloads for shared orders; the book holds a reference
+    // for as long as the order rests
+    void addOrder(const OrderPtr& order);
+    std::vector<Trade> matchOrder(const OrderPtr& order);
 
-    // Matching
-    std::vector<Trade> matchOrder(OrderPtr order);
+    void setRetireHandler(OrderRetireHandler handler) { retireHandler_ = std::move(handler); }
+    void setStopTriggerHandler(StopTriggerHandler handler) { triggerHandler_ = std::move(handler); }
 
-    // Market data
+    // Publish a LEVEL event (under the book lock, so in book order) each
+    // time a price level's aggregate changes. A match publishes each level
+    // it touched once, not once per fill.
+    void setEventRing(EventRing* events) { events_ = events; }
+
+    // Market data. Best prices, and levels and depth within the top
+    // BookTop::DEPTH, come from the published top of book without taking
+    // the book lock, so they can be read from any thread while matching.
+    BookTop getTop() const { return topOfBook_.read(); }
+    const TopOfBook& getTopOfBook() const { return topOfBook_; }
     Price getBestBid() const;
     Price getBestAsk() const;
     Quantity getBidQuantityAtLevel(Price price) const;
     Quantity getAskQuantityAtLevel(Price price) const;
+    Quantity getSideQuantity(Side side) const;  // Across every level of one side
     
     const std::string& getSymbol() const { return symbol_; }
+    SymbolId getSymbolId() const { return symbolId_; }
+    const OrderBookConfig& getConfig() const { return config_; }
     
     // Book depth
     std::vector<std::pair<Price, Quantity>> getBidDepth(size_t levels = 10) const;
@@ -65,39 +129,115 @@ public:
     // Display
     void printBook(size_t levels = 5) const;
 
+    // Parked stop orders
+    size_t getStopCount() const;
+
+    // Append a copy of every resting order, bids then asks, best level
+    // first and each level in queue order, then the parked stops in trigger
+    // order - see EngineSnapshot
+    void collectOrders(std::vector<Order>& out) const;
+
 private:
     std::string symbol_;
+    SymbolId symbolId_;
+    OrderBookConfig config_;
+    
+    // Buy orders (bids) - highest price first
+    std::unique_ptr<PriceLadder> bids_;
+    
+    // Sell orders (asks) - lowest price first
+    std::unique_ptr<PriceLadder> asks_;
+    
+    // Resting order records - price level queues link through these
+    OrderSlab slab_;
+    
+    // Total quantity resting on each side, kept with every level change so
+    // a FOK that the whole side can't fill is refused without a walk
+    Quantity bidQuantity_;
+    Quantity askQuantity_;
     
-    // Buy orders (bids) - sorted descending (highest price first)
-    std::map<Price, PriceLevel, std::greater<Price>> bids_;
+    // Single book-wide index: order id -> slab record
+    OrderIdMap<OrderSlot> orderIndex_;
     
-    // Sell orders (asks) - sorted ascending (lowest price first)
-    std::map<Price, PriceLevel, std::less<Price>> asks_;
+    // Parked stops, next to trigger first: buy stops elect at or above their
+    // price, sell stops at or below. Equal stop prices keep arrival order.
+    std::multimap<Price, OrderHandle> buyStops_;
+    std::multimap<Price, OrderHandle, std::greater<Price>> sellStops_;
+    OrderIdMap<OrderHandle> stopIndex_;
+    std::vector<OrderHandle> elected_;  // Scratch for releaseStops
     
-    // Fast order lookup
-    std::unordered_map<OrderId, OrderPtr> orderMap_;
+    OrderRetireHandler retireHandler_;
+    StopTriggerHandler triggerHandler_;
+    EventRing* events_;
     
-    // Thread safety
-    mutable std::mutex mutex_;
+    // References held for orders that came in through the OrderPtr overloads
+    OrderIdMap<OrderPtr> sharedOrders_;
+    
+    // Thread safety - a no-op when config_.synchronized is false
+    mutable OptionalMutex mutex_;
+    
+    // Top levels kept up to date with each level change, and published to
+    // topOfBook_ once per book operation that changed them
+    BookTop top_;
+    bool topChanged_;
+    TopOfBook topOfBook_;
+    
+    // Publishes the top when a book operation is done, still under its lock
+    struct TopPublisher {
+        OrderBook& book;
+        ~TopPublisher() { book.publishTop(); }
+    };
 
     // Helper methods
-    std::vector<Trade> matchMarketOrder(OrderPtr order);
-    std::vector<Trade> matchLimitOrder(OrderPtr order);
-    std::vector<Trade> matchIOCOrder(OrderPtr order);
-    std::vector<Trade> matchFOKOrder(OrderPtr order);
+    bool cancelLocked(OrderId orderId, Order* report = nullptr);
+    void matchMarketOrder(OrderHandle order, std::vector<Trade>& trades);
+    void matchLimitOrder(OrderHandle order, std::vector<Trade>& trades);
+    void matchIOCOrder(OrderHandle order, std::vector<Trade>& trades);
+    void matchFOKOrder(OrderHandle order, std::vector<Trade>& trades);
     
-    std::vector<Trade> executeMatches(OrderPtr order, 
-                                      std::map<Price, PriceLevel, std::less<Price>>& levels,
-                                      bool fillEntireOrder = false);
-    std::vector<Trade> executeMatches(OrderPtr order, 
-                                      std::map<Price, PriceLevel, std::greater<Price>>& levels,
-                                      bool fillEntireOrder = false);
+    // Matching kernel, specialized per aggressor side and order type so the
+    // per-fill loop carries no side or type branches; the non-template
+    // overload picks the side once per order
+    template <OrderType T>
+    void executeMatches(OrderHandle order, std::vector<Trade>& trades);
+    template <Side S, OrderType T>
+    void executeMatches(OrderHandle order, std::vector<Trade>& trades);
+    bool canFillEntireOrder(OrderHandle order, const PriceLadder& levels) const;
     
-    bool canFillEntireOrder(OrderPtr order, 
-                           const std::map<Price, PriceLevel, std::less<Price>>& levels) const;
-    bool canFillEntireOrder(OrderPtr order, 
-                           const std::map<Price, PriceLevel, std::greater<Price>>& levels) const;
+    void parkStop(OrderHandle order);
+    bool unparkStop(OrderHandle order);
+    void releaseStops(std::vector<Trade>& trades, size_t firstTrade);
+    bool rests(OrderHandle order) const;
+
+    PriceLadder& ladderFor(Side side) { return side == Side::BUY ? *bids_ : *asks_; }
+    PriceLadder& oppositeLadder(Side side) { return side == Side::BUY ? *asks_ : *bids_; }
+    Quantity& restingQuantity(Side side) { return side == Side::BUY ? bidQuantity_ : askQuantity_; }
+    void restOrder(OrderHandle order);
+    void retire(Order& order);
+    void removeFromLevel(OrderSlot slot);
+    void publishLevel(Side side, Price price, const PriceLevel* level) {
+        updateTop(side, price, level);
+        if (events_) {
+            publishLevelEvent(side, price, level);
+        }
+    }
+    void publishLevelEvent(Side side, Price price, const PriceLevel* level);
+    void updateTop(Side side, Price price, const PriceLevel* level);
+    void publishTop() {
+        if (topChanged_) {
+            topOfBook_.publish(top_);
+            topChanged_ = false;
+        }
+    }
+    Quantity levelQuantity(const PriceLadder& ladder, Side side, Price price) const;
+    bool isOnTick(Price price) const { return price % config_.tickSize == 0; }
+
+    static std::vector<std::pair<Price, Quantity>> collectDepth(const PriceLadder& ladder,
+                                                                size_t levels);
+    static std::vector<std::pair<Price, Quantity>> topDepth(const BookTop::Level* top,
+                                                            size_t count, size_t levels);
+    void collectLadder(const PriceLadder& ladder, std::vector<Order>& out) const;
+    static std::unique_ptr<PriceLadder> makeLadder(Side side, const OrderBookConfig& config);
 };
 
 } // namespace MatchingEngine
-
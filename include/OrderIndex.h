@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Common.h"
+#include <vector>
+#include <limits>
+
+namespace MatchingEngine {
+
+// Flat open-addressing map keyed by order id. Linear probing into a
+// power-of-two table with backward-shift deletion, so inserts and erases
+// never allocate once the table has been sized.
+template<typename V>
+class OrderIdMap {
+public:
+    explicit OrderIdMap(size_t capacity = 16) : size_(0) {
+        rehash(capacity);
+    }
+
+    V* find(OrderId key) {
+        size_t i = slotFor(key);
+        while (entries_[i].key != EMPTY_KEY) {
+            if (entries_[i].key == key) {
+                return &entries_[i].value;
+            }
+            i = (i + 1) & mask_;
+        }
+        return nullptr;
+    }
+
+    const V* find(OrderId key) const {
+        return const_cast<OrderIdMap*>(this)->find(key);
+    }
+
+    // Insert or overwrite
+    void insert(OrderId key, const V& value) {
+        if ((size_ + 1) * 2 > entries_.size()) {
+            rehash(entries_.size() * 2);
+        }
+        size_t i = slotFor(key);
+        while (entries_[i].key != EMPTY_KEY) {
+            if (entries_[i].key == key) {
+                entries_[i].value = value;
+                return;
+            }
+            i = (i + 1) & mask_;
+        }
+        entries_[i].key = key;
+        entries_[i].value = value;
+        ++size_;
+    }
+
+    bool erase(OrderId key) {
+        size_t i = slotFor(key);
+        while (entries_[i].key != key) {
+            if (entries_[i].key == EMPTY_KEY) {
+                return false;
+            }
+            i = (i + 1) & mask_;
+        }
+
+        // Shift later members of the probe chain back into the hole
+        size_t hole = i;
+        for (size_t j = (i + 1) & mask_; entries_[j].key != EMPTY_KEY; j = (j + 1) & mask_) {
+            size_t home = slotFor(entries_[j].key);
+            if (((j - home) & mask_) >= ((j - hole) & mask_)) {
+                entries_[hole] = entries_[j];
+                hole = j;
+            }
+        }
+        entries_[hole].key = EMPTY_KEY;
+        --size_;
+        return true;
+    }
+
+    // Size the table for count entries without further growth
+    void reserve(size_t count) {
+        if (count * 2 > entries_.size()) {
+            rehash(count * 2);
+        }
+    }
+
+    void clear() {
+        for (auto& entry : entries_) {
+            entry.key = EMPTY_KEY;
+        }
+        size_ = 0;
+    }
+
+    template<typename F>
+    void forEach(F&& visit) const {
+        for (const auto& entry : entries_) {
+            if (entry.key != EMPTY_KEY) {
+                visit(entry.key, entry.value);
+            }
+        }
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    static constexpr OrderId EMPTY_KEY = std::numeric_limits<OrderId>::max();
+
+    struct Entry {
+        OrderId key = EMPTY_KEY;
+        V value{};
+    };
+
+    std::vector<Entry> entries_;
+    size_t mask_;
+    unsigned shift_;
+    size_t size_;
+
+    // Fibonacci hashing spreads sequential ids across the table
+    size_t slotFor(OrderId key) const {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> shift_);
+    }
+
+    void rehash(size_t capacity) {
+        size_t tableSize = 16;
+        unsigned bits = 4;
+        while (tableSize < capacity) {
+            tableSize *= 2;
+            ++bits;
+        }
+
+        std::vector<Entry> old;
+        old.swap(entries_);
+        entries_.resize(tableSize);
+        mask_ = tableSize - 1;
+        shift_ = 64 - bits;
+        size_ = 0;
+
+        for (const auto& entry : old) {
+            if (entry.key != EMPTY_KEY) {
+                insert(entry.key, entry.value);
+            }
+        }
+    }
+};
+
+} // namespace MatchingEngine
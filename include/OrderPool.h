@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Order.h"
+#include <vector>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace MatchingEngine {
+
+// Fixed-size Order records carved out of large chunks and recycled through
+// an intrusive free list. Once the pool has grown to the working set,
+// acquiring and releasing an order never touches the heap. Not
+// synchronized - the owner serializes access.
+class OrderPool {
+public:
+    explicit OrderPool(size_t chunkSize = 4096)
+        : chunkSize_(chunkSize > 0 ? chunkSize : 1)
+        , freeList_(nullptr)
+        , inUse_(0)
+        , capacity_(0) {
+    }
+
+    OrderPool(const OrderPool&) = delete;
+    OrderPool& operator=(const OrderPool&) = delete;
+
+    template<typename... Args>
+    OrderHandle acquire(Args&&... args) {
+        if (!freeList_) {
+            grow();
+        }
+        Slot* slot = freeList_;
+        freeList_ = slot->next;
+        ++inUse_;
+        return new (slot->storage) Order(std::forward<Args>(args)...);
+    }
+
+    void release(OrderHandle order) {
+        order->~Order();
+        Slot* slot = reinterpret_cast<Slot*>(order);
+        slot->next = freeList_;
+        freeList_ = slot;
+        --inUse_;
+    }
+
+    // Pre-grow so the first count orders don't allocate either
+    void reserve(size_t count) {
+        while (capacity_ < count) {
+            grow();
+        }
+    }
+
+    size_t inUse() const { return inUse_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    static_assert(std::is_trivially_destructible<Order>::value,
+                  "pooled orders are recycled without running destructors on shutdown");
+
+    union Slot {
+        Slot* next;
+        alignas(Order) unsigned char storage[sizeof(Order)];
+    };
+
+    size_t chunkSize_;
+    std::vector<std::unique_ptr<Slot[]>> chunks_;
+    Slot* freeList_;
+    size_t inUse_;
+    size_t capacity_;
+
+    void grow() {
+        chunks_.emplace_back(new Slot[chunkSize_]);
+        Slot* chunk = chunks_.back().get();
+        for (size_t i = chunkSize_; i-- > 0;) {
+            chunk[i].next = freeList_;
+            freeList_ = &chunk[i];
+        }
+        capacity_ += chunkSize_;
+    }
+};
+
+} // namespace MatchingEngine
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Common.h"
+#include "Order.h"
+#include <vector>
+#include <limits>
+
+namespace MatchingEngine {
+
+using OrderSlot = uint32_t;
+constexpr OrderSlot INVALID_SLOT = std::numeric_limits<OrderSlot>::max();
+
+// Resting order record - the FIFO links of its price level live in the
+// record itself, so queue operations never allocate
+struct RestingOrder {
+    OrderHandle order = nullptr;
+    OrderSlot prev = INVALID_SLOT;
+    OrderSlot next = INVALID_SLOT;
+};
+
+// Preallocated slab of resting order records with an intrusive free list.
+// Records are addressed by slot index, so growing the slab keeps every
+// outstanding slot valid.
+class OrderSlab {
+public:
+    explicit OrderSlab(size_t capacity = 1024) : freeHead_(INVALID_SLOT), used_(0) {
+        records_.reserve(capacity);
+    }
+
+    OrderSlot allocate(OrderHandle order) {
+        OrderSlot slot;
+        if (freeHead_ != INVALID_SLOT) {
+            slot = freeHead_;
+            freeHead_ = records_[slot].next;
+        } else {
+            slot = static_cast<OrderSlot>(records_.size());
+            records_.emplace_back();
+        }
+
+        RestingOrder& record = records_[slot];
+        record.order = order;
+        record.prev = INVALID_SLOT;
+        record.next = INVALID_SLOT;
+        ++used_;
+        return slot;
+    }
+
+    void release(OrderSlot slot) {
+        RestingOrder& record = records_[slot];
+        record.order = nullptr;
+        record.prev = INVALID_SLOT;
+        record.next = freeHead_;
+        freeHead_ = slot;
+        --used_;
+    }
+
+    RestingOrder& operator[](OrderSlot slot) { return records_[slot]; }
+    const RestingOrder& operator[](OrderSlot slot) const { return records_[slot]; }
+
+    size_t size() const { return used_; }
+    size_t capacity() const { return records_.capacity(); }
+
+private:
+    std::vector<RestingOrder> records_;
+    OrderSlot freeHead_;
+    size_t used_;
+};
+
+} // namespace MatchingEngine
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "Common.h"
+#include "Order.h"
+#include "OrderSlab.h"
+#include <map>
+#include <vector>
+#include <functional>
+
+namespace MatchingEngine {
+
+// Price level - FIFO queue of resting orders at a specific price. The queue
+// is intrusive: links live in the slab records owned by the book.
+class PriceLevel {
+public:
+    explicit PriceLevel(Price price = 0)
+        : price_(price), totalQuantity_(0), orderCount_(0)
+        , head_(INVALID_SLOT), tail_(INVALID_SLOT) {}
+
+    void pushBack(OrderSlab& slab, OrderSlot slot);
+    void remove(OrderSlab& slab, OrderSlot slot);
+
+    // FIFO access used by matching
+    OrderSlot front() const { return head_; }
+    void popFront(OrderSlab& slab) { remove(slab, head_); }
+    void reduceQuantity(Quantity quantity) { totalQuantity_ -= quantity; }
+
+    Price getPrice() const { return price_; }
+    Quantity getTotalQuantity() const { return totalQuantity_; }
+    size_t getOrderCount() const { return orderCount_; }
+    bool isEmpty() const { return orderCount_ == 0; }
+
+private:
+    Price price_;
+    Quantity totalQuantity_;
+    uint32_t orderCount_;
+    OrderSlot head_;  // Oldest order - next to match
+    OrderSlot tail_;  // Newest order
+};
+
+// Price ladder - the price levels of one side of the book, best price first
+class PriceLadder {
+public:
+    virtual ~PriceLadder() = default;
+
+    // Level at price, or nullptr if nothing rests there
+    virtual PriceLevel* find(Price price) = 0;
+    virtual const PriceLevel* find(Price price) const = 0;
+
+    // Level at price, created if needed. The caller must add an order to a
+    // newly created level before any other ladder call.
+    virtual PriceLevel& getOrCreate(Price price) = 0;
+
+    // Drop an empty level
+    virtual void erase(Price price) = 0;
+
+    // Best level (highest bid / lowest ask), or nullptr if the side is empty
+    virtual PriceLevel* best() = 0;
+    virtual const PriceLevel* best() const = 0;
+
+    // Next level after price in priority order, or nullptr
+    virtual const PriceLevel* next(Price price) const = 0;
+
+    // Worst level (lowest bid / highest ask), or nullptr if the side is empty
+    virtual const PriceLevel* worst() const = 0;
+
+    // Quantity resting at limit or better, summed best level first and
+    // stopping as soon as it reaches enough - one walk over only the levels
+    // an order limited to that price could take
+    virtual Quantity depthThrough(Price limit, Quantity enough) const = 0;
+
+    // Whether price is at or better than limit on this side
+    virtual bool within(Price price, Price limit) const = 0;
+
+    // Whether a level at price could be created next to those resting now
+    virtual bool accepts(Price price) const = 0;
+
+    virtual bool empty() const = 0;
+    virtual size_t levelCount() const = 0;
+};
+
+// Ladder backed by a red-black tree - any price, O(log n) per level operation
+template<typename Compare>
+class MapPriceLadder : public PriceLadder {
+public:
+    PriceLevel* find(Price price) override {
+        auto it = levels_.find(price);
+        return it != levels_.end() ? &it->second : nullptr;
+    }
+
+    const PriceLevel* find(Price price) const override {
+        auto it = levels_.find(price);
+        return it != levels_.end() ? &it->second : nullptr;
+    }
+
+    PriceLevel& getOrCreate(Price price) override {
+        return levels_.try_emplace(price, price).first->second;
+    }
+
+    void erase(Price price) override { levels_.erase(price); }
+
+    PriceLevel* best() override {
+        return levels_.empty() ? nullptr : &levels_.begin()->second;
+    }
+
+    const PriceLevel* best() const override {
+        return levels_.empty() ? nullptr : &levels_.begin()->second;
+    }
+
+    const PriceLevel* next(Price price) const override {
+        auto it = levels_.upper_bound(price);
+        return it != levels_.end() ? &it->second : nullptr;
+    }
+
+    const PriceLevel* worst() const override {
+        return levels_.empty() ? nullptr : &levels_.rbegin()->second;
+    }
+
+    // Iterates the tree directly rather than re-finding each next level
+    Quantity depthThrough(Price limit, Quantity enough) const override {
+        Quantity total = 0;
+        for (auto it = levels_.begin(); it != levels_.end() && within(it->first, limit); ++it) {
+            total += it->second.getTotalQuantity();
+            if (total >= enough) {
+                break;
+            }
+        }
+        return total;
+    }
+
+    bool within(Price price, Price limit) const override { return !Compare()(limit, price); }
+    bool accepts(Price) const override { return true; }
+
+    bool empty() const override { return levels_.empty(); }
+    size_t levelCount() const override { return levels_.size(); }
+
+private:
+    std::map<Price, PriceLevel, Compare> levels_;
+};
+
+// Buy orders (bids) - sorted descending (highest price first)
+using MapBidLadder = MapPriceLadder<std::greater<Price>>;
+
+// Sell orders (asks) - sorted ascending (lowest price first)
+using MapAskLadder = MapPriceLadder<std::less<Price>>;
+
+// Ladder backed by a contiguous array of levels indexed by
+// (price - basePrice) / tickSize. Top of book and level lookup are O(1), and
+// the window re-centers (growing only if the occupied range no longer fits)
+// when a price falls outside it. Prices must be multiples of tickSize, and
+// the occupied range may span at most maxLevels ticks - accepts() refuses a
+// price further out.
+class ArrayPriceLadder : public PriceLadder {
+public:
+    ArrayPriceLadder(Side side, Price tickSize, size_t levels, size_t maxLevels);
+
+    PriceLevel* find(Price price) override;
+    const PriceLevel* find(Price price) const override;
+    PriceLevel& getOrCreate(Price price) override;
+    void erase(Price price) override;
+
+    PriceLevel* best() override;
+    const PriceLevel* best() const override;
+    const PriceLevel* next(Price price) const override;
+    const PriceLevel* worst() const override;
+    Quantity depthThrough(Price limit, Quantity enough) const override;
+    bool within(Price price, Price limit) const override {
+        return side_ == Side::BUY ? price >= limit : price <= limit;
+    }
+    bool accepts(Price price) const override;
+
+    bool empty() const override { return levelCount_ == 0; }
+    size_t levelCount() const override { return levelCount_; }
+
+    Price getBasePrice() const { return basePrice_; }
+    Price getTickSize() const { return tickSize_; }
+    size_t getCapacity() const { return levels_.size(); }
+    size_t getMaxLevels() const { return maxLevels_; }
+
+private:
+    Side side_;
+    Price tickSize_;
+    Price basePrice_;
+    std::vector<PriceLevel> levels_;
+    size_t maxLevels_;  // The window never grows past this
+    size_t lowIndex_;   // Lowest occupied slot (valid when levelCount_ > 0)
+    size_t highIndex_;  // Highest occupied slot (valid when levelCount_ > 0)
+    size_t levelCount_;
+
+    bool inWindow(Price price) const {
+        return price >= basePrice_ && ticksBetween(basePrice_, price) < levels_.size();
+    }
+    // Whole ticks from low up to high, without overflowing however far apart
+    uint64_t ticksBetween(Price low, Price high) const {
+        return (static_cast<uint64_t>(high) - static_cast<uint64_t>(low)) /
+               static_cast<uint64_t>(tickSize_);
+    }
+    size_t indexOf(Price price) const {
+        return static_cast<size_t>((price - basePrice_) / tickSize_);
+    }
+    Price priceAt(size_t index) const {
+        return basePrice_ + static_cast<Price>(index) * tickSize_;
+    }
+
+    void recenter(Price price);
+};
+
+} // namespace MatchingEngine
@@ -0,0 +1,868 @@
+#pragma once
+
+#include "Common.h"
+#include "EngineCommand.h"
+#include "FrameBuffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace MatchingEngine {
+
+// Version 2 wire protocol - packed, explicitly sized, little-endian fields
+// behind a 4-byte header:
+//
+//   uint16 length (whole frame)  uint8 type (MessageType)  uint8 flags (0)
+//
+// Text is replaced by RejectReason codes and the client id is given once at
+// logon, so an ack is 22 bytes instead of ~170. Decoding reads fields one by
+// one, so frames need no alignment.
+namespace ProtocolV2 {
+
+constexpr uint8_t VERSION = 2;
+constexpr size_t HEADER_SIZE = 4;
+constexpr size_t SYMBOL_SIZE = 16;
+constexpr size_t CLIENT_SIZE = 32;
+constexpr size_t MAX_BATCH = 64;  // Members in one batch frame
+
+// Little-endian field access independent of host byte order
+class Writer {
+public:
+    explicit Writer(char* out) : out_(reinterpret_cast<unsigned char*>(out)), size_(0) {}
+
+    void u8(uint8_t value) { out_[size_++] = value; }
+    void u16(uint16_t value) { put(value, 2); }
+    void u32(uint32_t value) { put(value, 4); }
+    void u64(uint64_t value) { put(value, 8); }
+    void i64(int64_t value) { put(static_cast<uint64_t>(value), 8); }
+    void bytes(const char* data, size_t length) {
+        std::memcpy(out_ + size_, data, length);
+        size_ += length;
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    unsigned char* out_;
+    size_t size_;
+
+    void put(uint64_t value, size_t width) {
+        for (size_t i = 0; i < width; ++i) {
+            out_[size_++] = static_cast<unsigned char>(value >> (8 * i));
+        }
+    }
+};
+
+class Reader {
+public:
+    explicit Reader(const char* data) : in_(reinterpret_cast<const unsigned char*>(data)), pos_(0) {}
+
+    uint8_t u8() { return in_[pos_++]; }
+    uint16_t u16() { return static_cast<uint16_t>(get(2)); }
+    uint32_t u32() { return static_cast<uint32_t>(get(4)); }
+    uint64_t u64() { return get(8); }
+    int64_t i64() { return static_cast<int64_t>(get(8)); }
+    void bytes(char* out, size_t length) {
+        std::memcpy(out, in_ + pos_, length);
+        pos_ += length;
+    }
+
+private:
+    const unsigned char* in_;
+    size_t pos_;
+
+    uint64_t get(size_t width) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < width; ++i) {
+            value |= static_cast<uint64_t>(in_[pos_++]) << (8 * i);
+        }
+        return value;
+    }
+};
+
+inline void writeHeader(Writer& writer, MessageType type, size_t length) {
+    writer.u16(static_cast<uint16_t>(length));
+    writer.u8(static_cast<uint8_t>(type));
+    writer.u8(0);
+}
+
+// Reader positioned after the header, or false if the frame isn't a
+// version 2 frame of this type and exact size
+inline bool openFrame(const Frame& frame, MessageType type, size_t length, Reader& reader) {
+    if (frame.length != length || frame.type != type) {
+        return false;
+    }
+    reader = Reader(frame.data + HEADER_SIZE);
+    return true;
+}
+
+inline void setSymbol(char (&symbol)[SYMBOL_SIZE], const std::string& value) {
+    std::memset(symbol, 0, SYMBOL_SIZE);
+    std::memcpy(symbol, value.data(), value.size() < SYMBOL_SIZE ? value.size() : SYMBOL_SIZE);
+}
+
+inline std::string getSymbol(const char (&symbol)[SYMBOL_SIZE]) {
+    return std::string(symbol, strnlen(symbol, SYMBOL_SIZE));
+}
+
+inline void setClientId(char (&clientId)[CLIENT_SIZE], const std::string& value) {
+    std::memset(clientId, 0, CLIENT_SIZE);
+    std::memcpy(clientId, value.data(), value.size() < CLIENT_SIZE ? value.size() : CLIENT_SIZE);
+}
+
+inline std::string getClientId(const char (&clientId)[CLIENT_SIZE]) {
+    return std::string(clientId, strnlen(clientId, CLIENT_SIZE));
+}
+
+// Field layouts. Each carries its wire size, encode() returning the bytes
+// written and decode() validating the frame.
+
+// A GTC order is SIZE bytes; any other time in force appends it and, for
+// GTD, the expiry, in EXTENDED_SIZE
+struct NewOrder {
+    static constexpr size_t SIZE = HEADER_SIZE + 8 + SYMBOL_SIZE + 1 + 1 + 8 + 8 + 8;
+    static constexpr size_t EXTENDED_SIZE = SIZE + 1 + 8;
+
+    OrderId clientOrderId = 0;
+    char symbol[SYMBOL_SIZE] = {};
+    Side side = Side::BUY;
+    OrderType orderType = OrderType::LIMIT;
+    Price price = 0;
+    Quantity quantity = 0;
+    Price stopPrice = 0;
+    TimeInForce timeInForce = TimeInForce::GTC;
+    uint64_t expireTime = 0;  // GTD: nanoseconds since the epoch (see timestampToNanos)
+
+    size_t encode(char* out) const {
+        bool extended = timeInForce != TimeInForce::GTC;
+        Writer writer(out);
+        writeHeader(writer, MessageType::NEW_ORDER, extended ? EXTENDED_SIZE : SIZE);
+        writer.u64(clientOrderId);
+        writer.bytes(symbol, SYMBOL_SIZE);
+        writer.u8(static_cast<uint8_t>(side));
+        writer.u8(static_cast<uint8_t>(orderType));
+        writer.i64(price);
+        writer.u64(quantity);
+        writer.i64(stopPrice);
+        if (extended) {
+            writer.u8(static_cast<uint8_t>(timeInForce));
+            writer.u64(expireTime);
+        }
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        bool extended = frame.length == EXTENDED_SIZE;
+        if (!openFrame(frame, MessageType::NEW_ORDER, extended ? EXTENDED_SIZE : SIZE, reader)) {
+            return false;
+        }
+        clientOrderId = reader.u64();
+        reader.bytes(symbol, SYMBOL_SIZE);
+        uint8_t sideValue = reader.u8();
+        uint8_t typeValue = reader.u8();
+        if (sideValue > static_cast<uint8_t>(Side::SELL) ||
+            typeValue > static_cast<uint8_t>(OrderType::FOK)) {
+            return false;
+        }
+        side = static_cast<Side>(sideValue);
+        orderType = static_cast<OrderType>(typeValue);
+        price = reader.i64();
+        quantity = reader.u64();
+        stopPrice = reader.i64();
+        timeInForce = TimeInForce::GTC;
+        expireTime = 0;
+        if (extended) {
+            uint8_t timeInForceValue = reader.u8();
+            if (timeInForceValue > static_cast<uint8_t>(TimeInForce::GTD)) {
+                return false;
+            }
+            timeInForce = static_cast<TimeInForce>(timeInForceValue);
+            expireTime = reader.u64();
+        }
+        return true;
+    }
+};
+
+struct CancelOrder {
+    static constexpr size_t SIZE = HEADER_SIZE + 8;
+
+    OrderId orderId = 0;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::CANCEL_ORDER, SIZE);
+        writer.u64(orderId);
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::CANCEL_ORDER, SIZE, reader)) {
+            return false;
+        }
+        orderId = reader.u64();
+        return true;
+    }
+};
+
+struct ModifyOrder {
+    static constexpr size_t SIZE = HEADER_SIZE + 8 + 8 + 8;
+
+    OrderId orderId = 0;
+    Price newPrice = 0;
+    Quantity newQuantity = 0;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::MODIFY_ORDER, SIZE);
+        writer.u64(orderId);
+        writer.i64(newPrice);
+        writer.u64(newQuantity);
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::MODIFY_ORDER, SIZE, reader)) {
+            return false;
+        }
+        orderId = reader.u64();
+        newPrice = reader.i64();
+        newQuantity = reader.u64();
+        return true;
+    }
+};
+
+// Amends one resting order like ModifyOrder, but the ORDER_ACK answering it
+// carries reference as its client order id, so replies to several amends of
+// the same order can be told apart
+struct CancelReplace {
+    static constexpr size_t SIZE = HEADER_SIZE + 8 + 8 + 8 + 8;
+
+    OrderId reference = 0;
+    OrderId orderId = 0;
+    Price newPrice = 0;
+    Quantity newQuantity = 0;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::CANCEL_REPLACE, SIZE);
+        writer.u64(reference);
+        writer.u64(orderId);
+        writer.i64(newPrice);
+        writer.u64(newQuantity);
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::CANCEL_REPLACE, SIZE, reader)) {
+            return false;
+        }
+        reference = reader.u64();
+        orderId = reader.u64();
+        newPrice = reader.i64();
+        newQuantity = reader.u64();
+        return true;
+    }
+};
+
+struct OrderAck {
+    static constexpr size_t SIZE = HEADER_SIZE + 8 + 8 + 1 + 1;
+
+    OrderId clientOrderId = 0;
+    OrderId orderId = 0;
+    OrderStatus status = OrderStatus::PENDING;
+    RejectReason reason = RejectReason::NONE;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::ORDER_ACK, SIZE);
+        writer.u64(clientOrderId);
+        writer.u64(orderId);
+        writer.u8(static_cast<uint8_t>(status));
+        writer.u8(static_cast<uint8_t>(reason));
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::ORDER_ACK, SIZE, reader)) {
+            return false;
+        }
+        clientOrderId = reader.u64();
+        orderId = reader.u64();
+        status = static_cast<OrderStatus>(reader.u8());
+        reason = static_cast<RejectReason>(reader.u8());
+        return true;
+    }
+};
+
+struct OrderReject {
+    static constexpr size_t SIZE = HEADER_SIZE + 8 + 1;
+
+    OrderId clientOrderId = 0;
+    RejectReason reason = RejectReason::NONE;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::ORDER_REJECT, SIZE);
+        writer.u64(clientOrderId);
+        writer.u8(static_cast<uint8_t>(reason));
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::ORDER_REJECT, SIZE, reader)) {
+            return false;
+        }
+        clientOrderId = reader.u64();
+        reason = static_cast<RejectReason>(reader.u8());
+        return true;
+    }
+};
+
+struct ExecutionReport {
+    static constexpr size_t SIZE = HEADER_SIZE + 8 + SYMBOL_SIZE + 1 + 8 + 8 + 8 + 1 + 8;
+
+    OrderId orderId = 0;
+    char symbol[SYMBOL_SIZE] = {};
+    Side side = Side::BUY;
+    Price executionPrice = 0;
+    Quantity executionQuantity = 0;
+    Quantity remainingQuantity = 0;
+    OrderStatus status = OrderStatus::PENDING;
+    uint64_t tradeId = 0;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::EXECUTION_REPORT, SIZE);
+        writer.u64(orderId);
+        writer.bytes(symbol, SYMBOL_SIZE);
+        writer.u8(static_cast<uint8_t>(side));
+        writer.i64(executionPrice);
+        writer.u64(executionQuantity);
+        writer.u64(remainingQuantity);
+        writer.u8(static_cast<uint8_t>(status));
+        writer.u64(tradeId);
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::EXECUTION_REPORT, SIZE, reader)) {
+            return false;
+        }
+        orderId = reader.u64();
+        reader.bytes(symbol, SYMBOL_SIZE);
+        side = static_cast<Side>(reader.u8());
+        executionPrice = reader.i64();
+        executionQuantity = reader.u64();
+        remainingQuantity = reader.u64();
+        status = static_cast<OrderStatus>(reader.u8());
+        tradeId = reader.u64();
+        return true;
+    }
+};
+
+struct MarketData {
+    static constexpr size_t SIZE = HEADER_SIZE + SYMBOL_SIZE + 8 + 8 + 8 + 8;
+
+    char symbol[SYMBOL_SIZE] = {};
+    Price bestBid = 0;
+    Price bestAsk = 0;
+    Quantity bidQuantity = 0;
+    Quantity askQuantity = 0;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::MARKET_DATA, SIZE);
+        writer.bytes(symbol, SYMBOL_SIZE);
+        writer.i64(bestBid);
+        writer.i64(bestAsk);
+        writer.u64(bidQuantity);
+        writer.u64(askQuantity);
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::MARKET_DATA, SIZE, reader)) {
+            return false;
+        }
+        reader.bytes(symbol, SYMBOL_SIZE);
+        bestBid = reader.i64();
+        bestAsk = reader.i64();
+        bidQuantity = reader.u64();
+        askQuantity = reader.u64();
+        return true;
+    }
+};
+
+struct MarketDataSubscribe {
+    static constexpr size_t SIZE = HEADER_SIZE + SYMBOL_SIZE;
+
+    char symbol[SYMBOL_SIZE] = {};  // All zero for every symbol
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::MARKET_DATA_SUBSCRIBE, SIZE);
+        writer.bytes(symbol, SYMBOL_SIZE);
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::MARKET_DATA_SUBSCRIBE, SIZE, reader)) {
+            return false;
+        }
+        reader.bytes(symbol, SYMBOL_SIZE);
+        return true;
+    }
+};
+
+struct BookUpdate {
+    static constexpr size_t SIZE = HEADER_SIZE + SYMBOL_SIZE + 1 + 8 + 8 + 4;
+
+    char symbol[SYMBOL_SIZE] = {};
+    Side side = Side::BUY;
+    Price price = 0;
+    Quantity quantity = 0;
+    uint32_t orderCount = 0;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::BOOK_UPDATE, SIZE);
+        writer.bytes(symbol, SYMBOL_SIZE);
+        writer.u8(static_cast<uint8_t>(side));
+        writer.i64(price);
+        writer.u64(quantity);
+        writer.u32(orderCount);
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::BOOK_UPDATE, SIZE, reader)) {
+            return false;
+        }
+        reader.bytes(symbol, SYMBOL_SIZE);
+        side = static_cast<Side>(reader.u8());
+        price = reader.i64();
+        quantity = reader.u64();
+        orderCount = reader.u32();
+        return true;
+    }
+};
+
+// Batches. Each opens with the client's reference for the whole batch and
+// a member count; the BATCH_ACK answering it echoes the reference and lists
+// one result per member in the order sent.
+
+// Several orders in one symbol, e.g. a ladder of quotes. Stop types are
+// not allowed - there is no stop price.
+struct NewOrderBatch {
+    static constexpr size_t FIXED_SIZE = HEADER_SIZE + 8 + SYMBOL_SIZE + 1;
+    static constexpr size_t ENTRY_SIZE = 1 + 1 + 8 + 8;
+
+    struct Entry {
+        Side side = Side::BUY;
+        OrderType orderType = OrderType::LIMIT;
+        Price price = 0;
+        Quantity quantity = 0;
+    };
+
+    OrderId reference = 0;
+    char symbol[SYMBOL_SIZE] = {};
+    size_t count = 0;
+    Entry entries[MAX_BATCH];
+
+    size_t size() const { return FIXED_SIZE + count * ENTRY_SIZE; }
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::NEW_ORDER_BATCH, size());
+        writer.u64(reference);
+        writer.bytes(symbol, SYMBOL_SIZE);
+        writer.u8(static_cast<uint8_t>(count));
+        for (size_t i = 0; i < count; ++i) {
+            writer.u8(static_cast<uint8_t>(entries[i].side));
+            writer.u8(static_cast<uint8_t>(entries[i].orderType));
+            writer.i64(entries[i].price);
+            writer.u64(entries[i].quantity);
+        }
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        if (frame.type != MessageType::NEW_ORDER_BATCH || frame.length < FIXED_SIZE) {
+            return false;
+        }
+        Reader reader(frame.data + HEADER_SIZE);
+        reference = reader.u64();
+        reader.bytes(symbol, SYMBOL_SIZE);
+        count = reader.u8();
+        if (count == 0 || count > MAX_BATCH || frame.length != size()) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t sideValue = reader.u8();
+            uint8_t typeValue = reader.u8();
+            if (sideValue > static_cast<uint8_t>(Side::SELL) ||
+                typeValue > static_cast<uint8_t>(OrderType::FOK) ||
+                typeValue == static_cast<uint8_t>(OrderType::STOP_LOSS) ||
+                typeValue == static_cast<uint8_t>(OrderType::STOP_LIMIT)) {
+                return false;
+            }
+            entries[i].side = static_cast<Side>(sideValue);
+            entries[i].orderType = static_cast<OrderType>(typeValue);
+            entries[i].price = reader.i64();
+            entries[i].quantity = reader.u64();
+        }
+        return true;
+    }
+};
+
+struct CancelBatch {
+    static constexpr size_t FIXED_SIZE = HEADER_SIZE + 8 + 1;
+    static constexpr size_t ENTRY_SIZE = 8;
+
+    OrderId reference = 0;
+    size_t count = 0;
+    OrderId orderIds[MAX_BATCH] = {};
+
+    size_t size() const { return FIXED_SIZE + count * ENTRY_SIZE; }
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::CANCEL_BATCH, size());
+        writer.u64(reference);
+        writer.u8(static_cast<uint8_t>(count));
+        for (size_t i = 0; i < count; ++i) {
+            writer.u64(orderIds[i]);
+        }
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        if (frame.type != MessageType::CANCEL_BATCH || frame.length < FIXED_SIZE) {
+            return false;
+        }
+        Reader reader(frame.data + HEADER_SIZE);
+        reference = reader.u64();
+        count = reader.u8();
+        if (count == 0 || count > MAX_BATCH || frame.length != size()) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            orderIds[i] = reader.u64();
+        }
+        return true;
+    }
+};
+
+// Cancel/replace of several resting orders
+struct ModifyBatch {
+    static constexpr size_t FIXED_SIZE = HEADER_SIZE + 8 + 1;
+    static constexpr size_t ENTRY_SIZE = 8 + 8 + 8;
+
+    struct Entry {
+        OrderId orderId = 0;
+        Price newPrice = 0;
+        Quantity newQuantity = 0;
+    };
+
+    OrderId reference = 0;
+    size_t count = 0;
+    Entry entries[MAX_BATCH];
+
+    size_t size() const { return FIXED_SIZE + count * ENTRY_SIZE; }
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::MODIFY_BATCH, size());
+        writer.u64(reference);
+        writer.u8(static_cast<uint8_t>(count));
+        for (size_t i = 0; i < count; ++i) {
+            writer.u64(entries[i].orderId);
+            writer.i64(entries[i].newPrice);
+            writer.u64(entries[i].newQuantity);
+        }
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        if (frame.type != MessageType::MODIFY_BATCH || frame.length < FIXED_SIZE) {
+            return false;
+        }
+        Reader reader(frame.data + HEADER_SIZE);
+        reference = reader.u64();
+        count = reader.u8();
+        if (count == 0 || count > MAX_BATCH || frame.length != size()) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            entries[i].orderId = reader.u64();
+            entries[i].newPrice = reader.i64();
+            entries[i].newQuantity = reader.u64();
+        }
+        return true;
+    }
+};
+
+struct BatchAck {
+    static constexpr size_t FIXED_SIZE = HEADER_SIZE + 8 + 1;
+    static constexpr size_t ENTRY_SIZE = 8 + 1 + 1;
+
+    struct Entry {
+        OrderId orderId = 0;
+        OrderStatus status = OrderStatus::PENDING;
+        RejectReason reason = RejectReason::NONE;
+    };
+
+    OrderId reference = 0;
+    size_t count = 0;
+    Entry entries[MAX_BATCH];
+
+    size_t size() const { return FIXED_SIZE + count * ENTRY_SIZE; }
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::BATCH_ACK, size());
+        writer.u64(reference);
+        writer.u8(static_cast<uint8_t>(count));
+        for (size_t i = 0; i < count; ++i) {
+            writer.u64(entries[i].orderId);
+            writer.u8(static_cast<uint8_t>(entries[i].status));
+            writer.u8(static_cast<uint8_t>(entries[i].reason));
+        }
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        if (frame.type != MessageType::BATCH_ACK || frame.length < FIXED_SIZE) {
+            return false;
+        }
+        Reader reader(frame.data + HEADER_SIZE);
+        reference = reader.u64();
+        count = reader.u8();
+        if (count > MAX_BATCH || frame.length != size()) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            entries[i].orderId = reader.u64();
+            entries[i].status = static_cast<OrderStatus>(reader.u8());
+            entries[i].reason = static_cast<RejectReason>(reader.u8());
+        }
+        return true;
+    }
+};
+
+// Pulls the logged-on client's orders - in one symbol unless the symbol is
+// all zero, on one side unless side is BOTH_SIDES
+struct MassCancel {
+    static constexpr size_t SIZE = HEADER_SIZE + 8 + SYMBOL_SIZE + 1;
+    static constexpr uint8_t BOTH_SIDES = 2;
+
+    OrderId reference = 0;
+    char symbol[SYMBOL_SIZE] = {};
+    uint8_t side = BOTH_SIDES;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::MASS_CANCEL, SIZE);
+        writer.u64(reference);
+        writer.bytes(symbol, SYMBOL_SIZE);
+        writer.u8(side);
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::MASS_CANCEL, SIZE, reader)) {
+            return false;
+        }
+        reference = reader.u64();
+        reader.bytes(symbol, SYMBOL_SIZE);
+        side = reader.u8();
+        return side <= BOTH_SIDES;
+    }
+};
+
+struct MassCancelAck {
+    static constexpr size_t SIZE = HEADER_SIZE + 8 + 4;
+
+    OrderId reference = 0;
+    uint32_t cancelled = 0;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::MASS_CANCEL_ACK, SIZE);
+        writer.u64(reference);
+        writer.u32(cancelled);
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::MASS_CANCEL_ACK, SIZE, reader)) {
+            return false;
+        }
+        reference = reader.u64();
+        cancelled = reader.u32();
+        return true;
+    }
+};
+
+struct Heartbeat {
+    static constexpr size_t SIZE = HEADER_SIZE + 8;
+
+    uint64_t sequenceNumber = 0;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::HEARTBEAT, SIZE);
+        writer.u64(sequenceNumber);
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::HEARTBEAT, SIZE, reader)) {
+            return false;
+        }
+        sequenceNumber = reader.u64();
+        return true;
+    }
+};
+
+// Engine links. A gateway forwards the commands its sessions send to the
+// engine node that owns them, one LINK_COMMAND per command, and the node
+// answers each with a LINK_RESULT under the same tag. Symbols and clients
+// travel by name, since interned ids are local to a process.
+struct LinkCommand {
+    static constexpr size_t SIZE = HEADER_SIZE + 8 + 1 + 1 + 1 + 1 + 8 + 8 + 8 + 8 +
+                                   SYMBOL_SIZE + CLIENT_SIZE + 1 + 8;
+
+    uint64_t tag = 0;
+    uint8_t type = 0;  // CommandType
+    Side side = Side::BUY;
+    OrderType orderType = OrderType::LIMIT;
+    uint8_t scope = 0;
+    OrderId orderId = 0;
+    Price price = 0;
+    Quantity quantity = 0;
+    Price stopPrice = 0;
+    char symbol[SYMBOL_SIZE] = {};
+    char clientId[CLIENT_SIZE] = {};
+    TimeInForce timeInForce = TimeInForce::GTC;
+    uint64_t expireTime = 0;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::LINK_COMMAND, SIZE);
+        writer.u64(tag);
+        writer.u8(type);
+        writer.u8(static_cast<uint8_t>(side));
+        writer.u8(static_cast<uint8_t>(orderType));
+        writer.u8(scope);
+        writer.u64(orderId);
+        writer.i64(price);
+        writer.u64(quantity);
+        writer.i64(stopPrice);
+        writer.bytes(symbol, SYMBOL_SIZE);
+        writer.bytes(clientId, CLIENT_SIZE);
+        writer.u8(static_cast<uint8_t>(timeInForce));
+        writer.u64(expireTime);
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::LINK_COMMAND, SIZE, reader)) {
+            return false;
+        }
+        tag = reader.u64();
+        type = reader.u8();
+        uint8_t sideValue = reader.u8();
+        uint8_t typeValue = reader.u8();
+        if (type > static_cast<uint8_t>(CommandType::MASS_CANCEL) || sideValue > static_cast<uint8_t>(Side::SELL) ||
+            typeValue > static_cast<uint8_t>(OrderType::FOK)) {
+            return false;
+        }
+        side = static_cast<Side>(sideValue);
+        orderType = static_cast<OrderType>(typeValue);
+        scope = reader.u8();
+        orderId = reader.u64();
+        price = reader.i64();
+        quantity = reader.u64();
+        stopPrice = reader.i64();
+        reader.bytes(symbol, SYMBOL_SIZE);
+        reader.bytes(clientId, CLIENT_SIZE);
+        uint8_t timeInForceValue = reader.u8();
+        if (timeInForceValue > static_cast<uint8_t>(TimeInForce::GTD)) {
+            return false;
+        }
+        timeInForce = static_cast<TimeInForce>(timeInForceValue);
+        expireTime = reader.u64();
+        return true;
+    }
+};
+
+// Answer to a LinkCommand. With hasReport set, the order fields are the
+// new order's state at the end of matching.
+struct LinkResult {
+    static constexpr size_t SIZE = HEADER_SIZE + 8 + 1 + 1 + 8 + 8 + 1 + 1 + 8 + 8 + 8;
+
+    uint64_t tag = 0;
+    bool success = false;
+    RejectReason reason = RejectReason::NONE;
+    OrderId orderId = 0;    // Assigned to a new order
+    Quantity quantity = 0;  // Orders a mass cancel pulled
+    bool hasReport = false;
+    OrderStatus status = OrderStatus::PENDING;
+    Price price = 0;
+    Quantity filledQuantity = 0;
+    Quantity remainingQuantity = 0;
+
+    size_t encode(char* out) const {
+        Writer writer(out);
+        writeHeader(writer, MessageType::LINK_RESULT, SIZE);
+        writer.u64(tag);
+        writer.u8(success ? 1 : 0);
+        writer.u8(static_cast<uint8_t>(reason));
+        writer.u64(orderId);
+        writer.u64(quantity);
+        writer.u8(hasReport ? 1 : 0);
+        writer.u8(static_cast<uint8_t>(status));
+        writer.i64(price);
+        writer.u64(filledQuantity);
+        writer.u64(remainingQuantity);
+        return writer.size();
+    }
+
+    bool decode(const Frame& frame) {
+        Reader reader(nullptr);
+        if (!openFrame(frame, MessageType::LINK_RESULT, SIZE, reader)) {
+            return false;
+        }
+        tag = reader.u64();
+        success = reader.u8() != 0;
+        reason = static_cast<RejectReason>(reader.u8());
+        orderId = reader.u64();
+        quantity = reader.u64();
+        hasReport = reader.u8() != 0;
+        status = static_cast<OrderStatus>(reader.u8());
+        price = reader.i64();
+        filledQuantity = reader.u64();
+        remainingQuantity = reader.u64();
+        return true;
+    }
+};
+
+} // namespace ProtocolV2
+
+} // namespace MatchingEngine
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Common.h"
+#include "EngineCommand.h"
+#include "Journal.h"
+#include "RingBuffer.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketType;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int SocketType;
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define closesocket close
+#endif
+
+namespace MatchingEngine {
+
+// Hot standby. The primary streams every command its engine sequences to one
+// standby as JournalRecords - the order the shards applied them in, with the
+// sequencer's timestamps - and the standby applies them to an identical
+// engine as they arrive, so it holds the same books and can take over
+// without replaying anything. The standby acknowledges cumulatively, once
+// per batch received, after applying it; a record with sequence 0 is a
+// heartbeat.
+//
+// A standby attaches only to a primary that hasn't sequenced anything yet,
+// and both start from empty books: there is no catch-up from a snapshot.
+// Once the standby is lost the primary carries on unreplicated.
+
+// Primary side
+class ReplicationPublisher {
+public:
+    // Fired on the ack thread with the highest sequence the standby has
+    // applied; attached false means the standby is gone for good
+    using AckCallback = std::function<void(uint64_t ackedSequence, bool attached)>;
+
+    explicit ReplicationPublisher(uint16_t port, uint32_t heartbeatIntervalMs = 5,
+                                  size_t queueCapacity = 16384);
+    ~ReplicationPublisher();
+
+    ReplicationPublisher(const ReplicationPublisher&) = delete;
+    ReplicationPublisher& operator=(const ReplicationPublisher&) = delete;
+
+    bool start();  // Listen for the standby
+    void stop();   // Sends what is queued first
+    uint16_t getPort() const { return port_; }
+
+    // Queue a sequenced command for the standby, from any thread. Returns its
+    // position in the stream, or 0 if no standby is attached - the first
+    // command published without one means none can attach later.
+    uint64_t publish(const EngineCommand& command);
+
+    bool hasStandby() const { return state_.load(std::memory_order_acquire) == ATTACHED; }
+    uint64_t getPublishedSequence() const { return published_.load(std::memory_order_acquire); }
+    uint64_t getAckedSequence() const { return acked_.load(std::memory_order_acquire); }
+
+    void setAckCallback(AckCallback callback) { ackCallback_ = std::move(callback); }
+
+private:
+    enum State : uint8_t {
+        WAITING,   // Nothing published, a standby may still attach
+        ATTACHED,
+        DETACHED   // Never replicating again
+    };
+
+    uint16_t port_;
+    uint32_t heartbeatIntervalMs_;
+    MpscRing<JournalRecord> queue_;
+    SocketType listenSocket_;
+    SocketType standbySocket_;
+    std::thread acceptThread_;
+    std::thread senderThread_;
+    std::atomic<bool> running_;
+    std::atomic<State> state_;
+    std::mutex attachMutex_;  // WAITING -> ATTACHED or DETACHED, decided once
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> published_;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> acked_;
+    AckCallback ackCallback_;
+
+    void runAcceptor();
+    bool attach(SocketType socket);
+    void readAcks();
+    void runSender();
+    bool sendAll(const void* data, size_t length);
+};
+
+// Standby side
+class ReplicationReceiver {
+public:
+    using ApplyHandler = std::function<void(const EngineCommand& command)>;
+    using FailoverHandler = std::function<void()>;
+
+    ReplicationReceiver(const std::string& primaryHost, uint16_t primaryPort,
+                        uint32_t failoverTimeoutMs = 50);
+    ~ReplicationReceiver();
+
+    ReplicationReceiver(const ReplicationReceiver&) = delete;
+    ReplicationReceiver& operator=(const ReplicationReceiver&) = delete;
+
+    // Attach to the primary; false if it can't be reached or refuses. apply
+    // runs on the receiver's thread for each command in stream order. Once
+    // the primary closes the stream or stays silent for failoverTimeoutMs,
+    // failover runs on the same thread, after the last command it sent.
+    bool start(ApplyHandler apply, FailoverHandler failover);
+    void stop();  // Detach without failing over
+
+    uint64_t getAppliedSequence() const { return applied_.load(std::memory_order_acquire); }
+
+private:
+    std::string primaryHost_;
+    uint16_t primaryPort_;
+    uint32_t failoverTimeoutMs_;
+    SocketType socket_;
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> applied_;
+    ApplyHandler apply_;
+    FailoverHandler failover_;
+
+    void run();
+};
+
+} // namespace MatchingEngine
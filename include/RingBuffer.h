@@ -0,0 +1,204 @@
+#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace MatchingEngine {
+
+inline size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Bounded single-producer / single-consumer ring. Head and tail live on
+// separate cache lines and each side caches the other's index, so the
+// common case touches no shared line at all.
+template<typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "ring slots are copied by value");
+
+public:
+    explicit SpscRing(size_t capacity)
+        : capacity_(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity))
+        , mask_(capacity_ - 1)
+        , slots_(new T[capacity_]) {
+    }
+
+    bool tryPush(const T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ >= capacity_) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ >= capacity_) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_) {
+                return false;
+            }
+        }
+        value = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pop up to maxCount items into out; returns how many were taken
+    size_t popBatch(T* out, size_t maxCount) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t available = cachedTail_ - head;
+        if (available == 0) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            available = cachedTail_ - head;
+        }
+        size_t count = available < maxCount ? available : maxCount;
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = slots_[(head + i) & mask_];
+        }
+        if (count > 0) {
+            head_.store(head + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_{0};
+    size_t cachedTail_ = 0;  // Consumer's view of tail_
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{0};
+    size_t cachedHead_ = 0;  // Producer's view of head_
+};
+
+// Bounded multi-producer / single-consumer ring. Producers claim a slot
+// with one CAS on the tail; every slot carries a sequence number that tells
+// the consumer when the write has landed (Vyukov's bounded queue).
+template<typename T>
+class MpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "ring slots are copied by value");
+
+public:
+    explicit MpscRing(size_t capacity)
+        : capacity_(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity))
+        , mask_(capacity_ - 1)
+        , cells_(new Cell[capacity_]) {
+        for (size_t i = 0; i < capacity_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // position (if given) receives the value's place in the overall push
+    // order, which is also the order the consumer pops in
+    bool tryPush(const T& value, size_t* position = nullptr) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[tail & mask_];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(tail);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(tail + 1, std::memory_order_release);
+                    if (position) {
+                        *position = tail;
+                    }
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Full
+            } else {
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Push count values into consecutive slots, so no other producer's
+    // value lands between them - all or nothing. count must be at most
+    // capacity().
+    bool tryPushBatch(const T* values, size_t count) {
+        if (count == 0) {
+            return true;
+        }
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            // The consumer frees slots in order, so if the last is free all are
+            size_t last = tail + count - 1;
+            size_t sequence = cells_[last & mask_].sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(last);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(tail, tail + count, std::memory_order_relaxed)) {
+                    for (size_t i = 0; i < count; ++i) {
+                        Cell& cell = cells_[(tail + i) & mask_];
+                        cell.value = values[i];
+                        cell.sequence.store(tail + i + 1, std::memory_order_release);
+                    }
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Not enough room
+            } else {
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value) {
+        Cell& cell = cells_[head_ & mask_];
+        if (cell.sequence.load(std::memory_order_acquire) != head_ + 1) {
+            return false;
+        }
+        value = cell.value;
+        cell.sequence.store(head_ + capacity_, std::memory_order_release);
+        ++head_;
+        return true;
+    }
+
+    // Pop up to maxCount items into out; returns how many were taken
+    size_t popBatch(T* out, size_t maxCount) {
+        size_t count = 0;
+        while (count < maxCount && tryPop(out[count])) {
+            ++count;
+        }
+        return count;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{0};
+    alignas(CACHE_LINE_SIZE) size_t head_ = 0;  // Consumer only
+};
+
+} // namespace MatchingEngine
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "Common.h"
+#include "EngineCommand.h"
+#include "Order.h"
+#include "OrderIndex.h"
+#include "OptionalMutex.h"
+#include "RingBuffer.h"
+#include <atomic>
+#include <vector>
+
+namespace MatchingEngine {
+
+// Pre-trade limits for one client; 0 leaves a limit off. Notional is price
+// (in Price units) times quantity.
+struct RiskLimits {
+    Quantity maxOrderQuantity = 0;
+    uint64_t maxOrderNotional = 0;
+    uint64_t maxOpenNotional = 0;    // Across the client's working orders
+    uint64_t maxPosition = 0;        // Per symbol, if every working order on the side filled
+    uint32_t maxOrdersPerSecond = 0;
+    uint32_t priceBandBps = 0;       // Limit price within this far of the reference price
+
+    bool any() const {
+        return maxOrderQuantity || maxOrderNotional || maxOpenNotional || maxPosition ||
+               maxOrdersPerSecond || priceBandBps;
+    }
+};
+
+// Pre-trade risk for one engine. check() is the stage an order passes
+// before it reaches its book; the engine feeds back what the client has
+// working and what has filled as orders are accepted, modified and leave
+// the book. State lives in flat records indexed by interned client id
+// under its own lock (off when the engine is single-threaded). Matching
+// never takes that lock: orders retired from inside a book go onto a
+// lock-free queue that the next check applies.
+//
+// Exposure is tracked while any limit is set, so set limits before orders
+// flow. Positions count fills of orders that have left the book; an order
+// still working counts at its full size on its side, so the check sees the
+// position the client would have if everything working filled.
+class RiskCheck {
+public:
+    explicit RiskCheck(bool synchronized = true);
+
+    // Limits for clients without their own, and for one client
+    void setDefaultLimits(const RiskLimits& limits);
+    void setClientLimits(ClientKey clientKey, const RiskLimits& limits);
+    bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // Reference for the price band, e.g. the previous close; trades move it
+    void setReferencePrice(SymbolId symbolId, Price price);
+    Price getReferencePrice(SymbolId symbolId) const;
+
+    // NONE if the new order may go on to its book. Every order checked
+    // counts against the client's rate, refused or not.
+    RejectReason check(const EngineCommand& command);
+
+    // The same limits for amending a working order (current, as it stands)
+    // to newQuantity remaining at newPrice, measured against what it holds
+    // now. Amends do not count against the rate.
+    RejectReason checkModify(const Order& current, Price newPrice, Quantity newQuantity);
+
+    // Exposure bookkeeping, driven by the engine. onRetire may run under a
+    // book lock, so it only queues the order's release.
+    void onAccept(const Order& order);
+    void onModify(const Order& order);  // State after the amend
+    void onRetire(const Order& order);
+    void onTrade(SymbolId symbolId, Price price);
+
+    // Current exposure, with every queued retire applied
+    uint64_t getOpenNotional(ClientKey clientKey);
+    int64_t getPosition(ClientKey clientKey, SymbolId symbolId);  // Filled, net
+
+private:
+    struct alignas(CACHE_LINE_SIZE) ClientState {
+        RiskLimits limits;
+        bool hasLimits = false;
+        uint64_t openNotional = 0;
+        int64_t windowSecond = 0;  // Rate window the count belongs to
+        uint32_t windowOrders = 0;
+    };
+
+    struct PositionState {
+        int64_t filled = 0;
+        Quantity workingBuy = 0;
+        Quantity workingSell = 0;
+    };
+
+    // What a live order holds against its client
+    struct Working {
+        ClientKey clientKey;
+        SymbolId symbolId;
+        Side side;
+        Quantity quantity;
+        uint64_t notional;
+    };
+
+    // A retired order's release, queued by matching
+    struct Retired {
+        OrderId orderId;
+        Quantity filled;
+    };
+
+    std::atomic<bool> enabled_;
+    RiskLimits defaultLimits_;
+    std::vector<ClientState> clients_;     // By client key, grown on first sight
+    std::vector<Price> references_;        // By symbol id
+    OrderIdMap<PositionState> positions_;  // By positionKey
+    OrderIdMap<Working> working_;          // By order id
+    MpscRing<Retired> retired_;            // Popped under mutex_
+    mutable OptionalMutex mutex_;
+
+    ClientState& client(ClientKey clientKey);
+    void applyRetired();  // Under mutex_
+    void retire(const Retired& retired);
+    uint64_t notionalOf(SymbolId symbolId, Price price, Price stopPrice, Quantity quantity) const;
+    // order's limits, with replaced (if any) the hold it would take the place of
+    RejectReason checkLimits(const RiskLimits& limits, const ClientState& state,
+                             const Working& order, Price price, const Working* replaced) const;
+    static uint64_t positionKey(ClientKey clientKey, SymbolId symbolId) {
+        return (static_cast<uint64_t>(clientKey) << 32) | symbolId;
+    }
+};
+
+} // namespace MatchingEngine
@@ -2,11 +2,23 @@
 
 #include "Common.h"
 #include "MatchingEngine.h"
+#include "ShardedEngine.h"
+#include "Gateway.h"
 #include "Message.h"
+#include "FrameBuffer.h"
+#include "Journal.h"
+#include "MarketDataPublisher.h"
+#include "FeedPublisher.h"
+#include "MetricsEndpoint.h"
+#include "Replication.h"
+#include "Transport.h"
+#include <deque>
 #include <memory>
 #include <thread>
 #include <atomic>
+#include <mutex>
 #include <vector>
+#include <unordered_map>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -26,9 +38,72 @@ typedef int SocketType;
 
 namespace MatchingEngine {
 
+class BatchReply;
+
+// How the server multiplexes client connections
+enum class ServerIoMode {
+    THREAD_PER_CLIENT,  // Blocking sockets, one thread per connection (portable)
+    EPOLL,              // Non-blocking sockets on a fixed pool of epoll loops (Linux)
+    IO_URING            // As EPOLL, polling through io_uring; falls back to epoll if unavailable
+};
+
+struct ServerConfig {
+    uint16_t port = SERVER_PORT;  // 0 picks a free port - see getPort()
+#ifdef __linux__
+    ServerIoMode ioMode = ServerIoMode::EPOLL;
+#else
+    ServerIoMode ioMode = ServerIoMode::THREAD_PER_CLIENT;
+#endif
+    size_t ioThreads = 2;     // Event loops (EPOLL / IO_URING)
+    size_t engineShards = 2;  // Matching shards behind the event loops
+    uint8_t maxProtocolVersion = 2;  // Highest wire version granted at logon
+    bool logEvents = true;           // Print order updates and trades off the matching threads
+    JournalConfig journal;           // Set journal.directory to journal every command
+    std::string snapshotPath;        // State is restored from here (+ journal) on start
+    uint32_t snapshotIntervalSeconds = 60;  // Event loop modes; otherwise only at stop()
+    bool feedEnabled = false;        // Publish the books over UDP as well (any I/O mode)
+    FeedConfig feed;
+    RiskLimits riskLimits;           // Pre-trade limits for every client (all off by default)
+    ExpiryConfig expiry;             // When DAY and GTD orders lapse
+    size_t expiryBatch = 4096;       // Most orders expired at once (see ShardedEngineConfig)
+    bool metricsEnabled = false;     // Time every stage of the order path (see Metrics.h)
+    uint16_t metricsPort = 9100;     // ...and serve them over HTTP; 0 picks a free port
+    uint8_t nodeId = 0;              // Position in a gateway's node list, if behind one
+    // Addresses of the gateways allowed to send LINK_COMMAND; a session
+    // from anywhere else that sends one is dropped
+    std::vector<std::string> linkPeers;
+    
+    // Gateway mode (event loop modes): match nothing locally and route every
+    // command to these engine nodes instead - see Gateway. The nodes journal,
+    // snapshot and apply risk limits; market data isn't served here.
+    std::vector<GatewayNode> gatewayNodes;
+    
+    // Hot standby (event loop modes, see Replication.h). A primary with
+    // replicationEnabled streams every command it sequences to a standby
+    // on replicationPort and holds each reply until the standby has applied
+    // the commands before it. A standby (primaryPort set) applies that
+    // stream and only opens port once the primary closes it or goes quiet
+    // for failoverTimeoutMs. Both start empty, with the same engineShards,
+    // nodeId and riskLimits.
+    bool replicationEnabled = false;
+    uint16_t replicationPort = 9300;      // 0 picks a free port - see getReplicationPort()
+    uint32_t heartbeatIntervalMs = 5;     // Primary, while it has nothing to stream
+    std::string primaryHost = "127.0.0.1";
+    uint16_t primaryPort = 0;             // Non-zero makes this server a standby
+    uint32_t failoverTimeoutMs = 50;
+    
+    // Sockets and CPUs. Pinning works in any mode; lowLatency (see
+    // LowLatencyOptions) also makes the event loops and shards spin.
+    TransportType transport = TransportType::KERNEL;
+    LowLatencyOptions lowLatency;
+    std::vector<int> ioCpus;     // CPU to pin each event loop to; missing or -1 = unpinned
+    std::vector<int> shardCpus;  // ...and each matching shard
+};
+
 class Server {
 public:
     explicit Server(uint16_t port = SERVER_PORT);
+    explicit Server(const ServerConfig& config);
     ~Server();
 
     // Server lifecycle
@@ -36,36 +111,122 @@ public:
     void stop();
     bool isRunning() const { return running_; }
 
+    uint16_t getPort() const { return port_; }
+    uint16_t getMetricsPort() const { return metricsEndpoint_ ? metricsEndpoint_->getPort() : 0; }
+    uint16_t getReplicationPort() const { return replication_ ? replication_->getPort() : 0; }
+    bool isStandby() const { return standby_ && !promoted_; }  // Not serving clients yet
+    ServerIoMode getIoMode() const { return config_.ioMode; }
+
     // Statistics
     size_t getActiveConnections() const { return activeConnections_; }
     size_t getTotalOrders() const;
     size_t getTotalTrades() const;
 
 private:
+    struct Session;
+    struct IoWorker;
+    using ReplyBuffer = std::vector<char>;
+
+    ServerConfig config_;
     uint16_t port_;
+    std::unique_ptr<Transport> transport_;
     SocketType serverSocket_;
     std::atomic<bool> running_;
     std::atomic<size_t> activeConnections_;
+    std::unique_ptr<Journal> journal_;  // Fed by the engine's command hook
+    std::unique_ptr<EventRing> events_; // Engine output for downstream consumers
+    std::unique_ptr<MarketDataPublisher> marketData_;  // L2 feed, event loop modes
+    std::unique_ptr<FeedPublisher> feed_;              // UDP L2 feed, if enabled
+    std::unique_ptr<MetricsEndpoint> metricsEndpoint_; // Prometheus scrape target, if enabled
+    std::thread snapshotThread_;
+    std::thread expiryThread_;  // THREAD_PER_CLIENT; shards expire their own orders
+    bool recovered_;
     
+    // THREAD_PER_CLIENT: synchronous engine, one thread per connection.
+    // Threads of disconnected clients are joined on the next accept.
+    struct ClientThread {
+        std::thread thread;
+        SocketType socket;
+    };
     std::unique_ptr<MatchingEngineCore> engine_;
     std::thread acceptThread_;
-    std::vector<std::thread> clientThreads_;
+    std::unordered_map<std::thread::id, ClientThread> clientThreads_;
+    std::vector<std::thread::id> finishedClients_;
+    std::mutex clientsMutex_;
+    
+    // Event loop modes: I/O threads hand commands to the matching shards,
+    // and results come back to the owning session through the command callback
+    std::unique_ptr<ShardedEngine> shardedEngine_;
+    std::unique_ptr<Gateway> gateway_;  // Instead of shardedEngine_ in gateway mode
+    std::vector<std::unique_ptr<IoWorker>> ioWorkers_;
+    std::unordered_map<uint64_t, std::shared_ptr<Session>> sessions_;
+    std::mutex sessionsMutex_;
+    std::atomic<uint64_t> nextSessionId_;
+    std::atomic<size_t> nextWorker_;
+    
+    // Hot standby and journal sync. Replies queue behind the replication
+    // and journal sequences current when they were made (0 = not waiting
+    // on that one), released in order as the standby acks and the journal
+    // syncs.
+    struct HeldReply {
+        uint64_t sequence;
+        uint64_t journalSequence;
+        std::shared_ptr<Session> session;
+        ReplyBuffer bytes;
+    };
+    std::unique_ptr<ReplicationPublisher> replication_;
+    std::unique_ptr<ReplicationReceiver> standby_;
+    std::atomic<bool> promoted_;
+    std::deque<HeldReply> heldReplies_;
+    std::mutex heldMutex_;
+    std::atomic<bool> lowLatencyWarned_;
 
     // Network operations
     void acceptClients();
-    void handleClient(SocketType clientSocket);
+    void handleClient(SocketType clientSocket, bool linkAllowed);
+    bool isLinkPeer(const std::string& address) const;
+    void reapClients();
     
-    // Message handlers
-    void handleNewOrder(SocketType clientSocket, const NewOrderMessage& msg);
-    void handleCancelOrder(SocketType clientSocket, const CancelOrderMessage& msg);
-    void handleModifyOrder(SocketType clientSocket, const ModifyOrderMessage& msg);
+    // Runs a decoded command on the synchronous engine - replies are
+    // collected and sent once per read. A batch member's result goes to
+    // batch instead, which replies for the whole batch.
+    void executeCommand(ReplyBuffer& replies, uint8_t version, EngineCommand& command,
+                        BatchReply* batch = nullptr);
+    
+    bool serveClients();  // Listen on port and start handling connections
+    
+    // Event loop
+    bool startEventLoops();
+    void stopEventLoops();
+    void runIoWorker(IoWorker& worker);
+    void acceptPending();
+    void readSession(IoWorker& worker, const std::shared_ptr<Session>& session);
+    void writeSession(IoWorker& worker, const std::shared_ptr<Session>& session);
+    void closeSession(IoWorker& worker, const std::shared_ptr<Session>& session);
+    bool dispatchFrame(Session& session, const Frame& frame);
+    void queueReply(Session& session, const void* data, size_t length);
+    void requestFlush(Session& session);
+    void onCommandComplete(const EngineCommand& command, bool success, const Order* order);
+    void sendReplies(const std::shared_ptr<Session>& session, const ReplyBuffer& replies);
+    void releaseHeldReplies();  // heldMutex_ held
+    bool releasable(const HeldReply& held) const;
+    bool waitsForJournal() const {
+        return journal_ && config_.journal.fsyncPolicy != FsyncPolicy::ASYNC;
+    }
+    void takeOver();
+    void onMarketDataReady(uint64_t sessionId);
+    
+    // Persistence
+    bool recoverState();
+    void runSnapshots();
+    void runExpiries();
+    void takeSnapshot();
     
     // Utilities
+    void configureSocket(SocketType socket, int cpu);  // For the thread on cpu
     bool sendMessage(SocketType socket, const void* data, size_t length);
-    bool receiveMessage(SocketType socket, void* buffer, size_t length);
     void initializeSocket();
     void cleanupSocket();
 };
 
 } // namespace MatchingEngine
-
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Common.h"
+#include "EngineCommand.h"
+#include "FrameBuffer.h"
+#include "Order.h"
+#include "MarketDataPublisher.h"
+#include "ProtocolV2.h"
+#include <vector>
+
+namespace MatchingEngine {
+
+// Per-connection protocol state
+struct SessionState {
+    uint8_t protocolVersion = 1;  // Until a logon negotiates higher
+    ClientKey clientKey = 0;      // From logon; every order's once logged on
+    bool loggedOn = false;
+    bool link = false;            // A gateway's link - results go back as LINK_RESULT
+    bool linkAllowed = false;     // The peer is a trusted gateway (ServerConfig::linkPeers)
+};
+
+// What an inbound frame turned out to be
+enum class FrameAction {
+    COMMAND,  // Decoded into an engine command for the caller to run
+    REPLIED,  // Handled here (logon, heartbeat); any reply has been appended
+    SUBSCRIBE,  // Market data request; command.symbolId is the symbol (0 = all)
+    BATCH,    // Batch request (v2); the members are in batch, see EngineCommand::inBatch
+    IGNORED,  // Unknown type, skipped by its length
+    INVALID   // Malformed - the connection should be dropped
+};
+
+// Decode one frame in either protocol version. A logon switches state and
+// input over to the negotiated version (at most maxVersion) for the frames
+// that follow it.
+FrameAction decodeFrame(const Frame& frame, SessionState& state, FrameBuffer& input,
+                        std::vector<char>& replies, EngineCommand& command,
+                        std::vector<EngineCommand>& batch, uint8_t maxVersion);
+
+// Append the replies for a command that has been applied: an ack, plus an
+// execution report when a new order traded, or a reject for a new order
+// the risk stage refused. order is the new order's state
+// at the end of matching (nullptr for cancel/modify).
+void appendCommandResult(std::vector<char>& replies, uint8_t version,
+                         const EngineCommand& command, bool success, const Order* order);
+
+// Append the LINK_RESULT answering a command that came over a gateway link;
+// command.clientOrderId is the link's tag
+void appendLinkResult(std::vector<char>& replies, const EngineCommand& command, bool success,
+                      const Order* order);
+
+// Gathers the results of a batch's members - which may complete in any
+// order, on different shards - into the one acknowledgement the client gets:
+// a BATCH_ACK listing every member in the order sent, then the execution
+// reports of the new orders that traded. For a mass cancel copied to several
+// shards it is one MASS_CANCEL_ACK with the total cancelled. A client must
+// not reuse a batch reference until its acknowledgement has arrived.
+class BatchReply {
+public:
+    // Record a member's result; true once every member has reported
+    bool add(const EngineCommand& command, bool success, const Order* order);
+
+    // Append the acknowledgement (protocol v2 - batches don't exist in v1)
+    void append(std::vector<char>& replies) const;
+
+    // Orders a mass cancel's copies pulled between them
+    uint64_t getCancelled() const { return cancelled_; }
+
+private:
+    CommandType type_ = CommandType::NEW_ORDER;
+    size_t reported_ = 0;
+    uint64_t cancelled_ = 0;
+    ProtocolV2::BatchAck ack_;
+    std::vector<char> reports_;
+};
+
+// Append one incremental L2 update
+void appendBookUpdate(std::vector<char>& replies, uint8_t version, const LevelUpdate& update);
+
+// Console trace of an inbound command; buffered, not flushed per line
+void logCommand(const EngineCommand& command);
+
+} // namespace MatchingEngine
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "Common.h"
+#include "EngineCommand.h"
+#include "MatchingEngine.h"
+#include "RingBuffer.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace MatchingEngine {
+
+// Maps a symbol to a shard; the result is taken modulo the shard count
+using SymbolHash = std::function<size_t(const std::string&)>;
+
+// Fired on the shard thread once a command has been applied. order is the
+// new order's state at the end of matching, nullptr for cancel/modify. A
+// new order the risk stage refused has success false, no order, and the
+// reason in command.reject.
+using CommandCallback = std::function<void(const EngineCommand& command, bool success,
+                                           const Order* order)>;
+
+struct ShardedEngineConfig {
+    size_t shardCount = 1;
+    size_t queueCapacity = 65536;  // Commands buffered per shard
+    std::vector<int> shardCpus;    // CPU to pin each shard to; missing or -1 = unpinned
+    SymbolHash symbolHash;         // Defaults to std::hash<std::string>
+    size_t spinIterations = 10000; // Empty polls before an idle shard starts sleeping
+    uint8_t nodeId = 0;            // Engine node behind a gateway; 0 when standalone
+    ExpiryConfig expiry;           // When DAY and GTD orders lapse
+    size_t expiryBatch = 4096;     // Most orders a shard expires between two command batches
+};
+
+// Engine that partitions symbols across shards. Each shard is one thread
+// that owns a MatchingEngineCore outright and runs it without locks;
+// producers on any thread hand it commands through a lock-free MPSC ring.
+//
+// Calls return once the command is queued. Order ids are assigned at submit
+// time and carry their shard in the low SHARD_BITS and the node id in the
+// top NODE_BITS, so cancels and modifies route without a lookup - here and
+// at a gateway in front of several nodes - and ids stay unique across
+// nodes without coordination. Callbacks fire on the shard threads.
+//
+// Each running shard expires its own DAY and GTD orders (see
+// MatchingEngineCore::expireOrders) between command batches, expiryBatch at
+// a time, so a close that lapses millions of orders is spread over many
+// batches instead of holding up the shard's queue. A standby applying a
+// primary's stream leaves expiry to the primary until it takes over.
+class ShardedEngine {
+public:
+    static constexpr unsigned SHARD_BITS = 8;
+    static constexpr size_t MAX_SHARDS = size_t(1) << SHARD_BITS;
+    static constexpr unsigned NODE_BITS = 8;
+    static constexpr unsigned NODE_SHIFT = 64 - NODE_BITS;
+    static constexpr size_t MAX_NODES = size_t(1) << NODE_BITS;
+
+    explicit ShardedEngine(const ShardedEngineConfig& config = ShardedEngineConfig());
+    ~ShardedEngine();
+
+    ShardedEngine(const ShardedEngine&) = delete;
+    ShardedEngine& operator=(const ShardedEngine&) = delete;
+
+    void start();
+    void stop();  // Drains queued commands before the shard threads exit
+    bool isRunning() const { return running_; }
+
+    // Order operations - return the assigned id / true once queued, or
+    // 0 / false if the engine is stopped with the shard's queue full
+    OrderId submitOrder(const std::string& symbol,
+                        Side side,
+                        OrderType type,
+                        Price price,
+                        Quantity quantity,
+                        const std::string& clientId = "",
+                        Price stopPrice = 0);
+
+    bool cancelOrder(OrderId orderId);
+    bool modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity);
+
+    // Queue a resolved command. A NEW_ORDER is routed by its symbol and given
+    // its id here; returns the id acted on, or 0 if nothing was queued.
+    // A MASS_CANCEL goes to its symbol's shard, or without
+    // MASS_CANCEL_BY_SYMBOL to every shard as a batch of getShardCount()
+    // members; each copy carries its shard in orderId and, once applied, the
+    // orders it cancelled in quantity. Returns non-zero if queued.
+    OrderId submit(EngineCommand command);
+
+    // Queue the members of a batch, routed and given ids as submit() does.
+    // Each shard's members are queued contiguously, so no other producer's
+    // command is applied in between. Returns false if any could not be queued.
+    bool submitBatch(EngineCommand* commands, size_t count);
+
+    // Block until every command queued before the call has been applied
+    void flush();
+
+    // Persistence. snapshot() works while running: each shard copies its
+    // state between two commands and goes straight back to matching, and
+    // the file is written on the calling thread. Don't call it
+    // concurrently with stop(). coveredSequence (if given) receives the
+    // journal sequence every shard has applied. recover() goes before
+    // start() and needs the same shard count and symbol hash the snapshot
+    // and journal were made with.
+    bool snapshot(const std::string& path, uint64_t* coveredSequence = nullptr);
+    bool recover(const std::string& snapshotPath, const std::string& journalDirectory);
+
+    // Hot standby: apply a command another engine with the same shard count
+    // and node id sequenced, on the calling thread, before start(). It goes
+    // to the shard in its order id, as in recovery, and keeps its id and
+    // timestamp; the core's hooks and callbacks fire as usual. false if it
+    // found nothing to act on.
+    bool applySequenced(const EngineCommand& command);
+
+    // Routing. Symbol ids remember their shard, so routing an order hashes
+    // its name only the first time the symbol is seen.
+    size_t shardFor(const std::string& symbol) const;
+    size_t shardFor(SymbolId symbolId);
+    static size_t shardOf(OrderId orderId) { return orderId & (MAX_SHARDS - 1); }
+    static size_t nodeOf(OrderId orderId) { return orderId >> NODE_SHIFT; }
+    size_t getShardCount() const { return shards_.size(); }
+
+    // Direct access to a shard's core. Only safe while nothing is queued for
+    // it - before start(), after stop(), or after flush() with producers idle.
+    MatchingEngineCore& getShard(size_t shard) { return shards_[shard]->core; }
+
+    // Market data - same caveat as getShard()
+    Price getBestBid(const std::string& symbol);
+    Price getBestAsk(const std::string& symbol);
+
+    // Configuration - call before start()
+    void setDefaultBookConfig(const OrderBookConfig& config);
+    void setBookConfig(const std::string& symbol, const OrderBookConfig& config);
+
+    // Pre-trade limits (see RiskCheck), set before start(). Each shard checks
+    // the orders it owns against its own copy, so positions are exact but a
+    // client's open notional and order rate are limited per shard.
+    void setRiskLimits(const RiskLimits& limits);
+    void setClientRiskLimits(ClientKey clientKey, const RiskLimits& limits);
+    void setEventRing(EventRing* events);  // Shards publish concurrently
+    void setOrderCallback(OrderCallback callback);
+    void setTradeCallback(TradeCallback callback);
+    void setCommandHook(CommandHook hook);  // Runs on the shard threads
+    void setCommandCallback(CommandCallback callback) { commandCallback_ = std::move(callback); }
+
+    // Statistics
+    size_t getTotalOrders() const;
+    size_t getTotalTrades() const;
+
+private:
+    struct Shard {
+        Shard(size_t queueCapacity, const ExpiryConfig& expiry);
+
+        MatchingEngineCore core;
+        MpscRing<EngineCommand> queue;
+        std::thread thread;
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> nextSequence{1};
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> enqueued{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> processed{0};
+        std::atomic<bool> snapshotPending{false};
+        size_t index = 0;
+    };
+
+    // Snapshot being captured - shard threads fill their slot
+    struct SnapshotJob {
+        std::vector<EngineSnapshot> shards;
+        size_t remaining = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    // Shard + 1 of each symbol id below ROUTE_CACHE_SIZE, 0 until first
+    // routed. Racing producers store the same value, so relaxed is enough;
+    // ids past the end fall back to hashing the name.
+    static constexpr size_t ROUTE_CACHE_SIZE = 4096;
+
+    ShardedEngineConfig config_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::atomic<uint16_t>> routes_;
+    std::atomic<bool> running_;
+    CommandCallback commandCallback_;
+    std::mutex snapshotMutex_;  // One snapshot at a time
+    SnapshotJob* snapshotJob_;  // Published to the shards through snapshotPending
+
+    bool enqueue(Shard& shard, const EngineCommand& command);
+    bool enqueueBatch(Shard& shard, const EngineCommand* commands, size_t count);
+    size_t route(EngineCommand& command);
+    void runShard(Shard& shard);
+    size_t drain(Shard& shard, EngineCommand* batch);
+    void expireDue(Shard& shard);
+    void captureShard(Shard& shard);
+    void reserveIssuedIds();
+};
+
+} // namespace MatchingEngine
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Common.h"
+#include "Order.h"
+#include <string>
+#include <vector>
+
+namespace MatchingEngine {
+
+// State of one MatchingEngineCore at a point in its command stream
+struct EngineSnapshot {
+    uint64_t journalSequence = 0;  // Last journaled command the state reflects
+    OrderId nextOrderId = 1;
+    // Resting orders book by book, each side best level first and each
+    // level in queue order, so resting them in sequence rebuilds priority
+    std::vector<Order> orders;
+    // When each of orders lapses (see TimeInForce), 0 for GTC; may be left
+    // empty when none does
+    std::vector<uint64_t> expireTimes;
+};
+
+// Snapshot files hold one section per engine (one per shard for a
+// ShardedEngine). Writing goes to a temporary file that is synced and
+// renamed over path, so a crash leaves the previous snapshot intact.
+bool writeSnapshot(const std::string& path, const std::vector<EngineSnapshot>& engines);
+
+// False if the file is missing, truncated or fails its checksum
+bool readSnapshot(const std::string& path, std::vector<EngineSnapshot>& engines);
+
+} // namespace MatchingEngine
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace MatchingEngine {
+
+// Pin a thread to one CPU. Returns false if the platform has no affinity
+// API or the call failed; cpu < 0 leaves the thread where it is.
+inline bool pinThreadToCpu(std::thread& thread, int cpu) {
+    if (cpu < 0) {
+        return false;
+    }
+#if defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus) == 0;
+#else
+    (void)thread;
+    return false;
+#endif
+}
+
+// Spin-wait hint - lets a sibling hyperthread run while we poll
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+} // namespace MatchingEngine
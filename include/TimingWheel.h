@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Common.h"
+#include "OrderIndex.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace MatchingEngine {
+
+// Hierarchical timing wheel of order expiry times. Time is cut into ticks;
+// each of the eight levels has 256 slots and covers one more byte of the
+// tick number, so every 64-bit tick has a place. An order sits at the
+// lowest level whose higher bytes match the wheel's current tick and moves
+// down (cascades) when the current tick reaches its slot. Scheduling and
+// cancelling are O(1); advancing finds the next occupied slot through each
+// level's occupancy bitmap, so an idle stretch costs nothing per tick.
+// Not synchronized - the owner serializes access.
+class TimingWheel {
+public:
+    static constexpr unsigned LEVEL_BITS = 8;
+    static constexpr size_t SLOTS = size_t(1) << LEVEL_BITS;
+    static constexpr size_t LEVELS = 64 / LEVEL_BITS;
+
+    explicit TimingWheel(uint64_t tickNanos = 1000000);
+
+    // Due once the clock reaches expireTime (nanoseconds, see
+    // timestampToNanos); replaces an earlier schedule of the same order.
+    // A time already past is due at the wheel's next tick.
+    void schedule(OrderId orderId, uint64_t expireTime);
+    bool cancel(OrderId orderId);
+
+    // Move the wheel up to now and append to due - at most limit of them -
+    // the orders whose tick has passed; returns how many. None leaves before
+    // its expireTime, nor more than a tick after it if limit allows. What
+    // limit held back comes out first next time.
+    size_t advance(uint64_t now, size_t limit, std::vector<OrderId>& due);
+
+    // Nothing comes due before this time (UINT64_MAX when empty), so calling
+    // advance() earlier finds nothing
+    uint64_t nextCheck() const;
+
+    uint64_t expireTimeOf(OrderId orderId) const;  // 0 if not scheduled
+    size_t size() const { return index_.size(); }
+    bool empty() const { return index_.empty(); }
+    uint64_t getTickNanos() const { return tickNanos_; }
+
+private:
+    struct Node {
+        OrderId orderId = 0;
+        uint64_t expireTime = 0;
+        uint32_t prev = 0;
+        uint32_t next = 0;  // Also links the free list
+        uint32_t slot = 0;  // level * SLOTS + slot within it
+    };
+
+    static constexpr size_t BITMAP_WORDS = SLOTS / 64;
+
+    uint64_t tickNanos_;
+    uint64_t current_;  // Lowest tick not yet passed
+    std::vector<Node> nodes_;
+    uint32_t freeList_;
+    OrderIdMap<uint32_t> index_;  // Order -> node
+    std::array<uint32_t, LEVELS * SLOTS> heads_;
+    std::array<std::array<uint64_t, BITMAP_WORDS>, LEVELS> occupied_;
+
+    uint64_t dueTick(uint64_t expireTime) const;
+    void place(uint32_t node);
+    void unlink(uint32_t node);
+    void release(uint32_t node);
+    void cascade(size_t level, size_t slot);
+    // Set current_, cascading every higher level's slot that it reaches the
+    // start of, so above level 0 the current slot is always empty
+    void moveTo(uint64_t tick);
+    // The next tick at or after current_ where a slot needs work - level 0
+    // slots are due there, higher ones cascade - and that slot's level
+    bool nextEvent(uint64_t& tick, size_t& level) const;
+};
+
+} // namespace MatchingEngine
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "Common.h"
+#include "RingBuffer.h"
+#include "ThreadUtil.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace MatchingEngine {
+
+// The best DEPTH levels of each side of one book, best first
+struct BookTop {
+    static constexpr size_t DEPTH = 10;
+
+    struct Level {
+        Price price = 0;
+        Quantity quantity = 0;
+    };
+
+    Level bids[DEPTH];
+    Level asks[DEPTH];
+    size_t bidLevels = 0;
+    size_t askLevels = 0;
+
+    Price bestBid() const { return bidLevels ? bids[0].price : 0; }
+    Price bestAsk() const { return askLevels ? asks[0].price : 0; }
+};
+
+// A BookTop published by one writer and read from any thread without a
+// lock (seqlock). The writer bumps the sequence to odd, stores the fields
+// and bumps it back to even; a reader retries if the sequence was odd or
+// moved while it copied. Fields are relaxed atomics, so a torn copy is
+// discarded rather than being a data race.
+class TopOfBook {
+public:
+    TopOfBook() : sequence_(0) {
+        for (auto& word : words_) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    TopOfBook(const TopOfBook&) = delete;
+    TopOfBook& operator=(const TopOfBook&) = delete;
+
+    // Writer only - callers serialize among themselves
+    void publish(const BookTop& top) {
+        uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        store(BID_LEVELS, top.bidLevels);
+        store(ASK_LEVELS, top.askLevels);
+        for (size_t i = 0; i < top.bidLevels; ++i) {
+            store(BIDS + 2 * i, static_cast<uint64_t>(top.bids[i].price));
+            store(BIDS + 2 * i + 1, top.bids[i].quantity);
+        }
+        for (size_t i = 0; i < top.askLevels; ++i) {
+            store(ASKS + 2 * i, static_cast<uint64_t>(top.asks[i].price));
+            store(ASKS + 2 * i + 1, top.asks[i].quantity);
+        }
+
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Consistent copy of everything last published
+    BookTop read() const {
+        BookTop top;
+        uint64_t sequence;
+        do {
+            sequence = begin();
+            top.bidLevels = clampLevels(load(BID_LEVELS));
+            top.askLevels = clampLevels(load(ASK_LEVELS));
+            for (size_t i = 0; i < top.bidLevels; ++i) {
+                top.bids[i].price = static_cast<Price>(load(BIDS + 2 * i));
+                top.bids[i].quantity = load(BIDS + 2 * i + 1);
+            }
+            for (size_t i = 0; i < top.askLevels; ++i) {
+                top.asks[i].price = static_cast<Price>(load(ASKS + 2 * i));
+                top.asks[i].quantity = load(ASKS + 2 * i + 1);
+            }
+        } while (!validate(sequence));
+        return top;
+    }
+
+    // Best price of one side, 0 if it is empty - reads two words
+    Price best(Side side) const {
+        size_t levels = side == Side::BUY ? BID_LEVELS : ASK_LEVELS;
+        size_t first = side == Side::BUY ? BIDS : ASKS;
+        uint64_t sequence;
+        Price price;
+        do {
+            sequence = begin();
+            price = load(levels) ? static_cast<Price>(load(first)) : 0;
+        } while (!validate(sequence));
+        return price;
+    }
+
+    // Times the top has been published
+    uint64_t getVersion() const { return sequence_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t BID_LEVELS = 0;
+    static constexpr size_t ASK_LEVELS = 1;
+    static constexpr size_t BIDS = 2;
+    static constexpr size_t ASKS = BIDS + 2 * BookTop::DEPTH;
+    static constexpr size_t WORDS = ASKS + 2 * BookTop::DEPTH;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> sequence_;
+    std::atomic<uint64_t> words_[WORDS];
+
+    void store(size_t index, uint64_t value) {
+        words_[index].store(value, std::memory_order_relaxed);
+    }
+
+    uint64_t load(size_t index) const { return words_[index].load(std::memory_order_relaxed); }
+
+    // A torn count must not index past the arrays before the retry
+    static size_t clampLevels(uint64_t levels) {
+        return levels < BookTop::DEPTH ? static_cast<size_t>(levels) : BookTop::DEPTH;
+    }
+
+    uint64_t begin() const {
+        uint64_t sequence = sequence_.load(std::memory_order_acquire);
+        while (sequence & 1) {
+            cpuRelax();
+            sequence = sequence_.load(std::memory_order_acquire);
+        }
+        return sequence;
+    }
+
+    bool validate(uint64_t sequence) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence_.load(std::memory_order_relaxed) == sequence;
+    }
+};
+
+} // namespace MatchingEngine
@@ -5,18 +5,19 @@
 
 namespace MatchingEngine {
 
-// Represents an executed trade
+// Represents an executed trade. The symbol is kept as its interned id so
+// recording a fill copies no strings.
 class Trade {
 public:
     Trade(OrderId buyOrderId,
           OrderId sellOrderId,
-          const std::string& symbol,
+          SymbolId symbolId,
           Price price,
           Quantity quantity,
           Timestamp timestamp)
         : buyOrderId_(buyOrderId)
         , sellOrderId_(sellOrderId)
-        , symbol_(symbol)
+        , symbolId_(symbolId)
         , price_(price)
         , quantity_(quantity)
         , timestamp_(timestamp) {
@@ -24,7 +25,8 @@ public:
 
     OrderId getBuyOrderId() const { return buyOrderId_; }
     OrderId getSellOrderId() const { return sellOrderId_; }
-    const std::string& getSymbol() const { return symbol_; }
+    SymbolId getSymbolId() const { return symbolId_; }
+    const std::string& getSymbol() const;
     Price getPrice() const { return price_; }
     Quantity getQuantity() const { return quantity_; }
     Timestamp getTimestamp() const { return timestamp_; }
@@ -34,7 +36,7 @@ public:
 private:
     OrderId buyOrderId_;
     OrderId sellOrderId_;
-    std::string symbol_;
+    SymbolId symbolId_;
     Price price_;
     Quantity quantity_;
     Timestamp timestamp_;
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "EventLoop.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketType;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int SocketType;
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define closesocket close
+#endif
+
+namespace MatchingEngine {
+
+enum class TransportType {
+    KERNEL  // BSD sockets through the kernel's TCP stack
+};
+
+// Opt-in latency over CPU. Connected sockets get TCP_NODELAY, SO_BUSY_POLL
+// so a read spins in the driver before sleeping, and SO_INCOMING_CPU
+// steering them to the CPU of the thread serving them; the server's event
+// loops and shards spin instead of blocking.
+struct LowLatencyOptions {
+    bool enabled = false;
+    uint32_t busyPollMicros = 50;  // Raising it past net.core.busy_read needs CAP_NET_ADMIN
+};
+
+// The stream transport under Server and Client: everything they do with a
+// socket goes through here, so another backend - a kernel-bypass stack -
+// can be dropped in as a new TransportType without touching either of them
+// or the engine. Calls mirror the BSD socket calls they wrap, including
+// returning -1 with errno set on failure.
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    // Listening socket on port (0 = any) of every interface, with port set
+    // to the one bound; INVALID_SOCKET on failure
+    virtual SocketType listen(uint16_t& port) = 0;
+    // peerAddress, if given, gets the peer's dotted IPv4 address
+    virtual SocketType accept(SocketType listener, std::string* peerAddress = nullptr) = 0;
+    virtual SocketType connect(const std::string& host, uint16_t port) = 0;
+
+    virtual int receive(SocketType socket, void* buffer, size_t length) = 0;
+    virtual int send(SocketType socket, const void* data, size_t length) = 0;
+    virtual void shutdown(SocketType socket) = 0;  // Wakes a blocked receive
+    virtual void close(SocketType socket) = 0;
+
+    // Blocking receives give up after timeoutMs; 0 waits forever
+    virtual void setReceiveTimeout(SocketType socket, uint32_t timeoutMs) = 0;
+
+    // Tune a connected socket for its serving thread's CPU (-1 = unknown)
+    // as the options ask; false if one couldn't be applied
+    virtual bool configure(SocketType socket, int cpu = -1) = 0;
+
+    // Readiness poller over this transport's sockets
+    virtual std::unique_ptr<Poller> createPoller(PollerType type) = 0;
+
+    const LowLatencyOptions& getOptions() const { return options_; }
+
+    // nullptr if the backend isn't available on this build
+    static std::unique_ptr<Transport> create(TransportType type = TransportType::KERNEL,
+                                             const LowLatencyOptions& options = LowLatencyOptions());
+
+protected:
+    explicit Transport(const LowLatencyOptions& options) : options_(options) {}
+
+    LowLatencyOptions options_;
+};
+
+} // namespace MatchingEngine
@@ -1,16 +1,54 @@
 #include "Client.h"
+#include "ProtocolV2.h"
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 
 namespace MatchingEngine {
 
+namespace {
+
+// How long to wait for a logon ack before assuming a version 1 server
+constexpr int LOGON_TIMEOUT_MS = 1000;
+
+// Client order ids a pipeline takes from the shared counter at once
+constexpr OrderId PIPELINE_ID_BLOCK = 1024;
+
+// Replies that end an order, after which its id is no longer mapped
+bool isFinal(OrderStatus status) {
+    return status == OrderStatus::FILLED || status == OrderStatus::CANCELLED ||
+           status == OrderStatus::REJECTED;
+}
+
+// Text the version 1 server would have sent with an ack
+std::string ackText(const ProtocolV2::OrderAck& ack) {
+    if (ack.reason != RejectReason::NONE) {
+        return rejectReasonToString(ack.reason);
+    }
+    switch (ack.status) {
+        case OrderStatus::CANCELLED: return "Order cancelled";
+        case OrderStatus::PENDING: return ack.clientOrderId ? "Order accepted" : "Order modified";
+        default: return "";
+    }
+}
+
+} // namespace
+
 Client::Client(const std::string& serverHost, uint16_t serverPort)
     : serverHost_(serverHost)
     , serverPort_(serverPort)
+    , transport_(Transport::create())
     , socket_(INVALID_SOCKET)
     , connected_(false)
     , nextClientOrderId_(1)
-    , clientId_("Client") {
+    , clientId_("Client")
+    , preferredProtocolVersion_(ProtocolV2::VERSION)
+    , protocolVersion_(1)
+    , verbose_(true)
+    , flushInterval_(0)
+    , flushBytes_(64 * 1024)
+    , queueCompletions_(false)
+    , trackedOrderLimit_(size_t(1) << 16) {
     
     initializeSocket();
 }
@@ -36,33 +74,30 @@ void Client::cleanupSocket() {
 #endif
 }
 
+void Client::setTransport(TransportType type, const LowLatencyOptions& options) {
+    if (!connected_) {
+        transport_ = Transport::create(type, options);
+    }
+}
+
 bool Client::connect() {
     if (connected_) {
         std::cerr << "Already connected to server" << std::endl;
         return false;
     }
     
-    // Create socket
-    socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    socket_ = transport_->connect(serverHost_, serverPort_);
     if (socket_ == INVALID_SOCKET) {
-        std::cerr << "Failed to create socket" << std::endl;
+        std::cerr << "Failed to connect to server " << serverHost_ << ":" << serverPort_ << std::endl;
         return false;
     }
+    if (!transport_->configure(socket_) && verbose_) {
+        std::cerr << "Low-latency socket options not applied" << std::endl;
+    }
     
-    // Connect to server
-    sockaddr_in serverAddr{};
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(serverPort_);
-    
-#ifdef _WIN32
-    serverAddr.sin_addr.s_addr = inet_addr(serverHost_.c_str());
-#else
-    inet_pton(AF_INET, serverHost_.c_str(), &serverAddr.sin_addr);
-#endif
-    
-    if (::connect(socket_, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        std::cerr << "Failed to connect to server " << serverHost_ << ":" << serverPort_ << std::endl;
-        closesocket(socket_);
+    if (!logon()) {
+        std::cerr << "Logon to server failed" << std::endl;
+        transport_->close(socket_);
         socket_ = INVALID_SOCKET;
         return false;
     }
@@ -71,28 +106,93 @@ bool Client::connect() {
     
     // Start receive thread
     receiveThread_ = std::thread(&Client::receiveMessages, this);
+    if (flushInterval_.count() > 0) {
+        flushStopping_ = false;
+        flushThread_ = std::thread(&Client::runFlushTimer, this);
+    }
     
     std::cout << "Connected to server " << serverHost_ << ":" << serverPort_ << std::endl;
     return true;
 }
 
-void Client::disconnect() {
-    if (!connected_) {
-        return;
+bool Client::logon() {
+    input_ = FrameBuffer();
+    protocolVersion_ = 1;
+    
+    LogonMessage logon;
+    logon.protocolVersion = preferredProtocolVersion_;
+    logon.setClientId(clientId_);
+    if (!sendMessage(&logon, sizeof(logon))) {
+        return false;
     }
     
-    connected_ = false;
+    // Servers that predate logon skip it without replying - speak version 1
+    // to them once the wait runs out
+    transport_->setReceiveTimeout(socket_, LOGON_TIMEOUT_MS);
+    
+    bool answered = false;
+    Frame frame;
+    while (!answered) {
+        char* target = input_.writePtr();
+        int received = transport_->receive(socket_, target, input_.writable());
+        if (received == 0) {
+            return false;  // Closed on us
+        }
+        if (received < 0) {
+            break;  // Timed out
+        }
+        input_.commit(static_cast<size_t>(received));
+        
+        if (input_.nextFrame(frame)) {
+            MessageScratch<LogonAckMessage> scratch;
+            const LogonAckMessage* ack = frame.type == MessageType::LOGON_ACK
+                ? viewMessage(frame, scratch) : nullptr;
+            if (!ack) {
+                return false;
+            }
+            protocolVersion_ = static_cast<uint8_t>(ack->protocolVersion);
+            answered = true;
+        } else if (input_.malformed()) {
+            return false;
+        }
+    }
     
-    if (socket_ != INVALID_SOCKET) {
-        closesocket(socket_);
-        socket_ = INVALID_SOCKET;
+    transport_->setReceiveTimeout(socket_, 0);
+    
+    // Replies sent after the ack may already be buffered behind it
+    input_.setProtocolVersion(protocolVersion_);
+    return true;
+}
+
+void Client::disconnect() {
+    // A connection the server dropped still has its thread and socket
+    bool wasConnected = connected_.exchange(false);
+    
+    // Shut down first so the receive thread's blocking recv returns
+    if (wasConnected && socket_ != INVALID_SOCKET) {
+        transport_->shutdown(socket_);
     }
     
     if (receiveThread_.joinable()) {
         receiveThread_.join();
     }
+    if (flushThread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(flushMutex_);
+            flushStopping_ = true;
+        }
+        flushWake_.notify_all();
+        flushThread_.join();
+    }
     
-    std::cout << "Disconnected from server" << std::endl;
+    if (socket_ != INVALID_SOCKET) {
+        transport_->close(socket_);
+        socket_ = INVALID_SOCKET;
+    }
+    
+    if (wasConnected) {
+        std::cout << "Disconnected from server" << std::endl;
+    }
 }
 
 OrderId Client::submitOrder(
@@ -101,35 +201,55 @@ OrderId Client::submitOrder(
     OrderType type,
     Price price,
     Quantity quantity,
-    Price stopPrice) {
+    Price stopPrice,
+    TimeInForce timeInForce,
+    uint64_t expireTime) {
     
     if (!connected_) {
         std::cerr << "Not connected to server" << std::endl;
         return 0;
     }
     
-    OrderId clientOrderId = nextClientOrderId_++;
+    OrderId clientOrderId = reserveClientOrderId();
+    return submitOrder(clientOrderId, symbol, side, type, price, quantity, stopPrice,
+                       timeInForce, expireTime)
+        ? clientOrderId : 0;
+}
+
+bool Client::submitOrder(
+    OrderId clientOrderId,
+    const std::string& symbol,
+    Side side,
+    OrderType type,
+    Price price,
+    Quantity quantity,
+    Price stopPrice,
+    TimeInForce timeInForce,
+    uint64_t expireTime) {
     
-    NewOrderMessage msg;
-    msg.clientOrderId = clientOrderId;
-    msg.setSymbol(symbol);
-    msg.side = side;
-    msg.orderType = type;
-    msg.price = price;
-    msg.quantity = quantity;
-    msg.stopPrice = stopPrice;
-    msg.setClientId(clientId_);
+    if (!connected_) {
+        std::cerr << "Not connected to server" << std::endl;
+        return false;
+    }
     
-    std::lock_guard<std::mutex> lock(sendMutex_);
-    if (!sendMessage(&msg, sizeof(NewOrderMessage))) {
+    char out[MAX_MESSAGE_SIZE];
+    size_t length = encodeNewOrder(out, clientOrderId, symbol, side, type, price, quantity,
+                                   stopPrice, timeInForce, expireTime);
+    bool sent;
+    {
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        sent = sendMessage(out, length);
+    }
+    if (!sent) {
         std::cerr << "Failed to send order" << std::endl;
-        return 0;
+        return false;
     }
     
-    std::cout << "[CLIENT] Order sent: " << symbol << " " << sideToString(side)
-              << " " << quantity << " @ " << priceToDouble(price) << std::endl;
-    
-    return clientOrderId;
+    if (verbose_) {
+        std::cout << "[CLIENT] Order sent: " << symbol << " " << sideToString(side)
+                  << " " << quantity << " @ " << priceToDouble(price) << std::endl;
+    }
+    return true;
 }
 
 bool Client::cancelOrder(OrderId orderId) {
@@ -138,17 +258,21 @@ bool Client::cancelOrder(OrderId orderId) {
         return false;
     }
     
-    CancelOrderMessage msg;
-    msg.orderId = orderId;
-    msg.setClientId(clientId_);
-    
-    std::lock_guard<std::mutex> lock(sendMutex_);
-    if (!sendMessage(&msg, sizeof(CancelOrderMessage))) {
+    char out[MAX_MESSAGE_SIZE];
+    size_t length = encodeCancel(out, orderId);
+    bool sent;
+    {
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        sent = sendMessage(out, length);
+    }
+    if (!sent) {
         std::cerr << "Failed to send cancel order" << std::endl;
         return false;
     }
     
-    std::cout << "[CLIENT] Cancel order sent: " << orderId << std::endl;
+    if (verbose_) {
+        std::cout << "[CLIENT] Cancel order sent: " << orderId << std::endl;
+    }
     return true;
 }
 
@@ -158,133 +282,655 @@ bool Client::modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity)
         return false;
     }
     
+    char out[MAX_MESSAGE_SIZE];
+    size_t length = encodeModify(out, orderId, newPrice, newQuantity);
+    bool sent;
+    {
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        sent = sendMessage(out, length);
+    }
+    if (!sent) {
+        std::cerr << "Failed to send modify order" << std::endl;
+        return false;
+    }
+    
+    if (verbose_) {
+        std::cout << "[CLIENT] Modify order sent: " << orderId 
+                  << " new price: " << priceToDouble(newPrice)
+                  << " new qty: " << newQuantity << std::endl;
+    }
+    return true;
+}
+
+size_t Client::encodeNewOrder(char* out, OrderId clientOrderId, const std::string& symbol,
+                              Side side, OrderType type, Price price, Quantity quantity,
+                              Price stopPrice, TimeInForce timeInForce,
+                              uint64_t expireTime) const {
+    if (protocolVersion_ >= ProtocolV2::VERSION) {
+        ProtocolV2::NewOrder msg;
+        msg.clientOrderId = clientOrderId;
+        ProtocolV2::setSymbol(msg.symbol, symbol);
+        msg.side = side;
+        msg.orderType = type;
+        msg.price = price;
+        msg.quantity = quantity;
+        msg.stopPrice = stopPrice;
+        msg.timeInForce = timeInForce;
+        msg.expireTime = expireTime;
+        return msg.encode(out);
+    }
+    
+    NewOrderMessage msg;
+    msg.clientOrderId = clientOrderId;
+    msg.setSymbol(symbol);
+    msg.side = side;
+    msg.orderType = type;
+    msg.price = price;
+    msg.quantity = quantity;
+    msg.stopPrice = stopPrice;
+    msg.setClientId(clientId_);
+    msg.timeInForce = timeInForce;
+    msg.expireTime = expireTime;
+    // GTC goes in the short form, which servers without time in force take
+    size_t length = timeInForce == TimeInForce::GTC ? NewOrderMessage::GTC_SIZE : sizeof(msg);
+    msg.header.length = static_cast<uint32_t>(length);
+    std::memcpy(out, &msg, length);
+    return length;
+}
+
+size_t Client::encodeCancel(char* out, OrderId orderId) const {
+    if (protocolVersion_ >= ProtocolV2::VERSION) {
+        ProtocolV2::CancelOrder msg;
+        msg.orderId = orderId;
+        return msg.encode(out);
+    }
+    
+    CancelOrderMessage msg;
+    msg.orderId = orderId;
+    msg.setClientId(clientId_);
+    std::memcpy(out, &msg, sizeof(msg));
+    return sizeof(msg);
+}
+
+size_t Client::encodeModify(char* out, OrderId orderId, Price newPrice, Quantity newQuantity) const {
+    if (protocolVersion_ >= ProtocolV2::VERSION) {
+        ProtocolV2::ModifyOrder msg;
+        msg.orderId = orderId;
+        msg.newPrice = newPrice;
+        msg.newQuantity = newQuantity;
+        return msg.encode(out);
+    }
+    
     ModifyOrderMessage msg;
     msg.orderId = orderId;
     msg.newPrice = newPrice;
     msg.newQuantity = newQuantity;
     msg.setClientId(clientId_);
-    
-    std::lock_guard<std::mutex> lock(sendMutex_);
-    if (!sendMessage(&msg, sizeof(ModifyOrderMessage))) {
-        std::cerr << "Failed to send modify order" << std::endl;
+    std::memcpy(out, &msg, sizeof(msg));
+    return sizeof(msg);
+}
+
+bool Client::subscribeMarketData(const std::string& symbol) {
+    if (!connected_) {
+        std::cerr << "Not connected to server" << std::endl;
         return false;
     }
     
-    std::cout << "[CLIENT] Modify order sent: " << orderId 
-              << " new price: " << priceToDouble(newPrice)
-              << " new qty: " << newQuantity << std::endl;
+    bool sent;
+    if (protocolVersion_ >= ProtocolV2::VERSION) {
+        ProtocolV2::MarketDataSubscribe msg;
+        ProtocolV2::setSymbol(msg.symbol, symbol);
+        
+        char out[ProtocolV2::MarketDataSubscribe::SIZE];
+        size_t length = msg.encode(out);
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        sent = sendMessage(out, length);
+    } else {
+        MarketDataSubscribeMessage msg;
+        msg.setSymbol(symbol);
+        
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        sent = sendMessage(&msg, sizeof(MarketDataSubscribeMessage));
+    }
+    if (!sent) {
+        std::cerr << "Failed to send market data subscription" << std::endl;
+        return false;
+    }
     return true;
 }
 
+bool Client::canSendBatch(size_t count, const char* what) const {
+    if (!connected_) {
+        std::cerr << "Not connected to server" << std::endl;
+        return false;
+    }
+    if (protocolVersion_ < ProtocolV2::VERSION) {
+        std::cerr << what << " needs protocol version " << int(ProtocolV2::VERSION) << std::endl;
+        return false;
+    }
+    if (count == 0 || count > ProtocolV2::MAX_BATCH) {
+        std::cerr << what << " takes 1 to " << ProtocolV2::MAX_BATCH << " members" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename Message>
+OrderId Client::sendBatch(Message& msg, const char* what) {
+    msg.reference = nextClientOrderId_++;
+    char out[MAX_MESSAGE_SIZE];
+    size_t length = msg.encode(out);
+    bool sent;
+    {
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        sent = sendMessage(out, length);
+    }
+    if (!sent) {
+        std::cerr << "Failed to send " << what << std::endl;
+        return 0;
+    }
+    if (verbose_) {
+        std::cout << "[CLIENT] " << what << " sent: " << msg.reference << std::endl;
+    }
+    return msg.reference;
+}
+
+OrderId Client::submitOrderBatch(const std::string& symbol,
+                                 const std::vector<ProtocolV2::NewOrderBatch::Entry>& orders) {
+    if (!canSendBatch(orders.size(), "Order batch")) {
+        return 0;
+    }
+    ProtocolV2::NewOrderBatch msg;
+    ProtocolV2::setSymbol(msg.symbol, symbol);
+    msg.count = orders.size();
+    std::copy(orders.begin(), orders.end(), msg.entries);
+    return sendBatch(msg, "Order batch");
+}
+
+OrderId Client::cancelOrders(const std::vector<OrderId>& orderIds) {
+    if (!canSendBatch(orderIds.size(), "Cancel batch")) {
+        return 0;
+    }
+    ProtocolV2::CancelBatch msg;
+    msg.count = orderIds.size();
+    std::copy(orderIds.begin(), orderIds.end(), msg.orderIds);
+    return sendBatch(msg, "Cancel batch");
+}
+
+OrderId Client::modifyOrders(const std::vector<ProtocolV2::ModifyBatch::Entry>& modifications) {
+    if (!canSendBatch(modifications.size(), "Modify batch")) {
+        return 0;
+    }
+    ProtocolV2::ModifyBatch msg;
+    msg.count = modifications.size();
+    std::copy(modifications.begin(), modifications.end(), msg.entries);
+    return sendBatch(msg, "Modify batch");
+}
+
+OrderId Client::replaceOrder(OrderId orderId, Price newPrice, Quantity newQuantity) {
+    if (!canSendBatch(1, "Cancel/replace")) {
+        return 0;
+    }
+    ProtocolV2::CancelReplace msg;
+    msg.orderId = orderId;
+    msg.newPrice = newPrice;
+    msg.newQuantity = newQuantity;
+    return sendBatch(msg, "Cancel/replace");
+}
+
+OrderId Client::massCancel(const std::string& symbol) {
+    return sendMassCancel(symbol, ProtocolV2::MassCancel::BOTH_SIDES);
+}
+
+OrderId Client::massCancel(const std::string& symbol, Side side) {
+    return sendMassCancel(symbol, static_cast<uint8_t>(side));
+}
+
+OrderId Client::sendMassCancel(const std::string& symbol, uint8_t side) {
+    if (!canSendBatch(1, "Mass cancel")) {
+        return 0;
+    }
+    ProtocolV2::MassCancel msg;
+    ProtocolV2::setSymbol(msg.symbol, symbol);
+    msg.side = side;
+    return sendBatch(msg, "Mass cancel");
+}
+
 void Client::receiveMessages() {
-    std::vector<char> buffer(MAX_MESSAGE_SIZE);
+    FrameBuffer& input = input_;
     
     while (connected_) {
-        // Read message header
-        MessageHeader header;
-        if (!receiveMessage(&header, sizeof(MessageHeader))) {
+        // Frames that arrived with the logon ack come first
+        Frame frame;
+        while (input.nextFrame(frame)) {
+            handleFrame(frame);
+        }
+        publishCompletions();
+        if (input.malformed()) {
+            std::cerr << "Malformed message received from server" << std::endl;
+            connected_ = false;
+            break;
+        }
+        
+        // Take everything that has arrived and dispatch it in place
+        char* target = input.writePtr();
+        int received = transport_->receive(socket_, target, input.writable());
+        if (received <= 0) {
             if (connected_) {
                 std::cerr << "Connection lost" << std::endl;
                 connected_ = false;
             }
             break;
         }
+        input.commit(static_cast<size_t>(received));
+    }
+}
+
+void Client::handleFrame(const Frame& frame) {
+    if (frame.version >= ProtocolV2::VERSION) {
+        handleFrameV2(frame);
+        return;
+    }
+    
+    // Handle message based on type
+    switch (frame.type) {
+        case MessageType::ORDER_ACK: {
+            MessageScratch<OrderAckMessage> scratch;
+            if (const OrderAckMessage* msg = viewMessage(frame, scratch)) {
+                handleOrderAck(*msg);
+            }
+            break;
+        }
         
-        // Handle message based on type
-        switch (header.type) {
-            case MessageType::ORDER_ACK: {
+        case MessageType::ORDER_REJECT: {
+            MessageScratch<OrderRejectMessage> scratch;
+            if (const OrderRejectMessage* msg = viewMessage(frame, scratch)) {
+                handleOrderReject(*msg);
+            }
+            break;
+        }
+        
+        case MessageType::EXECUTION_REPORT: {
+            MessageScratch<ExecutionReportMessage> scratch;
+            if (const ExecutionReportMessage* msg = viewMessage(frame, scratch)) {
+                handleExecutionReport(*msg);
+            }
+            break;
+        }
+        
+        case MessageType::MARKET_DATA: {
+            MessageScratch<MarketDataMessage> scratch;
+            if (const MarketDataMessage* msg = viewMessage(frame, scratch)) {
+                handleMarketData(*msg);
+            }
+            break;
+        }
+        
+        case MessageType::BOOK_UPDATE: {
+            MessageScratch<BookUpdateMessage> scratch;
+            if (const BookUpdateMessage* msg = viewMessage(frame, scratch)) {
+                handleBookUpdate(*msg);
+            }
+            break;
+        }
+        
+        case MessageType::HEARTBEAT: {
+            // Heartbeat received, ignore or handle
+            break;
+        }
+        
+        default:
+            std::cerr << "Unknown message type received from server" << std::endl;
+            break;
+    }
+}
+
+void Client::handleFrameV2(const Frame& frame) {
+    // Widened into the version 1 structs the callbacks take
+    switch (frame.type) {
+        case MessageType::ORDER_ACK: {
+            ProtocolV2::OrderAck wire;
+            if (wire.decode(frame)) {
                 OrderAckMessage msg;
-                if (receiveMessage(&msg, sizeof(OrderAckMessage))) {
-                    handleOrderAck(msg);
-                }
-                break;
+                msg.clientOrderId = wire.clientOrderId;
+                msg.orderId = wire.orderId;
+                msg.status = wire.status;
+                msg.setMessage(ackText(wire));
+                handleOrderAck(msg, wire.reason);
             }
-            
-            case MessageType::ORDER_REJECT: {
+            break;
+        }
+        
+        case MessageType::ORDER_REJECT: {
+            ProtocolV2::OrderReject wire;
+            if (wire.decode(frame)) {
                 OrderRejectMessage msg;
-                if (receiveMessage(&msg, sizeof(OrderRejectMessage))) {
-                    handleOrderReject(msg);
-                }
-                break;
+                msg.clientOrderId = wire.clientOrderId;
+                msg.setReason(rejectReasonToString(wire.reason));
+                handleOrderReject(msg, wire.reason);
             }
-            
-            case MessageType::EXECUTION_REPORT: {
+            break;
+        }
+        
+        case MessageType::EXECUTION_REPORT: {
+            ProtocolV2::ExecutionReport wire;
+            if (wire.decode(frame)) {
                 ExecutionReportMessage msg;
-                if (receiveMessage(&msg, sizeof(ExecutionReportMessage))) {
-                    handleExecutionReport(msg);
-                }
-                break;
+                msg.orderId = wire.orderId;
+                msg.setSymbol(ProtocolV2::getSymbol(wire.symbol));
+                msg.side = wire.side;
+                msg.executionPrice = wire.executionPrice;
+                msg.executionQuantity = wire.executionQuantity;
+                msg.remainingQuantity = wire.remainingQuantity;
+                msg.status = wire.status;
+                msg.tradeId = wire.tradeId;
+                handleExecutionReport(msg);
             }
-            
-            case MessageType::MARKET_DATA: {
+            break;
+        }
+        
+        case MessageType::MARKET_DATA: {
+            ProtocolV2::MarketData wire;
+            if (wire.decode(frame)) {
                 MarketDataMessage msg;
-                if (receiveMessage(&msg, sizeof(MarketDataMessage))) {
-                    handleMarketData(msg);
+                msg.setSymbol(ProtocolV2::getSymbol(wire.symbol));
+                msg.bestBid = wire.bestBid;
+                msg.bestAsk = wire.bestAsk;
+                msg.bidQuantity = wire.bidQuantity;
+                msg.askQuantity = wire.askQuantity;
+                handleMarketData(msg);
+            }
+            break;
+        }
+        
+        case MessageType::BOOK_UPDATE: {
+            ProtocolV2::BookUpdate wire;
+            if (wire.decode(frame)) {
+                BookUpdateMessage msg;
+                msg.setSymbol(ProtocolV2::getSymbol(wire.symbol));
+                msg.side = wire.side;
+                msg.price = wire.price;
+                msg.quantity = wire.quantity;
+                msg.orderCount = wire.orderCount;
+                handleBookUpdate(msg);
+            }
+            break;
+        }
+        
+        case MessageType::BATCH_ACK: {
+            ProtocolV2::BatchAck wire;
+            if (wire.decode(frame)) {
+                if (verbose_) {
+                    std::cout << "[CLIENT] Batch ACK: " << wire.reference << " ("
+                              << wire.count << " orders)" << std::endl;
+                }
+                if (batchAckCallback_) {
+                    batchAckCallback_(wire);
                 }
-                break;
             }
-            
-            case MessageType::HEARTBEAT: {
-                // Heartbeat received, ignore or handle
-                break;
+            break;
+        }
+        
+        case MessageType::MASS_CANCEL_ACK: {
+            ProtocolV2::MassCancelAck wire;
+            if (wire.decode(frame)) {
+                if (verbose_) {
+                    std::cout << "[CLIENT] Mass cancel ACK: " << wire.reference << " ("
+                              << wire.cancelled << " cancelled)" << std::endl;
+                }
+                if (massCancelAckCallback_) {
+                    massCancelAckCallback_(wire);
+                }
             }
-            
-            default:
-                std::cerr << "Unknown message type received from server" << std::endl;
-                break;
+            break;
         }
+        
+        case MessageType::HEARTBEAT:
+            break;
+        
+        default:
+            std::cerr << "Unknown message type received from server" << std::endl;
+            break;
     }
 }
 
-void Client::handleOrderAck(const OrderAckMessage& msg) {
-    std::cout << "[CLIENT] Order ACK: Client Order " << msg.clientOrderId 
-              << " -> Server Order " << msg.orderId 
-              << " Status: " << orderStatusToString(msg.status)
-              << " Message: " << msg.getMessage() << std::endl;
+void Client::handleOrderAck(const OrderAckMessage& msg, RejectReason reason) {
+    if (verbose_) {
+        std::cout << "[CLIENT] Order ACK: Client Order " << msg.clientOrderId 
+                  << " -> Server Order " << msg.orderId 
+                  << " Status: " << orderStatusToString(msg.status)
+                  << " Message: " << msg.getMessage() << std::endl;
+    }
     
-    if (orderAckCallback_) {
+    if (queueCompletions_) {
+        OrderCompletion completion;
+        completion.kind = OrderCompletion::Kind::ACK;
+        completion.clientOrderId = msg.clientOrderId;
+        completion.orderId = msg.orderId;
+        completion.status = msg.status;
+        completion.reason = reason;
+        addCompletion(completion);
+    } else if (orderAckCallback_) {
         orderAckCallback_(msg);
     }
 }
 
-void Client::handleOrderReject(const OrderRejectMessage& msg) {
-    std::cout << "[CLIENT] Order REJECT: Client Order " << msg.clientOrderId 
-              << " Reason: " << msg.getReason() << std::endl;
+void Client::handleOrderReject(const OrderRejectMessage& msg, RejectReason reason) {
+    if (verbose_) {
+        std::cout << "[CLIENT] Order REJECT: Client Order " << msg.clientOrderId 
+                  << " Reason: " << msg.getReason() << std::endl;
+    }
     
-    if (orderRejectCallback_) {
+    if (queueCompletions_) {
+        OrderCompletion completion;
+        completion.kind = OrderCompletion::Kind::REJECT;
+        completion.clientOrderId = msg.clientOrderId;
+        completion.status = OrderStatus::REJECTED;
+        completion.reason = reason;
+        addCompletion(completion);
+    } else if (orderRejectCallback_) {
         orderRejectCallback_(msg);
     }
 }
 
 void Client::handleExecutionReport(const ExecutionReportMessage& msg) {
-    std::cout << "[CLIENT] Execution Report: Order " << msg.orderId
-              << " Symbol: " << msg.getSymbol()
-              << " Side: " << sideToString(msg.side)
-              << " Executed: " << msg.executionQuantity << " @ " << priceToDouble(msg.executionPrice)
-              << " Remaining: " << msg.remainingQuantity
-              << " Status: " << orderStatusToString(msg.status) << std::endl;
-    
-    if (executionReportCallback_) {
+    if (verbose_) {
+        std::cout << "[CLIENT] Execution Report: Order " << msg.orderId
+                  << " Symbol: " << msg.getSymbol()
+                  << " Side: " << sideToString(msg.side)
+                  << " Executed: " << msg.executionQuantity << " @ " << priceToDouble(msg.executionPrice)
+                  << " Remaining: " << msg.remainingQuantity
+                  << " Status: " << orderStatusToString(msg.status) << std::endl;
+    }
+    
+    if (queueCompletions_) {
+        OrderCompletion completion;
+        completion.kind = OrderCompletion::Kind::EXECUTION;
+        completion.orderId = msg.orderId;
+        completion.status = msg.status;
+        completion.price = msg.executionPrice;
+        completion.quantity = msg.executionQuantity;
+        completion.remaining = msg.remainingQuantity;
+        completion.tradeId = msg.tradeId;
+        addCompletion(completion);
+    } else if (executionReportCallback_) {
         executionReportCallback_(msg);
     }
 }
 
 void Client::handleMarketData(const MarketDataMessage& msg) {
-    std::cout << "[CLIENT] Market Data: " << msg.getSymbol()
-              << " Bid: " << priceToDouble(msg.bestBid) << " x " << msg.bidQuantity
-              << " Ask: " << priceToDouble(msg.bestAsk) << " x " << msg.askQuantity << std::endl;
+    if (verbose_) {
+        std::cout << "[CLIENT] Market Data: " << msg.getSymbol()
+                  << " Bid: " << priceToDouble(msg.bestBid) << " x " << msg.bidQuantity
+                  << " Ask: " << priceToDouble(msg.bestAsk) << " x " << msg.askQuantity << std::endl;
+    }
     
     if (marketDataCallback_) {
         marketDataCallback_(msg);
     }
 }
 
+void Client::handleBookUpdate(const BookUpdateMessage& msg) {
+    // Too frequent to trace to the console like the order messages
+    if (bookUpdateCallback_) {
+        bookUpdateCallback_(msg);
+    }
+}
+
+void Client::addCompletion(OrderCompletion completion) {
+    // A new order's ack names both ids; later replies about it only the
+    // server's, bar a cancel/replace's, which carries its own reference
+    if (completion.clientOrderId != 0 && completion.kind == OrderCompletion::Kind::ACK &&
+        completion.orderId != 0 && !isFinal(completion.status)) {
+        if (clientOrderIds_.emplace(completion.orderId, completion.clientOrderId).second) {
+            trackedOrders_.push_back(completion.orderId);
+        }
+        // Whatever finished since has already gone; erasing it again is a miss
+        while (trackedOrders_.size() > std::max<size_t>(trackedOrderLimit_, 1)) {
+            clientOrderIds_.erase(trackedOrders_.front());
+            trackedOrders_.pop_front();
+        }
+    } else if (completion.orderId != 0) {
+        auto it = clientOrderIds_.find(completion.orderId);
+        if (it != clientOrderIds_.end()) {
+            if (completion.clientOrderId == 0) {
+                completion.clientOrderId = it->second;
+            }
+            if (isFinal(completion.status) && completion.status != OrderStatus::REJECTED) {
+                clientOrderIds_.erase(it);
+            }
+        }
+    }
+    arrived_.push_back(completion);
+}
+
+void Client::publishCompletions() {
+    if (arrived_.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(completionsMutex_);
+        if (completions_.empty()) {
+            completions_.swap(arrived_);
+        } else {
+            completions_.insert(completions_.end(), arrived_.begin(), arrived_.end());
+        }
+    }
+    arrived_.clear();
+    completionsReady_.notify_all();
+}
+
+size_t Client::pollCompletions(std::vector<OrderCompletion>& completions,
+                               std::chrono::microseconds wait) {
+    completions.clear();
+    std::unique_lock<std::mutex> lock(completionsMutex_);
+    if (completions_.empty() && wait.count() > 0) {
+        completionsReady_.wait_for(lock, wait, [this]() { return !completions_.empty(); });
+    }
+    // The caller's vector goes back to be filled next, keeping its capacity
+    completions.swap(completions_);
+    return completions.size();
+}
+
+OrderPipeline& Client::openPipeline() {
+    queueCompletions_ = true;
+    std::lock_guard<std::mutex> lock(pipelinesMutex_);
+    pipelines_.emplace_back(new OrderPipeline(*this));
+    return *pipelines_.back();
+}
+
+void Client::runFlushTimer() {
+    std::unique_lock<std::mutex> lock(flushMutex_);
+    while (!flushStopping_) {
+        flushWake_.wait_for(lock, flushInterval_);
+        if (flushStopping_) {
+            break;
+        }
+        auto cutoff = std::chrono::steady_clock::now() - flushInterval_;
+        std::lock_guard<std::mutex> pipelinesLock(pipelinesMutex_);
+        for (auto& pipeline : pipelines_) {
+            pipeline->flushIfOlderThan(cutoff);
+        }
+    }
+}
+
+template <typename Encode>
+bool OrderPipeline::queue(Encode encode) {
+    if (!client_.connected_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (buffer_.empty()) {
+        oldest_ = std::chrono::steady_clock::now();
+    }
+    char out[MAX_MESSAGE_SIZE];
+    buffer_.insert(buffer_.end(), out, out + encode(out));
+    return buffer_.size() < client_.flushBytes_ || flushLocked();
+}
+
+OrderId OrderPipeline::submitOrder(const std::string& symbol, Side side, OrderType type,
+                                   Price price, Quantity quantity, Price stopPrice,
+                                   TimeInForce timeInForce, uint64_t expireTime) {
+    // Only the owning thread touches the id block
+    if (nextId_ == endId_) {
+        nextId_ = client_.nextClientOrderId_.fetch_add(PIPELINE_ID_BLOCK);
+        endId_ = nextId_ + PIPELINE_ID_BLOCK;
+    }
+    OrderId clientOrderId = nextId_++;
+    bool queued = queue([&](char* out) {
+        return client_.encodeNewOrder(out, clientOrderId, symbol, side, type, price, quantity,
+                                      stopPrice, timeInForce, expireTime);
+    });
+    return queued ? clientOrderId : 0;
+}
+
+bool OrderPipeline::cancelOrder(OrderId orderId) {
+    return queue([&](char* out) { return client_.encodeCancel(out, orderId); });
+}
+
+bool OrderPipeline::modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity) {
+    return queue([&](char* out) {
+        return client_.encodeModify(out, orderId, newPrice, newQuantity);
+    });
+}
+
+bool OrderPipeline::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flushLocked();
+}
+
+bool OrderPipeline::flushIfOlderThan(std::chrono::steady_clock::time_point cutoff) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return buffer_.empty() || oldest_ > cutoff || flushLocked();
+}
+
+bool OrderPipeline::flushLocked() {
+    if (buffer_.empty()) {
+        return true;
+    }
+    bool sent = false;
+    if (client_.connected_) {
+        std::lock_guard<std::mutex> lock(client_.sendMutex_);
+        sent = client_.sendMessage(buffer_.data(), buffer_.size());
+    }
+    if (!sent) {
+        std::cerr << "Failed to send pipelined orders" << std::endl;
+    }
+    buffer_.clear();
+    return sent;
+}
+
+size_t OrderPipeline::pendingBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return buffer_.size();
+}
+
 bool Client::sendMessage(const void* data, size_t length) {
     size_t totalSent = 0;
     const char* buffer = static_cast<const char*>(data);
     
     while (totalSent < length) {
-        int sent = send(socket_, buffer + totalSent, static_cast<int>(length - totalSent), 0);
+        int sent = transport_->send(socket_, buffer + totalSent, length - totalSent);
         if (sent == SOCKET_ERROR) {
             return false;
         }
@@ -294,20 +940,5 @@ bool Client::sendMessage(const void* data, size_t length) {
     return true;
 }
 
-bool Client::receiveMessage(void* buffer, size_t length) {
-    size_t totalReceived = 0;
-    char* buf = static_cast<char*>(buffer);
-    
-    while (totalReceived < length) {
-        int received = recv(socket_, buf + totalReceived, static_cast<int>(length - totalReceived), 0);
-        if (received <= 0) {
-            return false;
-        }
-        totalReceived += received;
-    }
-    
-    return true;
-}
-
 } // namespace MatchingEngine
 
@@ -0,0 +1,312 @@
+#include "EventLoop.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <unordered_map>
+#include <vector>
+#endif
+
+#ifdef MATCHING_ENGINE_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+namespace MatchingEngine {
+
+#if defined(__linux__)
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+namespace {
+
+void drainEventFd(int fd) {
+    uint64_t value;
+    while (read(fd, &value, sizeof(value)) > 0) {
+    }
+}
+
+class EpollPoller : public Poller {
+public:
+    EpollPoller()
+        : epollFd_(epoll_create1(EPOLL_CLOEXEC))
+        , wakeFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+        if (valid()) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = wakeFd_;
+            epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event);
+        }
+    }
+
+    ~EpollPoller() override {
+        if (wakeFd_ >= 0) {
+            close(wakeFd_);
+        }
+        if (epollFd_ >= 0) {
+            close(epollFd_);
+        }
+    }
+
+    bool valid() const { return epollFd_ >= 0 && wakeFd_ >= 0; }
+
+    bool add(int fd, uint32_t events) override { return control(EPOLL_CTL_ADD, fd, events); }
+    bool modify(int fd, uint32_t events) override { return control(EPOLL_CTL_MOD, fd, events); }
+    void remove(int fd) override { epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr); }
+
+    int wait(IoReady* ready, int maxEvents, int timeoutMs) override {
+        if (static_cast<int>(events_.size()) < maxEvents) {
+            events_.resize(maxEvents);
+        }
+        int count = epoll_wait(epollFd_, events_.data(), maxEvents, timeoutMs);
+        if (count < 0) {
+            return 0;  // EINTR
+        }
+
+        int out = 0;
+        for (int i = 0; i < count; ++i) {
+            const epoll_event& event = events_[i];
+            if (event.data.fd == wakeFd_) {
+                drainEventFd(wakeFd_);
+                continue;
+            }
+            uint32_t bits = 0;
+            if (event.events & EPOLLIN) bits |= IO_READ;
+            if (event.events & EPOLLOUT) bits |= IO_WRITE;
+            if (event.events & (EPOLLHUP | EPOLLERR)) bits |= IO_CLOSED;
+            ready[out++] = IoReady{event.data.fd, bits};
+        }
+        return out;
+    }
+
+    void wake() override {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd_, &one, sizeof(one));
+        (void)written;
+    }
+
+private:
+    int epollFd_;
+    int wakeFd_;
+    std::vector<epoll_event> events_;
+
+    bool control(int op, int fd, uint32_t events) {
+        epoll_event event{};
+        event.events = (events & IO_READ ? uint32_t(EPOLLIN) : 0u) |
+                       (events & IO_WRITE ? uint32_t(EPOLLOUT) : 0u);
+        event.data.fd = fd;
+        return epoll_ctl(epollFd_, op, fd, &event) == 0;
+    }
+};
+
+#ifdef MATCHING_ENGINE_HAVE_LIBURING
+
+// One-shot POLL_ADD requests re-armed after every completion, which gives
+// the same level-triggered behaviour as the epoll backend. user_data packs
+// the fd with a generation so completions for a superseded request are
+// recognised and dropped.
+class IoUringPoller : public Poller {
+public:
+    IoUringPoller()
+        : ok_(io_uring_queue_init(QUEUE_DEPTH, &ring_, 0) == 0)
+        , wakeFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+        if (valid()) {
+            add(wakeFd_, IO_READ);
+        }
+    }
+
+    ~IoUringPoller() override {
+        if (wakeFd_ >= 0) {
+            close(wakeFd_);
+        }
+        if (ok_) {
+            io_uring_queue_exit(&ring_);
+        }
+    }
+
+    bool valid() const { return ok_ && wakeFd_ >= 0; }
+
+    bool add(int fd, uint32_t events) override {
+        Registration& registration = registrations_[fd];
+        registration.events = events;
+        ++registration.generation;
+        return arm(fd, registration);
+    }
+
+    bool modify(int fd, uint32_t events) override {
+        auto it = registrations_.find(fd);
+        if (it == registrations_.end()) {
+            return false;
+        }
+        cancel(fd, it->second);
+        it->second.events = events;
+        ++it->second.generation;
+        return arm(fd, it->second);
+    }
+
+    void remove(int fd) override {
+        auto it = registrations_.find(fd);
+        if (it != registrations_.end()) {
+            cancel(fd, it->second);
+            registrations_.erase(it);
+        }
+    }
+
+    int wait(IoReady* ready, int maxEvents, int timeoutMs) override {
+        io_uring_submit(&ring_);
+
+        io_uring_cqe* cqe = nullptr;
+        int result;
+        if (timeoutMs < 0) {
+            result = io_uring_wait_cqe(&ring_, &cqe);
+        } else {
+            __kernel_timespec timeout{};
+            timeout.tv_sec = timeoutMs / 1000;
+            timeout.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+            result = io_uring_wait_cqe_timeout(&ring_, &cqe, &timeout);
+        }
+        if (result < 0) {
+            return 0;
+        }
+
+        int out = 0;
+        unsigned head;
+        unsigned seen = 0;
+        io_uring_for_each_cqe(&ring_, head, cqe) {
+            ++seen;
+            uint64_t data = io_uring_cqe_get_data64(cqe);
+            if (data == CANCEL_TAG) {
+                continue;
+            }
+            int fd = static_cast<int>(data >> 32);
+            uint32_t generation = static_cast<uint32_t>(data);
+            auto it = registrations_.find(fd);
+            if (it == registrations_.end() || it->second.generation != generation ||
+                cqe->res == -ECANCELED) {
+                continue;
+            }
+
+            // The request fired and is gone; ask again for the next round
+            it->second.armed = false;
+            arm(fd, it->second);
+
+            if (fd == wakeFd_) {
+                drainEventFd(wakeFd_);
+                continue;
+            }
+            if (out < maxEvents) {
+                uint32_t bits = 0;
+                if (cqe->res & POLLIN) bits |= IO_READ;
+                if (cqe->res & POLLOUT) bits |= IO_WRITE;
+                if (cqe->res < 0 || (cqe->res & (POLLHUP | POLLERR))) bits |= IO_CLOSED;
+                ready[out++] = IoReady{fd, bits};
+            }
+        }
+        io_uring_cq_advance(&ring_, seen);
+        return out;
+    }
+
+    void wake() override {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd_, &one, sizeof(one));
+        (void)written;
+    }
+
+private:
+    static constexpr unsigned QUEUE_DEPTH = 1024;
+    static constexpr uint64_t CANCEL_TAG = ~uint64_t(0);
+
+    struct Registration {
+        uint32_t events = 0;
+        uint32_t generation = 0;
+        bool armed = false;
+    };
+
+    io_uring ring_;
+    bool ok_;
+    int wakeFd_;
+    std::unordered_map<int, Registration> registrations_;
+
+    static uint64_t tag(int fd, uint32_t generation) {
+        return (static_cast<uint64_t>(fd) << 32) | generation;
+    }
+
+    io_uring_sqe* nextSqe() {
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+        if (!sqe) {
+            io_uring_submit(&ring_);  // Submission queue full - flush and retry
+            sqe = io_uring_get_sqe(&ring_);
+        }
+        return sqe;
+    }
+
+    bool arm(int fd, Registration& registration) {
+        io_uring_sqe* sqe = nextSqe();
+        if (!sqe) {
+            return false;
+        }
+        unsigned mask = (registration.events & IO_READ ? POLLIN : 0) |
+                        (registration.events & IO_WRITE ? POLLOUT : 0);
+        io_uring_prep_poll_add(sqe, fd, mask);
+        io_uring_sqe_set_data64(sqe, tag(fd, registration.generation));
+        registration.armed = true;
+        return true;
+    }
+
+    void cancel(int fd, Registration& registration) {
+        if (!registration.armed) {
+            return;
+        }
+        io_uring_sqe* sqe = nextSqe();
+        if (sqe) {
+            io_uring_prep_poll_remove(sqe, tag(fd, registration.generation));
+            io_uring_sqe_set_data64(sqe, CANCEL_TAG);
+        }
+        registration.armed = false;
+    }
+};
+
+#endif // MATCHING_ENGINE_HAVE_LIBURING
+
+} // namespace
+
+std::unique_ptr<Poller> Poller::create(PollerType type) {
+#ifdef MATCHING_ENGINE_HAVE_LIBURING
+    if (type == PollerType::IO_URING) {
+        auto poller = std::make_unique<IoUringPoller>();
+        if (poller->valid()) {
+            return poller;
+        }
+        return nullptr;
+    }
+#else
+    if (type == PollerType::IO_URING) {
+        return nullptr;
+    }
+#endif
+    auto poller = std::make_unique<EpollPoller>();
+    if (!poller->valid()) {
+        return nullptr;
+    }
+    return poller;
+}
+
+#else // !__linux__
+
+bool setNonBlocking(int) {
+    return false;
+}
+
+std::unique_ptr<Poller> Poller::create(PollerType) {
+    return nullptr;
+}
+
+#endif
+
+} // namespace MatchingEngine
@@ -0,0 +1,224 @@
+#include "EventRing.h"
+#include "Order.h"
+#include "Trade.h"
+#include "ThreadUtil.h"
+#include "Interner.h"
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+namespace MatchingEngine {
+
+namespace {
+// Empty polls before an idle consumer starts sleeping
+constexpr size_t CONSUMER_SPIN_POLLS = 1000;
+} // namespace
+
+EngineEvent EngineEvent::fromTrade(const Trade& trade) {
+    EngineEvent event{};
+    event.type = EventType::TRADE;
+    event.symbolId = trade.getSymbolId();
+    event.orderId = trade.getBuyOrderId();
+    event.otherOrderId = trade.getSellOrderId();
+    event.price = trade.getPrice();
+    event.quantity = trade.getQuantity();
+    event.timestamp = trade.getTimestamp();
+    return event;
+}
+
+EngineEvent EngineEvent::fromOrder(const Order& order) {
+    EngineEvent event{};
+    event.type = EventType::ORDER;
+    event.side = static_cast<uint8_t>(order.getSide());
+    event.orderType = static_cast<uint8_t>(order.getType());
+    event.status = static_cast<uint8_t>(order.getStatus());
+    event.symbolId = order.getSymbolId();
+    event.orderId = order.getOrderId();
+    event.price = order.getPrice();
+    event.quantity = order.getQuantity();
+    event.remaining = order.getRemainingQuantity();
+    event.clientKey = order.getClientKey();
+    event.timestamp = order.getTimestamp();
+    return event;
+}
+
+EngineEvent EngineEvent::levelUpdate(SymbolId symbolId, Side side, Price price,
+                                     Quantity quantity, uint32_t orderCount) {
+    EngineEvent event{};
+    event.type = EventType::LEVEL;
+    event.side = static_cast<uint8_t>(side);
+    event.symbolId = symbolId;
+    event.price = price;
+    event.quantity = quantity;
+    event.orderCount = orderCount;
+    return event;
+}
+
+std::string EngineEvent::toString() const {
+    std::ostringstream oss;
+    if (type == EventType::LEVEL) {
+        oss << "Level[Symbol=" << symbolInterner().name(symbolId)
+            << ", Side=" << sideToString(static_cast<Side>(side))
+            << ", Price=" << std::fixed << std::setprecision(4) << priceToDouble(price)
+            << ", Qty=" << quantity
+            << ", Orders=" << orderCount
+            << "]";
+    } else if (type == EventType::TRADE) {
+        oss << "Trade[Buy=" << orderId
+            << ", Sell=" << otherOrderId
+            << ", Symbol=" << symbolInterner().name(symbolId)
+            << ", Price=" << std::fixed << std::setprecision(4) << priceToDouble(price)
+            << ", Qty=" << quantity
+            << "]";
+    } else {
+        oss << "Order[ID=" << orderId
+            << ", Symbol=" << symbolInterner().name(symbolId)
+            << ", Side=" << sideToString(static_cast<Side>(side))
+            << ", Type=" << orderTypeToString(static_cast<OrderType>(orderType))
+            << ", Price=" << std::fixed << std::setprecision(4) << priceToDouble(price)
+            << ", Qty=" << quantity
+            << ", Remaining=" << remaining
+            << ", Status=" << orderStatusToString(static_cast<OrderStatus>(status))
+            << "]";
+    }
+    return oss.str();
+}
+
+EventRing::EventRing(size_t capacity, size_t batchSize)
+    : capacity_(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity))
+    , mask_(capacity_ - 1)
+    , batchSize_(batchSize > 0 ? batchSize : 1)
+    , cells_(new Cell[capacity_])
+    , running_(false) {
+    for (size_t i = 0; i < capacity_; ++i) {
+        cells_[i].sequence.store(0, std::memory_order_relaxed);
+    }
+}
+
+EventRing::~EventRing() {
+    stop();
+}
+
+void EventRing::addConsumer(EventHandler handler) {
+    if (running_) {
+        return;
+    }
+    auto consumer = std::make_unique<Consumer>();
+    consumer->handler = std::move(handler);
+    consumers_.push_back(std::move(consumer));
+}
+
+void EventRing::start() {
+    if (running_) {
+        return;
+    }
+    uint64_t start = claimed_.load(std::memory_order_acquire);
+    gate_.store(start, std::memory_order_relaxed);
+    for (auto& consumer : consumers_) {
+        consumer->cursor.store(start, std::memory_order_relaxed);
+        consumer->finished.store(false, std::memory_order_relaxed);
+    }
+    running_ = true;
+    for (auto& consumer : consumers_) {
+        Consumer* target = consumer.get();
+        consumer->thread = std::thread([this, target]() { runConsumer(*target); });
+    }
+}
+
+void EventRing::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    for (auto& consumer : consumers_) {
+        if (consumer->thread.joinable()) {
+            consumer->thread.join();
+        }
+    }
+}
+
+void EventRing::publish(const EngineEvent& event) {
+    if (consumers_.empty() || !running_) {
+        return;
+    }
+
+    uint64_t position = claimed_.fetch_add(1, std::memory_order_acq_rel);
+
+    // Wait for the slowest consumer to free the slot a lap behind us
+    while (position - gate_.load(std::memory_order_acquire) >= capacity_) {
+        uint64_t slowest = slowestCursor();
+        if (slowest == UINT64_MAX) {
+            return;  // Every consumer has stopped; nobody will read it
+        }
+        gate_.store(slowest, std::memory_order_release);
+        if (position - slowest < capacity_) {
+            break;
+        }
+        std::this_thread::yield();
+    }
+
+    Cell& cell = cells_[position & mask_];
+    cell.event = event;
+    cell.sequence.store(position + 1, std::memory_order_release);
+}
+
+uint64_t EventRing::slowestCursor() const {
+    uint64_t slowest = UINT64_MAX;
+    for (const auto& consumer : consumers_) {
+        if (consumer->finished.load(std::memory_order_acquire)) {
+            continue;
+        }
+        uint64_t cursor = consumer->cursor.load(std::memory_order_acquire);
+        if (cursor < slowest) {
+            slowest = cursor;
+        }
+    }
+    return slowest;
+}
+
+void EventRing::runConsumer(Consumer& consumer) {
+    std::vector<EngineEvent> batch(batchSize_);
+    size_t idlePolls = 0;
+
+    while (running_) {
+        if (consume(consumer, batch) > 0) {
+            idlePolls = 0;
+        } else if (++idlePolls < CONSUMER_SPIN_POLLS) {
+            cpuRelax();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    // Deliver whatever was published before stop()
+    while (consumer.cursor.load(std::memory_order_relaxed) <
+           claimed_.load(std::memory_order_acquire)) {
+        if (consume(consumer, batch) == 0) {
+            std::this_thread::yield();  // A publisher is mid-write
+        }
+    }
+    consumer.finished.store(true, std::memory_order_release);
+}
+
+size_t EventRing::consume(Consumer& consumer, std::vector<EngineEvent>& batch) {
+    uint64_t cursor = consumer.cursor.load(std::memory_order_relaxed);
+    size_t count = 0;
+    while (count < batchSize_) {
+        const Cell& cell = cells_[(cursor + count) & mask_];
+        if (cell.sequence.load(std::memory_order_acquire) != cursor + count + 1) {
+            break;
+        }
+        batch[count] = cell.event;
+        ++count;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // Release the slots before running the handler, so publishers aren't
+    // held up by slow consumers any longer than necessary
+    consumer.cursor.store(cursor + count, std::memory_order_release);
+    consumer.handler(batch.data(), count);
+    return count;
+}
+
+} // namespace MatchingEngine
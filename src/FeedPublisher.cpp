@@ -0,0 +1,217 @@
+#include "FeedPublisher.h"
+#include "Interner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace MatchingEngine {
+
+namespace {
+
+bool resolve(const std::string& host, uint16_t port, sockaddr_in& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    return inet_pton(AF_INET, host.c_str(), &address.sin_addr) == 1;
+}
+
+FeedProtocol::Entry toEntry(SymbolId symbolId, Side side, Price price, Quantity quantity,
+                            uint32_t orderCount) {
+    FeedProtocol::Entry entry;
+    ProtocolV2::setSymbol(entry.symbol, symbolInterner().name(symbolId));
+    entry.side = side;
+    entry.price = price;
+    entry.quantity = quantity;
+    entry.orderCount = orderCount;
+    return entry;
+}
+
+} // namespace
+
+FeedPublisher::FeedPublisher(EventRing& events, const FeedConfig& config)
+    : config_(config)
+    , socket_(INVALID_SOCKET)
+    , running_(false)
+    , snapshotCycles_(0)
+    , sequence_(0) {
+    std::memset(&incrementalAddr_, 0, sizeof(incrementalAddr_));
+    std::memset(&snapshotAddr_, 0, sizeof(snapshotAddr_));
+    events.addConsumer([this](const EngineEvent* batch, size_t count) { onEvents(batch, count); });
+}
+
+FeedPublisher::~FeedPublisher() {
+    stop();
+}
+
+bool FeedPublisher::start() {
+    if (running_) {
+        return true;
+    }
+    if (!resolve(config_.incrementalAddress, config_.incrementalPort, incrementalAddr_) ||
+        !resolve(config_.snapshotAddress, config_.snapshotPort, snapshotAddr_)) {
+        std::cerr << "Invalid market data feed address" << std::endl;
+        return false;
+    }
+
+    socket_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socket_ == INVALID_SOCKET) {
+        std::cerr << "Failed to create feed socket" << std::endl;
+        return false;
+    }
+
+    // Only used when the destinations are groups; harmless otherwise
+#ifdef _WIN32
+    DWORD ttl = config_.ttl;
+#else
+    unsigned char ttl = config_.ttl;
+#endif
+    setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&ttl, sizeof(ttl));
+    if (!config_.interfaceAddress.empty()) {
+        in_addr local{};
+        if (inet_pton(AF_INET, config_.interfaceAddress.c_str(), &local) != 1 ||
+            setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, (const char*)&local,
+                       sizeof(local)) != 0) {
+            std::cerr << "Invalid feed interface: " << config_.interfaceAddress << std::endl;
+            closesocket(socket_);
+            socket_ = INVALID_SOCKET;
+            return false;
+        }
+    }
+
+    running_ = true;
+    snapshotThread_ = std::thread(&FeedPublisher::runSnapshots, this);
+    std::cout << "Market data feed on " << config_.incrementalAddress << ":"
+              << config_.incrementalPort << ", snapshots on " << config_.snapshotAddress << ":"
+              << config_.snapshotPort << std::endl;
+    return true;
+}
+
+void FeedPublisher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stopMutex_);
+        if (!running_.exchange(false)) {
+            return;
+        }
+    }
+    stopSignal_.notify_all();
+    if (snapshotThread_.joinable()) {
+        snapshotThread_.join();
+    }
+    closesocket(socket_);
+    socket_ = INVALID_SOCKET;
+}
+
+uint64_t FeedPublisher::getSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sequence_;
+}
+
+void FeedPublisher::onEvents(const EngineEvent* events, size_t count) {
+    entries_.clear();
+    packets_.clear();
+    packetSizes_.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < count; ++i) {
+            const EngineEvent& event = events[i];
+            if (event.type != EventType::LEVEL) {
+                continue;
+            }
+            Side side = static_cast<Side>(event.side);
+            Book& book = books_[event.symbolId];
+            auto apply = [&](auto& ladder) {
+                if (event.quantity == 0) {
+                    ladder.erase(event.price);
+                } else {
+                    ladder[event.price] = Level{event.quantity, event.orderCount};
+                }
+            };
+            if (side == Side::BUY) {
+                apply(book.bids);
+            } else {
+                apply(book.asks);
+            }
+            entries_.push_back(
+                toEntry(event.symbolId, side, event.price, event.quantity, event.orderCount));
+        }
+
+        // Numbered under the lock, sent after it
+        for (size_t first = 0; first < entries_.size(); first += FeedProtocol::MAX_ENTRIES) {
+            size_t entries = std::min(FeedProtocol::MAX_ENTRIES, entries_.size() - first);
+            FeedProtocol::PacketHeader header;
+            header.kind = FeedProtocol::PacketKind::INCREMENTAL;
+            header.sequence = ++sequence_;
+            size_t offset = packets_.size();
+            packets_.resize(offset + FeedProtocol::packetSize(entries));
+            packetSizes_.push_back(FeedProtocol::encode(packets_.data() + offset, header,
+                                                        entries_.data() + first, entries));
+        }
+    }
+
+    if (!running_) {
+        return;
+    }
+    size_t offset = 0;
+    for (size_t size : packetSizes_) {
+        send(incrementalAddr_, packets_.data() + offset, size);
+        offset += size;
+    }
+}
+
+void FeedPublisher::runSnapshots() {
+    while (running_) {
+        sendSnapshot();
+        std::unique_lock<std::mutex> lock(stopMutex_);
+        stopSignal_.wait_for(lock, std::chrono::milliseconds(config_.snapshotIntervalMs),
+                             [this]() { return !running_; });
+    }
+}
+
+void FeedPublisher::sendSnapshot() {
+    std::vector<FeedProtocol::Entry> image;
+    uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sequence = sequence_;
+        for (const auto& [symbolId, book] : books_) {
+            for (const auto& [price, level] : book.bids) {
+                image.push_back(toEntry(symbolId, Side::BUY, price, level.quantity, level.orderCount));
+            }
+            for (const auto& [price, level] : book.asks) {
+                image.push_back(toEntry(symbolId, Side::SELL, price, level.quantity, level.orderCount));
+            }
+        }
+    }
+
+    // An empty image is still one packet, so receivers can sync to it
+    size_t parts = std::max<size_t>(1, (image.size() + FeedProtocol::MAX_ENTRIES - 1) /
+                                           FeedProtocol::MAX_ENTRIES);
+    if (parts > UINT16_MAX) {
+        std::cerr << "Market data image too large for one snapshot cycle" << std::endl;
+        return;
+    }
+
+    char packet[FeedProtocol::MAX_PACKET_SIZE];
+    for (size_t part = 0; part < parts; ++part) {
+        size_t first = part * FeedProtocol::MAX_ENTRIES;
+        size_t entries = std::min(FeedProtocol::MAX_ENTRIES, image.size() - first);
+        FeedProtocol::PacketHeader header;
+        header.kind = FeedProtocol::PacketKind::SNAPSHOT;
+        header.sequence = sequence;
+        header.part = static_cast<uint16_t>(part);
+        header.parts = static_cast<uint16_t>(parts);
+        size_t size = FeedProtocol::encode(packet, header, image.data() + first, entries);
+        send(snapshotAddr_, packet, size);
+    }
+    ++snapshotCycles_;
+}
+
+void FeedPublisher::send(const sockaddr_in& address, const char* data, size_t length) {
+    // Best effort, like the network under it; receivers recover from loss
+    sendto(socket_, data, static_cast<int>(length), 0,
+           reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
+
+} // namespace MatchingEngine
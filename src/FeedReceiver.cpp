@@ -0,0 +1,294 @@
+#include "FeedReceiver.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <sys/select.h>
+#endif
+
+namespace MatchingEngine {
+
+namespace {
+
+// Incremental packets held while waiting for a snapshot; the oldest go first
+constexpr size_t MAX_PENDING_PACKETS = 65536;
+constexpr long RECEIVE_POLL_TIMEOUT_US = 100000;
+
+bool isMulticast(const in_addr& address) {
+    return (ntohl(address.s_addr) & 0xF0000000u) == 0xE0000000u;
+}
+
+} // namespace
+
+FeedReceiver::FeedReceiver(const FeedConfig& config)
+    : config_(config)
+    , incrementalSocket_(INVALID_SOCKET)
+    , snapshotSocket_(INVALID_SOCKET)
+    , incrementalPort_(0)
+    , snapshotPort_(0)
+    , running_(false)
+    , synced_(false)
+    , sequence_(0)
+    , gaps_(0)
+    , imageSequence_(0)
+    , imageNextPart_(0) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+}
+
+FeedReceiver::~FeedReceiver() {
+    stop();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool FeedReceiver::start() {
+    if (running_) {
+        return true;
+    }
+    if (!openChannel(config_.incrementalAddress, config_.incrementalPort, incrementalSocket_,
+                     incrementalPort_) ||
+        !openChannel(config_.snapshotAddress, config_.snapshotPort, snapshotSocket_,
+                     snapshotPort_)) {
+        stop();
+        return false;
+    }
+
+    running_ = true;
+    receiveThread_ = std::thread(&FeedReceiver::receiveLoop, this);
+    return true;
+}
+
+void FeedReceiver::stop() {
+    running_ = false;
+    if (receiveThread_.joinable()) {
+        receiveThread_.join();
+    }
+    for (SocketType* socket : {&incrementalSocket_, &snapshotSocket_}) {
+        if (*socket != INVALID_SOCKET) {
+            closesocket(*socket);
+            *socket = INVALID_SOCKET;
+        }
+    }
+}
+
+bool FeedReceiver::openChannel(const std::string& host, uint16_t port, SocketType& out,
+                               uint16_t& bound) {
+    in_addr group{};
+    if (inet_pton(AF_INET, host.c_str(), &group) != 1) {
+        std::cerr << "Invalid feed address: " << host << std::endl;
+        return false;
+    }
+
+    out = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (out == INVALID_SOCKET) {
+        std::cerr << "Failed to create feed socket" << std::endl;
+        return false;
+    }
+
+    // Several receivers on one host share the group's port
+    int opt = 1;
+    setsockopt(out, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+
+    // A group is joined on the wildcard address; a unicast feed binds its own
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    bool multicast = isMulticast(group);
+    address.sin_addr.s_addr = multicast ? htonl(INADDR_ANY) : group.s_addr;
+    if (bind(out, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR) {
+        std::cerr << "Failed to bind feed socket to " << host << ":" << port << std::endl;
+        return false;
+    }
+
+    if (multicast) {
+        ip_mreq membership{};
+        membership.imr_multiaddr = group;
+        membership.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (!config_.interfaceAddress.empty()) {
+            inet_pton(AF_INET, config_.interfaceAddress.c_str(), &membership.imr_interface);
+        }
+        if (setsockopt(out, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&membership,
+                       sizeof(membership)) != 0) {
+            std::cerr << "Failed to join feed group " << host << std::endl;
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    int length = sizeof(address);
+#else
+    socklen_t length = sizeof(address);
+#endif
+    getsockname(out, reinterpret_cast<sockaddr*>(&address), &length);
+    bound = ntohs(address.sin_port);
+    return true;
+}
+
+void FeedReceiver::receiveLoop() {
+    char buffer[FeedProtocol::MAX_PACKET_SIZE + 1];  // One spare byte shows oversized datagrams
+    while (running_) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(incrementalSocket_, &readable);
+        FD_SET(snapshotSocket_, &readable);
+        timeval timeout{0, RECEIVE_POLL_TIMEOUT_US};
+        int highest = static_cast<int>(std::max(incrementalSocket_, snapshotSocket_));
+        if (select(highest + 1, &readable, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
+
+        for (SocketType socket : {incrementalSocket_, snapshotSocket_}) {
+            if (!FD_ISSET(socket, &readable)) {
+                continue;
+            }
+            int received = recv(socket, buffer, sizeof(buffer), 0);
+            if (received > 0) {
+                onPacket(buffer, static_cast<size_t>(received));
+            }
+        }
+    }
+}
+
+void FeedReceiver::onPacket(const char* data, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FeedProtocol::PacketHeader header;
+    if (!FeedProtocol::decode(data, length, header, entries_)) {
+        return;
+    }
+    if (header.kind == FeedProtocol::PacketKind::INCREMENTAL) {
+        onIncremental(header.sequence, entries_);
+    } else {
+        onSnapshot(header, entries_);
+    }
+}
+
+void FeedReceiver::onIncremental(uint64_t sequence, std::vector<FeedProtocol::Entry>& entries) {
+    if (synced_) {
+        if (sequence <= sequence_) {
+            return;  // Duplicate
+        }
+        if (sequence == sequence_ + 1) {
+            for (const FeedProtocol::Entry& entry : entries) {
+                apply(books_, entry);
+            }
+            sequence_ = sequence;
+            return;
+        }
+        ++gaps_;
+        synced_ = false;
+    }
+
+    // Held until a snapshot at or after the gap makes it applicable
+    if (sequence > sequence_) {
+        pending_[sequence].swap(entries);
+        if (pending_.size() > MAX_PENDING_PACKETS) {
+            pending_.erase(pending_.begin());
+        }
+    }
+}
+
+void FeedReceiver::onSnapshot(const FeedProtocol::PacketHeader& header,
+                              const std::vector<FeedProtocol::Entry>& entries) {
+    if (synced_) {
+        return;
+    }
+
+    // Parts of one cycle arrive in order; anything else waits for the next
+    if (header.part == 0) {
+        image_.clear();
+        imageSequence_ = header.sequence;
+    } else if (imageNextPart_ == 0 || header.part != imageNextPart_ ||
+               header.sequence != imageSequence_) {
+        image_.clear();
+        imageNextPart_ = 0;
+        return;
+    }
+    for (const FeedProtocol::Entry& entry : entries) {
+        apply(image_, entry);
+    }
+    imageNextPart_ = static_cast<uint16_t>(header.part + 1);
+    if (imageNextPart_ < header.parts) {
+        return;
+    }
+
+    books_.swap(image_);
+    image_.clear();
+    imageNextPart_ = 0;
+    sequence_ = imageSequence_;
+    drainPending();
+    synced_ = pending_.empty();  // Otherwise another gap follows the snapshot
+}
+
+void FeedReceiver::drainPending() {
+    pending_.erase(pending_.begin(), pending_.upper_bound(sequence_));
+    while (!pending_.empty() && pending_.begin()->first == sequence_ + 1) {
+        for (const FeedProtocol::Entry& entry : pending_.begin()->second) {
+            apply(books_, entry);
+        }
+        ++sequence_;
+        pending_.erase(pending_.begin());
+    }
+}
+
+void FeedReceiver::apply(Books& books, const FeedProtocol::Entry& entry) {
+    Book& book = books[ProtocolV2::getSymbol(entry.symbol)];
+    auto update = [&](auto& ladder) {
+        if (entry.quantity == 0) {
+            ladder.erase(entry.price);
+        } else {
+            ladder[entry.price] = Level{entry.price, entry.quantity, entry.orderCount};
+        }
+    };
+    if (entry.side == Side::BUY) {
+        update(book.bids);
+    } else {
+        update(book.asks);
+    }
+}
+
+bool FeedReceiver::isSynced() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return synced_;
+}
+
+uint64_t FeedReceiver::getSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sequence_;
+}
+
+uint64_t FeedReceiver::getGaps() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return gaps_;
+}
+
+std::vector<FeedReceiver::Level> FeedReceiver::getDepth(const std::string& symbol, Side side,
+                                                        size_t levels) const {
+    std::vector<Level> depth;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = books_.find(symbol);
+    if (it == books_.end()) {
+        return depth;
+    }
+
+    auto collect = [&](const auto& ladder) {
+        for (const auto& entry : ladder) {
+            if (depth.size() >= levels) {
+                break;
+            }
+            depth.push_back(entry.second);
+        }
+    };
+    if (side == Side::BUY) {
+        collect(it->second.bids);
+    } else {
+        collect(it->second.asks);
+    }
+    return depth;
+}
+
+} // namespace MatchingEngine
@@ -0,0 +1,79 @@
+#include "FrameBuffer.h"
+#include <algorithm>
+
+namespace MatchingEngine {
+
+FrameBuffer::FrameBuffer(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, MAX_MESSAGE_SIZE * 2))
+    , storage_(new uint64_t[(capacity_ + sizeof(uint64_t) - 1) / sizeof(uint64_t)])
+    , readPos_(0)
+    , writePos_(0)
+    , malformed_(false)
+    , version_(1) {
+}
+
+char* FrameBuffer::writePtr() {
+    if (readPos_ == writePos_) {
+        readPos_ = writePos_ = 0;
+    } else if (writable() < MAX_MESSAGE_SIZE) {
+        // Move the partial frame to the front; it is shorter than a message.
+        // Keep its start aligned the way it was so in-place views still work.
+        size_t pending = writePos_ - readPos_;
+        size_t offset = readPos_ % alignof(uint64_t);
+        std::memmove(data() + offset, data() + readPos_, pending);
+        readPos_ = offset;
+        writePos_ = offset + pending;
+    }
+    return data() + writePos_;
+}
+
+bool FrameBuffer::nextFrame(Frame& frame) {
+    if (malformed_) {
+        return false;
+    }
+
+    const unsigned char* start = reinterpret_cast<const unsigned char*>(data() + readPos_);
+    uint32_t length;
+    MessageType type;
+    if (version_ >= 2) {
+        // uint16 length, uint8 type, uint8 flags - little-endian
+        if (buffered() < 4) {
+            return false;
+        }
+        length = static_cast<uint32_t>(start[0]) | (static_cast<uint32_t>(start[1]) << 8);
+        type = static_cast<MessageType>(start[2]);
+        if (length < 4) {
+            malformed_ = true;
+            return false;
+        }
+    } else {
+        if (buffered() < sizeof(MessageHeader)) {
+            return false;
+        }
+        MessageHeader header;
+        std::memcpy(&header, start, sizeof(MessageHeader));
+        length = header.length;
+        type = header.type;
+        if (length < sizeof(MessageHeader)) {
+            malformed_ = true;
+            return false;
+        }
+    }
+
+    if (length > MAX_MESSAGE_SIZE) {
+        malformed_ = true;
+        return false;
+    }
+    if (buffered() < length) {
+        return false;
+    }
+
+    frame.type = type;
+    frame.length = length;
+    frame.data = data() + readPos_;
+    frame.version = version_;
+    readPos_ += length;
+    return true;
+}
+
+} // namespace MatchingEngine
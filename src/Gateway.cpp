@@ -0,0 +1,376 @@
+#include "Gateway.h"
+#include "Interner.h"
+#include "Message.h"
+#include "Order.h"
+#include "ProtocolV2.h"
+#include <iostream>
+#include <functional>
+
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+
+namespace MatchingEngine {
+
+namespace {
+
+constexpr int LOGON_TIMEOUT_MS = 1000;
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;  // A node going away is an error, not SIGPIPE
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+} // namespace
+
+Gateway::Gateway(const GatewayConfig& config)
+    : config_(config)
+    , running_(false)
+    , nextTag_(1)
+    , totalOrders_(0) {
+    if (!config_.symbolHash) {
+        config_.symbolHash = std::hash<std::string>();
+    }
+    for (size_t i = 0; i < config_.nodes.size() && i < ShardedEngine::MAX_NODES; ++i) {
+        auto link = std::make_unique<Link>();
+        link->index = i;
+        link->node = config_.nodes[i];
+        links_.push_back(std::move(link));
+    }
+}
+
+Gateway::~Gateway() {
+    stop();
+}
+
+bool Gateway::start() {
+    if (running_ || links_.empty()) {
+        return false;
+    }
+    for (auto& link : links_) {
+        if (!connect(*link)) {
+            std::cerr << "Failed to reach engine node " << link->index << " at "
+                      << link->node.host << ":" << link->node.port << std::endl;
+            for (auto& opened : links_) {
+                if (opened->socket != INVALID_SOCKET) {
+                    closesocket(opened->socket);
+                    opened->socket = INVALID_SOCKET;
+                }
+                opened->up = false;
+            }
+            return false;
+        }
+    }
+
+    running_ = true;
+    for (auto& link : links_) {
+        link->writer = std::thread(&Gateway::runWriter, this, std::ref(*link));
+        link->reader = std::thread(&Gateway::runReader, this, std::ref(*link));
+    }
+    return true;
+}
+
+void Gateway::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    // Writers send what is queued and exit; shutting the sockets down then
+    // returns the readers' blocking recv
+    for (auto& link : links_) {
+        {
+            std::lock_guard<std::mutex> lock(link->mutex);  // Not between a writer's check and wait
+        }
+        link->wake.notify_all();
+        if (link->writer.joinable()) {
+            link->writer.join();
+        }
+#ifdef _WIN32
+        shutdown(link->socket, SD_BOTH);
+#else
+        shutdown(link->socket, SHUT_RDWR);
+#endif
+        if (link->reader.joinable()) {
+            link->reader.join();
+        }
+        closesocket(link->socket);
+        link->socket = INVALID_SOCKET;
+    }
+}
+
+bool Gateway::connect(Link& link) {
+    link.socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (link.socket == INVALID_SOCKET) {
+        return false;
+    }
+
+    sockaddr_in nodeAddr{};
+    nodeAddr.sin_family = AF_INET;
+    nodeAddr.sin_port = htons(link.node.port);
+#ifdef _WIN32
+    nodeAddr.sin_addr.s_addr = inet_addr(link.node.host.c_str());
+#else
+    inet_pton(AF_INET, link.node.host.c_str(), &nodeAddr.sin_addr);
+#endif
+    if (::connect(link.socket, (sockaddr*)&nodeAddr, sizeof(nodeAddr)) == SOCKET_ERROR) {
+        return false;
+    }
+
+    // Sends are already batched here; don't let Nagle hold them back too
+    int noDelay = 1;
+    setsockopt(link.socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
+    // Links need protocol v2; a node that grants less can't serve one
+    LogonMessage logon;
+    logon.protocolVersion = ProtocolV2::VERSION;
+    logon.setClientId("gateway");
+    if (send(link.socket, (const char*)&logon, sizeof(logon), SEND_FLAGS) !=
+        static_cast<int>(sizeof(logon))) {
+        return false;
+    }
+
+#ifdef _WIN32
+    DWORD timeout = LOGON_TIMEOUT_MS;
+    DWORD noTimeout = 0;
+#else
+    timeval timeout{LOGON_TIMEOUT_MS / 1000, (LOGON_TIMEOUT_MS % 1000) * 1000};
+    timeval noTimeout{0, 0};
+#endif
+    setsockopt(link.socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+    link.input = FrameBuffer();
+    Frame frame;
+    while (!link.input.nextFrame(frame)) {
+        int received = recv(link.socket, link.input.writePtr(),
+                            static_cast<int>(link.input.writable()), 0);
+        if (received <= 0 || link.input.malformed()) {
+            return false;
+        }
+        link.input.commit(static_cast<size_t>(received));
+    }
+    MessageScratch<LogonAckMessage> scratch;
+    const LogonAckMessage* ack = frame.type == MessageType::LOGON_ACK
+        ? viewMessage(frame, scratch) : nullptr;
+    if (!ack || ack->protocolVersion < ProtocolV2::VERSION) {
+        return false;
+    }
+
+    setsockopt(link.socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&noTimeout, sizeof(noTimeout));
+    link.input.setProtocolVersion(ProtocolV2::VERSION);
+    link.up = true;
+    return true;
+}
+
+size_t Gateway::nodeFor(const std::string& symbol) const {
+    return links_.empty() ? 0 : config_.symbolHash(symbol) % links_.size();
+}
+
+Gateway::Link* Gateway::route(const EngineCommand& command) const {
+    size_t node;
+    if (command.type == CommandType::NEW_ORDER || command.type == CommandType::MASS_CANCEL) {
+        node = nodeFor(symbolInterner().name(command.symbolId));
+    } else {
+        node = nodeOf(command.orderId);
+    }
+    return node < links_.size() ? links_[node].get() : nullptr;
+}
+
+bool Gateway::submit(EngineCommand& command) {
+    if (!running_) {
+        command.reject = RejectReason::NODE_UNAVAILABLE;
+        return false;
+    }
+
+    if (command.type == CommandType::MASS_CANCEL && !(command.scope & MASS_CANCEL_BY_SYMBOL)) {
+        // Every node holds some of the client's orders. A copy that can't
+        // go out reports none cancelled, so the total still arrives.
+        for (size_t i = 0; i < links_.size(); ++i) {
+            EngineCommand copy = command;
+            copy.batchIndex = static_cast<uint16_t>(i);
+            copy.batchSize = static_cast<uint16_t>(links_.size());
+            if (!forward(*links_[i], copy) && commandCallback_) {
+                copy.quantity = 0;
+                copy.reject = RejectReason::NODE_UNAVAILABLE;
+                commandCallback_(copy, false, nullptr);
+            }
+        }
+        return true;
+    }
+
+    Link* link = route(command);
+    if (!link || !forward(*link, command)) {
+        command.reject = RejectReason::NODE_UNAVAILABLE;
+        return false;
+    }
+    return true;
+}
+
+bool Gateway::submitBatch(EngineCommand* commands, size_t count) {
+    bool forwarded = true;
+    for (size_t i = 0; i < count; ++i) {
+        if (submit(commands[i])) {
+            continue;
+        }
+        forwarded = false;
+        if (commandCallback_) {
+            commandCallback_(commands[i], false, nullptr);
+        }
+    }
+    return forwarded;
+}
+
+bool Gateway::forward(Link& link, const EngineCommand& command) {
+    ProtocolV2::LinkCommand msg;
+    msg.tag = nextTag_++;
+    msg.type = static_cast<uint8_t>(command.type);
+    msg.side = command.side;
+    msg.orderType = command.orderType;
+    msg.scope = command.scope;
+    msg.orderId = command.orderId;
+    msg.price = command.price;
+    msg.quantity = command.quantity;
+    msg.stopPrice = command.stopPrice;
+    msg.timeInForce = command.timeInForce;
+    msg.expireTime = command.expireTime;
+    ProtocolV2::setSymbol(msg.symbol, symbolInterner().name(command.symbolId));
+    ProtocolV2::setClientId(msg.clientId, clientInterner().name(command.clientKey));
+
+    char out[ProtocolV2::LinkCommand::SIZE];
+    size_t length = msg.encode(out);
+    bool idle;
+    {
+        std::lock_guard<std::mutex> lock(link.mutex);
+        if (!link.up) {
+            return false;
+        }
+        link.pending.emplace(msg.tag, command);
+        idle = link.output.empty();
+        link.output.insert(link.output.end(), out, out + length);
+    }
+    // A busy writer picks this up with the rest of its next send
+    if (idle) {
+        link.wake.notify_one();
+    }
+    return true;
+}
+
+void Gateway::runWriter(Link& link) {
+    std::vector<char> sending;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(link.mutex);
+            link.wake.wait(lock, [&] { return !link.output.empty() || !running_; });
+            if (link.output.empty()) {
+                return;  // Stopping with nothing left to send
+            }
+            sending.swap(link.output);
+        }
+
+        size_t sent = 0;
+        while (sent < sending.size()) {
+            int written = send(link.socket, sending.data() + sent,
+                               static_cast<int>(sending.size() - sent), SEND_FLAGS);
+            if (written == SOCKET_ERROR) {
+                // The reader sees the connection close and fails what's pending
+#ifdef _WIN32
+                shutdown(link.socket, SD_BOTH);
+#else
+                shutdown(link.socket, SHUT_RDWR);
+#endif
+                return;
+            }
+            sent += static_cast<size_t>(written);
+        }
+        sending.clear();
+    }
+}
+
+void Gateway::runReader(Link& link) {
+    FrameBuffer& input = link.input;
+    for (;;) {
+        Frame frame;
+        while (input.nextFrame(frame)) {
+            complete(link, frame);
+        }
+        if (input.malformed()) {
+            std::cerr << "Malformed message from engine node " << link.index << std::endl;
+            break;
+        }
+
+        int received = recv(link.socket, input.writePtr(), static_cast<int>(input.writable()), 0);
+        if (received <= 0) {
+            if (running_) {
+                std::cerr << "Lost engine node " << link.index << std::endl;
+            }
+            break;
+        }
+        input.commit(static_cast<size_t>(received));
+    }
+    fail(link);
+}
+
+void Gateway::complete(Link& link, const Frame& frame) {
+    ProtocolV2::LinkResult result;
+    if (frame.type != MessageType::LINK_RESULT || !result.decode(frame)) {
+        return;  // Heartbeats and the like
+    }
+
+    EngineCommand command;
+    {
+        std::lock_guard<std::mutex> lock(link.mutex);
+        auto it = link.pending.find(result.tag);
+        if (it == link.pending.end()) {
+            return;
+        }
+        command = it->second;
+        link.pending.erase(it);
+    }
+
+    // Back to the command the session sent, with what the node made of it
+    command.reject = result.reason;
+    if (command.type == CommandType::NEW_ORDER) {
+        command.orderId = result.orderId;
+        if (result.success) {
+            totalOrders_++;
+        }
+    } else if (command.type == CommandType::MASS_CANCEL) {
+        command.quantity = result.quantity;
+    }
+    if (!commandCallback_) {
+        return;
+    }
+
+    if (!result.hasReport) {
+        commandCallback_(command, result.success, nullptr);
+        return;
+    }
+    Order order(command.orderId, command.symbolId, command.side, command.orderType, result.price,
+                result.filledQuantity + result.remainingQuantity, command.stopPrice,
+                command.clientKey);
+    order.fill(result.filledQuantity);
+    order.setStatus(result.status);
+    commandCallback_(command, result.success, &order);
+}
+
+void Gateway::fail(Link& link) {
+    std::unordered_map<uint64_t, EngineCommand> pending;
+    {
+        std::lock_guard<std::mutex> lock(link.mutex);
+        link.up = false;
+        pending.swap(link.pending);
+    }
+    if (!running_ || !commandCallback_) {
+        return;
+    }
+    for (auto& entry : pending) {
+        EngineCommand& command = entry.second;
+        command.reject = RejectReason::NODE_UNAVAILABLE;
+        if (command.type == CommandType::MASS_CANCEL) {
+            command.quantity = 0;
+        }
+        commandCallback_(command, false, nullptr);
+    }
+}
+
+} // namespace MatchingEngine
@@ -0,0 +1,520 @@
+#include "HistoricalReplay.h"
+#include "Interner.h"
+#include "MatchingEngine.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MatchingEngine {
+
+namespace {
+
+constexpr size_t COLUMN_ALIGNMENT = 64;
+constexpr size_t COLUMN_COUNT = 9;
+
+// Bytes per row of each column, in file order (see OrderColumns)
+constexpr size_t COLUMN_WIDTHS[COLUMN_COUNT] = {
+    sizeof(uint64_t), sizeof(OrderId), sizeof(Price), sizeof(Quantity), sizeof(Price),
+    sizeof(uint32_t), sizeof(uint8_t), sizeof(uint8_t), sizeof(uint8_t)};
+
+// Bytes of every column for one row
+constexpr size_t rowWidth() {
+    size_t width = 0;
+    for (size_t i = 0; i < COLUMN_COUNT; ++i) {
+        width += COLUMN_WIDTHS[i];
+    }
+    return width;
+}
+
+// Whether a file of this many bytes could hold the header's symbol table and
+// rows at all; checked before ColumnLayout so its arithmetic cannot overflow
+bool plausibleShape(const OrderFileHeader& header, size_t bytes) {
+    size_t space = bytes - sizeof(OrderFileHeader);
+    if (header.symbolCount > space / OrderFileHeader::SYMBOL_SIZE) {
+        return false;
+    }
+    space -= header.symbolCount * OrderFileHeader::SYMBOL_SIZE;
+    return header.rowCount <= space / rowWidth();
+}
+
+size_t alignColumn(size_t offset) {
+    return (offset + COLUMN_ALIGNMENT - 1) & ~(COLUMN_ALIGNMENT - 1);
+}
+
+// Where each column starts in a file of this shape; the last entry is the
+// file's size
+struct ColumnLayout {
+    size_t offsets[COLUMN_COUNT + 1];
+
+    ColumnLayout(size_t symbols, size_t rows) {
+        size_t offset = alignColumn(sizeof(OrderFileHeader) + symbols * OrderFileHeader::SYMBOL_SIZE);
+        for (size_t i = 0; i < COLUMN_COUNT; ++i) {
+            offsets[i] = offset;
+            offset = alignColumn(offset + COLUMN_WIDTHS[i] * rows);
+        }
+        offsets[COLUMN_COUNT] = offset;
+    }
+};
+
+std::string symbolAt(const char* entry) {
+    size_t length = 0;
+    while (length < OrderFileHeader::SYMBOL_SIZE && entry[length] != '\0') {
+        ++length;
+    }
+    return std::string(entry, length);
+}
+
+void writeSymbols(std::ostream& out, const std::vector<std::string>& symbols) {
+    for (const std::string& symbol : symbols) {
+        char entry[OrderFileHeader::SYMBOL_SIZE] = {};
+        std::memcpy(entry, symbol.data(), std::min(symbol.size(), sizeof(entry)));
+        out.write(entry, sizeof(entry));
+    }
+}
+
+template <typename T>
+void writeColumn(std::ostream& out, const std::vector<T>& column, size_t offset) {
+    static const char zeros[COLUMN_ALIGNMENT] = {};
+    size_t position = static_cast<size_t>(out.tellp());
+    out.write(zeros, static_cast<std::streamsize>(offset - position));
+    out.write(reinterpret_cast<const char*>(column.data()),
+              static_cast<std::streamsize>(column.size() * sizeof(T)));
+}
+
+// One symbol's rows - rows[begin, end) of the partitioned row order - and
+// what replaying them produced
+struct Partition {
+    uint32_t symbol = 0;
+    size_t begin = 0;
+    size_t end = 0;
+    std::vector<FillRecord> fills;
+    ReplayReport counts;
+    bool done = false;  // Guarded by the replay's result mutex
+};
+
+// Per-worker task queues. A worker takes its own tasks from the front and,
+// once they run out, steals from the back of the others'.
+class TaskQueues {
+public:
+    explicit TaskQueues(size_t workers) : queues_(workers) {}
+
+    void push(size_t worker, size_t task) {
+        queues_[worker].tasks.push_back(task);
+    }
+
+    bool take(size_t worker, size_t& task) {
+        for (size_t i = 0; i < queues_.size(); ++i) {
+            Queue& queue = queues_[(worker + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            } else {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+    std::vector<Queue> queues_;
+};
+
+void replayPartition(const OrderColumns& columns, const std::vector<size_t>& rows,
+                     const std::vector<SymbolId>& symbolIds, const OrderBookConfig& bookConfig,
+                     Partition& partition) {
+    EngineConfig engineConfig;
+    engineConfig.synchronized = false;
+    MatchingEngineCore engine(engineConfig);
+    OrderBookConfig config = bookConfig;
+    config.synchronized = false;
+    engine.setDefaultBookConfig(config);
+
+    uint32_t symbol = partition.symbol;
+    std::vector<FillRecord>& fills = partition.fills;
+    engine.setTradeCallback([&fills, symbol](const Trade& trade) {
+        fills.push_back(FillRecord{timestampToNanos(trade.getTimestamp()), trade.getBuyOrderId(),
+                                   trade.getSellOrderId(), trade.getPrice(), trade.getQuantity(),
+                                   symbol, 0});
+    });
+
+    ReplayReport& counts = partition.counts;
+    SymbolId symbolId = symbolIds[symbol];
+    for (size_t i = partition.begin; i != partition.end; ++i) {
+        size_t row = rows[i];
+        EngineCommand command;
+        switch (static_cast<OrderAction>(columns.action[row])) {
+            case OrderAction::NEW:
+                command = EngineCommand::newOrder(columns.orderId[row], symbolId,
+                                                  static_cast<Side>(columns.side[row]),
+                                                  static_cast<OrderType>(columns.orderType[row]),
+                                                  columns.price[row], columns.quantity[row], 0,
+                                                  columns.stopPrice[row]);
+                ++counts.orders;
+                break;
+            case OrderAction::CANCEL:
+                command = EngineCommand::cancel(columns.orderId[row]);
+                ++counts.cancels;
+                break;
+            case OrderAction::MODIFY:
+                command = EngineCommand::modify(columns.orderId[row], columns.price[row],
+                                                columns.quantity[row]);
+                ++counts.modifies;
+                break;
+        }
+        command.timestamp = columns.timestamp[row];
+        if (!engine.execute(command)) {
+            ++counts.unmatched;
+        }
+    }
+    counts.fills = fills.size();
+}
+
+} // namespace
+
+OrderFile::~OrderFile() {
+    close();
+}
+
+#ifndef _WIN32
+
+bool OrderFile::open(const std::string& path, std::string& error) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(OrderFileHeader)) {
+        ::close(fd);
+        error = path + " is not an order file";
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(info.st_size);
+    void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "cannot map " + path;
+        return false;
+    }
+    mapping_ = mapping;
+    mappedBytes_ = bytes;
+
+    const char* base = static_cast<const char*>(mapping);
+    OrderFileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, OrderFileHeader::MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != OrderFileHeader::VERSION) {
+        close();
+        error = path + " is not a version " + std::to_string(OrderFileHeader::VERSION) +
+                " order file";
+        return false;
+    }
+    if (!plausibleShape(header, bytes)) {
+        close();
+        error = path + " is truncated";
+        return false;
+    }
+    ColumnLayout layout(header.symbolCount, static_cast<size_t>(header.rowCount));
+    if (bytes < layout.offsets[COLUMN_COUNT]) {
+        close();
+        error = path + " is truncated";
+        return false;
+    }
+    // Read front to back by every partition pass, so let the kernel read ahead
+    madvise(mapping, bytes, MADV_SEQUENTIAL);
+
+    const char* table = base + sizeof(OrderFileHeader);
+    for (uint32_t i = 0; i < header.symbolCount; ++i) {
+        symbols_.push_back(symbolAt(table + i * OrderFileHeader::SYMBOL_SIZE));
+    }
+    rows_ = header.rowCount;
+    const size_t* offsets = layout.offsets;
+    columns_.timestamp = reinterpret_cast<const uint64_t*>(base + offsets[0]);
+    columns_.orderId = reinterpret_cast<const OrderId*>(base + offsets[1]);
+    columns_.price = reinterpret_cast<const Price*>(base + offsets[2]);
+    columns_.quantity = reinterpret_cast<const Quantity*>(base + offsets[3]);
+    columns_.stopPrice = reinterpret_cast<const Price*>(base + offsets[4]);
+    columns_.symbol = reinterpret_cast<const uint32_t*>(base + offsets[5]);
+    columns_.action = reinterpret_cast<const uint8_t*>(base + offsets[6]);
+    columns_.side = reinterpret_cast<const uint8_t*>(base + offsets[7]);
+    columns_.orderType = reinterpret_cast<const uint8_t*>(base + offsets[8]);
+    return true;
+}
+
+void OrderFile::close() {
+    if (mapping_) {
+        munmap(mapping_, mappedBytes_);
+        mapping_ = nullptr;
+    }
+    mappedBytes_ = 0;
+    rows_ = 0;
+    symbols_.clear();
+    columns_ = OrderColumns();
+}
+
+#else // _WIN32
+
+bool OrderFile::open(const std::string&, std::string& error) {
+    error = "order files are not supported on this platform";
+    return false;
+}
+
+void OrderFile::close() {
+}
+
+#endif
+
+void OrderFileWriter::addOrder(uint64_t timestamp, const std::string& symbol, OrderId orderId,
+                               Side side, OrderType type, Price price, Quantity quantity,
+                               Price stopPrice) {
+    addRow(timestamp, symbol, OrderAction::NEW, orderId, side, type, price, quantity, stopPrice);
+}
+
+void OrderFileWriter::addCancel(uint64_t timestamp, const std::string& symbol, OrderId orderId) {
+    addRow(timestamp, symbol, OrderAction::CANCEL, orderId, Side::BUY, OrderType::LIMIT, 0, 0, 0);
+}
+
+void OrderFileWriter::addModify(uint64_t timestamp, const std::string& symbol, OrderId orderId,
+                                Price newPrice, Quantity newQuantity) {
+    addRow(timestamp, symbol, OrderAction::MODIFY, orderId, Side::BUY, OrderType::LIMIT,
+           newPrice, newQuantity, 0);
+}
+
+void OrderFileWriter::addRow(uint64_t timestamp, const std::string& symbol, OrderAction action,
+                             OrderId orderId, Side side, OrderType type, Price price,
+                             Quantity quantity, Price stopPrice) {
+    auto it = symbolIndex_.find(symbol);
+    if (it == symbolIndex_.end()) {
+        it = symbolIndex_.emplace(symbol, static_cast<uint32_t>(symbols_.size())).first;
+        symbols_.push_back(symbol);
+    }
+    timestamp_.push_back(timestamp);
+    orderId_.push_back(orderId);
+    price_.push_back(price);
+    quantity_.push_back(quantity);
+    stopPrice_.push_back(stopPrice);
+    symbol_.push_back(it->second);
+    action_.push_back(static_cast<uint8_t>(action));
+    side_.push_back(static_cast<uint8_t>(side));
+    orderType_.push_back(static_cast<uint8_t>(type));
+}
+
+bool OrderFileWriter::write(const std::string& path, std::string& error) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot create " + path;
+        return false;
+    }
+
+    OrderFileHeader header{};
+    std::memcpy(header.magic, OrderFileHeader::MAGIC, sizeof(header.magic));
+    header.version = OrderFileHeader::VERSION;
+    header.symbolCount = static_cast<uint32_t>(symbols_.size());
+    header.rowCount = rows();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeSymbols(out, symbols_);
+
+    ColumnLayout layout(symbols_.size(), rows());
+    writeColumn(out, timestamp_, layout.offsets[0]);
+    writeColumn(out, orderId_, layout.offsets[1]);
+    writeColumn(out, price_, layout.offsets[2]);
+    writeColumn(out, quantity_, layout.offsets[3]);
+    writeColumn(out, stopPrice_, layout.offsets[4]);
+    writeColumn(out, symbol_, layout.offsets[5]);
+    writeColumn(out, action_, layout.offsets[6]);
+    writeColumn(out, side_, layout.offsets[7]);
+    writeColumn(out, orderType_, layout.offsets[8]);
+    writeColumn(out, std::vector<char>(), layout.offsets[COLUMN_COUNT]);
+
+    if (!out.flush()) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool readFillFile(const std::string& path, std::vector<std::string>& symbols,
+                  std::vector<FillRecord>& fills, std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    FillFileHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, FillFileHeader::MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != FillFileHeader::VERSION) {
+        error = path + " is not a version " + std::to_string(FillFileHeader::VERSION) +
+                " fill file";
+        return false;
+    }
+
+    symbols.clear();
+    for (uint32_t i = 0; i < header.symbolCount; ++i) {
+        char entry[OrderFileHeader::SYMBOL_SIZE];
+        if (!in.read(entry, sizeof(entry))) {
+            error = path + " is truncated";
+            return false;
+        }
+        symbols.push_back(symbolAt(entry));
+    }
+    fills.resize(header.fillCount);
+    if (!in.read(reinterpret_cast<char*>(fills.data()),
+                 static_cast<std::streamsize>(fills.size() * sizeof(FillRecord)))) {
+        error = path + " is truncated";
+        return false;
+    }
+    return true;
+}
+
+HistoricalReplay::HistoricalReplay(const ReplayConfig& config)
+    : config_(config) {
+}
+
+bool HistoricalReplay::run(const OrderFile& input, const std::string& fillPath,
+                           ReplayReport& report, std::string& error) {
+    auto started = std::chrono::steady_clock::now();
+    report = ReplayReport();
+    const OrderColumns& columns = input.columns();
+    const std::vector<std::string>& symbolNames = input.symbols();
+    size_t rowCount = input.rows();
+
+    // Counting sort of the rows by symbol, keeping file order within each
+    std::vector<size_t> starts(symbolNames.size() + 1, 0);
+    for (size_t row = 0; row < rowCount; ++row) {
+        if (columns.timestamp[row] == 0 || columns.symbol[row] >= symbolNames.size() ||
+            columns.action[row] > static_cast<uint8_t>(OrderAction::MODIFY) ||
+            columns.side[row] > static_cast<uint8_t>(Side::SELL) ||
+            columns.orderType[row] > static_cast<uint8_t>(OrderType::FOK)) {
+            error = "row " + std::to_string(row) + " is malformed";
+            return false;
+        }
+        ++starts[columns.symbol[row] + 1];
+    }
+    std::partial_sum(starts.begin(), starts.end(), starts.begin());
+    std::vector<size_t> rows(rowCount);
+    std::vector<size_t> next(starts.begin(), starts.end() - 1);
+    for (size_t row = 0; row < rowCount; ++row) {
+        rows[next[columns.symbol[row]]++] = row;
+    }
+
+    // Interned up front: books are created from several threads
+    std::vector<SymbolId> symbolIds;
+    for (const std::string& name : symbolNames) {
+        symbolIds.push_back(symbolInterner().intern(name));
+    }
+
+    std::vector<Partition> partitions;
+    for (uint32_t symbol = 0; symbol < symbolNames.size(); ++symbol) {
+        if (starts[symbol] != starts[symbol + 1]) {
+            Partition partition;
+            partition.symbol = symbol;
+            partition.begin = starts[symbol];
+            partition.end = starts[symbol + 1];
+            partitions.push_back(std::move(partition));
+        }
+    }
+
+    std::ofstream out(fillPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot create " + fillPath;
+        return false;
+    }
+    FillFileHeader header{};
+    std::memcpy(header.magic, FillFileHeader::MAGIC, sizeof(header.magic));
+    header.version = FillFileHeader::VERSION;
+    header.symbolCount = static_cast<uint32_t>(symbolNames.size());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeSymbols(out, symbolNames);
+
+    size_t threads = config_.threads ? config_.threads : std::thread::hardware_concurrency();
+    threads = std::max<size_t>(1, std::min(threads, partitions.size()));
+
+    // Largest partitions first, dealt round-robin, so the long ones start
+    // early and the short ones fill in around them
+    std::vector<size_t> bySize(partitions.size());
+    std::iota(bySize.begin(), bySize.end(), 0);
+    std::stable_sort(bySize.begin(), bySize.end(), [&](size_t a, size_t b) {
+        return partitions[a].end - partitions[a].begin > partitions[b].end - partitions[b].begin;
+    });
+    TaskQueues queues(threads);
+    for (size_t i = 0; i < bySize.size(); ++i) {
+        queues.push(i % threads, bySize[i]);
+    }
+
+    std::mutex resultMutex;
+    std::condition_variable resultReady;
+    std::vector<std::thread> workers;
+    for (size_t worker = 0; worker < threads; ++worker) {
+        workers.emplace_back([&, worker]() {
+            size_t task;
+            while (queues.take(worker, task)) {
+                replayPartition(columns, rows, symbolIds, config_.bookConfig, partitions[task]);
+                std::lock_guard<std::mutex> lock(resultMutex);
+                partitions[task].done = true;
+                resultReady.notify_all();
+            }
+        });
+    }
+
+    // Written in symbol order as each is done, freeing its fills, so the
+    // output doesn't depend on scheduling
+    for (Partition& partition : partitions) {
+        {
+            std::unique_lock<std::mutex> lock(resultMutex);
+            resultReady.wait(lock, [&]() { return partition.done; });
+        }
+        out.write(reinterpret_cast<const char*>(partition.fills.data()),
+                  static_cast<std::streamsize>(partition.fills.size() * sizeof(FillRecord)));
+        std::vector<FillRecord>().swap(partition.fills);
+
+        const ReplayReport& counts = partition.counts;
+        report.orders += counts.orders;
+        report.cancels += counts.cancels;
+        report.modifies += counts.modifies;
+        report.unmatched += counts.unmatched;
+        report.fills += counts.fills;
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    header.fillCount = report.fills;
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out.flush()) {
+        error = "cannot write " + fillPath;
+        return false;
+    }
+
+    report.partitions = partitions.size();
+    report.threads = threads;
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+} // namespace MatchingEngine
@@ -0,0 +1,99 @@
+#include "Interner.h"
+#include <algorithm>
+#include <mutex>
+
+namespace MatchingEngine {
+
+StringInterner::StringInterner() {
+    intern("");
+}
+
+uint32_t StringInterner::intern(const std::string& name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = ids_.find(name);
+        if (it != ids_.end()) {
+            return it->second;
+        }
+    }
+    
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    
+    uint32_t id = static_cast<uint32_t>(names_.size());
+    names_.push_back(name);
+    ids_.emplace(names_.back(), id);
+    return id;
+}
+
+uint32_t StringInterner::find(const std::string& name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    return it != ids_.end() ? it->second : 0;
+}
+
+const std::string& StringInterner::name(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return id < names_.size() ? names_[id] : names_[0];
+}
+
+size_t StringInterner::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return names_.size();
+}
+
+StringInterner& symbolInterner() {
+    static StringInterner interner;
+    return interner;
+}
+
+StringInterner& clientInterner() {
+    static StringInterner interner;
+    return interner;
+}
+
+SymbolDirectory::Key SymbolDirectory::keyOf(const char* symbol, size_t length) {
+    Key key{{0, 0}};
+    std::memcpy(key.words, symbol, length);
+    return key;
+}
+
+SymbolId SymbolDirectory::lookup(const char (&symbol)[WIDTH]) {
+    size_t length = strnlen(symbol, WIDTH);
+    Key key = keyOf(symbol, length);
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = ids_.find(key);
+        if (it != ids_.end()) {
+            return it->second;
+        }
+    }
+    return insert(key, std::string(symbol, length));
+}
+
+SymbolId SymbolDirectory::load(const std::string& symbol) {
+    size_t length = std::min(symbol.size(), WIDTH);
+    return insert(keyOf(symbol.data(), length), symbol.substr(0, length));
+}
+
+SymbolId SymbolDirectory::insert(const Key& key, const std::string& name) {
+    SymbolId id = symbolInterner().intern(name);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    ids_.emplace(key, id);
+    return id;
+}
+
+size_t SymbolDirectory::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return ids_.size();
+}
+
+SymbolDirectory& symbolDirectory() {
+    static SymbolDirectory directory;
+    return directory;
+}
+
+} // namespace MatchingEngine
@@ -0,0 +1,481 @@
+#include "Journal.h"
+#include "Interner.h"
+#include "ThreadUtil.h"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MatchingEngine {
+
+namespace {
+
+constexpr size_t WRITER_BATCH_SIZE = 256;
+constexpr size_t WRITER_SPIN_ITERATIONS = 1000;
+constexpr char SEGMENT_PREFIX[] = "journal-";
+constexpr char SEGMENT_SUFFIX[] = ".seg";
+
+// Segments are named by the first sequence they hold, zero-padded so
+// lexical order is sequence order
+std::string segmentName(uint64_t firstSequence) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%020" PRIu64 "%s", SEGMENT_PREFIX, firstSequence,
+                  SEGMENT_SUFFIX);
+    return name;
+}
+
+std::vector<std::string> listSegments(const std::string& directory) {
+    std::vector<std::string> segments;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind(SEGMENT_PREFIX, 0) == 0 && entry.path().extension() == SEGMENT_SUFFIX) {
+            segments.push_back(entry.path().string());
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+// 0 if the name doesn't parse
+uint64_t firstSequenceOf(const std::string& path) {
+    std::string name = std::filesystem::path(path).filename().string();
+    size_t prefix = sizeof(SEGMENT_PREFIX) - 1;
+    if (name.size() <= prefix) {
+        return 0;
+    }
+    return std::strtoull(name.c_str() + prefix, nullptr, 10);
+}
+
+void copyName(char* out, size_t size, const std::string& name) {
+    std::memset(out, 0, size);
+    std::memcpy(out, name.data(), std::min(name.size(), size));
+}
+
+std::string readName(const char* in, size_t size) {
+    return std::string(in, strnlen(in, size));
+}
+
+} // namespace
+
+// JournalRecord implementation
+JournalRecord JournalRecord::fromCommand(const EngineCommand& command) {
+    JournalRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.type = static_cast<uint8_t>(command.type);
+    record.side = static_cast<uint8_t>(command.side);
+    record.orderType = static_cast<uint8_t>(command.orderType);
+    record.scope = command.scope;
+    record.orderId = command.orderId;
+    record.price = command.price;
+    record.quantity = command.quantity;
+    record.stopPrice = command.stopPrice;
+    record.timestamp = command.timestamp;
+    record.expireTime = command.expireTime;
+    record.timeInForce = static_cast<uint8_t>(command.timeInForce);
+    if (command.type == CommandType::NEW_ORDER || command.type == CommandType::MASS_CANCEL) {
+        copyName(record.symbol, SYMBOL_SIZE, symbolInterner().name(command.symbolId));
+        copyName(record.clientId, CLIENT_SIZE, clientInterner().name(command.clientKey));
+    }
+    return record;
+}
+
+bool JournalRecord::toCommand(EngineCommand& command) const {
+    if (sequence == 0 || checksum != computeChecksum() ||
+        type > static_cast<uint8_t>(CommandType::MASS_CANCEL) ||
+        timeInForce > static_cast<uint8_t>(TimeInForce::GTD)) {
+        return false;
+    }
+
+    switch (static_cast<CommandType>(type)) {
+        case CommandType::NEW_ORDER:
+            command = EngineCommand::newOrder(
+                orderId, symbolInterner().intern(readName(symbol, SYMBOL_SIZE)),
+                static_cast<Side>(side), static_cast<OrderType>(orderType), price, quantity, clientInterner().intern(readName(clientId, CLIENT_SIZE)),
+                stopPrice);
+            command.timeInForce = static_cast<TimeInForce>(timeInForce);
+            command.expireTime = expireTime;
+            break;
+        case CommandType::CANCEL_ORDER:
+            command = EngineCommand::cancel(orderId);
+            break;
+        case CommandType::MODIFY_ORDER:
+            command = EngineCommand::modify(orderId, price, quantity);
+            break;
+        case CommandType::MASS_CANCEL:
+            command = EngineCommand::massCancel(
+                scope, symbolInterner().intern(readName(symbol, SYMBOL_SIZE)),
+                static_cast<Side>(side), clientInterner().intern(readName(clientId, CLIENT_SIZE)));
+            command.orderId = orderId;  // Shard it was applied on
+            break;
+    }
+    command.timestamp = timestamp;
+    return true;
+}
+
+uint32_t JournalRecord::computeChecksum() const {
+    // FNV-1a - catches torn and zeroed records, not tampering
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(this);
+    uint32_t hash = 2166136261u;
+    for (size_t i = offsetof(JournalRecord, type); i < sizeof(JournalRecord); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Journal implementation
+Journal::Journal(const JournalConfig& config)
+    : config_(config)
+    , queue_(config.queueCapacity)
+    , running_(false)
+    , failed_(false)
+    , firstSequence_(1)
+    , appendedSequence_(0)
+    , writtenSequence_(0)
+    , durableSequence_(0)
+    , fd_(-1)
+    , mapping_(nullptr)
+    , segmentRecords_(std::max<size_t>(config.segmentSize / sizeof(JournalRecord), 1))
+    , writeIndex_(0)
+    , syncedIndex_(0)
+    , popped_(0) {
+}
+
+Journal::~Journal() {
+    close();
+}
+
+bool Journal::open(uint64_t resumeAfter) {
+    if (running_ || config_.directory.empty()) {
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(config_.directory, error);
+    if (error) {
+        std::cerr << "Failed to create journal directory " << config_.directory << std::endl;
+        return false;
+    }
+
+    // Carry on numbering after whatever an earlier run left
+    uint64_t last = resumeAfter;
+    if (!read(config_.directory, 0, [&last](uint64_t sequence, const EngineCommand&) {
+            last = std::max(last, sequence);
+        })) {
+        return false;
+    }
+    firstSequence_ = last + 1 - popped_;  // Queue positions carry over a reopen
+    failed_ = false;
+    appendedSequence_ = last;
+    writtenSequence_ = last;
+    durableSequence_ = last;
+
+    // Appends always go to a fresh segment, never after a possibly torn tail
+    if (!openSegment(last + 1)) {
+        return false;
+    }
+
+    running_ = true;
+    writer_ = std::thread(&Journal::runWriter, this);
+    return true;
+}
+
+void Journal::close() {
+    if (!running_) {
+        return;
+    }
+
+    running_ = false;
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    closeSegment();
+    
+    // Release waiters whose records never made it
+    {
+        std::lock_guard<std::mutex> lock(durableMutex_);
+    }
+    durableChanged_.notify_all();
+}
+
+void Journal::truncate(uint64_t throughSequence) {
+    std::vector<std::string> segments = listSegments(config_.directory);
+    for (size_t i = 0; i + 1 < segments.size(); ++i) {
+        // A segment ends just before the next one starts
+        uint64_t nextFirst = firstSequenceOf(segments[i + 1]);
+        if (nextFirst == 0 || nextFirst > throughSequence + 1) {
+            break;
+        }
+        std::error_code error;
+        std::filesystem::remove(segments[i], error);
+    }
+}
+
+uint64_t Journal::append(const EngineCommand& command) {
+    // The writer stamps sequence and checksum, in the order it pops
+    JournalRecord record = JournalRecord::fromCommand(command);
+
+    // Back-pressure: the writer is behind by a whole queue
+    size_t position;
+    while (!queue_.tryPush(record, &position)) {
+        std::this_thread::yield();
+    }
+    uint64_t sequence = firstSequence_ + position;
+    uint64_t seen = appendedSequence_.load(std::memory_order_relaxed);
+    while (seen < sequence &&
+           !appendedSequence_.compare_exchange_weak(seen, sequence, std::memory_order_acq_rel)) {
+    }
+    return sequence;
+}
+
+bool Journal::waitDurable(uint64_t sequence) {
+    std::unique_lock<std::mutex> lock(durableMutex_);
+    durableChanged_.wait(lock, [&]() {
+        return durableSequence_ >= sequence || !running_ || failed_;
+    });
+    return durableSequence_ >= sequence;
+}
+
+void Journal::markDurable(uint64_t sequence) {
+    {
+        std::lock_guard<std::mutex> lock(durableMutex_);
+        durableSequence_ = sequence;
+    }
+    durableChanged_.notify_all();
+    if (durableCallback_) {
+        durableCallback_(sequence);
+    }
+}
+
+void Journal::fail(const char* what, uint64_t sequence) {
+    {
+        std::lock_guard<std::mutex> lock(durableMutex_);
+        if (failed_.exchange(true)) {
+            return;
+        }
+    }
+    std::cerr << "Journal " << what << " failed at sequence " << sequence
+              << "; nothing after " << durableSequence_ << " is durable" << std::endl;
+    durableChanged_.notify_all();
+    if (durableCallback_) {
+        durableCallback_(durableSequence_);
+    }
+}
+
+void Journal::runWriter() {
+    JournalRecord batch[WRITER_BATCH_SIZE];
+    auto lastSync = std::chrono::steady_clock::now();
+    auto interval = std::chrono::microseconds(config_.fsyncIntervalMicros);
+    size_t idlePolls = 0;
+
+    for (;;) {
+        // Read the flag first so nothing pushed before close() is missed
+        bool stopping = !running_.load(std::memory_order_acquire);
+        size_t count = queue_.popBatch(batch, WRITER_BATCH_SIZE);
+        uint64_t first = firstSequence_ + popped_;
+        popped_ += count;
+
+        // Each record keeps the sequence append() gave out for its place in
+        // the queue. After a failure the rest are only drained, as writing
+        // them would leave a gap on disk.
+        for (size_t i = 0; i < count && !failed_; ++i) {
+            batch[i].stamp(first + i);
+            if (!writeRecord(batch[i])) {
+                fail("write", batch[i].sequence);
+            }
+        }
+
+        // Group commit: one sync covers the whole batch
+        auto now = std::chrono::steady_clock::now();
+        if (config_.fsyncPolicy == FsyncPolicy::PER_BATCH ||
+            (config_.fsyncPolicy == FsyncPolicy::INTERVAL && now - lastSync >= interval)) {
+            sync(true);
+            lastSync = now;
+        } else if (config_.fsyncPolicy == FsyncPolicy::ASYNC) {
+            sync(false);
+        }
+
+        if (count > 0) {
+            idlePolls = 0;
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+        if (++idlePolls < WRITER_SPIN_ITERATIONS) {
+            cpuRelax();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    sync(config_.fsyncPolicy != FsyncPolicy::ASYNC);
+}
+
+#ifndef _WIN32
+
+bool Journal::writeRecord(const JournalRecord& record) {
+    if (writeIndex_ == segmentRecords_) {
+        // Segment full - make it durable before moving on
+        sync(config_.fsyncPolicy != FsyncPolicy::ASYNC);
+        closeSegment();
+        if (!openSegment(record.sequence)) {
+            return false;
+        }
+    }
+    if (!mapping_) {
+        return false;
+    }
+
+    std::memcpy(mapping_ + writeIndex_ * sizeof(JournalRecord), &record, sizeof(record));
+    ++writeIndex_;
+    writtenSequence_.store(record.sequence, std::memory_order_release);
+    return true;
+}
+
+void Journal::sync(bool force) {
+    if (!mapping_ || syncedIndex_ == writeIndex_ || failed_) {
+        return;
+    }
+
+    // msync works on whole pages
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = syncedIndex_ * sizeof(JournalRecord) / pageSize * pageSize;
+    size_t end = writeIndex_ * sizeof(JournalRecord);
+    if (msync(mapping_ + begin, end - begin, force ? MS_SYNC : MS_ASYNC) != 0) {
+        fail("sync", writtenSequence_.load(std::memory_order_acquire));
+        return;
+    }
+    syncedIndex_ = writeIndex_;
+
+    // ASYNC reports records as durable once the kernel owns them
+    markDurable(writtenSequence_.load(std::memory_order_acquire));
+}
+
+bool Journal::openSegment(uint64_t firstSequence) {
+    std::string path = config_.directory + "/" + segmentName(firstSequence);
+    size_t bytes = segmentRecords_ * sizeof(JournalRecord);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create journal segment " << path << std::endl;
+        return false;
+    }
+
+    // Allocate every block up front so appends never extend the file
+    if (posix_fallocate(fd, 0, static_cast<off_t>(bytes)) != 0 &&
+        ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        std::cerr << "Failed to allocate journal segment " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Failed to map journal segment " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    fd_ = fd;
+    mapping_ = static_cast<char*>(mapping);
+    writeIndex_ = 0;
+    syncedIndex_ = 0;
+    return true;
+}
+
+void Journal::closeSegment() {
+    if (mapping_) {
+        munmap(mapping_, segmentRecords_ * sizeof(JournalRecord));
+        mapping_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool Journal::read(const std::string& directory, uint64_t afterSequence,
+                   const RecordHandler& handler) {
+    std::error_code error;
+    if (!std::filesystem::is_directory(directory, error)) {
+        return !std::filesystem::exists(directory, error);  // Nothing journaled yet
+    }
+
+    for (const std::string& path : listSegments(directory)) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size_t records = static_cast<size_t>(info.st_size) / sizeof(JournalRecord);
+        if (records == 0) {
+            ::close(fd);
+            continue;
+        }
+
+        size_t bytes = records * sizeof(JournalRecord);
+        void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+        madvise(mapping, bytes, MADV_SEQUENTIAL);
+
+        // A segment ends at its first unused or torn record
+        const JournalRecord* begin = static_cast<const JournalRecord*>(mapping);
+        EngineCommand command;
+        for (const JournalRecord* record = begin; record != begin + records; ++record) {
+            if (!record->toCommand(command)) {
+                break;
+            }
+            if (record->sequence > afterSequence) {
+                handler(record->sequence, command);
+            }
+        }
+        munmap(mapping, bytes);
+    }
+    return true;
+}
+
+#else // _WIN32
+
+bool Journal::writeRecord(const JournalRecord&) {
+    return false;
+}
+
+void Journal::sync(bool) {
+}
+
+bool Journal::openSegment(uint64_t) {
+    std::cerr << "Journaling is not supported on this platform" << std::endl;
+    return false;
+}
+
+void Journal::closeSegment() {
+}
+
+bool Journal::read(const std::string&, uint64_t, const RecordHandler&) {
+    return false;
+}
+
+#endif
+
+} // namespace MatchingEngine
@@ -0,0 +1,126 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace MatchingEngine {
+
+namespace {
+
+unsigned highestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram(unsigned precisionBits)
+    : precisionBits_(std::min(std::max(precisionBits, 2u), 16u))
+    , counts_(bucketCount(precisionBits_), 0)
+    , count_(0)
+    , min_(std::numeric_limits<uint64_t>::max())
+    , max_(0)
+    , sum_(0) {
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t value, unsigned precisionBits) {
+    uint64_t subBuckets = uint64_t(1) << precisionBits;
+    if (value < subBuckets) {
+        return static_cast<size_t>(value);
+    }
+    // The top precisionBits bits of the value pick the bucket within its
+    // power-of-two range
+    unsigned shift = highestBit(value) - precisionBits + 1;
+    uint64_t half = subBuckets / 2;
+    uint64_t sub = value >> shift;
+    return static_cast<size_t>(subBuckets + (shift - 1) * half + (sub - half));
+}
+
+uint64_t LatencyHistogram::highestIn(size_t bucket, unsigned precisionBits) {
+    uint64_t subBuckets = uint64_t(1) << precisionBits;
+    if (bucket < subBuckets) {
+        return bucket;
+    }
+    uint64_t half = subBuckets / 2;
+    uint64_t offset = bucket - subBuckets;
+    unsigned shift = static_cast<unsigned>(offset / half) + 1;
+    uint64_t sub = offset % half + half;
+    return ((sub + 1) << shift) - 1;  // Wraps to the top of the range for the last bucket
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    record(value, 1);
+}
+
+void LatencyHistogram::record(uint64_t value, uint64_t count) {
+    if (count == 0) {
+        return;
+    }
+    counts_[bucketOf(value, precisionBits_)] += count;
+    count_ += count;
+    sum_ += value * count;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.precisionBits_ != precisionBits_) {
+        return;
+    }
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    min_ = std::numeric_limits<uint64_t>::max();
+    max_ = 0;
+    sum_ = 0;
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    double clamped = std::min(std::max(percentile, 0.0), 100.0);
+    uint64_t rank = static_cast<uint64_t>(std::ceil(clamped / 100.0 * count_));
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            return std::min(highestIn(i, precisionBits_), max_);
+        }
+    }
+    return max_;
+}
+
+std::string LatencyHistogram::summary(const std::string& unit) const {
+    std::ostringstream out;
+    out << "count=" << count_
+        << " min=" << min() << unit
+        << " p50=" << percentile(50.0) << unit
+        << " p99=" << percentile(99.0) << unit
+        << " p99.9=" << percentile(99.9) << unit
+        << " max=" << max_ << unit;
+    return out.str();
+}
+
+} // namespace MatchingEngine
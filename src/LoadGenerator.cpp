@@ -0,0 +1,453 @@
+#include "LoadGenerator.h"
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace MatchingEngine {
+
+namespace {
+
+constexpr auto DRAIN_POLL = std::chrono::milliseconds(1);
+
+uint64_t nanosBetween(std::chrono::steady_clock::time_point from,
+                      std::chrono::steady_clock::time_point to) {
+    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+    return nanos > 0 ? static_cast<uint64_t>(nanos) : 0;
+}
+
+} // namespace
+
+void LoadReport::merge(const LoadReport& other) {
+    newOrderAck.merge(other.newOrderAck);
+    cancelAck.merge(other.cancelAck);
+    modifyAck.merge(other.modifyAck);
+    firstFill.merge(other.firstFill);
+    sendLag.merge(other.sendLag);
+    sent += other.sent;
+    answered += other.answered;
+    rejected += other.rejected;
+    skipped += other.skipped;
+    unanswered += other.unanswered;
+    connected += other.connected;
+    sendSeconds = std::max(sendSeconds, other.sendSeconds);
+}
+
+bool ReplayFlow::parse(std::istream& in, std::string& error) {
+    std::unordered_map<std::string, uint32_t> symbolIndex;
+    auto symbolOf = [&](const std::string& name) {
+        auto it = symbolIndex.find(name);
+        if (it != symbolIndex.end()) {
+            return it->second;
+        }
+        uint32_t index = static_cast<uint32_t>(symbols.size());
+        symbols.push_back(name);
+        symbolIndex.emplace(name, index);
+        return index;
+    };
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        std::istringstream tokens(line.substr(0, line.find('#')));
+        std::string command;
+        if (!(tokens >> command)) {
+            continue;
+        }
+
+        FlowStep step;
+        std::string symbol;
+        double price = 0;
+        bool ok;
+        if (command == "buy" || command == "sell") {
+            step.side = command == "buy" ? Side::BUY : Side::SELL;
+            ok = static_cast<bool>(tokens >> symbol >> step.quantity >> price);
+            step.price = doubleToPrice(price);
+        } else if (command == "market-buy" || command == "market-sell") {
+            step.side = command == "market-buy" ? Side::BUY : Side::SELL;
+            step.type = OrderType::MARKET;
+            ok = static_cast<bool>(tokens >> symbol >> step.quantity);
+        } else if (command == "cancel") {
+            step.kind = FlowStep::Kind::CANCEL;
+            ok = static_cast<bool>(tokens >> step.target) && step.target > 0;
+        } else if (command == "modify") {
+            step.kind = FlowStep::Kind::MODIFY;
+            ok = static_cast<bool>(tokens >> step.target >> price >> step.quantity) &&
+                 step.target > 0;
+            step.price = doubleToPrice(price);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            error = "line " + std::to_string(lineNumber) + ": cannot parse '" + line + "'";
+            return false;
+        }
+
+        if (step.kind == FlowStep::Kind::NEW_ORDER) {
+            step.symbol = symbolOf(symbol);
+            ++orders;
+        }
+        steps.push_back(step);
+    }
+
+    if (steps.empty()) {
+        error = "no commands";
+        return false;
+    }
+    return true;
+}
+
+bool ReplayFlow::load(const std::string& path, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    return parse(in, error);
+}
+
+struct LoadGenerator::Connection {
+    // A new order from send until it is known to have left the book
+    struct Order {
+        Clock::time_point due;
+        OrderId orderId = 0;  // Server id, once acked
+        bool fillSeen = false;
+    };
+
+    // A cancel or modify awaiting its ack
+    struct Request {
+        Clock::time_point due;
+        FlowStep::Kind kind;
+    };
+
+    size_t index = 0;
+    std::unique_ptr<Client> client;
+    std::thread sender;
+    std::mt19937 random;
+    std::discrete_distribution<uint32_t> symbolChoice;
+
+    // Shared by the sender and the client's receive thread
+    std::mutex mutex;
+    std::unordered_map<OrderId, Order> orders;       // By client order id
+    std::unordered_map<OrderId, OrderId> clientIds;  // Server order id -> client order id
+    std::unordered_map<OrderId, std::deque<Request>> requests;  // By server order id
+    std::vector<OrderId> live;  // Acked client order ids that may still rest
+    uint64_t outstanding = 0;
+    LoadReport report;
+
+    void forget(OrderId clientOrderId) {
+        auto it = orders.find(clientOrderId);
+        if (it != orders.end()) {
+            clientIds.erase(it->second.orderId);
+            orders.erase(it);
+        }
+    }
+};
+
+LoadGenerator::LoadGenerator(const LoadConfig& config) : config_(config) {
+}
+
+LoadGenerator::~LoadGenerator() {
+    for (auto& connection : connections_) {
+        if (connection->sender.joinable()) {
+            connection->sender.join();
+        }
+    }
+}
+
+bool LoadGenerator::run(LoadReport& report) {
+    symbols_ = replay_.symbols;
+    std::vector<double> weights;
+    if (replay_.steps.empty()) {
+        symbols_.clear();
+        for (size_t i = 0; i < std::max<size_t>(config_.symbols, 1); ++i) {
+            symbols_.push_back("SYM" + std::to_string(i));
+            weights.push_back(1.0 / std::pow(static_cast<double>(i + 1), config_.symbolSkew));
+        }
+    }
+
+    connections_.clear();
+    for (size_t i = 0; i < config_.connections; ++i) {
+        auto connection = std::make_unique<Connection>();
+        connection->index = i;
+        connection->random.seed(config_.seed + static_cast<uint32_t>(i));
+        connection->symbolChoice = std::discrete_distribution<uint32_t>(weights.begin(), weights.end());
+        connection->client = std::make_unique<Client>(config_.host, config_.port);
+        connection->client->setClientId("loadgen-" + std::to_string(i));
+        connection->client->setVerbose(false);
+        connection->client->setTransport(TransportType::KERNEL, config_.lowLatency);
+        attach(*connection);
+        if (connection->client->connect()) {
+            connection->report.connected = 1;
+            connections_.push_back(std::move(connection));
+        }
+    }
+    if (connections_.empty()) {
+        return false;
+    }
+
+    // Connections are staggered across one interval so their sends interleave
+    auto start = Clock::now() + std::chrono::milliseconds(10);
+    recordFrom_ = start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(config_.warmupSeconds));
+    auto end = recordFrom_ + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(config_.durationSeconds));
+    double interval = 1e9 / std::max(config_.ratePerConnection, 1e-3);
+    for (auto& connection : connections_) {
+        auto offset = std::chrono::nanoseconds(static_cast<int64_t>(
+            interval * connection->index / connections_.size()));
+        connection->sender = std::thread(&LoadGenerator::sendLoop, this,
+                                         std::ref(*connection), start + offset, end);
+    }
+    for (auto& connection : connections_) {
+        connection->sender.join();
+    }
+
+    auto drainUntil = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(config_.drainSeconds));
+    auto outstanding = [this]() {
+        uint64_t total = 0;
+        for (auto& connection : connections_) {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            total += connection->outstanding;
+        }
+        return total;
+    };
+    while (outstanding() > 0 && Clock::now() < drainUntil) {
+        std::this_thread::sleep_for(DRAIN_POLL);
+    }
+
+    for (auto& connection : connections_) {
+        connection->client->disconnect();
+        std::lock_guard<std::mutex> lock(connection->mutex);
+        connection->report.unanswered = connection->outstanding;
+        report.merge(connection->report);
+    }
+    return true;
+}
+
+void LoadGenerator::attach(Connection& connection) {
+    Client& client = *connection.client;
+
+    client.setOrderAckCallback([this, &connection](const OrderAckMessage& msg) {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        if (msg.clientOrderId != 0) {
+            auto it = connection.orders.find(msg.clientOrderId);
+            if (it == connection.orders.end()) {
+                return;
+            }
+            record(connection.report, connection.report.newOrderAck, it->second.due, now);
+            it->second.orderId = msg.orderId;
+            connection.clientIds[msg.orderId] = msg.clientOrderId;
+            connection.live.push_back(msg.clientOrderId);
+            --connection.outstanding;
+            return;
+        }
+
+        // Cancel and modify acks carry only the server order id
+        auto it = connection.requests.find(msg.orderId);
+        if (it == connection.requests.end() || it->second.empty()) {
+            return;
+        }
+        Connection::Request request = it->second.front();
+        it->second.pop_front();
+        if (it->second.empty()) {
+            connection.requests.erase(it);
+        }
+        --connection.outstanding;
+        record(connection.report,
+               request.kind == FlowStep::Kind::CANCEL ? connection.report.cancelAck
+                                                      : connection.report.modifyAck,
+               request.due, now);
+        if (msg.status == OrderStatus::REJECTED && request.due >= recordFrom_) {
+            ++connection.report.rejected;
+        }
+        if (msg.status == OrderStatus::CANCELLED ||
+            (msg.status == OrderStatus::REJECTED && request.kind == FlowStep::Kind::CANCEL)) {
+            auto owner = connection.clientIds.find(msg.orderId);
+            if (owner != connection.clientIds.end()) {
+                connection.forget(owner->second);
+            }
+        }
+    });
+
+    client.setOrderRejectCallback([this, &connection](const OrderRejectMessage& msg) {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        auto it = connection.orders.find(msg.clientOrderId);
+        if (it == connection.orders.end()) {
+            return;
+        }
+        record(connection.report, connection.report.newOrderAck, it->second.due, now);
+        if (it->second.due >= recordFrom_) {
+            ++connection.report.rejected;
+        }
+        --connection.outstanding;
+        connection.forget(msg.clientOrderId);
+    });
+
+    client.setExecutionReportCallback([this, &connection](const ExecutionReportMessage& msg) {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        auto owner = connection.clientIds.find(msg.orderId);
+        if (owner == connection.clientIds.end()) {
+            return;
+        }
+        OrderId clientOrderId = owner->second;
+        Connection::Order& order = connection.orders[clientOrderId];
+        if (!order.fillSeen && msg.executionQuantity > 0) {
+            order.fillSeen = true;
+            if (order.due >= recordFrom_) {
+                connection.report.firstFill.record(nanosBetween(order.due, now));
+            }
+        }
+        if (msg.status == OrderStatus::FILLED || msg.status == OrderStatus::CANCELLED) {
+            connection.forget(clientOrderId);
+        }
+    });
+}
+
+void LoadGenerator::sendLoop(Connection& connection, Clock::time_point start,
+                             Clock::time_point end) {
+    double interval = 1e9 / std::max(config_.ratePerConnection, 1e-3);
+    auto began = Clock::now();
+    for (uint64_t index = 0;; ++index) {
+        // The schedule never waits for replies or for a late send: a message
+        // due while the previous one was stuck goes out straight after it
+        auto due = start + std::chrono::nanoseconds(static_cast<int64_t>(interval * index));
+        if (due >= end || !connection.client->isConnected()) {
+            break;
+        }
+        auto now = Clock::now();
+        if (now < due) {
+            std::this_thread::sleep_until(due);
+            now = Clock::now();
+        }
+
+        FlowStep step;
+        if (!nextStep(connection, index, step)) {
+            continue;
+        }
+        if (due >= recordFrom_) {
+            std::lock_guard<std::mutex> lock(connection.mutex);
+            connection.report.sendLag.record(nanosBetween(due, now));
+        }
+        send(connection, step, due);
+    }
+
+    std::lock_guard<std::mutex> lock(connection.mutex);
+    connection.report.sendSeconds = std::chrono::duration<double>(Clock::now() - began).count();
+}
+
+bool LoadGenerator::nextStep(Connection& connection, uint64_t index, FlowStep& step) {
+    if (!replay_.steps.empty()) {
+        step = replay_.steps[index % replay_.steps.size()];
+        if (step.kind != FlowStep::Kind::NEW_ORDER) {
+            step.target += (index / replay_.steps.size()) * replay_.orders;  // Same order, this pass
+        }
+        return true;
+    }
+
+    std::mt19937& random = connection.random;
+    unsigned roll = random() % 100;
+    const FlowMix& mix = config_.mix;
+    step = FlowStep();
+    step.symbol = connection.symbolChoice(random);
+    step.side = random() & 1 ? Side::BUY : Side::SELL;
+    step.quantity = 1 + random() % std::max<Quantity>(config_.maxQuantity, 1);
+
+    if (roll >= mix.marketPercent && roll < mix.marketPercent + mix.cancelPercent + mix.modifyPercent) {
+        bool cancel = roll < mix.marketPercent + mix.cancelPercent;
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        // Orders that left the book since they were listed are dropped here
+        while (!connection.live.empty()) {
+            size_t pick = random() % connection.live.size();
+            OrderId clientOrderId = connection.live[pick];
+            bool resting = connection.orders.count(clientOrderId) != 0;
+            if (!resting || cancel) {
+                connection.live[pick] = connection.live.back();
+                connection.live.pop_back();
+            }
+            if (resting) {
+                step.kind = cancel ? FlowStep::Kind::CANCEL : FlowStep::Kind::MODIFY;
+                step.target = clientOrderId;
+                break;
+            }
+        }
+    } else if (roll < mix.marketPercent) {
+        step.type = OrderType::MARKET;
+        return true;
+    }
+
+    // Limit orders, and modifies, price off mid; a cancel with nothing to
+    // cancel becomes a limit order
+    int ticks = static_cast<int>(random() % (config_.priceLevels + 2)) - 1;
+    Price offset = ticks * config_.tickSize;
+    step.price = step.side == Side::BUY ? config_.midPrice - offset : config_.midPrice + offset;
+    return true;
+}
+
+void LoadGenerator::send(Connection& connection, const FlowStep& step, Clock::time_point due) {
+    Client& client = *connection.client;
+    bool measured = due >= recordFrom_;
+
+    if (step.kind == FlowStep::Kind::NEW_ORDER) {
+        OrderId clientOrderId = client.reserveClientOrderId();
+        {
+            // Listed before sending - the ack may come back before submitOrder returns
+            std::lock_guard<std::mutex> lock(connection.mutex);
+            connection.orders[clientOrderId].due = due;
+            ++connection.outstanding;
+            connection.report.sent += measured;
+        }
+        if (!client.submitOrder(clientOrderId, symbols_[step.symbol], step.side, step.type,
+                                step.price, step.quantity)) {
+            std::lock_guard<std::mutex> lock(connection.mutex);
+            connection.forget(clientOrderId);
+            --connection.outstanding;
+        }
+        return;
+    }
+
+    OrderId orderId;
+    {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        auto it = connection.orders.find(step.target);
+        if (it == connection.orders.end() || it->second.orderId == 0) {
+            connection.report.skipped += measured;  // Not acked yet, or already gone
+            return;
+        }
+        orderId = it->second.orderId;
+        connection.requests[orderId].push_back(Connection::Request{due, step.kind});
+        ++connection.outstanding;
+        connection.report.sent += measured;
+    }
+    bool sent = step.kind == FlowStep::Kind::CANCEL
+        ? client.cancelOrder(orderId)
+        : client.modifyOrder(orderId, step.price, step.quantity);
+    if (!sent) {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        auto it = connection.requests.find(orderId);
+        if (it != connection.requests.end() && !it->second.empty()) {
+            it->second.pop_back();
+            --connection.outstanding;
+        }
+    }
+}
+
+void LoadGenerator::record(LoadReport& report, LatencyHistogram& histogram,
+                           Clock::time_point due, Clock::time_point now) const {
+    if (due < recordFrom_) {
+        return;
+    }
+    histogram.record(nanosBetween(due, now));
+    ++report.answered;
+}
+
+} // namespace MatchingEngine
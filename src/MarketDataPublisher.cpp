@@ -0,0 +1,190 @@
+#include "MarketDataPublisher.h"
+
+namespace MatchingEngine {
+
+MarketDataPublisher::MarketDataPublisher(EventRing& events)
+    : nextSubscriptionId_(1)
+    , conflated_(0) {
+    events.addConsumer([this](const EngineEvent* batch, size_t count) { onEvents(batch, count); });
+}
+
+MarketDataPublisher::SubscriptionId MarketDataPublisher::subscribe(SymbolId symbolId,
+                                                                   ReadyCallback onReady) {
+    auto subscription = std::make_shared<Subscription>();
+    subscription->symbolId = symbolId;
+    subscription->onReady = std::move(onReady);
+
+    SubscriptionId id;
+    bool ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = nextSubscriptionId_++;
+
+        // The image goes in under the same lock that orders deltas, so the
+        // first update the subscriber sees is the one right after it
+        if (symbolId != 0) {
+            auto it = books_.find(symbolId);
+            if (it != books_.end()) {
+                enqueueBook(*subscription, symbolId, it->second);
+            }
+        } else {
+            for (const auto& entry : books_) {
+                enqueueBook(*subscription, entry.first, entry.second);
+            }
+        }
+        ready = !subscription->queue.empty();
+        subscriptions_[id] = subscription;
+    }
+
+    if (ready && subscription->onReady) {
+        subscription->onReady(id);
+    }
+    return id;
+}
+
+void MarketDataPublisher::unsubscribe(SubscriptionId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscriptions_.erase(id);
+}
+
+bool MarketDataPublisher::poll(SubscriptionId id, std::vector<LevelUpdate>& out) {
+    std::shared_ptr<Subscription> subscription;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = subscriptions_.find(id);
+        if (it == subscriptions_.end()) {
+            return false;
+        }
+        subscription = it->second;
+    }
+
+    std::lock_guard<std::mutex> lock(subscription->mutex);
+    out.insert(out.end(), subscription->queue.begin(), subscription->queue.end());
+    subscription->queue.clear();
+    subscription->queued.clear();
+    return true;
+}
+
+std::vector<LevelUpdate> MarketDataPublisher::getDepth(SymbolId symbolId, Side side,
+                                                       size_t levels) const {
+    std::vector<LevelUpdate> depth;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = books_.find(symbolId);
+    if (it == books_.end()) {
+        return depth;
+    }
+
+    auto collect = [&](const auto& ladder) {
+        for (const auto& [price, level] : ladder) {
+            if (depth.size() >= levels) {
+                break;
+            }
+            depth.push_back({symbolId, side, price, level.quantity, level.orderCount});
+        }
+    };
+    if (side == Side::BUY) {
+        collect(it->second.bids);
+    } else {
+        collect(it->second.asks);
+    }
+    return depth;
+}
+
+uint64_t MarketDataPublisher::getConflated() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return conflated_;
+}
+
+void MarketDataPublisher::onEvents(const EngineEvent* events, size_t count) {
+    // Reused across batches; only the ring's consumer thread gets here
+    thread_local std::vector<LevelUpdate> updates;
+    thread_local std::vector<std::pair<SubscriptionId, std::shared_ptr<Subscription>>> ready;
+    updates.clear();
+    ready.clear();
+
+    for (size_t i = 0; i < count; ++i) {
+        const EngineEvent& event = events[i];
+        if (event.type == EventType::LEVEL) {
+            updates.push_back({event.symbolId, static_cast<Side>(event.side), event.price,
+                               event.quantity, event.orderCount});
+        }
+    }
+    if (updates.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const LevelUpdate& update : updates) {
+            applyLevel(update);
+        }
+
+        // Each subscription is locked once per batch
+        for (auto& [id, subscription] : subscriptions_) {
+            bool becameReady;
+            {
+                std::lock_guard<std::mutex> queueLock(subscription->mutex);
+                bool wasEmpty = subscription->queue.empty();
+                for (const LevelUpdate& update : updates) {
+                    if (subscription->symbolId == 0 || subscription->symbolId == update.symbolId) {
+                        enqueue(*subscription, update);
+                    }
+                }
+                becameReady = wasEmpty && !subscription->queue.empty();
+            }
+            if (becameReady) {
+                ready.emplace_back(id, subscription);
+            }
+        }
+    }
+
+    // Outside the lock, so callbacks may poll or unsubscribe
+    for (auto& [id, subscription] : ready) {
+        if (subscription->onReady) {
+            subscription->onReady(id);
+        }
+    }
+    ready.clear();
+}
+
+void MarketDataPublisher::applyLevel(const LevelUpdate& update) {
+    Book& book = books_[update.symbolId];
+    auto apply = [&](auto& ladder) {
+        if (update.quantity == 0) {
+            ladder.erase(update.price);
+        } else {
+            ladder[update.price] = Level{update.quantity, update.orderCount};
+        }
+    };
+    if (update.side == Side::BUY) {
+        apply(book.bids);
+    } else {
+        apply(book.asks);
+    }
+}
+
+void MarketDataPublisher::enqueue(Subscription& subscription, const LevelUpdate& update) {
+    LevelKey key{update.symbolId, update.side, update.price};
+    auto it = subscription.queued.find(key);
+    if (it != subscription.queued.end()) {
+        // Not taken yet - only the latest aggregate matters
+        subscription.queue[it->second] = update;
+        ++conflated_;
+        return;
+    }
+
+    subscription.queued.emplace(key, subscription.queue.size());
+    subscription.queue.push_back(update);
+}
+
+void MarketDataPublisher::enqueueBook(Subscription& subscription, SymbolId symbolId,
+                                      const Book& book) {
+    for (const auto& [price, level] : book.bids) {
+        enqueue(subscription, {symbolId, Side::BUY, price, level.quantity, level.orderCount});
+    }
+    for (const auto& [price, level] : book.asks) {
+        enqueue(subscription, {symbolId, Side::SELL, price, level.quantity, level.orderCount});
+    }
+}
+
+} // namespace MatchingEngine
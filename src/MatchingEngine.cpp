@@ -1,12 +1,42 @@
 #include "MatchingEngine.h"
+#include "Interner.h"
+#include "Journal.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
 
 namespace MatchingEngine {
 
-MatchingEngineCore::MatchingEngineCore() 
-    : nextOrderId_(1)
+namespace {
+
+// Stops elected while matching the current order, reported after it.
+// The trigger handler runs on the matching thread, so per thread is enough.
+thread_local std::vector<Order> electedStops;
+
+constexpr uint64_t NANOS_PER_DAY = 86400ULL * 1000000000ULL;
+
+// Types that can stay in the book, and so can outlive their time in force
+bool canRest(OrderType type) {
+    return type == OrderType::LIMIT || type == OrderType::STOP_LOSS ||
+           type == OrderType::STOP_LIMIT;
+}
+
+} // namespace
+
+MatchingEngineCore::MatchingEngineCore(const EngineConfig& config) 
+    : config_(config)
+    , bookCount_(0)
+    , booksMutex_(config.synchronized)
+    , nextOrderId_(1)
+    , journalSequence_(0)
     , totalOrders_(0)
-    , totalTrades_(0) {
+    , totalTrades_(0)
+    , mutex_(config.synchronized)
+    , risk_(config.synchronized)
+    , expiries_(config.expiry.tickNanos)
+    , nextExpiryCheck_(UINT64_MAX)
+    , events_(nullptr) {
 }
 
 OrderId MatchingEngineCore::submitOrder(
@@ -18,171 +48,561 @@ OrderId MatchingEngineCore::submitOrder(
     const std::string& clientId,
     Price stopPrice) {
     
+    SymbolId symbolId = symbolInterner().intern(symbol);
+    ClientKey clientKey = clientInterner().intern(clientId);
+    
+    EngineCommand command = EngineCommand::newOrder(0, symbolId, side, type, price,
+                                                    quantity, clientKey, stopPrice);
+    if (checkRisk(command) != RejectReason::NONE) {
+        return 0;
+    }
+    
     // Generate order ID
-    OrderId orderId = nextOrderId_++;
+    command.orderId = nextOrderId_++;
+    recordCommand(command);
+    return processNewOrder(command);
+}
+
+bool MatchingEngineCore::execute(const EngineCommand& command, Order* report) {
+    EngineCommand sequenced = command;
+    recordCommand(sequenced);
+    return apply(sequenced, report, true);
+}
+
+RejectReason MatchingEngineCore::checkRisk(const EngineCommand& command) {
+    if (!risk_.isEnabled()) {
+        return RejectReason::NONE;
+    }
+    StageTimer timer(Stage::RISK);
+    if (command.type != CommandType::MODIFY_ORDER) {
+        return risk_.check(command);
+    }
+    // Amends are measured against the order as it stands; one that is gone
+    // fails in the book instead
+    OrderBook* book = findBook(command.orderId);
+    Order current(0, SymbolId(0), Side::BUY, OrderType::LIMIT, 0, 0);
+    if (!book || !book->copyOrder(command.orderId, current)) {
+        return RejectReason::NONE;
+    }
+    return risk_.checkModify(current, command.price, command.quantity);
+}
+
+bool MatchingEngineCore::replay(const EngineCommand& command, uint64_t journalSequence) {
+    noteJournalSequence(journalSequence);
+    return apply(command, nullptr, false);
+}
+
+bool MatchingEngineCore::apply(const EngineCommand& command, Order* report, bool notify) {
+    switch (command.type) {
+        case CommandType::NEW_ORDER:
+            // Ids handed in from outside must never be drawn again
+            noteOrderId(command.orderId);
+            processNewOrder(command, report, notify);
+            return true;
+        case CommandType::CANCEL_ORDER:
+            return applyCancel(command.orderId);
+        case CommandType::MODIFY_ORDER:
+            return applyModify(command.orderId, command.price, command.quantity);
+        case CommandType::MASS_CANCEL:
+            applyMassCancel(command);
+            return true;
+    }
+    return false;
+}
+
+OrderId MatchingEngineCore::processNewOrder(const EngineCommand& command, Order* result,
+                                            bool notify) {
     totalOrders_++;
     
-    // Create order
-    auto order = std::make_shared<Order>(orderId, symbol, side, type, price, quantity, stopPrice);
-    order->setClientId(clientId);
-    
     // Get or create order book
-    OrderBook* book = getOrCreateOrderBook(symbol);
+    uint64_t stamp = stageStart();
+    OrderBook* book = getOrCreateOrderBook(command.symbolId);
+    stamp = stageEnd(Stage::BOOK_LOOKUP, stamp);
     
-    // Track order to symbol mapping
+    // Create order and track which book it belongs to. One that may lapse
+    // is scheduled before matching, under the same lock, so it is off the
+    // wheel again whenever it retires.
+    OrderHandle order;
+    uint64_t expireTime = canRest(command.orderType) ? expiryTimeOf(command) : 0;
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        orderToSymbol_[orderId] = symbol;
+        std::lock_guard<OptionalMutex> lock(mutex_);
+        order = orderPool_.acquire(command.orderId, command.symbolId, command.side,
+                                   command.orderType, command.price, command.quantity,
+                                   command.stopPrice, command.clientKey,
+                                   command.timestamp ? nanosToTimestamp(command.timestamp)
+                                                     : getCurrentTimestamp());
+        orderToBook_.insert(command.orderId, book);
+        if (expireTime != 0) {
+            order->setTimeInForce(command.timeInForce);
+            scheduleExpiry(command.orderId, expireTime);
+        }
     }
+    risk_.onAccept(*order);
     
-    notifyOrder(order);
+    // Match order - the buffer is reused so steady-state matching doesn't allocate
+    static thread_local std::vector<Trade> trades;
+    trades.clear();
     
-    // Match order
-    std::vector<Trade> trades = book->matchOrder(order);
+    // Once an order rests another thread may fill and recycle it, so report
+    // from a copy taken under the book lock
+    Order report = *order;
+    bool rested = book->matchOrder(order, trades, &report);
     
-    // Notify trades
-    for (const auto& trade : trades) {
-        totalTrades_++;
-        notifyTrade(trade);
+    // Orders that did not come to rest are done
+    if (!rested) {
+        retireOrder(*order);
     }
+    stamp = stageEnd(Stage::MATCH, stamp);
     
-    // Notify final order status
-    notifyOrder(order);
+    if (!trades.empty()) {
+        risk_.onTrade(command.symbolId, trades.back().getPrice());
+    }
     
-    return orderId;
+    // Notify trades
+    totalTrades_ += trades.size();
+    if (notify) {
+        for (const auto& trade : trades) {
+            notifyTrade(trade);
+        }
+        
+        // Notify final order status, then of any stops its trades elected
+        notifyOrder(report);
+        for (const Order& elected : electedStops) {
+            notifyOrder(elected);
+        }
+    }
+    electedStops.clear();
+    if (result) {
+        *result = report;
+    }
+    stageEnd(Stage::DISPATCH, stamp);
+    
+    return command.orderId;
 }
 
 bool MatchingEngineCore::cancelOrder(OrderId orderId) {
-    std::string symbol;
-    
+    EngineCommand command = EngineCommand::cancel(orderId);
+    recordCommand(command);
+    return applyCancel(orderId);
+}
+
+bool MatchingEngineCore::modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity) {
+    EngineCommand command = EngineCommand::modify(orderId, newPrice, newQuantity);
+    if (checkRisk(command) != RejectReason::NONE) {
+        return false;
+    }
+    recordCommand(command);
+    return applyModify(orderId, newPrice, newQuantity);
+}
+
+size_t MatchingEngineCore::massCancel(const EngineCommand& command) {
+    EngineCommand sequenced = command;
+    recordCommand(sequenced);
+    return applyMassCancel(sequenced);
+}
+
+size_t MatchingEngineCore::expireOrders(uint64_t now, size_t limit) {
+    // Due orders paired with their books, then grouped so each book takes
+    // its share under one lock
+    static thread_local std::vector<OrderId> due;
+    static thread_local std::vector<std::pair<OrderBook*, OrderId>> byBook;
+    due.clear();
+    byBook.clear();
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = orderToSymbol_.find(orderId);
-        if (it == orderToSymbol_.end()) {
-            return false;
+        std::lock_guard<OptionalMutex> lock(mutex_);
+        if (now < nextExpiryCheck_.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        expiries_.advance(now, limit, due);
+        nextExpiryCheck_.store(expiries_.nextCheck(), std::memory_order_relaxed);
+        for (OrderId orderId : due) {
+            OrderBook* const* book = orderToBook_.find(orderId);
+            if (book) {
+                byBook.emplace_back(*book, orderId);
+            }
         }
-        symbol = it->second;
     }
-    
-    auto bookIt = orderBooks_.find(symbol);
-    if (bookIt == orderBooks_.end()) {
-        return false;
+    if (byBook.empty()) {
+        return 0;
     }
+    std::stable_sort(byBook.begin(), byBook.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
     
-    bool success = bookIt->second->cancelOrder(orderId);
-    
-    if (success) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        orderToSymbol_.erase(orderId);
+    static thread_local std::vector<Order> expired;
+    expired.clear();
+    for (size_t begin = 0; begin < byBook.size();) {
+        OrderBook* book = byBook[begin].first;
+        due.clear();
+        for (; begin < byBook.size() && byBook[begin].first == book; ++begin) {
+            EngineCommand command = EngineCommand::cancel(byBook[begin].second);
+            command.timestamp = now;
+            recordCommand(command);
+            due.push_back(command.orderId);
+        }
+        book->cancelOrders(due.data(), due.size(), &expired);
     }
-    
-    return success;
+    for (const Order& order : expired) {
+        notifyOrder(order);
+    }
+    return expired.size();
 }
 
-bool MatchingEngineCore::modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity) {
-    std::string symbol;
-    
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = orderToSymbol_.find(orderId);
-        if (it == orderToSymbol_.end()) {
-            return false;
+size_t MatchingEngineCore::getScheduledExpiries() const {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    return expiries_.size();
+}
+
+uint64_t MatchingEngineCore::expiryTimeOf(const EngineCommand& command) const {
+    switch (command.timeInForce) {
+        case TimeInForce::GTC:
+            return 0;
+        case TimeInForce::GTD:
+            return std::max<uint64_t>(command.expireTime, 1);
+        case TimeInForce::DAY: {
+            uint64_t entered = command.timestamp ? command.timestamp
+                                                 : timestampToNanos(getCurrentTimestamp());
+            uint64_t close = entered - entered % NANOS_PER_DAY +
+                             config_.expiry.sessionCloseNanos % NANOS_PER_DAY;
+            return close > entered ? close : close + NANOS_PER_DAY;
         }
-        symbol = it->second;
     }
-    
-    auto bookIt = orderBooks_.find(symbol);
-    if (bookIt == orderBooks_.end()) {
+    return 0;
+}
+
+void MatchingEngineCore::scheduleExpiry(OrderId orderId, uint64_t expireTime) {
+    expiries_.schedule(orderId, expireTime);
+    // Lowering the check with a plain store is safe: mutex_ is held
+    if (expireTime < nextExpiryCheck_.load(std::memory_order_relaxed)) {
+        nextExpiryCheck_.store(expireTime, std::memory_order_relaxed);
+    }
+}
+
+bool MatchingEngineCore::applyCancel(OrderId orderId) {
+    uint64_t stamp = stageStart();
+    OrderBook* book = findBook(orderId);
+    stamp = stageEnd(Stage::BOOK_LOOKUP, stamp);
+    if (!book) {
         return false;
     }
     
-    return bookIt->second->modifyOrder(orderId, newPrice, newQuantity);
+    // The book retires the order through retireOrder on success
+    bool cancelled = book->cancelOrder(orderId);
+    stageEnd(Stage::MATCH, stamp);
+    return cancelled;
 }
 
-OrderPtr MatchingEngineCore::getOrder(OrderId orderId) {
-    std::string symbol;
+size_t MatchingEngineCore::applyMassCancel(const EngineCommand& command) {
+    OrderFilter filter;
+    filter.bySide = (command.scope & MASS_CANCEL_BY_SIDE) != 0;
+    filter.side = command.side;
+    filter.byClient = (command.scope & MASS_CANCEL_BY_CLIENT) != 0;
+    filter.clientKey = command.clientKey;
     
+    // Books are never destroyed, so they can be cancelled from outside the lock
+    std::vector<OrderBook*> books;
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = orderToSymbol_.find(orderId);
-        if (it == orderToSymbol_.end()) {
-            return nullptr;
+        std::shared_lock<OptionalSharedMutex> lock(booksMutex_);
+        if (command.scope & MASS_CANCEL_BY_SYMBOL) {
+            if (command.symbolId < books_.size() && books_[command.symbolId]) {
+                books.push_back(books_[command.symbolId].get());
+            }
+        } else {
+            for (const auto& book : books_) {
+                if (book) {
+                    books.push_back(book.get());
+                }
+            }
         }
-        symbol = it->second;
     }
     
-    auto bookIt = orderBooks_.find(symbol);
-    if (bookIt == orderBooks_.end()) {
+    size_t cancelled = 0;
+    for (OrderBook* book : books) {
+        cancelled += book->cancelOrders(filter);
+    }
+    return cancelled;
+}
+
+bool MatchingEngineCore::applyModify(OrderId orderId, Price newPrice, Quantity newQuantity) {
+    uint64_t stamp = stageStart();
+    OrderBook* book = findBook(orderId);
+    stamp = stageEnd(Stage::BOOK_LOOKUP, stamp);
+    if (!book) {
+        return false;
+    }
+    
+    if (!risk_.isEnabled()) {
+        bool modified = book->modifyOrder(orderId, newPrice, newQuantity);
+        stageEnd(Stage::MATCH, stamp);
+        return modified;
+    }
+    Order amended(0, SymbolId(0), Side::BUY, OrderType::LIMIT, 0, 0);
+    bool modified = book->modifyOrder(orderId, newPrice, newQuantity, &amended);
+    if (modified) {
+        risk_.onModify(amended);
+    }
+    stageEnd(Stage::MATCH, stamp);
+    return modified;
+}
+
+OrderPtr MatchingEngineCore::getOrder(OrderId orderId) {
+    OrderBook* book = findBook(orderId);
+    if (!book) {
         return nullptr;
     }
     
-    return bookIt->second->getOrder(orderId);
+    return book->getOrderCopy(orderId);
 }
 
-Price MatchingEngineCore::getBestBid(const std::string& symbol) {
-    auto it = orderBooks_.find(symbol);
-    if (it == orderBooks_.end()) {
-        return 0;
+size_t MatchingEngineCore::getLiveOrders() const {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    return orderPool_.inUse();
+}
+
+size_t MatchingEngineCore::getOrderCapacity() const {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    return orderPool_.capacity();
+}
+
+size_t MatchingEngineCore::getBookCount() const {
+    std::shared_lock<OptionalSharedMutex> lock(booksMutex_);
+    return bookCount_;
+}
+
+OrderBook* MatchingEngineCore::findBook(OrderId orderId) const {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    OrderBook* const* book = orderToBook_.find(orderId);
+    return book ? *book : nullptr;
+}
+
+void MatchingEngineCore::retireOrder(Order& order) {
+    risk_.onRetire(order);
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    orderToBook_.erase(order.getOrderId());
+    if (order.getTimeInForce() != TimeInForce::GTC) {
+        expiries_.cancel(order.getOrderId());
     }
-    return it->second->getBestBid();
+    orderPool_.release(&order);
+}
+
+BookTop MatchingEngineCore::getTop(const std::string& symbol) {
+    OrderBook* book = findBook(symbol);
+    return book ? book->getTop() : BookTop();
+}
+
+Price MatchingEngineCore::getBestBid(const std::string& symbol) {
+    OrderBook* book = findBook(symbol);
+    return book ? book->getBestBid() : 0;
 }
 
 Price MatchingEngineCore::getBestAsk(const std::string& symbol) {
-    auto it = orderBooks_.find(symbol);
-    if (it == orderBooks_.end()) {
-        return 0;
-    }
-    return it->second->getBestAsk();
+    OrderBook* book = findBook(symbol);
+    return book ? book->getBestAsk() : 0;
 }
 
 std::vector<std::pair<Price, Quantity>> MatchingEngineCore::getBidDepth(
     const std::string& symbol, size_t levels) {
-    auto it = orderBooks_.find(symbol);
-    if (it == orderBooks_.end()) {
+    OrderBook* book = findBook(symbol);
+    if (!book) {
         return {};
     }
-    return it->second->getBidDepth(levels);
+    return book->getBidDepth(levels);
 }
 
 std::vector<std::pair<Price, Quantity>> MatchingEngineCore::getAskDepth(
     const std::string& symbol, size_t levels) {
-    auto it = orderBooks_.find(symbol);
-    if (it == orderBooks_.end()) {
+    OrderBook* book = findBook(symbol);
+    if (!book) {
         return {};
     }
-    return it->second->getAskDepth(levels);
+    return book->getAskDepth(levels);
 }
 
 void MatchingEngineCore::printOrderBook(const std::string& symbol, size_t levels) {
-    auto it = orderBooks_.find(symbol);
-    if (it != orderBooks_.end()) {
-        it->second->printBook(levels);
+    OrderBook* book = findBook(symbol);
+    if (book) {
+        book->printBook(levels);
     } else {
         std::cout << "Order book for " << symbol << " not found.\n";
     }
 }
 
-OrderBook* MatchingEngineCore::getOrCreateOrderBook(const std::string& symbol) {
-    auto it = orderBooks_.find(symbol);
-    if (it != orderBooks_.end()) {
-        return it->second.get();
+void MatchingEngineCore::setBookConfig(const std::string& symbol, const OrderBookConfig& config) {
+    std::lock_guard<OptionalSharedMutex> lock(booksMutex_);
+    bookConfigs_[symbol] = config;
+}
+
+OrderBook* MatchingEngineCore::findBook(const std::string& symbol) const {
+    SymbolId symbolId = symbolInterner().find(symbol);
+    if (symbolId == 0) {
+        return nullptr;  // No book anywhere has this name
+    }
+    std::shared_lock<OptionalSharedMutex> lock(booksMutex_);
+    return symbolId < books_.size() ? books_[symbolId].get() : nullptr;
+}
+
+OrderBook* MatchingEngineCore::getOrCreateOrderBook(SymbolId symbolId) {
+    {
+        std::shared_lock<OptionalSharedMutex> lock(booksMutex_);
+        if (symbolId < books_.size() && books_[symbolId]) {
+            return books_[symbolId].get();
+        }
+    }
+    
+    std::lock_guard<OptionalSharedMutex> lock(booksMutex_);
+    if (symbolId >= books_.size()) {
+        books_.resize(symbolId + 1);
+    } else if (books_[symbolId]) {
+        return books_[symbolId].get();  // Created while we waited for the lock
     }
     
     // Create new order book
-    auto book = std::make_unique<OrderBook>(symbol);
-    OrderBook* bookPtr = book.get();
-    orderBooks_[symbol] = std::move(book);
+    const std::string& symbol = symbolInterner().name(symbolId);
+    auto configIt = bookConfigs_.find(symbol);
+    OrderBookConfig config =
+        configIt != bookConfigs_.end() ? configIt->second : defaultBookConfig_;
+    config.synchronized = config_.synchronized;
+    auto book = std::make_unique<OrderBook>(symbol, config);
+    book->setRetireHandler([this](Order& order) { retireOrder(order); });
+    book->setStopTriggerHandler([](const Order& order) { electedStops.push_back(order); });
+    book->setEventRing(events_);
+    books_[symbolId] = std::move(book);
+    ++bookCount_;
+    
+    return books_[symbolId].get();
+}
+
+void MatchingEngineCore::captureSnapshot(EngineSnapshot& snapshot) const {
+    snapshot.journalSequence = journalSequence_;
+    snapshot.nextOrderId = nextOrderId_;
+    snapshot.orders.clear();
+    snapshot.expireTimes.clear();
+    
+    {
+        std::shared_lock<OptionalSharedMutex> lock(booksMutex_);
+        for (const auto& book : books_) {
+            if (book) {
+                book->collectOrders(snapshot.orders);
+            }
+        }
+    }
+    
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    if (!expiries_.empty()) {
+        snapshot.expireTimes.reserve(snapshot.orders.size());
+        for (const Order& order : snapshot.orders) {
+            snapshot.expireTimes.push_back(order.getTimeInForce() == TimeInForce::GTC
+                                               ? 0
+                                               : expiries_.expireTimeOf(order.getOrderId()));
+        }
+    }
+}
+
+bool MatchingEngineCore::loadSnapshot(const EngineSnapshot& snapshot) {
+    if (getLiveOrders() != 0) {
+        return false;
+    }
+    
+    {
+        std::lock_guard<OptionalMutex> lock(mutex_);
+        orderPool_.reserve(snapshot.orders.size());
+        orderToBook_.reserve(snapshot.orders.size());
+    }
+    
+    // Orders arrive grouped by book and in priority order, so appending
+    // each to its level rebuilds every queue as it was
+    OrderBook* book = nullptr;
+    SymbolId bookSymbol = 0;
+    bool expiring = snapshot.expireTimes.size() == snapshot.orders.size();
+    for (size_t i = 0; i < snapshot.orders.size(); ++i) {
+        const Order& saved = snapshot.orders[i];
+        if (!book || bookSymbol != saved.getSymbolId()) {
+            bookSymbol = saved.getSymbolId();
+            book = getOrCreateOrderBook(bookSymbol);
+        }
+        OrderHandle order;
+        {
+            std::lock_guard<OptionalMutex> lock(mutex_);
+            order = orderPool_.acquire(saved);
+            orderToBook_.insert(order->getOrderId(), book);
+            uint64_t expireTime = expiring ? snapshot.expireTimes[i] : 0;
+            if (expireTime != 0 && order->getTimeInForce() != TimeInForce::GTC) {
+                scheduleExpiry(order->getOrderId(), expireTime);
+            } else {
+                order->setTimeInForce(TimeInForce::GTC);
+            }
+        }
+        risk_.onAccept(*order);
+        book->addOrder(order);
+        if (order->getStatus() == OrderStatus::REJECTED) {
+            retireOrder(*order);  // Off-tick for this book's current config
+        }
+    }
+    
+    noteOrderId(snapshot.nextOrderId - 1);
+    noteJournalSequence(snapshot.journalSequence);
+    return true;
+}
+
+bool MatchingEngineCore::recover(const std::string& snapshotPath,
+                                 const std::string& journalDirectory) {
+    std::vector<EngineSnapshot> snapshots;
+    std::error_code error;
+    if (!snapshotPath.empty() && std::filesystem::exists(snapshotPath, error)) {
+        if (!readSnapshot(snapshotPath, snapshots) || snapshots.size() != 1 ||
+            !loadSnapshot(snapshots[0])) {
+            std::cerr << "Snapshot " << snapshotPath << " is damaged or does not fit this engine"
+                      << std::endl;
+            return false;
+        }
+    }
     
-    return bookPtr;
+    if (journalDirectory.empty()) {
+        return true;
+    }
+    uint64_t after = journalSequence_;
+    return Journal::read(journalDirectory, after,
+                         [this](uint64_t sequence, const EngineCommand& command) {
+                             replay(command, sequence);
+                         });
+}
+
+void MatchingEngineCore::noteJournalSequence(uint64_t sequence) {
+    uint64_t current = journalSequence_.load(std::memory_order_relaxed);
+    while (sequence > current &&
+           !journalSequence_.compare_exchange_weak(current, sequence, std::memory_order_relaxed)) {
+    }
 }
 
-void MatchingEngineCore::notifyOrder(const OrderPtr& order) {
+void MatchingEngineCore::noteOrderId(OrderId orderId) {
+    OrderId current = nextOrderId_.load(std::memory_order_relaxed);
+    while (orderId >= current &&
+           !nextOrderId_.compare_exchange_weak(current, orderId + 1, std::memory_order_relaxed)) {
+    }
+}
+
+void MatchingEngineCore::setEventRing(EventRing* events) {
+    std::lock_guard<OptionalSharedMutex> lock(booksMutex_);
+    events_ = events;
+    for (auto& book : books_) {
+        if (book) {
+            book->setEventRing(events);
+        }
+    }
+}
+
+void MatchingEngineCore::notifyOrder(const Order& order) {
+    if (events_) {
+        events_->publish(EngineEvent::fromOrder(order));
+    }
     if (orderCallback_) {
         orderCallback_(order);
     }
 }
 
 void MatchingEngineCore::notifyTrade(const Trade& trade) {
+    if (events_) {
+        events_->publish(EngineEvent::fromTrade(trade));
+    }
     if (tradeCallback_) {
         tradeCallback_(trade);
     }
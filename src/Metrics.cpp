@@ -0,0 +1,310 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+namespace MatchingEngine {
+
+namespace {
+
+constexpr size_t STAGES = static_cast<size_t>(Stage::COUNT);
+constexpr size_t COUNTERS = static_cast<size_t>(Counter::COUNT);
+constexpr size_t GAUGES = static_cast<size_t>(Gauge::COUNT);
+
+// Shortest calibration window; shorter ones make the TSC rate noisy
+constexpr auto MIN_CALIBRATION = std::chrono::milliseconds(10);
+
+bool tscIsCycles() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string escapeLabel(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+        }
+        escaped += c == '\n' ? ' ' : c;
+    }
+    return escaped;
+}
+
+} // namespace
+
+const char* stageName(Stage stage) {
+    switch (stage) {
+        case Stage::RECEIVE: return "receive";
+        case Stage::DECODE: return "decode";
+        case Stage::QUEUE: return "queue";
+        case Stage::RISK: return "risk";
+        case Stage::BOOK_LOOKUP: return "book_lookup";
+        case Stage::MATCH: return "match";
+        case Stage::DISPATCH: return "dispatch";
+        case Stage::SEND: return "send";
+        default: return "unknown";
+    }
+}
+
+const char* counterName(Counter counter) {
+    switch (counter) {
+        case Counter::FRAMES: return "frames";
+        case Counter::COMMANDS: return "commands";
+        case Counter::BYTES_RECEIVED: return "bytes_received";
+        case Counter::BYTES_SENT: return "bytes_sent";
+        default: return "unknown";
+    }
+}
+
+const char* gaugeName(Gauge gauge) {
+    switch (gauge) {
+        case Gauge::QUEUE_DEPTH: return "queue_depth";
+        case Gauge::RESTING_ORDERS: return "resting_orders";
+        case Gauge::BOOKS: return "books";
+        case Gauge::ORDER_CAPACITY: return "order_capacity";
+        default: return "unknown";
+    }
+}
+
+ThreadMetrics::ThreadMetrics(std::string name) : name_(std::move(name)) {
+    for (auto& stage : buckets_) {
+        for (auto& bucket : stage) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+    for (auto& counter : counters_) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < GAUGES; ++i) {
+        gauges_[i].store(0, std::memory_order_relaxed);
+        gaugesSet_[i].store(false, std::memory_order_relaxed);
+    }
+}
+
+std::string ThreadMetrics::name() const {
+    std::lock_guard<std::mutex> lock(nameMutex_);
+    return name_;
+}
+
+void ThreadMetrics::setName(std::string name) {
+    std::lock_guard<std::mutex> lock(nameMutex_);
+    name_ = std::move(name);
+}
+
+// Owns a thread's registration; its destructor runs as the thread exits
+struct MetricsRegistry::Holder {
+    MetricsRegistry& registry;
+    std::shared_ptr<ThreadMetrics> metrics;
+
+    explicit Holder(MetricsRegistry& owner) : registry(owner) {
+        std::ostringstream name;
+        name << "thread-" << std::this_thread::get_id();
+        metrics = std::make_shared<ThreadMetrics>(name.str());
+        std::lock_guard<std::mutex> lock(registry.mutex_);
+        registry.threads_.push_back(metrics);
+    }
+    ~Holder() { registry.retire(metrics); }
+};
+
+MetricsRegistry::MetricsRegistry()
+    : enabled_(false)
+    , exited_(std::make_shared<ThreadMetrics>("exited"))
+    , calibrationTime_(std::chrono::steady_clock::now())
+    , calibrationTicks_(readTsc()) {
+}
+
+ThreadMetrics& MetricsRegistry::local() {
+    thread_local Holder holder(*this);
+    return *holder.metrics;
+}
+
+void MetricsRegistry::retire(const std::shared_ptr<ThreadMetrics>& metrics) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fold(*metrics, *exited_);
+    threads_.erase(std::remove(threads_.begin(), threads_.end(), metrics), threads_.end());
+}
+
+void MetricsRegistry::fold(const ThreadMetrics& from, ThreadMetrics& into) {
+    // Under mutex_, the only writer of the exited aggregate
+    for (size_t stage = 0; stage < STAGES; ++stage) {
+        for (size_t bucket = 0; bucket < ThreadMetrics::BUCKETS; ++bucket) {
+            ThreadMetrics::bump(into.buckets_[stage][bucket],
+                                from.buckets_[stage][bucket].load(std::memory_order_relaxed));
+        }
+    }
+    for (size_t i = 0; i < COUNTERS; ++i) {
+        ThreadMetrics::bump(into.counters_[i], from.counters_[i].load(std::memory_order_relaxed));
+    }
+    // Gauges of a thread that has gone no longer describe anything
+}
+
+double MetricsRegistry::ticksPerNanosecond() const {
+    if (!tscIsCycles()) {
+        return 1.0;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - calibrationTime_;
+    if (elapsed < MIN_CALIBRATION) {
+        std::this_thread::sleep_for(MIN_CALIBRATION - elapsed);
+    }
+    // Read the pair back to back so the ratio spans the same interval
+    uint64_t ticks = readTsc();
+    auto now = std::chrono::steady_clock::now();
+    double nanos = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - calibrationTime_).count());
+    double rate = static_cast<double>(ticks - calibrationTicks_) / nanos;
+    return rate > 0.0 ? rate : 1.0;
+}
+
+void MetricsRegistry::copy(const ThreadMetrics& from, MetricsSnapshot::Thread& to, double ticksPerNs) const {
+    to.name = from.name();
+    to.stages.assign(STAGES, LatencyHistogram());
+    for (size_t stage = 0; stage < STAGES; ++stage) {
+        for (size_t bucket = 0; bucket < ThreadMetrics::BUCKETS; ++bucket) {
+            uint64_t count = from.buckets_[stage][bucket].load(std::memory_order_relaxed);
+            if (count != 0) {
+                uint64_t ticks = LatencyHistogram::highestIn(bucket, ThreadMetrics::PRECISION_BITS);
+                to.stages[stage].record(static_cast<uint64_t>(ticks / ticksPerNs), count);
+            }
+        }
+    }
+    for (size_t i = 0; i < COUNTERS; ++i) {
+        to.counters[i] = from.counters_[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < GAUGES; ++i) {
+        to.hasGauge[i] = from.gaugesSet_[i].load(std::memory_order_relaxed);
+        to.gauges[i] = from.gauges_[i].load(std::memory_order_relaxed);
+    }
+}
+
+MetricsSnapshot MetricsRegistry::snapshot() const {
+    MetricsSnapshot snapshot;
+    snapshot.ticksPerNanosecond = ticksPerNanosecond();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    snapshot.threads.resize(threads_.size() + 1);
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        copy(*threads_[i], snapshot.threads[i], snapshot.ticksPerNanosecond);
+    }
+    copy(*exited_, snapshot.threads.back(), snapshot.ticksPerNanosecond);
+    return snapshot;
+}
+
+void MetricsRegistry::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ThreadMetrics*> all;
+    for (const auto& metrics : threads_) {
+        all.push_back(metrics.get());
+    }
+    all.push_back(exited_.get());
+    for (ThreadMetrics* metrics : all) {
+        for (auto& stage : metrics->buckets_) {
+            for (auto& bucket : stage) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+        for (auto& counter : metrics->counters_) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+        for (auto& set : metrics->gaugesSet_) {
+            set.store(false, std::memory_order_relaxed);
+        }
+    }
+}
+
+MetricsRegistry& metrics() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+LatencyHistogram MetricsSnapshot::stage(Stage stage) const {
+    LatencyHistogram merged;
+    for (const auto& thread : threads) {
+        merged.merge(thread.stages[static_cast<size_t>(stage)]);
+    }
+    return merged;
+}
+
+uint64_t MetricsSnapshot::counter(Counter counter) const {
+    uint64_t total = 0;
+    for (const auto& thread : threads) {
+        total += thread.counters[static_cast<size_t>(counter)];
+    }
+    return total;
+}
+
+std::string MetricsSnapshot::toText() const {
+    std::ostringstream out;
+    out << "  " << std::left << std::setw(12) << "stage" << std::right
+        << std::setw(12) << "count" << std::setw(10) << "p50" << std::setw(10) << "p99"
+        << std::setw(10) << "p99.9" << std::setw(12) << "max" << "  (ns)\n";
+    for (size_t i = 0; i < STAGES; ++i) {
+        LatencyHistogram merged = stage(static_cast<Stage>(i));
+        if (merged.count() == 0) {
+            continue;
+        }
+        out << "  " << std::left << std::setw(12) << stageName(static_cast<Stage>(i)) << std::right
+            << std::setw(12) << merged.count()
+            << std::setw(10) << merged.percentile(50.0)
+            << std::setw(10) << merged.percentile(99.0)
+            << std::setw(10) << merged.percentile(99.9)
+            << std::setw(12) << merged.max() << "\n";
+    }
+    out << " ";
+    for (size_t i = 0; i < COUNTERS; ++i) {
+        out << " " << counterName(static_cast<Counter>(i)) << "=" << counter(static_cast<Counter>(i));
+    }
+    out << "\n";
+    return out.str();
+}
+
+std::string MetricsSnapshot::toPrometheus() const {
+    static const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+    std::ostringstream out;
+
+    out << "# HELP matching_stage_latency_ns Time spent in each stage of the order path\n"
+        << "# TYPE matching_stage_latency_ns summary\n";
+    for (const auto& thread : threads) {
+        std::string threadLabel = "thread=\"" + escapeLabel(thread.name) + "\"";
+        for (size_t i = 0; i < STAGES; ++i) {
+            const LatencyHistogram& histogram = thread.stages[i];
+            if (histogram.count() == 0) {
+                continue;
+            }
+            std::string labels = threadLabel + ",stage=\"" + stageName(static_cast<Stage>(i)) + "\"";
+            for (double quantile : QUANTILES) {
+                out << "matching_stage_latency_ns{" << labels << ",quantile=\"" << quantile << "\"} "
+                    << histogram.percentile(quantile * 100.0) << "\n";
+            }
+            out << "matching_stage_latency_ns_sum{" << labels << "} "
+                << static_cast<uint64_t>(histogram.mean() * histogram.count()) << "\n";
+            out << "matching_stage_latency_ns_count{" << labels << "} " << histogram.count() << "\n";
+        }
+    }
+
+    for (size_t i = 0; i < COUNTERS; ++i) {
+        std::string name = std::string("matching_") + counterName(static_cast<Counter>(i)) + "_total";
+        out << "# TYPE " << name << " counter\n";
+        for (const auto& thread : threads) {
+            if (thread.counters[i] != 0) {
+                out << name << "{thread=\"" << escapeLabel(thread.name) << "\"} " << thread.counters[i] << "\n";
+            }
+        }
+    }
+
+    for (size_t i = 0; i < GAUGES; ++i) {
+        std::string name = std::string("matching_") + gaugeName(static_cast<Gauge>(i));
+        out << "# TYPE " << name << " gauge\n";
+        for (const auto& thread : threads) {
+            if (thread.hasGauge[i]) {
+                out << name << "{thread=\"" << escapeLabel(thread.name) << "\"} " << thread.gauges[i] << "\n";
+            }
+        }
+    }
+    return out.str();
+}
+
+} // namespace MatchingEngine
@@ -0,0 +1,119 @@
+#include "MetricsEndpoint.h"
+#include "Metrics.h"
+#include <iostream>
+#include <string>
+
+namespace MatchingEngine {
+
+namespace {
+
+// A scraper that hangs up early must not take the server down with SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+} // namespace
+
+MetricsEndpoint::~MetricsEndpoint() {
+    stop();
+}
+
+bool MetricsEndpoint::start(uint16_t port) {
+    if (running_) {
+        return false;
+    }
+
+    socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (socket_ == INVALID_SOCKET) {
+        std::cerr << "Failed to create metrics socket" << std::endl;
+        return false;
+    }
+
+    int opt = 1;
+#ifdef _WIN32
+    setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+#else
+    setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+#endif
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+    if (bind(socket_, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+        listen(socket_, 16) == SOCKET_ERROR) {
+        std::cerr << "Failed to listen for metrics on port " << port << std::endl;
+        closesocket(socket_);
+        socket_ = INVALID_SOCKET;
+        return false;
+    }
+
+#ifdef _WIN32
+    int length = sizeof(address);
+#else
+    socklen_t length = sizeof(address);
+#endif
+    port_ = getsockname(socket_, (sockaddr*)&address, &length) == 0 ? ntohs(address.sin_port) : port;
+
+    running_ = true;
+    thread_ = std::thread(&MetricsEndpoint::serve, this);
+    return true;
+}
+
+void MetricsEndpoint::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    // Unblock accept
+#ifdef _WIN32
+    shutdown(socket_, SD_BOTH);
+#else
+    shutdown(socket_, SHUT_RDWR);
+#endif
+    closesocket(socket_);
+    socket_ = INVALID_SOCKET;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void MetricsEndpoint::serve() {
+    while (running_) {
+        SocketType client = accept(socket_, nullptr, nullptr);
+        if (client == INVALID_SOCKET) {
+            continue;  // Interrupted, or stop() closed the socket
+        }
+        answer(client);
+        closesocket(client);
+    }
+}
+
+void MetricsEndpoint::answer(SocketType client) {
+    // Whatever the request asks for, the answer is the metrics page; read
+    // it only so closing doesn't reset the connection under the reply
+    char request[2048];
+    recv(client, request, sizeof(request), 0);
+
+    std::string body = metrics().snapshot().toPrometheus();
+    std::string response =
+        "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "Connection: close\r\n"
+        "\r\n" + body;
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        int written = send(client, response.data() + sent, static_cast<int>(response.size() - sent),
+                           SEND_FLAGS);
+        if (written == SOCKET_ERROR || written == 0) {
+            return;
+        }
+        sent += static_cast<size_t>(written);
+    }
+}
+
+} // namespace MatchingEngine
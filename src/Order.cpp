@@ -1,4 +1,5 @@
 #include "Order.h"
+#include "Interner.h"
 #include <sstream>
 #include <iomanip>
 
@@ -11,17 +12,43 @@ Order::Order(OrderId orderId,
              Price price,
              Quantity quantity,
              Price stopPrice)
+    : Order(orderId, symbolInterner().intern(symbol), side, type, price, quantity, stopPrice) {
+}
+
+Order::Order(OrderId orderId,
+             SymbolId symbolId,
+             Side side,
+             OrderType type,
+             Price price,
+             Quantity quantity,
+             Price stopPrice,
+             ClientKey clientKey,
+             Timestamp timestamp)
     : orderId_(orderId)
-    , symbol_(symbol)
-    , side_(side)
-    , type_(type)
     , price_(price)
-    , quantity_(quantity)
     , remainingQuantity_(quantity)
+    , side_(static_cast<uint8_t>(side))
+    , type_(static_cast<uint8_t>(type))
+    , status_(static_cast<uint8_t>(OrderStatus::PENDING))
+    , symbolId_(symbolId)
+    , quantity_(quantity)
     , stopPrice_(stopPrice)
-    , status_(OrderStatus::PENDING)
-    , timestamp_(getCurrentTimestamp())
-    , clientId_("") {
+    , timestamp_(timestamp)
+    , clientKey_(clientKey)
+    , timeInForce_(static_cast<uint8_t>(TimeInForce::GTC)) {
+    static_assert(sizeof(Order) == CACHE_LINE_SIZE, "an order is one cache line");
+}
+
+const std::string& Order::getSymbol() const {
+    return symbolInterner().name(symbolId_);
+}
+
+const std::string& Order::getClientId() const {
+    return clientInterner().name(clientKey_);
+}
+
+void Order::setClientId(const std::string& clientId) {
+    clientKey_ = clientInterner().intern(clientId);
 }
 
 void Order::fill(Quantity quantity) {
@@ -32,18 +59,18 @@ void Order::fill(Quantity quantity) {
     remainingQuantity_ -= quantity;
     
     if (remainingQuantity_ == 0) {
-        status_ = OrderStatus::FILLED;
-    } else if (remainingQuantity_ < quantity_) {
-        status_ = OrderStatus::PARTIAL_FILL;
+        setStatus(OrderStatus::FILLED);
+    } else if (quantity > 0) {
+        setStatus(OrderStatus::PARTIAL_FILL);
     }
 }
 
 bool Order::shouldTrigger(Price currentPrice) const {
-    if (type_ != OrderType::STOP_LOSS && type_ != OrderType::STOP_LIMIT) {
+    if (getType() != OrderType::STOP_LOSS && getType() != OrderType::STOP_LIMIT) {
         return false;
     }
     
-    if (side_ == Side::BUY) {
+    if (getSide() == Side::BUY) {
         // Buy stop triggers when price rises to stop price
         return currentPrice >= stopPrice_;
     } else {
@@ -55,13 +82,13 @@ bool Order::shouldTrigger(Price currentPrice) const {
 std::string Order::toString() const {
     std::ostringstream oss;
     oss << "Order[ID=" << orderId_ 
-        << ", Symbol=" << symbol_
-        << ", Side=" << sideToString(side_)
-        << ", Type=" << orderTypeToString(type_)
+        << ", Symbol=" << getSymbol()
+        << ", Side=" << sideToString(getSide())
+        << ", Type=" << orderTypeToString(getType())
         << ", Price=" << std::fixed << std::setprecision(4) << priceToDouble(price_)
         << ", Qty=" << quantity_
         << ", Remaining=" << remainingQuantity_
-        << ", Status=" << orderStatusToString(status_)
+        << ", Status=" << orderStatusToString(getStatus())
         << "]";
     return oss.str();
 }
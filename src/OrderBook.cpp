@@ -1,482 +1,725 @@
 #include "OrderBook.h"
+#include "Interner.h"
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
 
 namespace MatchingEngine {
 
-// PriceLevel implementation
-void PriceLevel::addOrder(OrderPtr order) {
-    orders_.push_back(order);
-    orderMap_[order->getOrderId()] = --orders_.end();
-    totalQuantity_ += order->getRemainingQuantity();
+// OrderBook implementation
+OrderBook::OrderBook(const std::string& symbol, const OrderBookConfig& config) 
+    : symbol_(symbol)
+    , symbolId_(symbolInterner().intern(symbol))
+    , config_(config)
+    , slab_(config.orderCapacity)
+    , bidQuantity_(0)
+    , askQuantity_(0)
+    , orderIndex_(config.orderCapacity * 2)
+    , events_(nullptr)
+    , mutex_(config.synchronized)
+    , topChanged_(false) {
+    if (config_.tickSize <= 0) {
+        config_.tickSize = 1;
+    }
+    bids_ = makeLadder(Side::BUY, config_);
+    asks_ = makeLadder(Side::SELL, config_);
 }
 
-void PriceLevel::removeOrder(OrderId orderId) {
-    auto it = orderMap_.find(orderId);
-    if (it != orderMap_.end()) {
-        totalQuantity_ -= (*it->second)->getRemainingQuantity();
-        orders_.erase(it->second);
-        orderMap_.erase(it);
+std::unique_ptr<PriceLadder> OrderBook::makeLadder(Side side, const OrderBookConfig& config) {
+    if (config.ladderType == PriceLadderType::ARRAY) {
+        return std::make_unique<ArrayPriceLadder>(side, config.tickSize, config.ladderLevels,
+                                                  config.ladderMaxLevels);
     }
+    if (side == Side::BUY) {
+        return std::make_unique<MapBidLadder>();
+    }
+    return std::make_unique<MapAskLadder>();
 }
 
-OrderPtr PriceLevel::getOrder(OrderId orderId) {
-    auto it = orderMap_.find(orderId);
-    if (it != orderMap_.end()) {
-        return *it->second;
+void OrderBook::addOrder(OrderHandle order) {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    TopPublisher publisher{*this};
+    
+    bool stop = order->getType() == OrderType::STOP_LOSS ||
+                order->getType() == OrderType::STOP_LIMIT;
+    if (!isOnTick(order->getPrice()) ||
+        (!stop && !ladderFor(order->getSide()).accepts(order->getPrice()))) {
+        order->setStatus(OrderStatus::REJECTED);
+        return;
+    }
+    
+    if (stop) {
+        parkStop(order);
+    } else {
+        restOrder(order);
     }
-    return nullptr;
 }
 
-// OrderBook implementation
-OrderBook::OrderBook(const std::string& symbol) 
-    : symbol_(symbol) {
+void OrderBook::addOrder(const OrderPtr& order) {
+    addOrder(order.get());
+    
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    if (rests(order.get())) {
+        sharedOrders_.insert(order->getOrderId(), order);
+    }
 }
 
-void OrderBook::addOrder(OrderPtr order) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    orderMap_[order->getOrderId()] = order;
-    
-    if (order->getSide() == Side::BUY) {
-        bids_[order->getPrice()].addOrder(order);
+std::vector<Trade> OrderBook::matchOrder(const OrderPtr& order) {
+    std::vector<Trade> trades;
+    if (matchOrder(order.get(), trades)) {
+        std::lock_guard<OptionalMutex> lock(mutex_);
+        if (rests(order.get())) {
+            sharedOrders_.insert(order->getOrderId(), order);
+        }
+    }
+    return trades;
+}
+
+void OrderBook::retire(Order& order) {
+    OrderId orderId = order.getOrderId();
+    if (retireHandler_) {
+        retireHandler_(order);
+    }
+    if (!sharedOrders_.empty()) {
+        sharedOrders_.erase(orderId);
+    }
+}
+
+void OrderBook::restOrder(OrderHandle order) {
+    OrderSlot slot = slab_.allocate(order);
+    orderIndex_.insert(order->getOrderId(), slot);
+    PriceLevel& level = ladderFor(order->getSide()).getOrCreate(order->getPrice());
+    level.pushBack(slab_, slot);
+    restingQuantity(order->getSide()) += order->getRemainingQuantity();
+    publishLevel(order->getSide(), order->getPrice(), &level);
+}
+
+void OrderBook::removeFromLevel(OrderSlot slot) {
+    const Order& order = *slab_[slot].order;
+    PriceLadder& ladder = ladderFor(order.getSide());
+    PriceLevel* level = ladder.find(order.getPrice());
+    if (level) {
+        level->remove(slab_, slot);
+        restingQuantity(order.getSide()) -= order.getRemainingQuantity();
+        if (level->isEmpty()) {
+            ladder.erase(order.getPrice());
+            level = nullptr;
+        }
+        publishLevel(order.getSide(), order.getPrice(), level);
+    }
+}
+
+void OrderBook::updateTop(Side side, Price price, const PriceLevel* level) {
+    BookTop::Level* levels = side == Side::BUY ? top_.bids : top_.asks;
+    size_t& count = side == Side::BUY ? top_.bidLevels : top_.askLevels;
+    const PriceLadder& ladder = ladderFor(side);
+    
+    // Where price is among the top levels, or would go. With fewer than
+    // DEPTH levels the top holds the whole side.
+    size_t index = 0;
+    while (index < count && levels[index].price != price &&
+           ladder.within(levels[index].price, price)) {
+        ++index;
+    }
+    bool found = index < count && levels[index].price == price;
+    
+    if (level) {
+        if (found) {
+            levels[index].quantity = level->getTotalQuantity();
+        } else if (index < BookTop::DEPTH) {
+            // A new level in the top pushes the last one out
+            size_t last = std::min(count, BookTop::DEPTH - 1);
+            for (size_t i = last; i > index; --i) {
+                levels[i] = levels[i - 1];
+            }
+            levels[index].price = price;
+            levels[index].quantity = level->getTotalQuantity();
+            count = last + 1;
+        } else {
+            return;
+        }
+    } else if (found) {
+        // The level is gone; the first one below the top moves up
+        for (size_t i = index; i + 1 < count; ++i) {
+            levels[i] = levels[i + 1];
+        }
+        if (--count == BookTop::DEPTH - 1) {
+            const PriceLevel* next = count ? ladder.next(levels[count - 1].price) : ladder.best();
+            if (next) {
+                levels[count].price = next->getPrice();
+                levels[count].quantity = next->getTotalQuantity();
+                ++count;
+            }
+        }
     } else {
-        asks_[order->getPrice()].addOrder(order);
+        return;
     }
+    topChanged_ = true;
+}
+
+void OrderBook::publishLevelEvent(Side side, Price price, const PriceLevel* level) {
+    Quantity quantity = level ? level->getTotalQuantity() : 0;
+    uint32_t orderCount = level ? static_cast<uint32_t>(level->getOrderCount()) : 0;
+    events_->publish(EngineEvent::levelUpdate(symbolId_, side, price, quantity, orderCount));
 }
 
 bool OrderBook::cancelOrder(OrderId orderId) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    auto it = orderMap_.find(orderId);
-    if (it == orderMap_.end()) {
-        return false;
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    TopPublisher publisher{*this};
+    return cancelLocked(orderId);
+}
+
+size_t OrderBook::cancelOrders(const OrderFilter& filter) {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    TopPublisher publisher{*this};
+    
+    // Collect first - cancelling unlinks what the walk would step through
+    static thread_local std::vector<OrderId> doomed;
+    doomed.clear();
+    for (Side side : {Side::BUY, Side::SELL}) {
+        if (filter.bySide && side != filter.side) {
+            continue;
+        }
+        const PriceLadder& ladder = ladderFor(side);
+        for (const PriceLevel* level = ladder.best(); level; level = ladder.next(level->getPrice())) {
+            for (OrderSlot slot = level->front(); slot != INVALID_SLOT; slot = slab_[slot].next) {
+                if (filter.matches(*slab_[slot].order)) {
+                    doomed.push_back(slab_[slot].order->getOrderId());
+                }
+            }
+        }
     }
-    
-    OrderPtr order = it->second;
-    order->setStatus(OrderStatus::CANCELLED);
-    
-    if (order->getSide() == Side::BUY) {
-        auto levelIt = bids_.find(order->getPrice());
-        if (levelIt != bids_.end()) {
-            levelIt->second.removeOrder(orderId);
-            if (levelIt->second.isEmpty()) {
-                bids_.erase(levelIt);
+    auto collectStops = [&](const auto& stops) {
+        for (const auto& entry : stops) {
+            if (filter.matches(*entry.second)) {
+                doomed.push_back(entry.second->getOrderId());
             }
         }
-    } else {
-        auto levelIt = asks_.find(order->getPrice());
-        if (levelIt != asks_.end()) {
-            levelIt->second.removeOrder(orderId);
-            if (levelIt->second.isEmpty()) {
-                asks_.erase(levelIt);
+    };
+    collectStops(buyStops_);
+    collectStops(sellStops_);
+    
+    for (OrderId orderId : doomed) {
+        cancelLocked(orderId);
+    }
+    return doomed.size();
+}
+
+size_t OrderBook::cancelOrders(const OrderId* orderIds, size_t count,
+                               std::vector<Order>* cancelled) {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    TopPublisher publisher{*this};
+    
+    size_t found = 0;
+    Order report(0, SymbolId(0), Side::BUY, OrderType::LIMIT, 0, 0);
+    for (size_t i = 0; i < count; ++i) {
+        if (cancelLocked(orderIds[i], cancelled ? &report : nullptr)) {
+            ++found;
+            if (cancelled) {
+                cancelled->push_back(report);
             }
         }
     }
+    return found;
+}
+
+bool OrderBook::cancelLocked(OrderId orderId, Order* report) {
+    const OrderSlot* slot = orderIndex_.find(orderId);
+    if (!slot) {
+        OrderHandle* stop = stopIndex_.find(orderId);
+        if (!stop) {
+            return false;
+        }
+        Order& order = **stop;
+        unparkStop(&order);
+        order.setStatus(OrderStatus::CANCELLED);
+        if (report) {
+            *report = order;
+        }
+        retire(order);
+        return true;
+    }
+    
+    OrderSlot cancelled = *slot;
+    Order& order = *slab_[cancelled].order;
+    order.setStatus(OrderStatus::CANCELLED);
+    if (report) {
+        *report = order;
+    }
+    removeFromLevel(cancelled);
     
-    orderMap_.erase(it);
+    orderIndex_.erase(orderId);
+    slab_.release(cancelled);
+    retire(order);
     return true;
 }
 
-bool OrderBook::modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity) {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool OrderBook::modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity,
+                            Order* report) {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    TopPublisher publisher{*this};
     
-    auto it = orderMap_.find(orderId);
-    if (it == orderMap_.end()) {
+    if (!isOnTick(newPrice) || newQuantity == 0) {
         return false;
     }
+    const OrderSlot* found = orderIndex_.find(orderId);
+    if (!found) {
+        // A parked stop keeps its trigger and its place among the stops
+        OrderHandle* stop = stopIndex_.find(orderId);
+        if (!stop) {
+            return false;
+        }
+        (*stop)->setPrice(newPrice);
+        (*stop)->amend(newQuantity);
+        if (report) {
+            *report = **stop;
+        }
+        return true;
+    }
     
-    OrderPtr order = it->second;
-    
-    // Remove from current price level
-    if (order->getSide() == Side::BUY) {
-        auto levelIt = bids_.find(order->getPrice());
-        if (levelIt != bids_.end()) {
-            levelIt->second.removeOrder(orderId);
-            if (levelIt->second.isEmpty()) {
-                bids_.erase(levelIt);
-            }
+    OrderSlot slot = *found;
+    Order& order = *slab_[slot].order;
+    Side side = order.getSide();
+    Quantity remaining = order.getRemainingQuantity();
+    
+    if (newPrice == order.getPrice()) {
+        PriceLevel& level = *ladderFor(side).find(newPrice);
+        if (newQuantity <= remaining) {
+            // Reducing keeps time priority and is applied where the order sits
+            level.reduceQuantity(remaining - newQuantity);
+            restingQuantity(side) -= remaining - newQuantity;
+            order.amend(newQuantity);
+        } else {
+            // Added quantity goes to the back of the same level
+            level.remove(slab_, slot);
+            order.amend(newQuantity);
+            level.pushBack(slab_, slot);
+            restingQuantity(side) += newQuantity - remaining;
+        }
+        if (newQuantity != remaining) {
+            publishLevel(side, newPrice, &level);
         }
     } else {
-        auto levelIt = asks_.find(order->getPrice());
-        if (levelIt != asks_.end()) {
-            levelIt->second.removeOrder(orderId);
-            if (levelIt->second.isEmpty()) {
-                asks_.erase(levelIt);
-            }
+        // A new price loses time priority
+        if (!ladderFor(side).accepts(newPrice)) {
+            return false;
         }
+        removeFromLevel(slot);
+        order.setPrice(newPrice);
+        order.amend(newQuantity);
+        PriceLevel& level = ladderFor(side).getOrCreate(newPrice);
+        level.pushBack(slab_, slot);
+        restingQuantity(side) += newQuantity;
+        publishLevel(side, newPrice, &level);
     }
     
-    // Update order
-    order->setPrice(newPrice);
-    order->setQuantity(newQuantity);
-    order->setStatus(OrderStatus::PENDING);
+    if (report) {
+        *report = order;
+    }
+    return true;
+}
+
+OrderHandle OrderBook::getOrder(OrderId orderId) {
+    std::lock_guard<OptionalMutex> lock(mutex_);
     
-    // Add to new price level (loses time priority)
-    if (order->getSide() == Side::BUY) {
-        bids_[newPrice].addOrder(order);
-    } else {
-        asks_[newPrice].addOrder(order);
+    const OrderSlot* slot = orderIndex_.find(orderId);
+    if (slot) {
+        return slab_[*slot].order;
     }
+    OrderHandle* stop = stopIndex_.find(orderId);
+    return stop ? *stop : nullptr;
+}
+
+OrderPtr OrderBook::getOrderCopy(OrderId orderId) const {
+    std::lock_guard<OptionalMutex> lock(mutex_);
     
-    return true;
+    const OrderSlot* slot = orderIndex_.find(orderId);
+    if (slot) {
+        return std::make_shared<Order>(*slab_[*slot].order);
+    }
+    const OrderHandle* stop = stopIndex_.find(orderId);
+    return stop ? std::make_shared<Order>(**stop) : nullptr;
 }
 
-OrderPtr OrderBook::getOrder(OrderId orderId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool OrderBook::copyOrder(OrderId orderId, Order& copy) const {
+    std::lock_guard<OptionalMutex> lock(mutex_);
     
-    auto it = orderMap_.find(orderId);
-    if (it != orderMap_.end()) {
-        return it->second;
+    const OrderSlot* slot = orderIndex_.find(orderId);
+    if (slot) {
+        copy = *slab_[*slot].order;
+        return true;
+    }
+    const OrderHandle* stop = stopIndex_.find(orderId);
+    if (!stop) {
+        return false;
     }
-    return nullptr;
+    copy = **stop;
+    return true;
 }
 
-std::vector<Trade> OrderBook::matchOrder(OrderPtr order) {
-    std::lock_guard<std::mutex> lock(mutex_);
+std::vector<Trade> OrderBook::matchOrder(OrderHandle order) {
+    std::vector<Trade> trades;
+    matchOrder(order, trades);
+    return trades;
+}
+
+bool OrderBook::matchOrder(OrderHandle order, std::vector<Trade>& trades, Order* report) {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    TopPublisher publisher{*this};
+    
+    // A limit order whose remainder couldn't rest is refused up front
+    if ((order->getType() != OrderType::MARKET && !isOnTick(order->getPrice())) ||
+        (order->getType() == OrderType::LIMIT &&
+         !ladderFor(order->getSide()).accepts(order->getPrice()))) {
+        order->setStatus(OrderStatus::REJECTED);
+        if (report) {
+            *report = *order;
+        }
+        return false;
+    }
     
+    size_t firstTrade = trades.size();
     switch (order->getType()) {
         case OrderType::MARKET:
-            return matchMarketOrder(order);
+            matchMarketOrder(order, trades);
+            break;
         case OrderType::LIMIT:
-            return matchLimitOrder(order);
+            matchLimitOrder(order, trades);
+            break;
         case OrderType::IOC:
-            return matchIOCOrder(order);
+            matchIOCOrder(order, trades);
+            break;
         case OrderType::FOK:
-            return matchFOKOrder(order);
+            matchFOKOrder(order, trades);
+            break;
         case OrderType::STOP_LOSS:
         case OrderType::STOP_LIMIT:
-            // Stop orders should be stored and triggered later
-            // For now, treat as regular limit orders
-            return matchLimitOrder(order);
+            parkStop(order);
+            break;
         default:
-            return {};
+            break;
     }
-}
-
-std::vector<Trade> OrderBook::matchMarketOrder(OrderPtr order) {
-    std::vector<Trade> trades;
     
-    if (order->getSide() == Side::BUY) {
-        // Match against asks
-        trades = executeMatches(order, asks_, false);
-    } else {
-        // Match against bids
-        trades = executeMatches(order, bids_, false);
+    // Copied before elected stops can fill a resting remainder
+    if (report) {
+        *report = *order;
     }
+    bool rested = rests(order);
     
-    // Market orders cancel unfilled portion
-    if (order->getRemainingQuantity() > 0) {
-        order->setStatus(OrderStatus::CANCELLED);
+    if (trades.size() > firstTrade && (!buyStops_.empty() || !sellStops_.empty())) {
+        releaseStops(trades, firstTrade);
     }
-    
-    return trades;
+    return rested;
 }
 
-std::vector<Trade> OrderBook::matchLimitOrder(OrderPtr order) {
-    std::vector<Trade> trades;
-    
+bool OrderBook::rests(OrderHandle order) const {
+    const OrderSlot* slot = orderIndex_.find(order->getOrderId());
+    if (slot) {
+        return slab_[*slot].order == order;
+    }
+    const OrderHandle* stop = stopIndex_.find(order->getOrderId());
+    return stop && *stop == order;
+}
+
+void OrderBook::parkStop(OrderHandle order) {
     if (order->getSide() == Side::BUY) {
-        // Buy limit can match with asks at or below limit price
-        trades = executeMatches(order, asks_, false);
+        buyStops_.emplace(order->getStopPrice(), order);
+    } else {
+        sellStops_.emplace(order->getStopPrice(), order);
+    }
+    stopIndex_.insert(order->getOrderId(), order);
+}
+
+bool OrderBook::unparkStop(OrderHandle order) {
+    auto unlink = [order](auto& stops) {
+        auto range = stops.equal_range(order->getStopPrice());
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == order) {
+                stops.erase(it);
+                return true;
+            }
+        }
+        return false;
+    };
+    stopIndex_.erase(order->getOrderId());
+    return order->getSide() == Side::BUY ? unlink(buyStops_) : unlink(sellStops_);
+}
+
+void OrderBook::releaseStops(std::vector<Trade>& trades, size_t firstTrade) {
+    // Each round elects the stops crossed by the previous round's trades
+    while (firstTrade < trades.size()) {
+        Price high = trades[firstTrade].getPrice();
+        Price low = high;
+        for (size_t i = firstTrade + 1; i < trades.size(); ++i) {
+            high = std::max(high, trades[i].getPrice());
+            low = std::min(low, trades[i].getPrice());
+        }
+        firstTrade = trades.size();
         
-        // If not fully filled, add to book
-        if (order->getRemainingQuantity() > 0 && order->isActive()) {
-            bids_[order->getPrice()].addOrder(order);
-            orderMap_[order->getOrderId()] = order;
+        elected_.clear();
+        auto buy = buyStops_.begin();
+        for (; buy != buyStops_.end() && buy->first <= high; ++buy) {
+            elected_.push_back(buy->second);
         }
-    } else {
-        // Sell limit can match with bids at or above limit price
-        trades = executeMatches(order, bids_, false);
+        buyStops_.erase(buyStops_.begin(), buy);
+        auto sell = sellStops_.begin();
+        for (; sell != sellStops_.end() && sell->first >= low; ++sell) {
+            elected_.push_back(sell->second);
+        }
+        sellStops_.erase(sellStops_.begin(), sell);
         
-        // If not fully filled, add to book
-        if (order->getRemainingQuantity() > 0 && order->isActive()) {
-            asks_[order->getPrice()].addOrder(order);
-            orderMap_[order->getOrderId()] = order;
+        // Elected stops enter at the time of the trade that elected them
+        const Timestamp electedAt = trades.back().getTimestamp();
+        for (OrderHandle order : elected_) {
+            stopIndex_.erase(order->getOrderId());
+            order->setTimestamp(electedAt);
+            if (order->getType() == OrderType::STOP_LIMIT) {
+                order->setType(OrderType::LIMIT);
+                matchLimitOrder(order, trades);
+            } else {
+                order->setType(OrderType::MARKET);
+                matchMarketOrder(order, trades);
+            }
+            
+            bool rested = rests(order);
+            if (triggerHandler_) {
+                triggerHandler_(*order);
+            }
+            if (!rested) {
+                retire(*order);
+            }
         }
     }
-    
-    return trades;
 }
 
-std::vector<Trade> OrderBook::matchIOCOrder(OrderPtr order) {
-    std::vector<Trade> trades;
+size_t OrderBook::getStopCount() const {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    return stopIndex_.size();
+}
+
+void OrderBook::matchMarketOrder(OrderHandle order, std::vector<Trade>& trades) {
+    executeMatches<OrderType::MARKET>(order, trades);
     
-    if (order->getSide() == Side::BUY) {
-        trades = executeMatches(order, asks_, false);
-    } else {
-        trades = executeMatches(order, bids_, false);
+    // Market orders cancel unfilled portion
+    if (order->getRemainingQuantity() > 0) {
+        order->setStatus(OrderStatus::CANCELLED);
     }
+}
+
+void OrderBook::matchLimitOrder(OrderHandle order, std::vector<Trade>& trades) {
+    // Buy limit matches asks at or below its price, sell limit bids at or above
+    executeMatches<OrderType::LIMIT>(order, trades);
+    
+    // If not fully filled, add to book. Only an elected stop can find its
+    // price past what the ladder holds; its remainder is cancelled.
+    if (order->getRemainingQuantity() > 0 && order->isActive()) {
+        if (ladderFor(order->getSide()).accepts(order->getPrice())) {
+            restOrder(order);
+        } else {
+            order->setStatus(OrderStatus::CANCELLED);
+        }
+    }
+}
+
+void OrderBook::matchIOCOrder(OrderHandle order, std::vector<Trade>& trades) {
+    executeMatches<OrderType::IOC>(order, trades);
     
     // IOC cancels unfilled portion
     if (order->getRemainingQuantity() > 0) {
         order->setStatus(OrderStatus::CANCELLED);
     }
-    
-    return trades;
 }
 
-std::vector<Trade> OrderBook::matchFOKOrder(OrderPtr order) {
-    std::vector<Trade> trades;
+void OrderBook::matchFOKOrder(OrderHandle order, std::vector<Trade>& trades) {
+    PriceLadder& levels = oppositeLadder(order->getSide());
     
     // Check if entire order can be filled
-    bool canFill = false;
-    if (order->getSide() == Side::BUY) {
-        canFill = canFillEntireOrder(order, asks_);
-    } else {
-        canFill = canFillEntireOrder(order, bids_);
-    }
-    
-    if (!canFill) {
+    if (!canFillEntireOrder(order, levels)) {
         order->setStatus(OrderStatus::CANCELLED);
-        return trades;
+        return;
     }
     
     // Execute the entire order
+    executeMatches<OrderType::FOK>(order, trades);
+}
+
+template <OrderType T>
+void OrderBook::executeMatches(OrderHandle order, std::vector<Trade>& trades) {
     if (order->getSide() == Side::BUY) {
-        trades = executeMatches(order, asks_, true);
+        executeMatches<Side::BUY, T>(order, trades);
     } else {
-        trades = executeMatches(order, bids_, true);
+        executeMatches<Side::SELL, T>(order, trades);
     }
-    
-    return trades;
 }
 
-// Match buy order against sell orders (asks)
-std::vector<Trade> OrderBook::executeMatches(
-    OrderPtr order, 
-    std::map<Price, PriceLevel, std::less<Price>>& levels,
-    bool fillEntireOrder) {
-    
-    std::vector<Trade> trades;
-    
-    auto it = levels.begin();
-    while (it != levels.end() && order->getRemainingQuantity() > 0) {
-        // Check price compatibility
-        if (order->getType() == OrderType::LIMIT) {
-            if (order->getSide() == Side::BUY && it->first > order->getPrice()) {
-                break;  // Ask price too high
-            }
+// Match an incoming order against the opposite side, best level first
+template <Side S, OrderType T>
+void OrderBook::executeMatches(OrderHandle order, std::vector<Trade>& trades) {
+    constexpr Side PASSIVE = S == Side::BUY ? Side::SELL : Side::BUY;
+    PriceLadder& levels = S == Side::BUY ? *asks_ : *bids_;
+    Quantity& passiveQuantity = S == Side::BUY ? askQuantity_ : bidQuantity_;
+    const OrderId orderId = order->getOrderId();
+    const SymbolId symbolId = order->getSymbolId();
+    
+    while (order->getRemainingQuantity() > 0) {
+        PriceLevel* level = levels.best();
+        if (!level) {
+            break;
         }
         
-        PriceLevel& level = it->second;
-        auto& orders = level.getOrders();
-        
-        auto orderIt = orders.begin();
-        while (orderIt != orders.end() && order->getRemainingQuantity() > 0) {
-            OrderPtr matchingOrder = *orderIt;
-            
-            // Calculate fill quantity
-            Quantity fillQty = std::min(order->getRemainingQuantity(), 
-                                       matchingOrder->getRemainingQuantity());
-            
-            // Create trade
-            Price tradePrice = matchingOrder->getPrice();  // Passive order price
-            Trade trade(
-                order->getSide() == Side::BUY ? order->getOrderId() : matchingOrder->getOrderId(),
-                order->getSide() == Side::SELL ? order->getOrderId() : matchingOrder->getOrderId(),
-                symbol_,
-                tradePrice,
-                fillQty,
-                getCurrentTimestamp()
-            );
-            trades.push_back(trade);
-            
-            // Update orders
-            order->fill(fillQty);
-            matchingOrder->fill(fillQty);
-            
-            // Remove filled orders
-            if (matchingOrder->isFilled()) {
-                orderIt = orders.erase(orderIt);
-                orderMap_.erase(matchingOrder->getOrderId());
-            } else {
-                ++orderIt;
-            }
-        }
-        
-        // Remove empty price level
-        if (level.isEmpty()) {
-            it = levels.erase(it);
-        } else {
-            ++it;
-        }
-    }
-    
-    return trades;
-}
-
-// Match sell order against buy orders (bids)
-std::vector<Trade> OrderBook::executeMatches(
-    OrderPtr order, 
-    std::map<Price, PriceLevel, std::greater<Price>>& levels,
-    bool fillEntireOrder) {
-    
-    std::vector<Trade> trades;
-    
-    auto it = levels.begin();
-    while (it != levels.end() && order->getRemainingQuantity() > 0) {
-        // Check price compatibility
-        if (order->getType() == OrderType::LIMIT) {
-            if (order->getSide() == Side::SELL && it->first < order->getPrice()) {
-                break;  // Bid price too low
+        // Only limits stop at their price; FOK quantity was checked up front
+        const Price price = level->getPrice();
+        if constexpr (T == OrderType::LIMIT) {
+            if (S == Side::BUY ? price > order->getPrice() : price < order->getPrice()) {
+                break;
             }
         }
         
-        PriceLevel& level = it->second;
-        auto& orders = level.getOrders();
-        
-        auto orderIt = orders.begin();
-        while (orderIt != orders.end() && order->getRemainingQuantity() > 0) {
-            OrderPtr matchingOrder = *orderIt;
+        // Every fill here is at the level's (passive) price, and at the time
+        // the aggressor was sequenced rather than the clock's, so a replica
+        // applying the same commands prints the same trades
+        const Timestamp timestamp = order->getTimestamp();
+        while (!level->isEmpty() && order->getRemainingQuantity() > 0) {
+            OrderSlot slot = level->front();
+            Order& matchingOrder = *slab_[slot].order;
+            OrderId matchingId = matchingOrder.getOrderId();
             
-            // Calculate fill quantity
-            Quantity fillQty = std::min(order->getRemainingQuantity(), 
-                                       matchingOrder->getRemainingQuantity());
-            
-            // Create trade
-            Price tradePrice = matchingOrder->getPrice();  // Passive order price
-            Trade trade(
-                order->getSide() == Side::BUY ? order->getOrderId() : matchingOrder->getOrderId(),
-                order->getSide() == Side::SELL ? order->getOrderId() : matchingOrder->getOrderId(),
-                symbol_,
-                tradePrice,
-                fillQty,
-                getCurrentTimestamp()
-            );
-            trades.push_back(trade);
+            Quantity fillQty = std::min(order->getRemainingQuantity(),
+                                        matchingOrder.getRemainingQuantity());
+            if constexpr (S == Side::BUY) {
+                trades.emplace_back(orderId, matchingId, symbolId, price, fillQty, timestamp);
+            } else {
+                trades.emplace_back(matchingId, orderId, symbolId, price, fillQty, timestamp);
+            }
             
-            // Update orders
             order->fill(fillQty);
-            matchingOrder->fill(fillQty);
+            matchingOrder.fill(fillQty);
+            level->reduceQuantity(fillQty);
+            passiveQuantity -= fillQty;
             
             // Remove filled orders
-            if (matchingOrder->isFilled()) {
-                orderIt = orders.erase(orderIt);
-                orderMap_.erase(matchingOrder->getOrderId());
-            } else {
-                ++orderIt;
+            if (matchingOrder.isFilled()) {
+                level->popFront(slab_);
+                orderIndex_.erase(matchingId);
+                slab_.release(slot);
+                retire(matchingOrder);
             }
         }
         
         // Remove empty price level
-        if (level.isEmpty()) {
-            it = levels.erase(it);
-        } else {
-            ++it;
+        if (level->isEmpty()) {
+            levels.erase(price);
+            level = nullptr;
         }
+        publishLevel(PASSIVE, price, level);
     }
-    
-    return trades;
 }
 
-bool OrderBook::canFillEntireOrder(
-    OrderPtr order, 
-    const std::map<Price, PriceLevel, std::less<Price>>& levels) const {
-    
-    Quantity availableQty = 0;
-    
-    for (const auto& [price, level] : levels) {
-        // Check price compatibility for limit orders
-        if (order->getType() == OrderType::LIMIT || order->getType() == OrderType::FOK) {
-            if (order->getSide() == Side::BUY && price > order->getPrice()) {
-                break;
-            }
-        }
-        
-        availableQty += level.getTotalQuantity();
-        
-        if (availableQty >= order->getRemainingQuantity()) {
-            return true;
-        }
+bool OrderBook::canFillEntireOrder(OrderHandle order, const PriceLadder& levels) const {
+    Quantity needed = order->getRemainingQuantity();
+    Quantity available = order->getSide() == Side::BUY ? askQuantity_ : bidQuantity_;
+    if (available < needed) {
+        return false;
     }
     
-    return false;
-}
-
-bool OrderBook::canFillEntireOrder(
-    OrderPtr order, 
-    const std::map<Price, PriceLevel, std::greater<Price>>& levels) const {
-    
-    Quantity availableQty = 0;
-    
-    for (const auto& [price, level] : levels) {
-        // Check price compatibility for limit orders
-        if (order->getType() == OrderType::LIMIT || order->getType() == OrderType::FOK) {
-            if (order->getSide() == Side::SELL && price < order->getPrice()) {
-                break;
-            }
-        }
-        
-        availableQty += level.getTotalQuantity();
-        
-        if (availableQty >= order->getRemainingQuantity()) {
-            return true;
-        }
+    // Unpriced, or priced through the whole side: the side total decides
+    const PriceLevel* worst = levels.worst();
+    if (order->getType() == OrderType::MARKET ||
+        (worst && levels.within(worst->getPrice(), order->getPrice()))) {
+        return true;
     }
-    
-    return false;
+    return levels.depthThrough(order->getPrice(), needed) >= needed;
 }
 
 Price OrderBook::getBestBid() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return bids_.empty() ? 0 : bids_.begin()->first;
+    return topOfBook_.best(Side::BUY);
 }
 
 Price OrderBook::getBestAsk() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return asks_.empty() ? 0 : asks_.begin()->first;
+    return topOfBook_.best(Side::SELL);
 }
 
 Quantity OrderBook::getBidQuantityAtLevel(Price price) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = bids_.find(price);
-    return it != bids_.end() ? it->second.getTotalQuantity() : 0;
+    return levelQuantity(*bids_, Side::BUY, price);
 }
 
 Quantity OrderBook::getAskQuantityAtLevel(Price price) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = asks_.find(price);
-    return it != asks_.end() ? it->second.getTotalQuantity() : 0;
+    return levelQuantity(*asks_, Side::SELL, price);
 }
 
-std::vector<std::pair<Price, Quantity>> OrderBook::getBidDepth(size_t levels) const {
-    std::lock_guard<std::mutex> lock(mutex_);
+Quantity OrderBook::levelQuantity(const PriceLadder& ladder, Side side, Price price) const {
+    BookTop top = topOfBook_.read();
+    const BookTop::Level* levels = side == Side::BUY ? top.bids : top.asks;
+    size_t count = side == Side::BUY ? top.bidLevels : top.askLevels;
+    for (size_t i = 0; i < count; ++i) {
+        if (levels[i].price == price) {
+            return levels[i].quantity;
+        }
+    }
+    if (count < BookTop::DEPTH) {
+        return 0;  // The top is the whole side
+    }
+    
+    // Below the top - walk the ladder
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    const PriceLevel* level = ladder.find(price);
+    return level ? level->getTotalQuantity() : 0;
+}
+
+Quantity OrderBook::getSideQuantity(Side side) const {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    return side == Side::BUY ? bidQuantity_ : askQuantity_;
+}
+
+std::vector<std::pair<Price, Quantity>> OrderBook::collectDepth(
+    const PriceLadder& ladder, size_t levels) {
     std::vector<std::pair<Price, Quantity>> depth;
     
-    size_t count = 0;
-    for (const auto& [price, level] : bids_) {
-        if (count >= levels) break;
-        depth.emplace_back(price, level.getTotalQuantity());
-        ++count;
+    for (const PriceLevel* level = ladder.best();
+         level && depth.size() < levels;
+         level = ladder.next(level->getPrice())) {
+        depth.emplace_back(level->getPrice(), level->getTotalQuantity());
     }
     
     return depth;
 }
 
-std::vector<std::pair<Price, Quantity>> OrderBook::getAskDepth(size_t levels) const {
-    std::lock_guard<std::mutex> lock(mutex_);
+std::vector<std::pair<Price, Quantity>> OrderBook::topDepth(const BookTop::Level* top,
+                                                            size_t count, size_t levels) {
     std::vector<std::pair<Price, Quantity>> depth;
-    
-    size_t count = 0;
-    for (const auto& [price, level] : asks_) {
-        if (count >= levels) break;
-        depth.emplace_back(price, level.getTotalQuantity());
-        ++count;
+    depth.reserve(std::min(count, levels));
+    for (size_t i = 0; i < count && i < levels; ++i) {
+        depth.emplace_back(top[i].price, top[i].quantity);
     }
-    
     return depth;
 }
 
+std::vector<std::pair<Price, Quantity>> OrderBook::getBidDepth(size_t levels) const {
+    if (levels <= BookTop::DEPTH) {
+        BookTop top = topOfBook_.read();
+        return topDepth(top.bids, top.bidLevels, levels);
+    }
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    return collectDepth(*bids_, levels);
+}
+
+std::vector<std::pair<Price, Quantity>> OrderBook::getAskDepth(size_t levels) const {
+    if (levels <= BookTop::DEPTH) {
+        BookTop top = topOfBook_.read();
+        return topDepth(top.asks, top.askLevels, levels);
+    }
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    return collectDepth(*asks_, levels);
+}
+
 void OrderBook::printBook(size_t levels) const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<OptionalMutex> lock(mutex_);
     
     std::cout << "\n=== Order Book: " << symbol_ << " ===\n";
     std::cout << std::fixed << std::setprecision(4);
     
     // Print asks (inverted order for visual appeal)
-    auto askDepth = getAskDepth(levels);
+    auto askDepth = collectDepth(*asks_, levels);
     for (auto it = askDepth.rbegin(); it != askDepth.rend(); ++it) {
         std::cout << "        "
                   << std::setw(10) << priceToDouble(it->first) << " | "
@@ -486,7 +729,7 @@ void OrderBook::printBook(size_t levels) const {
     std::cout << "        " << std::string(30, '-') << "\n";
     
     // Print bids
-    auto bidDepth = getBidDepth(levels);
+    auto bidDepth = collectDepth(*bids_, levels);
     for (const auto& [price, qty] : bidDepth) {
         std::cout << "    BID "
                   << std::setw(8) << qty << " | "
@@ -496,5 +739,25 @@ void OrderBook::printBook(size_t levels) const {
     std::cout << "==============================\n\n";
 }
 
-} // namespace MatchingEngine
+void OrderBook::collectOrders(std::vector<Order>& out) const {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    out.reserve(out.size() + orderIndex_.size() + stopIndex_.size());
+    collectLadder(*bids_, out);
+    collectLadder(*asks_, out);
+    for (const auto& entry : buyStops_) {
+        out.push_back(*entry.second);
+    }
+    for (const auto& entry : sellStops_) {
+        out.push_back(*entry.second);
+    }
+}
 
+void OrderBook::collectLadder(const PriceLadder& ladder, std::vector<Order>& out) const {
+    for (const PriceLevel* level = ladder.best(); level; level = ladder.next(level->getPrice())) {
+        for (OrderSlot slot = level->front(); slot != INVALID_SLOT; slot = slab_[slot].next) {
+            out.push_back(*slab_[slot].order);
+        }
+    }
+}
+
+} // namespace MatchingEngine
@@ -0,0 +1,250 @@
+#include "PriceLadder.h"
+#include <algorithm>
+
+namespace MatchingEngine {
+
+// PriceLevel implementation
+void PriceLevel::pushBack(OrderSlab& slab, OrderSlot slot) {
+    RestingOrder& record = slab[slot];
+    record.prev = tail_;
+    record.next = INVALID_SLOT;
+    
+    if (tail_ != INVALID_SLOT) {
+        slab[tail_].next = slot;
+    } else {
+        head_ = slot;
+    }
+    tail_ = slot;
+    
+    ++orderCount_;
+    totalQuantity_ += record.order->getRemainingQuantity();
+}
+
+void PriceLevel::remove(OrderSlab& slab, OrderSlot slot) {
+    RestingOrder& record = slab[slot];
+    
+    if (record.prev != INVALID_SLOT) {
+        slab[record.prev].next = record.next;
+    } else {
+        head_ = record.next;
+    }
+    if (record.next != INVALID_SLOT) {
+        slab[record.next].prev = record.prev;
+    } else {
+        tail_ = record.prev;
+    }
+    
+    --orderCount_;
+    totalQuantity_ -= record.order->getRemainingQuantity();
+}
+
+// ArrayPriceLadder implementation
+ArrayPriceLadder::ArrayPriceLadder(Side side, Price tickSize, size_t levels, size_t maxLevels)
+    : side_(side)
+    , tickSize_(tickSize > 0 ? tickSize : 1)
+    , basePrice_(0)
+    , levels_(std::max<size_t>(levels, 2))
+    , maxLevels_(std::max(maxLevels, levels_.size()))
+    , lowIndex_(0)
+    , highIndex_(0)
+    , levelCount_(0) {
+}
+
+bool ArrayPriceLadder::accepts(Price price) const {
+    if (levelCount_ == 0 || inWindow(price)) {
+        return true;
+    }
+    Price low = std::min(priceAt(lowIndex_), price);
+    Price high = std::max(priceAt(highIndex_), price);
+    return ticksBetween(low, high) < maxLevels_;
+}
+
+PriceLevel* ArrayPriceLadder::find(Price price) {
+    if (levelCount_ == 0 || !inWindow(price)) {
+        return nullptr;
+    }
+    PriceLevel& level = levels_[indexOf(price)];
+    return level.isEmpty() ? nullptr : &level;
+}
+
+const PriceLevel* ArrayPriceLadder::find(Price price) const {
+    if (levelCount_ == 0 || !inWindow(price)) {
+        return nullptr;
+    }
+    const PriceLevel& level = levels_[indexOf(price)];
+    return level.isEmpty() ? nullptr : &level;
+}
+
+PriceLevel& ArrayPriceLadder::getOrCreate(Price price) {
+    if (!inWindow(price)) {
+        recenter(price);
+    }
+
+    size_t index = indexOf(price);
+    PriceLevel& level = levels_[index];
+    if (!level.isEmpty()) {
+        return level;
+    }
+
+    level = PriceLevel(price);
+    if (levelCount_ == 0) {
+        lowIndex_ = highIndex_ = index;
+    } else {
+        lowIndex_ = std::min(lowIndex_, index);
+        highIndex_ = std::max(highIndex_, index);
+    }
+    ++levelCount_;
+    return level;
+}
+
+void ArrayPriceLadder::erase(Price price) {
+    if (levelCount_ == 0 || !inWindow(price)) {
+        return;
+    }
+
+    size_t index = indexOf(price);
+    if (!levels_[index].isEmpty() || index < lowIndex_ || index > highIndex_) {
+        return;
+    }
+
+    if (--levelCount_ == 0) {
+        return;
+    }
+
+    // Walk the occupied bound inward to the next live level
+    if (index == lowIndex_) {
+        while (levels_[lowIndex_].isEmpty()) {
+            ++lowIndex_;
+        }
+    }
+    if (index == highIndex_) {
+        while (levels_[highIndex_].isEmpty()) {
+            --highIndex_;
+        }
+    }
+}
+
+PriceLevel* ArrayPriceLadder::best() {
+    if (levelCount_ == 0) {
+        return nullptr;
+    }
+    return &levels_[side_ == Side::BUY ? highIndex_ : lowIndex_];
+}
+
+const PriceLevel* ArrayPriceLadder::best() const {
+    if (levelCount_ == 0) {
+        return nullptr;
+    }
+    return &levels_[side_ == Side::BUY ? highIndex_ : lowIndex_];
+}
+
+const PriceLevel* ArrayPriceLadder::next(Price price) const {
+    if (levelCount_ == 0) {
+        return nullptr;
+    }
+
+    if (side_ == Side::BUY) {
+        // Next lower bid
+        if (price <= priceAt(lowIndex_)) {
+            return nullptr;
+        }
+        size_t index = price > priceAt(highIndex_) ? highIndex_ : indexOf(price) - 1;
+        while (index > lowIndex_ && levels_[index].isEmpty()) {
+            --index;
+        }
+        return levels_[index].isEmpty() ? nullptr : &levels_[index];
+    }
+
+    // Next higher ask
+    if (price >= priceAt(highIndex_)) {
+        return nullptr;
+    }
+    size_t index = price < priceAt(lowIndex_) ? lowIndex_ : indexOf(price) + 1;
+    while (index < highIndex_ && levels_[index].isEmpty()) {
+        ++index;
+    }
+    return levels_[index].isEmpty() ? nullptr : &levels_[index];
+}
+
+const PriceLevel* ArrayPriceLadder::worst() const {
+    if (levelCount_ == 0) {
+        return nullptr;
+    }
+    return &levels_[side_ == Side::BUY ? lowIndex_ : highIndex_];
+}
+
+Quantity ArrayPriceLadder::depthThrough(Price limit, Quantity enough) const {
+    Quantity total = 0;
+    if (levelCount_ == 0) {
+        return total;
+    }
+
+    // Index walk from the best slot toward the limit
+    bool buy = side_ == Side::BUY;
+    size_t index = buy ? highIndex_ : lowIndex_;
+    size_t end = buy ? lowIndex_ : highIndex_;
+    while (within(priceAt(index), limit)) {
+        total += levels_[index].getTotalQuantity();  // 0 for an empty slot
+        if (total >= enough || index == end) {
+            break;
+        }
+        index = buy ? index - 1 : index + 1;
+    }
+    return total;
+}
+
+void ArrayPriceLadder::recenter(Price price) {
+    size_t capacity = levels_.size();
+
+    if (levelCount_ == 0) {
+        basePrice_ = price - static_cast<Price>(capacity / 2) * tickSize_;
+        return;
+    }
+
+    // Occupied range that the new window has to cover
+    Price low = std::min(priceAt(lowIndex_), price);
+    Price high = std::max(priceAt(highIndex_), price);
+    size_t span = static_cast<size_t>(ticksBetween(low, high)) + 1;  // accepts() bounds it
+
+    // Keep at least half the window free so drift doesn't re-center every
+    // order, short of growing past maxLevels_
+    size_t newCapacity = capacity;
+    while (newCapacity < span * 2 && newCapacity < maxLevels_) {
+        newCapacity *= 2;
+    }
+    newCapacity = std::min(newCapacity, maxLevels_);
+
+    Price newBase = low - static_cast<Price>((newCapacity - span) / 2) * tickSize_;
+    size_t oldLow = lowIndex_;
+    size_t oldHigh = highIndex_;
+    Price oldBase = basePrice_;
+    basePrice_ = newBase;
+    lowIndex_ = indexOf(oldBase + static_cast<Price>(oldLow) * tickSize_);
+    highIndex_ = indexOf(oldBase + static_cast<Price>(oldHigh) * tickSize_);
+
+    if (newCapacity != capacity) {
+        std::vector<PriceLevel> levels(newCapacity);
+        for (size_t i = oldLow; i <= oldHigh; ++i) {
+            levels[lowIndex_ + (i - oldLow)] = std::move(levels_[i]);
+        }
+        levels_.swap(levels);
+        return;
+    }
+
+    // Same capacity - shift the occupied range in place
+    if (lowIndex_ > oldLow) {
+        size_t shift = lowIndex_ - oldLow;
+        for (size_t i = oldHigh + 1; i-- > oldLow;) {
+            levels_[i + shift] = std::move(levels_[i]);
+            levels_[i] = PriceLevel();
+        }
+    } else if (lowIndex_ < oldLow) {
+        size_t shift = oldLow - lowIndex_;
+        for (size_t i = oldLow; i <= oldHigh; ++i) {
+            levels_[i - shift] = std::move(levels_[i]);
+            levels_[i] = PriceLevel();
+        }
+    }
+}
+
+} // namespace MatchingEngine
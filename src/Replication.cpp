@@ -0,0 +1,432 @@
+#include "Replication.h"
+#include "ThreadUtil.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+
+namespace MatchingEngine {
+
+namespace {
+
+constexpr size_t SENDER_BATCH_SIZE = 256;
+constexpr size_t SENDER_SPIN_ITERATIONS = 1000;
+constexpr int ATTACH_TIMEOUT_MS = 1000;
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;  // A peer going away is an error, not SIGPIPE
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+JournalRecord heartbeat() {
+    JournalRecord record;
+    std::memset(&record, 0, sizeof(record));
+    return record;
+}
+
+void setReceiveTimeout(SocketType socket, uint32_t milliseconds) {
+#ifdef _WIN32
+    DWORD timeout = milliseconds;
+#else
+    timeval timeout{static_cast<time_t>(milliseconds / 1000),
+                    static_cast<suseconds_t>((milliseconds % 1000) * 1000)};
+#endif
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
+void setNoDelay(SocketType socket) {
+    int noDelay = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+}
+
+void shutdownSocket(SocketType socket) {
+#ifdef _WIN32
+    shutdown(socket, SD_BOTH);
+#else
+    shutdown(socket, SHUT_RDWR);
+#endif
+}
+
+} // namespace
+
+ReplicationPublisher::ReplicationPublisher(uint16_t port, uint32_t heartbeatIntervalMs,
+                                           size_t queueCapacity)
+    : port_(port)
+    , heartbeatIntervalMs_(heartbeatIntervalMs)
+    , queue_(queueCapacity)
+    , listenSocket_(INVALID_SOCKET)
+    , standbySocket_(INVALID_SOCKET)
+    , running_(false)
+    , state_(WAITING)
+    , published_(0)
+    , acked_(0) {
+}
+
+ReplicationPublisher::~ReplicationPublisher() {
+    stop();
+}
+
+bool ReplicationPublisher::start() {
+    if (running_) {
+        return false;
+    }
+
+    listenSocket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket_ == INVALID_SOCKET) {
+        return false;
+    }
+    int opt = 1;
+    setsockopt(listenSocket_, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port_);
+    if (bind(listenSocket_, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+        listen(listenSocket_, 1) == SOCKET_ERROR) {
+        std::cerr << "Failed to listen for a standby on port " << port_ << std::endl;
+        closesocket(listenSocket_);
+        listenSocket_ = INVALID_SOCKET;
+        return false;
+    }
+
+    // Port 0 asks the OS for a free port
+    sockaddr_in bound{};
+    socklen_t boundLength = sizeof(bound);
+    if (getsockname(listenSocket_, (sockaddr*)&bound, &boundLength) == 0) {
+        port_ = ntohs(bound.sin_port);
+    }
+
+    running_ = true;
+    senderThread_ = std::thread(&ReplicationPublisher::runSender, this);
+    acceptThread_ = std::thread(&ReplicationPublisher::runAcceptor, this);
+    return true;
+}
+
+void ReplicationPublisher::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    // The sender drains the queue and exits; then the standby sees the
+    // stream close, and the acceptor's blocking calls return
+    if (senderThread_.joinable()) {
+        senderThread_.join();
+    }
+    shutdownSocket(listenSocket_);
+    if (standbySocket_ != INVALID_SOCKET) {
+        shutdownSocket(standbySocket_);
+    }
+    if (acceptThread_.joinable()) {
+        acceptThread_.join();
+    }
+    closesocket(listenSocket_);
+    listenSocket_ = INVALID_SOCKET;
+    if (standbySocket_ != INVALID_SOCKET) {
+        closesocket(standbySocket_);
+        standbySocket_ = INVALID_SOCKET;
+    }
+    state_ = DETACHED;
+}
+
+uint64_t ReplicationPublisher::publish(const EngineCommand& command) {
+    State state = state_.load(std::memory_order_acquire);
+    if (state == WAITING) {
+        std::lock_guard<std::mutex> lock(attachMutex_);
+        state = state_.load(std::memory_order_relaxed);
+        if (state == WAITING) {
+            std::cerr << "No standby attached before the first command - running unreplicated"
+                      << std::endl;
+            state_ = state = DETACHED;
+        }
+    }
+    if (state != ATTACHED) {
+        return 0;
+    }
+
+    // Back-pressure: the standby is behind by a whole queue
+    JournalRecord record = JournalRecord::fromCommand(command);
+    size_t position;
+    while (!queue_.tryPush(record, &position)) {
+        std::this_thread::yield();
+    }
+
+    uint64_t sequence = position + 1;
+    uint64_t seen = published_.load(std::memory_order_relaxed);
+    while (seen < sequence &&
+           !published_.compare_exchange_weak(seen, sequence, std::memory_order_acq_rel)) {
+    }
+    return sequence;
+}
+
+void ReplicationPublisher::runAcceptor() {
+    while (running_) {
+        sockaddr_in peer{};
+        socklen_t peerLength = sizeof(peer);
+        SocketType socket = accept(listenSocket_, (sockaddr*)&peer, &peerLength);
+        if (socket == INVALID_SOCKET) {
+            if (running_) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            continue;
+        }
+        if (!attach(socket)) {
+            closesocket(socket);
+            continue;
+        }
+
+        readAcks();
+        state_ = DETACHED;
+        if (running_) {
+            std::cerr << "Lost the standby - running unreplicated" << std::endl;
+        }
+        if (ackCallback_) {
+            ackCallback_(acked_.load(std::memory_order_acquire), false);
+        }
+    }
+}
+
+bool ReplicationPublisher::attach(SocketType socket) {
+    std::lock_guard<std::mutex> lock(attachMutex_);
+    if (state_.load(std::memory_order_relaxed) != WAITING) {
+        std::cerr << "Refused a standby: commands were sequenced without one" << std::endl;
+        return false;
+    }
+
+    // The first heartbeat tells the standby it is attached; nothing else
+    // is sending until state_ says so
+    setNoDelay(socket);
+    standbySocket_ = socket;
+    JournalRecord accepted = heartbeat();
+    if (!sendAll(&accepted, sizeof(accepted))) {
+        standbySocket_ = INVALID_SOCKET;
+        return false;
+    }
+    state_.store(ATTACHED, std::memory_order_release);
+    return true;
+}
+
+void ReplicationPublisher::readAcks() {
+    uint64_t ack;
+    size_t filled = 0;
+    for (;;) {
+        int received = recv(standbySocket_, reinterpret_cast<char*>(&ack) + filled,
+                            static_cast<int>(sizeof(ack) - filled), 0);
+        if (received <= 0) {
+            return;
+        }
+        filled += static_cast<size_t>(received);
+        if (filled < sizeof(ack)) {
+            continue;
+        }
+        filled = 0;
+        if (ack > acked_.load(std::memory_order_relaxed)) {
+            acked_.store(ack, std::memory_order_release);
+            if (ackCallback_) {
+                ackCallback_(ack, true);
+            }
+        }
+    }
+}
+
+void ReplicationPublisher::runSender() {
+    std::vector<JournalRecord> batch(SENDER_BATCH_SIZE);
+    uint64_t sentSequence = 0;
+    auto heartbeatInterval = std::chrono::milliseconds(heartbeatIntervalMs_);
+    auto lastSend = std::chrono::steady_clock::now();
+    size_t idlePolls = 0;
+
+    for (;;) {
+        // Read the flag first so nothing pushed before stop() is missed
+        bool stopping = !running_.load(std::memory_order_acquire);
+        size_t count = queue_.popBatch(batch.data(), batch.size());
+        bool attached = hasStandby();
+
+        if (count > 0) {
+            for (size_t i = 0; i < count; ++i) {
+                batch[i].stamp(++sentSequence);
+            }
+            // One send per batch; a standby that can't keep up fails the link
+            if (attached && !sendAll(batch.data(), count * sizeof(JournalRecord))) {
+                shutdownSocket(standbySocket_);
+            }
+            lastSend = std::chrono::steady_clock::now();
+            idlePolls = 0;
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (attached && now - lastSend >= heartbeatInterval) {
+            JournalRecord beat = heartbeat();
+            if (!sendAll(&beat, sizeof(beat))) {
+                shutdownSocket(standbySocket_);
+            }
+            lastSend = now;
+        }
+        if (++idlePolls < SENDER_SPIN_ITERATIONS) {
+            cpuRelax();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+bool ReplicationPublisher::sendAll(const void* data, size_t length) {
+    const char* bytes = static_cast<const char*>(data);
+    size_t sent = 0;
+    while (sent < length) {
+        int written = send(standbySocket_, bytes + sent, static_cast<int>(length - sent),
+                           SEND_FLAGS);
+        if (written == SOCKET_ERROR) {
+            return false;
+        }
+        sent += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+ReplicationReceiver::ReplicationReceiver(const std::string& primaryHost, uint16_t primaryPort,
+                                         uint32_t failoverTimeoutMs)
+    : primaryHost_(primaryHost)
+    , primaryPort_(primaryPort)
+    , failoverTimeoutMs_(failoverTimeoutMs)
+    , socket_(INVALID_SOCKET)
+    , running_(false)
+    , applied_(0) {
+}
+
+ReplicationReceiver::~ReplicationReceiver() {
+    stop();
+}
+
+bool ReplicationReceiver::start(ApplyHandler apply, FailoverHandler failover) {
+    if (running_) {
+        return false;
+    }
+
+    socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (socket_ == INVALID_SOCKET) {
+        return false;
+    }
+    sockaddr_in primary{};
+    primary.sin_family = AF_INET;
+    primary.sin_port = htons(primaryPort_);
+#ifdef _WIN32
+    primary.sin_addr.s_addr = inet_addr(primaryHost_.c_str());
+#else
+    inet_pton(AF_INET, primaryHost_.c_str(), &primary.sin_addr);
+#endif
+    if (::connect(socket_, (sockaddr*)&primary, sizeof(primary)) == SOCKET_ERROR) {
+        closesocket(socket_);
+        socket_ = INVALID_SOCKET;
+        return false;
+    }
+    setNoDelay(socket_);
+
+    // Attached once the primary's first heartbeat arrives; a primary that
+    // refuses closes instead
+    setReceiveTimeout(socket_, ATTACH_TIMEOUT_MS);
+    JournalRecord accepted;
+    size_t filled = 0;
+    while (filled < sizeof(accepted)) {
+        int received = recv(socket_, reinterpret_cast<char*>(&accepted) + filled,
+                            static_cast<int>(sizeof(accepted) - filled), 0);
+        if (received <= 0) {
+            closesocket(socket_);
+            socket_ = INVALID_SOCKET;
+            return false;
+        }
+        filled += static_cast<size_t>(received);
+    }
+    if (accepted.sequence != 0) {
+        closesocket(socket_);
+        socket_ = INVALID_SOCKET;
+        return false;
+    }
+
+    // Silence for this long is the primary failing
+    setReceiveTimeout(socket_, failoverTimeoutMs_);
+    apply_ = std::move(apply);
+    failover_ = std::move(failover);
+    running_ = true;
+    thread_ = std::thread(&ReplicationReceiver::run, this);
+    return true;
+}
+
+void ReplicationReceiver::stop() {
+    // Unless the thread already finished by failing over
+    if (running_.exchange(false)) {
+        shutdownSocket(socket_);
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (socket_ != INVALID_SOCKET) {
+        closesocket(socket_);
+        socket_ = INVALID_SOCKET;
+    }
+}
+
+void ReplicationReceiver::run() {
+    std::vector<JournalRecord> records(256);
+    char* buffer = reinterpret_cast<char*>(records.data());
+    const size_t capacity = records.size() * sizeof(JournalRecord);
+    size_t filled = 0;
+    bool damaged = false;
+
+    for (;;) {
+        int received = recv(socket_, buffer + filled, static_cast<int>(capacity - filled), 0);
+        if (received <= 0) {
+            break;  // Closed, or silent past the failover timeout
+        }
+        filled += static_cast<size_t>(received);
+
+        // Apply the whole records received, then acknowledge them together
+        size_t complete = filled / sizeof(JournalRecord);
+        uint64_t applied = applied_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < complete; ++i) {
+            const JournalRecord& record = records[i];
+            if (record.sequence == 0) {
+                continue;  // Heartbeat
+            }
+            EngineCommand command;
+            if (record.sequence != applied + 1 || !record.toCommand(command)) {
+                damaged = true;
+                break;
+            }
+            apply_(command);
+            applied = record.sequence;
+        }
+        if (damaged) {
+            break;
+        }
+        applied_.store(applied, std::memory_order_release);
+        send(socket_, (const char*)&applied, sizeof(applied), SEND_FLAGS);
+
+        filled -= complete * sizeof(JournalRecord);
+        std::memmove(buffer, buffer + complete * sizeof(JournalRecord), filled);
+    }
+
+    if (!running_.exchange(false)) {
+        return;  // stop() asked
+    }
+    if (damaged) {
+        // Taking over would serve books that differ from the primary's
+        std::cerr << "Replication stream damaged after sequence " << applied_.load()
+                  << " - standby stopped" << std::endl;
+        return;
+    }
+    if (failover_) {
+        failover_();
+    }
+}
+
+} // namespace MatchingEngine
@@ -0,0 +1,277 @@
+#include "RiskCheck.h"
+#include <chrono>
+
+namespace MatchingEngine {
+
+namespace {
+
+constexpr int64_t BPS = 10000;
+
+int64_t currentSecond() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Retires a burst of matching can queue before one has to wait for the lock
+constexpr size_t RETIRED_CAPACITY = 4096;
+
+} // namespace
+
+RiskCheck::RiskCheck(bool synchronized)
+    : enabled_(false)
+    , retired_(RETIRED_CAPACITY)
+    , mutex_(synchronized) {
+}
+
+void RiskCheck::setDefaultLimits(const RiskLimits& limits) {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    defaultLimits_ = limits;
+    if (limits.any()) {
+        enabled_ = true;
+    }
+}
+
+void RiskCheck::setClientLimits(ClientKey clientKey, const RiskLimits& limits) {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    ClientState& state = client(clientKey);
+    state.limits = limits;
+    state.hasLimits = true;
+    if (limits.any()) {
+        enabled_ = true;
+    }
+}
+
+void RiskCheck::setReferencePrice(SymbolId symbolId, Price price) {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    if (symbolId >= references_.size()) {
+        references_.resize(symbolId + 1, 0);
+    }
+    references_[symbolId] = price;
+}
+
+Price RiskCheck::getReferencePrice(SymbolId symbolId) const {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    return symbolId < references_.size() ? references_[symbolId] : 0;
+}
+
+RiskCheck::ClientState& RiskCheck::client(ClientKey clientKey) {
+    if (clientKey >= clients_.size()) {
+        clients_.resize(clientKey + 1);
+    }
+    return clients_[clientKey];
+}
+
+uint64_t RiskCheck::notionalOf(SymbolId symbolId, Price price, Price stopPrice,
+                               Quantity quantity) const {
+    // Market-priced orders are valued where they would be expected to trade
+    if (price <= 0) {
+        price = stopPrice > 0 ? stopPrice
+                              : (symbolId < references_.size() ? references_[symbolId] : 0);
+    }
+    return static_cast<uint64_t>(price) * quantity;
+}
+
+RejectReason RiskCheck::check(const EngineCommand& command) {
+    if (!isEnabled() || command.type != CommandType::NEW_ORDER) {
+        return RejectReason::NONE;
+    }
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    applyRetired();
+    ClientState& state = client(command.clientKey);
+    const RiskLimits& limits = state.hasLimits ? state.limits : defaultLimits_;
+
+    if (limits.maxOrdersPerSecond) {
+        int64_t second = currentSecond();
+        if (second != state.windowSecond) {
+            state.windowSecond = second;
+            state.windowOrders = 0;
+        }
+        if (++state.windowOrders > limits.maxOrdersPerSecond) {
+            return RejectReason::RISK_ORDER_RATE;
+        }
+    }
+
+    Working order;
+    order.clientKey = command.clientKey;
+    order.symbolId = command.symbolId;
+    order.side = command.side;
+    order.quantity = command.quantity;
+    order.notional = notionalOf(command.symbolId, command.price, command.stopPrice,
+                                command.quantity);
+    return checkLimits(limits, state, order, command.price, nullptr);
+}
+
+RejectReason RiskCheck::checkModify(const Order& current, Price newPrice, Quantity newQuantity) {
+    if (!isEnabled()) {
+        return RejectReason::NONE;
+    }
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    applyRetired();
+    const Working* held = working_.find(current.getOrderId());
+    if (!held) {
+        return RejectReason::NONE;  // Accepted before any limit was set
+    }
+    ClientState& state = client(held->clientKey);
+    const RiskLimits& limits = state.hasLimits ? state.limits : defaultLimits_;
+
+    // What the order would hold once amended, as onModify will count it
+    Working amended = *held;
+    amended.quantity = current.getFilledQuantity() + newQuantity;
+    amended.notional = notionalOf(held->symbolId, newPrice, current.getStopPrice(),
+                                  amended.quantity);
+    return checkLimits(limits, state, amended, newPrice, held);
+}
+
+RejectReason RiskCheck::checkLimits(const RiskLimits& limits, const ClientState& state,
+                                    const Working& order, Price price,
+                                    const Working* replaced) const {
+    if (limits.maxOrderQuantity && order.quantity > limits.maxOrderQuantity) {
+        return RejectReason::RISK_ORDER_SIZE;
+    }
+
+    // Fat finger: a limit price far from where the symbol last traded
+    Price reference = order.symbolId < references_.size() ? references_[order.symbolId] : 0;
+    if (limits.priceBandBps && reference > 0 && price > 0) {
+        Price distance = price > reference ? price - reference : reference - price;
+        if (distance * BPS > reference * static_cast<int64_t>(limits.priceBandBps)) {
+            return RejectReason::RISK_PRICE_BAND;
+        }
+    }
+
+    if (limits.maxOrderNotional && order.notional > limits.maxOrderNotional) {
+        return RejectReason::RISK_ORDER_NOTIONAL;
+    }
+    uint64_t openNotional = state.openNotional - (replaced ? replaced->notional : 0);
+    if (limits.maxOpenNotional && openNotional + order.notional > limits.maxOpenNotional) {
+        return RejectReason::RISK_OPEN_NOTIONAL;
+    }
+
+    if (limits.maxPosition) {
+        const PositionState* position = positions_.find(positionKey(order.clientKey,
+                                                                    order.symbolId));
+        int64_t filled = position ? position->filled : 0;
+        Quantity working = position ? (order.side == Side::BUY ? position->workingBuy
+                                                               : position->workingSell)
+                                    : 0;
+        working = working - (replaced ? replaced->quantity : 0) + order.quantity;
+        int64_t extent = order.side == Side::BUY ? filled + static_cast<int64_t>(working)
+                                                 : static_cast<int64_t>(working) - filled;
+        if (extent > static_cast<int64_t>(limits.maxPosition)) {
+            return RejectReason::RISK_POSITION;
+        }
+    }
+    return RejectReason::NONE;
+}
+
+void RiskCheck::onAccept(const Order& order) {
+    if (!isEnabled()) {
+        return;
+    }
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    Working working;
+    working.clientKey = order.getClientKey();
+    working.symbolId = order.getSymbolId();
+    working.side = order.getSide();
+    working.quantity = order.getQuantity();
+    working.notional = notionalOf(working.symbolId, order.getPrice(), order.getStopPrice(),
+                                  working.quantity);
+    working_.insert(order.getOrderId(), working);
+
+    client(working.clientKey).openNotional += working.notional;
+    uint64_t key = positionKey(working.clientKey, working.symbolId);
+    PositionState* position = positions_.find(key);
+    if (!position) {
+        positions_.insert(key, PositionState());
+        position = positions_.find(key);
+    }
+    (working.side == Side::BUY ? position->workingBuy : position->workingSell) += working.quantity;
+}
+
+void RiskCheck::onModify(const Order& order) {
+    if (!isEnabled()) {
+        return;
+    }
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    Working* working = working_.find(order.getOrderId());
+    if (!working) {
+        return;
+    }
+    uint64_t notional = notionalOf(working->symbolId, order.getPrice(), order.getStopPrice(),
+                                   order.getQuantity());
+    ClientState& state = client(working->clientKey);
+    state.openNotional = state.openNotional - working->notional + notional;
+    PositionState* position = positions_.find(positionKey(working->clientKey, working->symbolId));
+    if (position) {
+        Quantity& side = working->side == Side::BUY ? position->workingBuy : position->workingSell;
+        side = side - working->quantity + order.getQuantity();
+    }
+    working->notional = notional;
+    working->quantity = order.getQuantity();
+}
+
+void RiskCheck::onRetire(const Order& order) {
+    if (!isEnabled()) {
+        return;
+    }
+    Retired retired{order.getOrderId(), order.getFilledQuantity()};
+    if (retired_.tryPush(retired)) {
+        return;
+    }
+    // Full: apply what is queued, then this one, to keep their order
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    applyRetired();
+    retire(retired);
+}
+
+void RiskCheck::applyRetired() {
+    Retired retired;
+    while (retired_.tryPop(retired)) {
+        retire(retired);
+    }
+}
+
+void RiskCheck::retire(const Retired& retired) {
+    Working* working = working_.find(retired.orderId);
+    if (!working) {
+        return;  // Accepted before any limit was set
+    }
+    client(working->clientKey).openNotional -= working->notional;
+    PositionState* position = positions_.find(positionKey(working->clientKey, working->symbolId));
+    if (position) {
+        int64_t filled = static_cast<int64_t>(retired.filled);
+        if (working->side == Side::BUY) {
+            position->workingBuy -= working->quantity;
+            position->filled += filled;
+        } else {
+            position->workingSell -= working->quantity;
+            position->filled -= filled;
+        }
+    }
+    working_.erase(retired.orderId);
+}
+
+void RiskCheck::onTrade(SymbolId symbolId, Price price) {
+    if (!isEnabled()) {
+        return;
+    }
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    if (symbolId >= references_.size()) {
+        references_.resize(symbolId + 1, 0);
+    }
+    references_[symbolId] = price;
+}
+
+uint64_t RiskCheck::getOpenNotional(ClientKey clientKey) {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    applyRetired();
+    return clientKey < clients_.size() ? clients_[clientKey].openNotional : 0;
+}
+
+int64_t RiskCheck::getPosition(ClientKey clientKey, SymbolId symbolId) {
+    std::lock_guard<OptionalMutex> lock(mutex_);
+    applyRetired();
+    const PositionState* position = positions_.find(positionKey(clientKey, symbolId));
+    return position ? position->filled : 0;
+}
+
+} // namespace MatchingEngine
@@ -1,25 +1,192 @@
 #include "Server.h"
+#include "EventLoop.h"
+#include "FrameBuffer.h"
+#include "Interner.h"
+#include "Metrics.h"
+#include "ServerProtocol.h"
+#include "ThreadUtil.h"
 #include <iostream>
 #include <cstring>
+#include <cerrno>
+#include <cstddef>
+#include <algorithm>
+#include <chrono>
 
 namespace MatchingEngine {
 
+namespace {
+
+constexpr int IO_EVENT_BATCH = 64;
+constexpr int IO_POLL_TIMEOUT_MS = 100;
+
+} // namespace
+
+// Connection owned by one I/O thread
+struct Server::Session : std::enable_shared_from_this<Server::Session> {
+    uint64_t id = 0;
+    SocketType socket = INVALID_SOCKET;
+    IoWorker* worker = nullptr;
+    FrameBuffer input;        // Bytes not yet dispatched - I/O thread only
+    SessionState state;       // Negotiated protocol - I/O thread only
+    bool writeArmed = false;  // Waiting for POLLOUT - I/O thread only
+    std::atomic<uint8_t> protocolVersion{1};  // Copy of state's, read by shard threads
+    std::atomic<bool> link{false};            // Likewise
+    
+    // Replies appended by shard threads, written out by the I/O thread
+    std::mutex outputMutex;
+    std::vector<char> output;
+    std::atomic<bool> flushQueued{false};
+    
+    // L2 updates waiting in the publisher; they are only taken once output
+    // has drained, so a slow reader gets them conflated
+    MarketDataPublisher::SubscriptionId subscription = 0;  // I/O thread only
+    std::atomic<bool> marketDataPending{false};
+    
+    // Batches with members still on the shards, by reference
+    std::mutex batchMutex;
+    std::unordered_map<OrderId, BatchReply> batches;
+};
+
+// One event loop thread and the sessions it serves
+struct Server::IoWorker {
+    size_t index = 0;
+    int cpu = -1;  // Pinned to, if configured
+    std::unique_ptr<Poller> poller;
+    std::thread thread;
+    std::unordered_map<SocketType, std::shared_ptr<Session>> sessions;  // I/O thread only
+    
+    // Handed over from other threads; picked up after every wait
+    std::mutex pendingMutex;
+    std::vector<std::shared_ptr<Session>> adopted;
+    std::vector<std::shared_ptr<Session>> flushes;
+};
+
 Server::Server(uint16_t port)
-    : port_(port)
+    : Server([port]() {
+        ServerConfig config;
+        config.port = port;
+        return config;
+    }()) {
+}
+
+Server::Server(const ServerConfig& config)
+    : config_(config)
+    , port_(config.port)
     , serverSocket_(INVALID_SOCKET)
     , running_(false)
-    , activeConnections_(0) {
+    , activeConnections_(0)
+    , recovered_(false)
+    , nextSessionId_(1)
+    , nextWorker_(0)
+    , promoted_(false)
+    , lowLatencyWarned_(false) {
     
-    engine_ = std::make_unique<MatchingEngineCore>();
+#ifndef __linux__
+    config_.ioMode = ServerIoMode::THREAD_PER_CLIENT;
+#endif
+    
+    // Engine output is formatted and printed a batch at a time on the
+    // event ring's consumer thread, never on a matching thread
+    events_ = std::make_unique<EventRing>();
+    if (config_.logEvents) {
+        events_->addConsumer([](const EngineEvent* events, size_t count) {
+            std::string out;
+            for (size_t i = 0; i < count; ++i) {
+                if (events[i].type == EventType::LEVEL) {
+                    continue;  // Market data has its own consumer
+                }
+                out += events[i].type == EventType::TRADE ? "[ENGINE] Trade executed: "
+                                                          : "[ENGINE] Order update: ";
+                out += events[i].toString();
+                out += '\n';
+            }
+            if (!out.empty()) {
+                std::cout << out << std::flush;
+            }
+        });
+    }
     
-    // Set up callbacks
-    engine_->setOrderCallback([](const OrderPtr& order) {
-        std::cout << "[ENGINE] Order update: " << order->toString() << std::endl;
-    });
+    transport_ = Transport::create(config_.transport, config_.lowLatency);
     
-    engine_->setTradeCallback([](const Trade& trade) {
-        std::cout << "[ENGINE] Trade executed: " << trade.toString() << std::endl;
-    });
+    // State lives on the nodes behind a gateway
+    if (!config_.gatewayNodes.empty() && config_.ioMode != ServerIoMode::THREAD_PER_CLIENT) {
+        config_.journal.directory.clear();
+        config_.snapshotPath.clear();
+    }
+    
+    // Only a sharded engine replicates; a standby doesn't in turn
+    bool sharded = config_.ioMode != ServerIoMode::THREAD_PER_CLIENT && config_.gatewayNodes.empty();
+    if (!sharded || config_.primaryPort != 0) {
+        config_.replicationEnabled = false;
+    }
+    
+    CommandHook commandHook;
+    if (!config_.journal.directory.empty()) {
+        journal_ = std::make_unique<Journal>(config_.journal);
+        commandHook = [this](const EngineCommand& command) { return journal_->append(command); };
+        if (sharded && config_.journal.fsyncPolicy != FsyncPolicy::ASYNC) {
+            journal_->setDurableCallback([this](uint64_t) {
+                std::lock_guard<std::mutex> lock(heldMutex_);
+                releaseHeldReplies();
+            });
+        }
+    }
+    if (config_.replicationEnabled) {
+        replication_ = std::make_unique<ReplicationPublisher>(config_.replicationPort,
+                                                              config_.heartbeatIntervalMs);
+        replication_->setAckCallback([this](uint64_t, bool) {
+            std::lock_guard<std::mutex> lock(heldMutex_);
+            releaseHeldReplies();
+        });
+        commandHook = [this](const EngineCommand& command) {
+            replication_->publish(command);
+            return journal_ ? journal_->append(command) : 0;
+        };
+    }
+    if (sharded && config_.primaryPort != 0) {
+        standby_ = std::make_unique<ReplicationReceiver>(config_.primaryHost, config_.primaryPort,
+                                                         config_.failoverTimeoutMs);
+    }
+    
+    marketData_ = std::make_unique<MarketDataPublisher>(*events_);
+    if (config_.feedEnabled) {
+        feed_ = std::make_unique<FeedPublisher>(*events_, config_.feed);
+    }
+    
+    if (config_.ioMode == ServerIoMode::THREAD_PER_CLIENT) {
+        EngineConfig engineConfig;
+        engineConfig.expiry = config_.expiry;
+        engine_ = std::make_unique<MatchingEngineCore>(engineConfig);
+        engine_->setEventRing(events_.get());
+        engine_->setCommandHook(commandHook);
+        engine_->getRiskCheck().setDefaultLimits(config_.riskLimits);
+    } else if (!config_.gatewayNodes.empty()) {
+        GatewayConfig gatewayConfig;
+        gatewayConfig.nodes = config_.gatewayNodes;
+        gateway_ = std::make_unique<Gateway>(gatewayConfig);
+        gateway_->setCommandCallback(
+            [this](const EngineCommand& command, bool success, const Order* order) {
+                onCommandComplete(command, success, order);
+            });
+    } else {
+        ShardedEngineConfig engineConfig;
+        engineConfig.shardCount = config_.engineShards;
+        engineConfig.nodeId = config_.nodeId;
+        engineConfig.shardCpus = config_.shardCpus;
+        engineConfig.expiry = config_.expiry;
+        engineConfig.expiryBatch = config_.expiryBatch;
+        if (config_.lowLatency.enabled) {
+            engineConfig.spinIterations = SIZE_MAX;  // Idle shards never sleep
+        }
+        shardedEngine_ = std::make_unique<ShardedEngine>(engineConfig);
+        shardedEngine_->setEventRing(events_.get());
+        shardedEngine_->setCommandHook(commandHook);
+        shardedEngine_->setRiskLimits(config_.riskLimits);
+        shardedEngine_->setCommandCallback(
+            [this](const EngineCommand& command, bool success, const Order* order) {
+                onCommandComplete(command, success, order);
+            });
+    }
     
     initializeSocket();
 }
@@ -51,59 +218,147 @@ bool Server::start() {
         return false;
     }
     
-    // Create socket
-    serverSocket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (serverSocket_ == INVALID_SOCKET) {
-        std::cerr << "Failed to create socket" << std::endl;
-        return false;
+    // Before any thread that records starts
+    if (config_.metricsEnabled) {
+        metrics().setEnabled(true);
+        if (!metricsEndpoint_) {
+            metricsEndpoint_ = std::make_unique<MetricsEndpoint>();
+            if (!metricsEndpoint_->start(config_.metricsPort)) {
+                metricsEndpoint_.reset();
+                return false;
+            }
+        }
     }
     
-    // Set socket options
-    int opt = 1;
-#ifdef _WIN32
-    setsockopt(serverSocket_, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
-#else
-    setsockopt(serverSocket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-#endif
+    // Consumers run first so the market data publishers see the recovered
+    // books being rebuilt
+    if (feed_ && !feed_->start()) {
+        return false;
+    }
+    events_->start();
     
-    // Bind socket
-    sockaddr_in serverAddr{};
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_addr.s_addr = INADDR_ANY;
-    serverAddr.sin_port = htons(port_);
+    // Rebuild the books once, before any new command can arrive
+    if (!recovered_) {
+        if (!recoverState()) {
+            return false;
+        }
+        recovered_ = true;
+    }
     
-    if (bind(serverSocket_, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        std::cerr << "Failed to bind socket to port " << port_ << std::endl;
-        closesocket(serverSocket_);
+    uint64_t recoveredSequence = 0;
+    if (shardedEngine_) {
+        for (size_t i = 0; i < shardedEngine_->getShardCount(); ++i) {
+            recoveredSequence = std::max(recoveredSequence,
+                                         shardedEngine_->getShard(i).getJournalSequence());
+        }
+    } else if (engine_) {
+        recoveredSequence = engine_->getJournalSequence();
+    }
+    if (journal_ && !journal_->isOpen() && !journal_->open(recoveredSequence)) {
+        std::cerr << "Failed to open journal in " << config_.journal.directory << std::endl;
         return false;
     }
     
-    // Listen
-    if (listen(serverSocket_, SOMAXCONN) == SOCKET_ERROR) {
-        std::cerr << "Failed to listen on socket" << std::endl;
-        closesocket(serverSocket_);
+    // Replicas are built from empty books, command by command
+    bool restored = recoveredSequence != 0;
+    for (size_t i = 0; shardedEngine_ && i < shardedEngine_->getShardCount(); ++i) {
+        restored = restored || shardedEngine_->getShard(i).getLiveOrders() != 0;
+    }
+    if (standby_) {
+        if (restored) {
+            std::cerr << "A standby must start without recovered state" << std::endl;
+            return false;
+        }
+        bool attached = standby_->start(
+            [this](const EngineCommand& command) { shardedEngine_->applySequenced(command); },
+            [this]() { takeOver(); });
+        if (!attached) {
+            std::cerr << "Failed to attach to primary " << config_.primaryHost << ":"
+                      << config_.primaryPort << std::endl;
+            return false;
+        }
+        running_ = true;
+        std::cout << "Standing by for " << config_.primaryHost << ":" << config_.primaryPort
+                  << std::endl;
+        return true;
+    }
+    if (replication_ && restored) {
+        std::cerr << "Recovered state can't be replicated - running without a standby"
+                  << std::endl;
+    } else if (replication_) {
+        if (!replication_->start()) {
+            return false;
+        }
+        std::cout << "Replicating to a standby on port " << replication_->getPort() << std::endl;
+    }
+    
+    return serveClients();
+}
+
+bool Server::serveClients() {
+    serverSocket_ = transport_->listen(port_);
+    if (serverSocket_ == INVALID_SOCKET) {
+        std::cerr << "Failed to listen on port " << port_ << std::endl;
         return false;
     }
     
     running_ = true;
     
-    // Start accept thread
-    acceptThread_ = std::thread(&Server::acceptClients, this);
+    if (config_.ioMode == ServerIoMode::THREAD_PER_CLIENT) {
+        // Start accept thread
+        acceptThread_ = std::thread(&Server::acceptClients, this);
+        expiryThread_ = std::thread(&Server::runExpiries, this);
+    } else if (!startEventLoops()) {
+        running_ = false;
+        transport_->close(serverSocket_);
+        serverSocket_ = INVALID_SOCKET;
+        return false;
+    } else if (!config_.snapshotPath.empty() && config_.snapshotIntervalSeconds > 0) {
+        snapshotThread_ = std::thread(&Server::runSnapshots, this);
+    }
     
     std::cout << "Server started on port " << port_ << std::endl;
+    promoted_ = true;
+    if (metricsEndpoint_) {
+        std::cout << "Metrics served on port " << metricsEndpoint_->getPort() << std::endl;
+    }
     return true;
 }
 
 void Server::stop() {
+    // A standby taking over finishes first, so there's one server to stop
+    if (standby_) {
+        standby_->stop();
+    }
     if (!running_) {
         return;
     }
     
     running_ = false;
     
+    if (snapshotThread_.joinable()) {
+        snapshotThread_.join();
+    }
+    if (expiryThread_.joinable()) {
+        expiryThread_.join();
+    }
+    if (shardedEngine_ || gateway_) {
+        stopEventLoops();
+    }
+    if (replication_) {
+        replication_->stop();
+    }
+    {
+        std::lock_guard<std::mutex> lock(heldMutex_);
+        heldReplies_.clear();
+    }
+    
     // Close server socket to unblock accept
     if (serverSocket_ != INVALID_SOCKET) {
-        closesocket(serverSocket_);
+#ifndef _WIN32
+        transport_->shutdown(serverSocket_);
+#endif
+        transport_->close(serverSocket_);
         serverSocket_ = INVALID_SOCKET;
     }
     
@@ -112,27 +367,46 @@ void Server::stop() {
         acceptThread_.join();
     }
     
-    // Wait for client threads
-    for (auto& thread : clientThreads_) {
-        if (thread.joinable()) {
-            thread.join();
+    // Unblock client threads still waiting in recv, then wait for them
+    std::unordered_map<std::thread::id, ClientThread> clients;
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        for (auto& entry : clientThreads_) {
+            transport_->shutdown(entry.second.socket);
         }
+        clients.swap(clientThreads_);
+        finishedClients_.clear();
+    }
+    for (auto& entry : clients) {
+        if (entry.second.thread.joinable()) {
+            entry.second.thread.join();
+        }
+    }
+    
+    // Every command has been applied; make them all durable, then
+    // snapshot the quiet engine so the next start replays nothing
+    if (journal_) {
+        journal_->close();
+    }
+    events_->stop();
+    if (feed_) {
+        feed_->stop();
+    }
+    if (!config_.snapshotPath.empty()) {
+        takeSnapshot();
+    }
+    if (metricsEndpoint_) {
+        metricsEndpoint_->stop();
+        metricsEndpoint_.reset();
     }
-    clientThreads_.clear();
     
     std::cout << "Server stopped" << std::endl;
 }
 
 void Server::acceptClients() {
     while (running_) {
-        sockaddr_in clientAddr{};
-#ifdef _WIN32
-        int clientAddrLen = sizeof(clientAddr);
-#else
-        socklen_t clientAddrLen = sizeof(clientAddr);
-#endif
-        
-        SocketType clientSocket = accept(serverSocket_, (sockaddr*)&clientAddr, &clientAddrLen);
+        std::string peer;
+        SocketType clientSocket = transport_->accept(serverSocket_, &peer);
         
         if (clientSocket == INVALID_SOCKET) {
             if (running_) {
@@ -140,158 +414,168 @@ void Server::acceptClients() {
             }
             continue;
         }
+        configureSocket(clientSocket, -1);
         
         activeConnections_++;
         std::cout << "Client connected. Active connections: " << activeConnections_ << std::endl;
         
-        // Handle client in new thread
-        clientThreads_.emplace_back(&Server::handleClient, this, clientSocket);
+        reapClients();
+        
+        // Handle client in new thread. The thread can't report itself
+        // finished until it is registered, since both need clientsMutex_.
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        std::thread thread(&Server::handleClient, this, clientSocket, isLinkPeer(peer));
+        std::thread::id id = thread.get_id();
+        clientThreads_.emplace(id, ClientThread{std::move(thread), clientSocket});
+    }
+}
+
+bool Server::isLinkPeer(const std::string& address) const {
+    return std::find(config_.linkPeers.begin(), config_.linkPeers.end(), address) !=
+           config_.linkPeers.end();
+}
+
+void Server::reapClients() {
+    std::vector<std::thread> finished;
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        for (const auto& id : finishedClients_) {
+            auto it = clientThreads_.find(id);
+            if (it != clientThreads_.end()) {
+                finished.push_back(std::move(it->second.thread));
+                clientThreads_.erase(it);
+            }
+        }
+        finishedClients_.clear();
+    }
+    for (auto& thread : finished) {
+        thread.join();
     }
 }
 
-void Server::handleClient(SocketType clientSocket) {
-    std::vector<char> buffer(MAX_MESSAGE_SIZE);
+void Server::handleClient(SocketType clientSocket, bool linkAllowed) {
+    FrameBuffer input;
+    ReplyBuffer replies;
+    SessionState state;
+    state.linkAllowed = linkAllowed;
+    std::vector<EngineCommand> batch;
+    metrics().nameThread("client");
     
     while (running_) {
-        // Read message header
-        MessageHeader header;
-        if (!receiveMessage(clientSocket, &header, sizeof(MessageHeader))) {
+        // Take whatever has arrived - possibly many pipelined messages
+        char* target = input.writePtr();
+        uint64_t stamp = stageStart();
+        int received = transport_->receive(clientSocket, target, input.writable());
+        if (received <= 0) {
             break;
         }
+        stageEnd(Stage::RECEIVE, stamp);
+        countMetric(Counter::BYTES_RECEIVED, static_cast<uint64_t>(received));
+        input.commit(static_cast<size_t>(received));
         
-        // Handle message based on type
-        switch (header.type) {
-            case MessageType::NEW_ORDER: {
-                NewOrderMessage msg;
-                if (receiveMessage(clientSocket, &msg, sizeof(NewOrderMessage))) {
-                    handleNewOrder(clientSocket, msg);
+        Frame frame;
+        bool ok = true;
+        while (ok && input.nextFrame(frame)) {
+            EngineCommand command;
+            stamp = stageStart();
+            FrameAction action = decodeFrame(frame, state, input, replies, command, batch,
+                                             config_.maxProtocolVersion);
+            stageEnd(Stage::DECODE, stamp);
+            countMetric(Counter::FRAMES, 1);
+            if (action == FrameAction::COMMAND) {
+                executeCommand(replies, state.protocolVersion, command);
+            } else if (action == FrameAction::BATCH) {
+                BatchReply reply;
+                for (EngineCommand& member : batch) {
+                    executeCommand(replies, state.protocolVersion, member, &reply);
                 }
-                break;
+                reply.append(replies);
+            } else if (action == FrameAction::SUBSCRIBE) {
+                std::cerr << "Market data needs an event loop I/O mode" << std::endl;
             }
-            
-            case MessageType::CANCEL_ORDER: {
-                CancelOrderMessage msg;
-                if (receiveMessage(clientSocket, &msg, sizeof(CancelOrderMessage))) {
-                    handleCancelOrder(clientSocket, msg);
-                }
-                break;
-            }
-            
-            case MessageType::MODIFY_ORDER: {
-                ModifyOrderMessage msg;
-                if (receiveMessage(clientSocket, &msg, sizeof(ModifyOrderMessage))) {
-                    handleModifyOrder(clientSocket, msg);
-                }
-                break;
-            }
-            
-            case MessageType::HEARTBEAT: {
-                HeartbeatMessage msg;
-                if (receiveMessage(clientSocket, &msg, sizeof(HeartbeatMessage))) {
-                    // Echo heartbeat back
-                    sendMessage(clientSocket, &msg, sizeof(HeartbeatMessage));
-                }
-                break;
+            ok = action != FrameAction::INVALID;
+        }
+        if (!ok || input.malformed()) {
+            std::cerr << "Malformed message received" << std::endl;
+            break;
+        }
+        
+        // One send covers the replies to everything just read, once what
+        // they answer is on disk
+        if (!replies.empty()) {
+            if (waitsForJournal()) {
+                journal_->waitDurable(journal_->getAppendedSequence());
             }
-            
-            default:
-                std::cerr << "Unknown message type received" << std::endl;
-                break;
+            sendMessage(clientSocket, replies.data(), replies.size());
+            replies.clear();
         }
     }
     
-    closesocket(clientSocket);
+    transport_->close(clientSocket);
     activeConnections_--;
     std::cout << "Client disconnected. Active connections: " << activeConnections_ << std::endl;
+    
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    finishedClients_.push_back(std::this_thread::get_id());
 }
 
-void Server::handleNewOrder(SocketType clientSocket, const NewOrderMessage& msg) {
-    std::cout << "[SERVER] New order: " << msg.getSymbol() 
-              << " " << sideToString(msg.side)
-              << " " << msg.quantity << " @ " << priceToDouble(msg.price) << std::endl;
-    
-    // Submit to engine
-    OrderId orderId = engine_->submitOrder(
-        msg.getSymbol(),
-        msg.side,
-        msg.orderType,
-        msg.price,
-        msg.quantity,
-        msg.getClientId(),
-        msg.stopPrice
-    );
-    
-    // Send acknowledgment
-    OrderAckMessage ack;
-    ack.clientOrderId = msg.clientOrderId;
-    ack.orderId = orderId;
-    ack.status = OrderStatus::PENDING;
-    ack.setMessage("Order accepted");
-    
-    sendMessage(clientSocket, &ack, sizeof(OrderAckMessage));
-    
-    // Get final order status and send execution report if filled
-    auto order = engine_->getOrder(orderId);
-    if (order && order->getStatus() != OrderStatus::PENDING) {
-        ExecutionReportMessage exec;
-        exec.orderId = orderId;
-        exec.setSymbol(order->getSymbol());
-        exec.side = order->getSide();
-        exec.executionPrice = order->getPrice();
-        exec.executionQuantity = order->getFilledQuantity();
-        exec.remainingQuantity = order->getRemainingQuantity();
-        exec.status = order->getStatus();
-        
-        sendMessage(clientSocket, &exec, sizeof(ExecutionReportMessage));
+void Server::executeCommand(ReplyBuffer& replies, uint8_t version, EngineCommand& command,
+                            BatchReply* batch) {
+    if (config_.logEvents) {
+        logCommand(command);
     }
-}
-
-void Server::handleCancelOrder(SocketType clientSocket, const CancelOrderMessage& msg) {
-    std::cout << "[SERVER] Cancel order: " << msg.orderId << std::endl;
-    
-    bool success = engine_->cancelOrder(msg.orderId);
+    auto reply = [&](bool success, const Order* order) {
+        if (batch) {
+            batch->add(command, success, order);
+        } else {
+            appendCommandResult(replies, version, command, success, order);
+        }
+    };
     
-    OrderAckMessage ack;
-    ack.orderId = msg.orderId;
+    if (command.type == CommandType::MASS_CANCEL) {
+        command.quantity = engine_->massCancel(command);
+        reply(true, nullptr);
+        return;
+    }
+    if (command.type == CommandType::MODIFY_ORDER) {
+        command.reject = engine_->checkRisk(command);
+        reply(command.reject == RejectReason::NONE && engine_->execute(command), nullptr);
+        return;
+    }
+    if (command.type != CommandType::NEW_ORDER) {
+        reply(engine_->execute(command), nullptr);
+        return;
+    }
     
-    if (success) {
-        ack.status = OrderStatus::CANCELLED;
-        ack.setMessage("Order cancelled");
-    } else {
-        ack.status = OrderStatus::REJECTED;
-        ack.setMessage("Order not found");
+    command.reject = engine_->checkRisk(command);
+    if (command.reject != RejectReason::NONE) {
+        reply(false, nullptr);
+        return;
     }
     
-    sendMessage(clientSocket, &ack, sizeof(OrderAckMessage));
+    // Final state of the new order comes back in the report
+    command.orderId = engine_->reserveOrderId();
+    Order report(command.orderId, command.symbolId, command.side, command.orderType,
+                 command.price, command.quantity);
+    bool success = engine_->execute(command, &report);
+    reply(success, &report);
 }
 
-void Server::handleModifyOrder(SocketType clientSocket, const ModifyOrderMessage& msg) {
-    std::cout << "[SERVER] Modify order: " << msg.orderId 
-              << " new price: " << priceToDouble(msg.newPrice)
-              << " new qty: " << msg.newQuantity << std::endl;
-    
-    bool success = engine_->modifyOrder(msg.orderId, msg.newPrice, msg.newQuantity);
-    
-    OrderAckMessage ack;
-    ack.orderId = msg.orderId;
-    
-    if (success) {
-        ack.status = OrderStatus::PENDING;
-        ack.setMessage("Order modified");
-    } else {
-        ack.status = OrderStatus::REJECTED;
-        ack.setMessage("Failed to modify order");
+void Server::configureSocket(SocketType socket, int cpu) {
+    if (!transport_->configure(socket, cpu) && !lowLatencyWarned_.exchange(true)) {
+        std::cerr << "Low-latency socket options not applied (busy polling past "
+                  << "net.core.busy_read needs CAP_NET_ADMIN)" << std::endl;
     }
-    
-    sendMessage(clientSocket, &ack, sizeof(OrderAckMessage));
 }
 
 bool Server::sendMessage(SocketType socket, const void* data, size_t length) {
+    StageTimer timer(Stage::SEND);
+    countMetric(Counter::BYTES_SENT, length);
     size_t totalSent = 0;
     const char* buffer = static_cast<const char*>(data);
     
     while (totalSent < length) {
-        int sent = send(socket, buffer + totalSent, static_cast<int>(length - totalSent), 0);
+        int sent = transport_->send(socket, buffer + totalSent, length - totalSent);
         if (sent == SOCKET_ERROR) {
             return false;
         }
@@ -301,28 +585,599 @@ bool Server::sendMessage(SocketType socket, const void* data, size_t length) {
     return true;
 }
 
-bool Server::receiveMessage(SocketType socket, void* buffer, size_t length) {
-    size_t totalReceived = 0;
-    char* buf = static_cast<char*>(buffer);
+bool Server::recoverState() {
+    if (!journal_ && config_.snapshotPath.empty()) {
+        return true;
+    }
     
-    while (totalReceived < length) {
-        int received = recv(socket, buf + totalReceived, static_cast<int>(length - totalReceived), 0);
-        if (received <= 0) {
+    const std::string& journalDirectory = config_.journal.directory;
+    size_t restored = 0;
+    if (shardedEngine_) {
+        if (!shardedEngine_->recover(config_.snapshotPath, journalDirectory)) {
             return false;
         }
-        totalReceived += received;
+        for (size_t i = 0; i < shardedEngine_->getShardCount(); ++i) {
+            restored += shardedEngine_->getShard(i).getLiveOrders();
+        }
+    } else {
+        if (!engine_->recover(config_.snapshotPath, journalDirectory)) {
+            return false;
+        }
+        restored = engine_->getLiveOrders();
     }
     
+    std::cout << "Recovered " << restored << " resting orders" << std::endl;
     return true;
 }
 
+void Server::runSnapshots() {
+    auto interval = std::chrono::seconds(config_.snapshotIntervalSeconds);
+    auto next = std::chrono::steady_clock::now() + interval;
+    
+    while (running_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (std::chrono::steady_clock::now() >= next) {
+            takeSnapshot();
+            next = std::chrono::steady_clock::now() + interval;
+        }
+    }
+}
+
+void Server::runExpiries() {
+    // Ticks finer than the sleep just mean each wake-up finds more due
+    auto pause = std::chrono::nanoseconds(
+        std::max<uint64_t>(config_.expiry.tickNanos, 1000000));
+    size_t batch = std::max<size_t>(config_.expiryBatch, 1);
+    
+    while (running_) {
+        uint64_t now = timestampToNanos(getCurrentTimestamp());
+        // Client threads get the engine back between batches
+        if (now < engine_->nextExpiryCheck() || engine_->expireOrders(now, batch) < batch) {
+            std::this_thread::sleep_for(pause);
+        }
+    }
+}
+
+void Server::takeSnapshot() {
+    uint64_t covered = 0;
+    bool written;
+    if (shardedEngine_) {
+        written = shardedEngine_->snapshot(config_.snapshotPath, &covered);
+    } else {
+        std::vector<EngineSnapshot> snapshot(1);
+        engine_->captureSnapshot(snapshot[0]);
+        covered = snapshot[0].journalSequence;
+        written = writeSnapshot(config_.snapshotPath, snapshot);
+    }
+    
+    // Journal segments the snapshot covers are no longer needed
+    if (written && journal_) {
+        journal_->truncate(covered);
+    }
+}
+
 size_t Server::getTotalOrders() const {
-    return engine_->getTotalOrders();
+    if (gateway_) {
+        return gateway_->getTotalOrders();
+    }
+    return shardedEngine_ ? shardedEngine_->getTotalOrders() : engine_->getTotalOrders();
 }
 
 size_t Server::getTotalTrades() const {
-    return engine_->getTotalTrades();
+    if (gateway_) {
+        return 0;  // Trades happen on the nodes
+    }
+    return shardedEngine_ ? shardedEngine_->getTotalTrades() : engine_->getTotalTrades();
 }
 
-} // namespace MatchingEngine
+// Event loop implementation
+
+#ifdef __linux__
 
+bool Server::startEventLoops() {
+    PollerType pollerType =
+        config_.ioMode == ServerIoMode::IO_URING ? PollerType::IO_URING : PollerType::EPOLL;
+    size_t workerCount = std::max<size_t>(config_.ioThreads, 1);
+    
+    ioWorkers_.clear();
+    for (size_t i = 0; i < workerCount; ++i) {
+        auto worker = std::make_unique<IoWorker>();
+        worker->index = i;
+        worker->cpu = i < config_.ioCpus.size() ? config_.ioCpus[i] : -1;
+        worker->poller = transport_->createPoller(pollerType);
+        if (!worker->poller && pollerType == PollerType::IO_URING) {
+            std::cerr << "io_uring unavailable, falling back to epoll" << std::endl;
+            pollerType = PollerType::EPOLL;
+            config_.ioMode = ServerIoMode::EPOLL;
+            worker->poller = transport_->createPoller(pollerType);
+        }
+        if (!worker->poller) {
+            std::cerr << "Failed to create event loop" << std::endl;
+            ioWorkers_.clear();
+            return false;
+        }
+        ioWorkers_.push_back(std::move(worker));
+    }
+    
+    // The first loop also accepts
+    setNonBlocking(serverSocket_);
+    if (!ioWorkers_[0]->poller->add(serverSocket_, IO_READ)) {
+        std::cerr << "Failed to watch listening socket" << std::endl;
+        ioWorkers_.clear();
+        return false;
+    }
+    
+    if (!gateway_) {
+        shardedEngine_->start();
+    } else if (!gateway_->start()) {
+        ioWorkers_.clear();
+        return false;
+    }
+    for (auto& worker : ioWorkers_) {
+        worker->thread = std::thread(&Server::runIoWorker, this, std::ref(*worker));
+        pinThreadToCpu(worker->thread, worker->cpu);
+    }
+    return true;
+}
+
+void Server::stopEventLoops() {
+    for (auto& worker : ioWorkers_) {
+        worker->poller->wake();
+    }
+    for (auto& worker : ioWorkers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    
+    // Apply what was queued; replies for sessions about to close are dropped
+    if (gateway_) {
+        gateway_->stop();
+    } else {
+        shardedEngine_->stop();
+    }
+    
+    for (auto& worker : ioWorkers_) {
+        std::vector<std::shared_ptr<Session>> sessions;
+        for (auto& entry : worker->sessions) {
+            sessions.push_back(entry.second);
+        }
+        for (auto& adopted : worker->adopted) {
+            sessions.push_back(adopted);
+            worker->sessions[adopted->socket] = adopted;
+        }
+        for (auto& session : sessions) {
+            closeSession(*worker, session);
+        }
+    }
+    ioWorkers_.clear();
+    
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    sessions_.clear();
+}
+
+void Server::runIoWorker(IoWorker& worker) {
+    IoReady ready[IO_EVENT_BATCH];
+    std::vector<std::shared_ptr<Session>> pending;
+    metrics().nameThread("io-" + std::to_string(worker.index));
+    
+    // Low-latency mode polls without ever sleeping in the kernel
+    const bool spin = transport_->getOptions().enabled;
+    while (running_) {
+        int count = worker.poller->wait(ready, IO_EVENT_BATCH, spin ? 0 : IO_POLL_TIMEOUT_MS);
+        if (count == 0 && spin) {
+            cpuRelax();
+        }
+        
+        for (int i = 0; i < count; ++i) {
+            if (ready[i].fd == serverSocket_) {
+                acceptPending();
+                continue;
+            }
+            
+            auto it = worker.sessions.find(ready[i].fd);
+            if (it == worker.sessions.end()) {
+                continue;
+            }
+            std::shared_ptr<Session> session = it->second;
+            
+            if (ready[i].events & IO_READ) {
+                readSession(worker, session);
+            }
+            if (session->socket != INVALID_SOCKET && (ready[i].events & IO_WRITE)) {
+                writeSession(worker, session);
+            }
+            if (session->socket != INVALID_SOCKET && (ready[i].events & IO_CLOSED) &&
+                !(ready[i].events & IO_READ)) {
+                closeSession(worker, session);
+            }
+        }
+        
+        // New connections handed to this loop
+        pending.clear();
+        {
+            std::lock_guard<std::mutex> lock(worker.pendingMutex);
+            pending.swap(worker.adopted);
+        }
+        for (auto& session : pending) {
+            worker.sessions[session->socket] = session;
+            worker.poller->add(session->socket, IO_READ);
+        }
+        
+        // Sessions with replies queued by the shards
+        pending.clear();
+        {
+            std::lock_guard<std::mutex> lock(worker.pendingMutex);
+            pending.swap(worker.flushes);
+        }
+        for (auto& session : pending) {
+            session->flushQueued = false;
+            if (session->socket != INVALID_SOCKET) {
+                writeSession(worker, session);
+            }
+        }
+    }
+}
+
+void Server::acceptPending() {
+    for (;;) {
+        std::string peer;
+        SocketType clientSocket = transport_->accept(serverSocket_, &peer);
+        if (clientSocket == INVALID_SOCKET) {
+            return;  // Backlog drained
+        }
+        setNonBlocking(clientSocket);
+        
+        auto session = std::make_shared<Session>();
+        session->id = nextSessionId_++;
+        session->socket = clientSocket;
+        session->state.linkAllowed = isLinkPeer(peer);
+        session->worker = ioWorkers_[nextWorker_++ % ioWorkers_.size()].get();
+        configureSocket(clientSocket, session->worker->cpu);
+        {
+            std::lock_guard<std::mutex> lock(sessionsMutex_);
+            sessions_[session->id] = session;
+        }
+        
+        activeConnections_++;
+        std::cout << "Client connected. Active connections: " << activeConnections_ << std::endl;
+        
+        IoWorker& worker = *session->worker;
+        {
+            std::lock_guard<std::mutex> lock(worker.pendingMutex);
+            worker.adopted.push_back(std::move(session));
+        }
+        worker.poller->wake();
+    }
+}
+
+void Server::readSession(IoWorker& worker, const std::shared_ptr<Session>& session) {
+    FrameBuffer& input = session->input;
+    
+    for (;;) {
+        char* target = input.writePtr();
+        size_t space = input.writable();
+        uint64_t stamp = stageStart();
+        ssize_t received = transport_->receive(session->socket, target, space);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (received <= 0) {
+            closeSession(worker, session);  // Orderly shutdown or error
+            return;
+        }
+        stageEnd(Stage::RECEIVE, stamp);
+        countMetric(Counter::BYTES_RECEIVED, static_cast<uint64_t>(received));
+        input.commit(static_cast<size_t>(received));
+        
+        // Dispatch every complete frame straight out of the buffer
+        Frame frame;
+        while (input.nextFrame(frame)) {
+            if (!dispatchFrame(*session, frame)) {
+                std::cerr << "Malformed message received" << std::endl;
+                closeSession(worker, session);
+                return;
+            }
+        }
+        if (input.malformed()) {
+            std::cerr << "Malformed message length received" << std::endl;
+            closeSession(worker, session);
+            return;
+        }
+        
+        // A short read means the socket is drained
+        if (static_cast<size_t>(received) < space) {
+            return;
+        }
+    }
+}
+
+bool Server::dispatchFrame(Session& session, const Frame& frame) {
+    // Replies made here go out before anything the shards send afterwards,
+    // so a logon ack always precedes the acks in the new version
+    thread_local ReplyBuffer replies;
+    thread_local std::vector<EngineCommand> batch;
+    EngineCommand command;
+    uint64_t stamp = stageStart();
+    FrameAction action = decodeFrame(frame, session.state, session.input, replies, command, batch,
+                                     config_.maxProtocolVersion);
+    command.receivedAt = stageEnd(Stage::DECODE, stamp);  // Opens the QUEUE stage
+    countMetric(Counter::FRAMES, 1);
+    session.protocolVersion = session.state.protocolVersion;
+    session.link = session.state.link;
+    
+    if (action == FrameAction::COMMAND) {
+        if (config_.logEvents) {
+            logCommand(command);
+        }
+        command.sessionId = session.id;
+        bool queued = gateway_ ? gateway_->submit(command) : shardedEngine_->submit(command) != 0;
+        if (!queued && session.state.link) {
+            appendLinkResult(replies, command, false, nullptr);
+        } else if (!queued) {
+            appendCommandResult(replies, session.state.protocolVersion, command, false, nullptr);
+        }
+    } else if (action == FrameAction::BATCH) {
+        // Acknowledged once the last member completes - see onCommandComplete
+        for (EngineCommand& member : batch) {
+            if (config_.logEvents) {
+                logCommand(member);
+            }
+            member.sessionId = session.id;
+            member.receivedAt = command.receivedAt;
+        }
+        if (gateway_) {
+            gateway_->submitBatch(batch.data(), batch.size());  // Fails members it can't route
+        } else {
+            shardedEngine_->submitBatch(batch.data(), batch.size());  // Fails only when stopping
+        }
+    } else if (action == FrameAction::SUBSCRIBE) {
+        if (session.subscription) {
+            marketData_->unsubscribe(session.subscription);
+        }
+        uint64_t sessionId = session.id;
+        session.subscription = marketData_->subscribe(
+            command.symbolId,
+            [this, sessionId](MarketDataPublisher::SubscriptionId) { onMarketDataReady(sessionId); });
+    }
+    if (!replies.empty()) {
+        queueReply(session, replies.data(), replies.size());
+        replies.clear();
+    }
+    return action != FrameAction::INVALID;
+}
+
+void Server::onCommandComplete(const EngineCommand& command, bool success, const Order* order) {
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        auto it = sessions_.find(command.sessionId);
+        if (it == sessions_.end()) {
+            return;  // Disconnected meanwhile
+        }
+        session = it->second;
+    }
+    
+    // Build the whole reply first so the session's output is locked once
+    thread_local ReplyBuffer replies;
+    if (command.inBatch()) {
+        // Members finish on their shards' threads; the last one replies
+        std::lock_guard<std::mutex> lock(session->batchMutex);
+        auto it = session->batches.find(command.clientOrderId);
+        if (it == session->batches.end()) {
+            it = session->batches.emplace(command.clientOrderId, BatchReply()).first;
+        }
+        if (!it->second.add(command, success, order)) {
+            return;
+        }
+        if (session->link) {
+            // Only a mass cancel is copied to several shards of a node
+            EngineCommand total = command;
+            total.quantity = it->second.getCancelled();
+            appendLinkResult(replies, total, true, nullptr);
+        } else {
+            it->second.append(replies);
+        }
+        session->batches.erase(it);
+    } else if (session->link) {
+        appendLinkResult(replies, command, success, order);
+    } else {
+        appendCommandResult(replies, session->protocolVersion, command, success, order);
+    }
+    sendReplies(session, replies);
+    replies.clear();
+}
+
+void Server::sendReplies(const std::shared_ptr<Session>& session, const ReplyBuffer& replies) {
+    if (!replication_ && !waitsForJournal()) {
+        queueReply(*session, replies.data(), replies.size());
+        return;
+    }
+    
+    // Every command sequenced so far was published and journaled before
+    // this reply was made, so it is safe once the standby has acked them
+    // all and the journal has synced them. Replies leave in the order they
+    // were made.
+    std::lock_guard<std::mutex> lock(heldMutex_);
+    HeldReply held{replication_ ? replication_->getPublishedSequence() : 0,
+                   waitsForJournal() ? journal_->getAppendedSequence() : 0, session, ReplyBuffer()};
+    if (heldReplies_.empty() && releasable(held)) {
+        queueReply(*session, replies.data(), replies.size());
+        return;
+    }
+    held.bytes = replies;
+    heldReplies_.push_back(std::move(held));
+    releaseHeldReplies();  // The ack or sync may have come in meanwhile
+}
+
+bool Server::releasable(const HeldReply& held) const {
+    // Without a standby there is nothing to wait for; nor once the journal
+    // has stopped or failed, when no sync is coming
+    bool replicated = !replication_ || !replication_->hasStandby() ||
+                      held.sequence <= replication_->getAckedSequence();
+    bool durable = held.journalSequence == 0 || !journal_->isOpen() || journal_->hasFailed() ||
+                   held.journalSequence <= journal_->getDurableSequence();
+    return replicated && durable;
+}
+
+void Server::releaseHeldReplies() {
+    while (!heldReplies_.empty() && releasable(heldReplies_.front())) {
+        HeldReply& held = heldReplies_.front();
+        if (running_) {
+            queueReply(*held.session, held.bytes.data(), held.bytes.size());
+        }
+        heldReplies_.pop_front();
+    }
+}
+
+void Server::takeOver() {
+    std::cout << "Primary lost after sequence " << standby_->getAppliedSequence()
+              << " - taking over" << std::endl;
+    if (!serveClients()) {
+        std::cerr << "Standby failed to take over" << std::endl;
+    }
+}
+
+void Server::onMarketDataReady(uint64_t sessionId) {
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        auto it = sessions_.find(sessionId);
+        if (it == sessions_.end()) {
+            return;
+        }
+        session = it->second;
+    }
+    
+    // The I/O thread takes the updates when it next writes the session
+    session->marketDataPending = true;
+    requestFlush(*session);
+}
+
+void Server::queueReply(Session& session, const void* data, size_t length) {
+    {
+        std::lock_guard<std::mutex> lock(session.outputMutex);
+        const char* bytes = static_cast<const char*>(data);
+        session.output.insert(session.output.end(), bytes, bytes + length);
+    }
+    requestFlush(session);
+}
+
+void Server::requestFlush(Session& session) {
+    // One flush request per batch of replies
+    if (!session.flushQueued.exchange(true)) {
+        IoWorker& worker = *session.worker;
+        {
+            std::lock_guard<std::mutex> lock(worker.pendingMutex);
+            worker.flushes.push_back(session.shared_from_this());
+        }
+        worker.poller->wake();
+    }
+}
+
+void Server::writeSession(IoWorker& worker, const std::shared_ptr<Session>& session) {
+    // Reused for every session on this I/O thread
+    thread_local std::vector<LevelUpdate> updates;
+    
+    bool failed = false;
+    bool more;
+    {
+        std::lock_guard<std::mutex> lock(session->outputMutex);
+        std::vector<char>& output = session->output;
+        
+        // Market data is only encoded once earlier output has gone out;
+        // until then the publisher keeps conflating it
+        if (output.empty() && session->marketDataPending.exchange(false)) {
+            updates.clear();
+            marketData_->poll(session->subscription, updates);
+            for (const LevelUpdate& update : updates) {
+                appendBookUpdate(output, session->protocolVersion, update);
+            }
+        }
+        
+        StageTimer timer(Stage::SEND);
+        size_t sent = 0;
+        while (sent < output.size()) {
+            ssize_t written = transport_->send(session->socket, output.data() + sent,
+                                               output.size() - sent);
+            if (written > 0) {
+                sent += written;
+            } else if (written < 0 && errno == EINTR) {
+                continue;
+            } else if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                failed = true;
+                break;
+            }
+        }
+        output.erase(output.begin(), output.begin() + sent);
+        countMetric(Counter::BYTES_SENT, sent);
+        more = !output.empty() || session->marketDataPending;
+    }
+    
+    if (failed) {
+        closeSession(worker, session);
+        return;
+    }
+    
+    // Watch for writability only while a backlog remains
+    if (more != session->writeArmed) {
+        worker.poller->modify(session->socket, IO_READ | (more ? IO_WRITE : 0));
+        session->writeArmed = more;
+    }
+}
+
+void Server::closeSession(IoWorker& worker, const std::shared_ptr<Session>& session) {
+    if (session->socket == INVALID_SOCKET) {
+        return;
+    }
+    
+    if (session->subscription) {
+        marketData_->unsubscribe(session->subscription);
+        session->subscription = 0;
+    }
+    worker.poller->remove(session->socket);
+    worker.sessions.erase(session->socket);
+    transport_->close(session->socket);
+    session->socket = INVALID_SOCKET;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        sessions_.erase(session->id);
+    }
+    
+    activeConnections_--;
+    std::cout << "Client disconnected. Active connections: " << activeConnections_ << std::endl;
+}
+
+#else // !__linux__
+
+bool Server::startEventLoops() {
+    return false;
+}
+
+void Server::stopEventLoops() {
+}
+
+void Server::onCommandComplete(const EngineCommand&, bool, const Order*) {
+}
+
+void Server::sendReplies(const std::shared_ptr<Session>&, const ReplyBuffer&) {
+}
+
+void Server::releaseHeldReplies() {
+}
+
+bool Server::releasable(const HeldReply&) const {
+    return true;
+}
+
+void Server::takeOver() {
+}
+
+#endif
+
+} // namespace MatchingEngine
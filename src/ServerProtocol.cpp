@@ -0,0 +1,539 @@
+#include "ServerProtocol.h"
+#include "Interner.h"
+#include "Message.h"
+#include "ProtocolV2.h"
+#include <algorithm>
+#include <iostream>
+
+namespace MatchingEngine {
+
+namespace {
+
+void append(std::vector<char>& replies, const void* data, size_t length) {
+    const char* bytes = static_cast<const char*>(data);
+    replies.insert(replies.end(), bytes, bytes + length);
+}
+
+void appendAck(std::vector<char>& replies, uint8_t version, OrderId clientOrderId,
+               OrderId orderId, OrderStatus status, RejectReason reason, const char* text) {
+    if (version >= ProtocolV2::VERSION) {
+        ProtocolV2::OrderAck ack;
+        ack.clientOrderId = clientOrderId;
+        ack.orderId = orderId;
+        ack.status = status;
+        ack.reason = reason;
+        char out[ProtocolV2::OrderAck::SIZE];
+        append(replies, out, ack.encode(out));
+        return;
+    }
+
+    OrderAckMessage ack;
+    ack.clientOrderId = clientOrderId;
+    ack.orderId = orderId;
+    ack.status = status;
+    ack.setMessage(reason == RejectReason::NONE ? text : rejectReasonToString(reason));
+    append(replies, &ack, sizeof(ack));
+}
+
+void appendReject(std::vector<char>& replies, uint8_t version, OrderId clientOrderId,
+                  RejectReason reason) {
+    if (version >= ProtocolV2::VERSION) {
+        ProtocolV2::OrderReject reject;
+        reject.clientOrderId = clientOrderId;
+        reject.reason = reason;
+        char out[ProtocolV2::OrderReject::SIZE];
+        append(replies, out, reject.encode(out));
+        return;
+    }
+
+    OrderRejectMessage reject;
+    reject.clientOrderId = clientOrderId;
+    reject.setReason(rejectReasonToString(reason));
+    append(replies, &reject, sizeof(reject));
+}
+
+// Why a modify failed: the risk stage's reason if it refused, else the book's
+RejectReason modifyRejectReason(const EngineCommand& command) {
+    return command.reject != RejectReason::NONE ? command.reject : RejectReason::MODIFY_REJECTED;
+}
+
+void appendExecutionReport(std::vector<char>& replies, uint8_t version, const Order& order) {
+    if (version >= ProtocolV2::VERSION) {
+        ProtocolV2::ExecutionReport exec;
+        exec.orderId = order.getOrderId();
+        ProtocolV2::setSymbol(exec.symbol, order.getSymbol());
+        exec.side = order.getSide();
+        exec.executionPrice = order.getPrice();
+        exec.executionQuantity = order.getFilledQuantity();
+        exec.remainingQuantity = order.getRemainingQuantity();
+        exec.status = order.getStatus();
+        char out[ProtocolV2::ExecutionReport::SIZE];
+        append(replies, out, exec.encode(out));
+        return;
+    }
+
+    ExecutionReportMessage exec;
+    exec.orderId = order.getOrderId();
+    exec.setSymbol(order.getSymbol());
+    exec.side = order.getSide();
+    exec.executionPrice = order.getPrice();
+    exec.executionQuantity = order.getFilledQuantity();
+    exec.remainingQuantity = order.getRemainingQuantity();
+    exec.status = order.getStatus();
+    append(replies, &exec, sizeof(exec));
+}
+
+FrameAction handleLogon(const Frame& frame, SessionState& state, FrameBuffer& input,
+                        std::vector<char>& replies, uint8_t maxVersion) {
+    MessageScratch<LogonMessage> scratch;
+    const LogonMessage* logon = viewMessage(frame, scratch);
+    if (!logon || state.protocolVersion != 1) {
+        return FrameAction::INVALID;  // Logon comes once, before any switch
+    }
+
+    uint32_t requested = std::max<uint32_t>(logon->protocolVersion, 1);
+    uint8_t version = static_cast<uint8_t>(std::min<uint32_t>(requested, maxVersion));
+    state.clientKey = clientInterner().intern(logon->getClientId());
+    state.loggedOn = true;
+
+    // The ack still goes out in version 1; everything after it uses the new one
+    LogonAckMessage ack;
+    ack.protocolVersion = version;
+    append(replies, &ack, sizeof(ack));
+
+    state.protocolVersion = version;
+    input.setProtocolVersion(version);
+    return FrameAction::REPLIED;
+}
+
+// A time in force this build knows, and a GTD order says until when
+bool validExpiry(TimeInForce timeInForce, uint64_t expireTime) {
+    switch (timeInForce) {
+        case TimeInForce::GTC:
+        case TimeInForce::DAY:
+            return true;
+        case TimeInForce::GTD:
+            return expireTime != 0;
+    }
+    return false;
+}
+
+FrameAction decodeV1(const Frame& frame, SessionState& state, std::vector<char>& replies,
+                     EngineCommand& command) {
+    switch (frame.type) {
+        case MessageType::NEW_ORDER: {
+            MessageScratch<NewOrderMessage> scratch;
+            const NewOrderMessage* msg = viewMessage(frame, scratch, NewOrderMessage::GTC_SIZE);
+            if (!msg || !validExpiry(msg->timeInForce, msg->expireTime)) {
+                return FrameAction::INVALID;
+            }
+            // Risk is keyed on who logged on, not on what each order claims
+            ClientKey clientKey = state.clientKey;
+            if (msg->clientId[0]) {
+                if (!state.loggedOn) {
+                    clientKey = clientInterner().intern(msg->getClientId());
+                } else if (clientInterner().find(msg->getClientId()) != clientKey ||
+                           clientKey == 0) {
+                    appendReject(replies, 1, msg->clientOrderId, RejectReason::INVALID_MESSAGE);
+                    return FrameAction::REPLIED;
+                }
+            }
+            command = EngineCommand::newOrder(0, symbolDirectory().lookup(msg->symbol),
+                                              msg->side, msg->orderType, msg->price,
+                                              msg->quantity, clientKey, msg->stopPrice);
+            command.timeInForce = msg->timeInForce;
+            command.expireTime = msg->expireTime;
+            command.clientOrderId = msg->clientOrderId;
+            return FrameAction::COMMAND;
+        }
+
+        case MessageType::CANCEL_ORDER: {
+            MessageScratch<CancelOrderMessage> scratch;
+            const CancelOrderMessage* msg = viewMessage(frame, scratch);
+            if (!msg) {
+                return FrameAction::INVALID;
+            }
+            command = EngineCommand::cancel(msg->orderId);
+            return FrameAction::COMMAND;
+        }
+
+        case MessageType::MODIFY_ORDER: {
+            MessageScratch<ModifyOrderMessage> scratch;
+            const ModifyOrderMessage* msg = viewMessage(frame, scratch);
+            if (!msg) {
+                return FrameAction::INVALID;
+            }
+            command = EngineCommand::modify(msg->orderId, msg->newPrice, msg->newQuantity);
+            return FrameAction::COMMAND;
+        }
+
+        case MessageType::MARKET_DATA_SUBSCRIBE: {
+            MessageScratch<MarketDataSubscribeMessage> scratch;
+            const MarketDataSubscribeMessage* msg = viewMessage(frame, scratch);
+            if (!msg) {
+                return FrameAction::INVALID;
+            }
+            command = EngineCommand();
+            command.symbolId = symbolDirectory().lookup(msg->symbol);
+            return FrameAction::SUBSCRIBE;
+        }
+
+        case MessageType::HEARTBEAT:
+            // Echo heartbeat back
+            if (frame.length != sizeof(HeartbeatMessage)) {
+                return FrameAction::INVALID;
+            }
+            append(replies, frame.data, frame.length);
+            return FrameAction::REPLIED;
+
+        default:
+            return FrameAction::IGNORED;
+    }
+}
+
+// Batch members are acknowledged together under the batch's reference
+void joinBatch(EngineCommand& member, OrderId reference, size_t index, size_t count) {
+    member.clientOrderId = reference;
+    member.batchIndex = static_cast<uint16_t>(index);
+    member.batchSize = static_cast<uint16_t>(count);
+}
+
+FrameAction decodeV2(const Frame& frame, SessionState& state, std::vector<char>& replies,
+                     EngineCommand& command, std::vector<EngineCommand>& batch) {
+    switch (frame.type) {
+        case MessageType::NEW_ORDER: {
+            ProtocolV2::NewOrder msg;
+            if (!msg.decode(frame) || !validExpiry(msg.timeInForce, msg.expireTime)) {
+                return FrameAction::INVALID;
+            }
+            command = EngineCommand::newOrder(
+                0, symbolDirectory().lookup(msg.symbol), msg.side,
+                msg.orderType, msg.price, msg.quantity, state.clientKey, msg.stopPrice);
+            command.timeInForce = msg.timeInForce;
+            command.expireTime = msg.expireTime;
+            command.clientOrderId = msg.clientOrderId;
+            return FrameAction::COMMAND;
+        }
+
+        case MessageType::CANCEL_ORDER: {
+            ProtocolV2::CancelOrder msg;
+            if (!msg.decode(frame)) {
+                return FrameAction::INVALID;
+            }
+            command = EngineCommand::cancel(msg.orderId);
+            return FrameAction::COMMAND;
+        }
+
+        case MessageType::MODIFY_ORDER: {
+            ProtocolV2::ModifyOrder msg;
+            if (!msg.decode(frame)) {
+                return FrameAction::INVALID;
+            }
+            command = EngineCommand::modify(msg.orderId, msg.newPrice, msg.newQuantity);
+            return FrameAction::COMMAND;
+        }
+
+        case MessageType::CANCEL_REPLACE: {
+            ProtocolV2::CancelReplace msg;
+            if (!msg.decode(frame)) {
+                return FrameAction::INVALID;
+            }
+            command = EngineCommand::modify(msg.orderId, msg.newPrice, msg.newQuantity);
+            command.clientOrderId = msg.reference;
+            return FrameAction::COMMAND;
+        }
+
+        case MessageType::NEW_ORDER_BATCH: {
+            ProtocolV2::NewOrderBatch msg;
+            if (!msg.decode(frame)) {
+                return FrameAction::INVALID;
+            }
+            SymbolId symbolId = symbolDirectory().lookup(msg.symbol);
+            batch.clear();
+            for (size_t i = 0; i < msg.count; ++i) {
+                const auto& entry = msg.entries[i];
+                batch.push_back(EngineCommand::newOrder(0, symbolId, entry.side, entry.orderType,
+                                                        entry.price, entry.quantity,
+                                                        state.clientKey));
+                joinBatch(batch.back(), msg.reference, i, msg.count);
+            }
+            return FrameAction::BATCH;
+        }
+
+        case MessageType::CANCEL_BATCH: {
+            ProtocolV2::CancelBatch msg;
+            if (!msg.decode(frame)) {
+                return FrameAction::INVALID;
+            }
+            batch.clear();
+            for (size_t i = 0; i < msg.count; ++i) {
+                batch.push_back(EngineCommand::cancel(msg.orderIds[i]));
+                joinBatch(batch.back(), msg.reference, i, msg.count);
+            }
+            return FrameAction::BATCH;
+        }
+
+        case MessageType::MODIFY_BATCH: {
+            ProtocolV2::ModifyBatch msg;
+            if (!msg.decode(frame)) {
+                return FrameAction::INVALID;
+            }
+            batch.clear();
+            for (size_t i = 0; i < msg.count; ++i) {
+                const auto& entry = msg.entries[i];
+                batch.push_back(EngineCommand::modify(entry.orderId, entry.newPrice, entry.newQuantity));
+                joinBatch(batch.back(), msg.reference, i, msg.count);
+            }
+            return FrameAction::BATCH;
+        }
+
+        case MessageType::MASS_CANCEL: {
+            ProtocolV2::MassCancel msg;
+            if (!msg.decode(frame)) {
+                return FrameAction::INVALID;
+            }
+            // A session only ever pulls its own client's orders
+            uint8_t scope = MASS_CANCEL_BY_CLIENT;
+            SymbolId symbolId = 0;
+            if (msg.symbol[0]) {
+                scope |= MASS_CANCEL_BY_SYMBOL;
+                symbolId = symbolDirectory().lookup(msg.symbol);
+            }
+            Side side = Side::BUY;
+            if (msg.side != ProtocolV2::MassCancel::BOTH_SIDES) {
+                scope |= MASS_CANCEL_BY_SIDE;
+                side = static_cast<Side>(msg.side);
+            }
+            command = EngineCommand::massCancel(scope, symbolId, side, state.clientKey);
+            command.clientOrderId = msg.reference;
+            return FrameAction::COMMAND;
+        }
+
+        case MessageType::LINK_COMMAND: {
+            // Names any client and any scope, so only a trusted gateway may
+            ProtocolV2::LinkCommand msg;
+            if (!state.linkAllowed || !msg.decode(frame)) {
+                return FrameAction::INVALID;
+            }
+            // The gateway resolved the command; only the names need
+            // interning again in this process
+            command = EngineCommand();
+            command.type = static_cast<CommandType>(msg.type);
+            command.side = msg.side;
+            command.orderType = msg.orderType;
+            command.scope = msg.scope;
+            command.symbolId = symbolDirectory().lookup(msg.symbol);
+            command.clientKey = clientInterner().intern(ProtocolV2::getClientId(msg.clientId));
+            command.orderId = msg.orderId;
+            command.price = msg.price;
+            command.quantity = msg.quantity;
+            command.stopPrice = msg.stopPrice;
+            command.timeInForce = msg.timeInForce;
+            command.expireTime = msg.expireTime;
+            command.clientOrderId = msg.tag;
+            state.link = true;
+            return FrameAction::COMMAND;
+        }
+
+        case MessageType::MARKET_DATA_SUBSCRIBE: {
+            ProtocolV2::MarketDataSubscribe msg;
+            if (!msg.decode(frame)) {
+                return FrameAction::INVALID;
+            }
+            command = EngineCommand();
+            command.symbolId = symbolDirectory().lookup(msg.symbol);
+            return FrameAction::SUBSCRIBE;
+        }
+
+        case MessageType::HEARTBEAT:
+            if (frame.length != ProtocolV2::Heartbeat::SIZE) {
+                return FrameAction::INVALID;
+            }
+            append(replies, frame.data, frame.length);
+            return FrameAction::REPLIED;
+
+        default:
+            return FrameAction::IGNORED;
+    }
+}
+
+} // namespace
+
+FrameAction decodeFrame(const Frame& frame, SessionState& state, FrameBuffer& input,
+                        std::vector<char>& replies, EngineCommand& command,
+                        std::vector<EngineCommand>& batch, uint8_t maxVersion) {
+    if (frame.type == MessageType::LOGON) {
+        return handleLogon(frame, state, input, replies, maxVersion);
+    }
+
+    FrameAction action = frame.version >= ProtocolV2::VERSION
+        ? decodeV2(frame, state, replies, command, batch)
+        : decodeV1(frame, state, replies, command);
+    if (action == FrameAction::IGNORED) {
+        std::cerr << "Unknown message type received" << std::endl;
+    }
+    return action;
+}
+
+void appendCommandResult(std::vector<char>& replies, uint8_t version,
+                         const EngineCommand& command, bool success, const Order* order) {
+    switch (command.type) {
+        case CommandType::NEW_ORDER:
+            if (!success) {
+                appendReject(replies, version, command.clientOrderId, command.reject);
+                break;
+            }
+            appendAck(replies, version, command.clientOrderId, command.orderId,
+                      OrderStatus::PENDING, RejectReason::NONE, "Order accepted");
+            // Execution report once the order has traded or finished
+            if (order && order->getStatus() != OrderStatus::PENDING) {
+                appendExecutionReport(replies, version, *order);
+            }
+            break;
+
+        case CommandType::CANCEL_ORDER:
+            if (success) {
+                appendAck(replies, version, 0, command.orderId, OrderStatus::CANCELLED,
+                          RejectReason::NONE, "Order cancelled");
+            } else {
+                appendAck(replies, version, 0, command.orderId, OrderStatus::REJECTED,
+                          RejectReason::ORDER_NOT_FOUND, "");
+            }
+            break;
+
+        case CommandType::MODIFY_ORDER:
+            // clientOrderId is the reference of a CANCEL_REPLACE, 0 otherwise
+            if (success) {
+                appendAck(replies, version, command.clientOrderId, command.orderId,
+                          OrderStatus::PENDING, RejectReason::NONE, "Order modified");
+            } else {
+                appendAck(replies, version, command.clientOrderId, command.orderId,
+                          OrderStatus::REJECTED, modifyRejectReason(command), "");
+            }
+            break;
+
+        case CommandType::MASS_CANCEL: {
+            ProtocolV2::MassCancelAck ack;
+            ack.reference = command.clientOrderId;
+            ack.cancelled = static_cast<uint32_t>(command.quantity);
+            char out[ProtocolV2::MassCancelAck::SIZE];
+            append(replies, out, ack.encode(out));
+            break;
+        }
+    }
+}
+
+void appendLinkResult(std::vector<char>& replies, const EngineCommand& command, bool success,
+                      const Order* order) {
+    ProtocolV2::LinkResult result;
+    result.tag = command.clientOrderId;
+    result.success = success;
+    result.reason = command.reject;
+    result.orderId = command.orderId;
+    result.quantity = command.type == CommandType::MASS_CANCEL ? command.quantity : 0;
+    if (order) {
+        result.hasReport = true;
+        result.status = order->getStatus();
+        result.price = order->getPrice();
+        result.filledQuantity = order->getFilledQuantity();
+        result.remainingQuantity = order->getRemainingQuantity();
+    }
+    char out[ProtocolV2::LinkResult::SIZE];
+    append(replies, out, result.encode(out));
+}
+
+bool BatchReply::add(const EngineCommand& command, bool success, const Order* order) {
+    type_ = command.type;
+    ack_.reference = command.clientOrderId;
+    ack_.count = command.batchSize;
+
+    ProtocolV2::BatchAck::Entry& entry = ack_.entries[command.batchIndex % ProtocolV2::MAX_BATCH];
+    entry.orderId = command.orderId;
+    switch (command.type) {
+        case CommandType::NEW_ORDER:
+            entry.status = success ? OrderStatus::PENDING : OrderStatus::REJECTED;
+            entry.reason = success ? RejectReason::NONE : command.reject;
+            if (order && order->getStatus() != OrderStatus::PENDING) {
+                appendExecutionReport(reports_, ProtocolV2::VERSION, *order);
+            }
+            break;
+        case CommandType::CANCEL_ORDER:
+            entry.status = success ? OrderStatus::CANCELLED : OrderStatus::REJECTED;
+            entry.reason = success ? RejectReason::NONE : RejectReason::ORDER_NOT_FOUND;
+            break;
+        case CommandType::MODIFY_ORDER:
+            entry.status = success ? OrderStatus::PENDING : OrderStatus::REJECTED;
+            entry.reason = success ? RejectReason::NONE : modifyRejectReason(command);
+            break;
+        case CommandType::MASS_CANCEL:
+            cancelled_ += command.quantity;
+            break;
+    }
+    return ++reported_ >= command.batchSize;
+}
+
+void BatchReply::append(std::vector<char>& replies) const {
+    if (type_ == CommandType::MASS_CANCEL) {
+        ProtocolV2::MassCancelAck ack;
+        ack.reference = ack_.reference;
+        ack.cancelled = static_cast<uint32_t>(cancelled_);
+        char out[ProtocolV2::MassCancelAck::SIZE];
+        ::MatchingEngine::append(replies, out, ack.encode(out));
+        return;
+    }
+    char out[ProtocolV2::BatchAck::FIXED_SIZE + ProtocolV2::MAX_BATCH * ProtocolV2::BatchAck::ENTRY_SIZE];
+    ::MatchingEngine::append(replies, out, ack_.encode(out));
+    replies.insert(replies.end(), reports_.begin(), reports_.end());
+}
+
+void appendBookUpdate(std::vector<char>& replies, uint8_t version, const LevelUpdate& update) {
+    const std::string& symbol = symbolInterner().name(update.symbolId);
+    if (version >= ProtocolV2::VERSION) {
+        ProtocolV2::BookUpdate wire;
+        ProtocolV2::setSymbol(wire.symbol, symbol);
+        wire.side = update.side;
+        wire.price = update.price;
+        wire.quantity = update.quantity;
+        wire.orderCount = update.orderCount;
+        char out[ProtocolV2::BookUpdate::SIZE];
+        append(replies, out, wire.encode(out));
+        return;
+    }
+
+    BookUpdateMessage msg;
+    msg.setSymbol(symbol);
+    msg.side = update.side;
+    msg.price = update.price;
+    msg.quantity = update.quantity;
+    msg.orderCount = update.orderCount;
+    append(replies, &msg, sizeof(msg));
+}
+
+void logCommand(const EngineCommand& command) {
+    switch (command.type) {
+        case CommandType::NEW_ORDER:
+            std::cout << "[SERVER] New order: " << symbolInterner().name(command.symbolId)
+                      << " " << sideToString(command.side)
+                      << " " << command.quantity << " @ " << priceToDouble(command.price)
+                      << '\n';
+            break;
+        case CommandType::CANCEL_ORDER:
+            std::cout << "[SERVER] Cancel order: " << command.orderId << '\n';
+            break;
+        case CommandType::MODIFY_ORDER:
+            std::cout << "[SERVER] Modify order: " << command.orderId
+                      << " new price: " << priceToDouble(command.price)
+                      << " new qty: " << command.quantity << '\n';
+            break;
+        case CommandType::MASS_CANCEL:
+            std::cout << "[SERVER] Mass cancel: "
+                      << ((command.scope & MASS_CANCEL_BY_SYMBOL)
+                              ? symbolInterner().name(command.symbolId) : std::string("all symbols"))
+                      << ((command.scope & MASS_CANCEL_BY_SIDE) ? " " + sideToString(command.side)
+                                                                : std::string())
+                      << '\n';
+            break;
+    }
+}
+
+} // namespace MatchingEngine
@@ -0,0 +1,497 @@
+#include "ShardedEngine.h"
+#include "Interner.h"
+#include "ThreadUtil.h"
+#include "Journal.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+namespace MatchingEngine {
+
+namespace {
+
+constexpr size_t SHARD_BATCH_SIZE = 64;
+
+EngineConfig shardCoreConfig(const ExpiryConfig& expiry) {
+    EngineConfig config;
+    config.synchronized = false;  // Only the shard thread touches its core
+    config.expiry = expiry;
+    return config;
+}
+
+} // namespace
+
+ShardedEngine::Shard::Shard(size_t queueCapacity, const ExpiryConfig& expiry)
+    : core(shardCoreConfig(expiry))
+    , queue(queueCapacity) {
+}
+
+ShardedEngine::ShardedEngine(const ShardedEngineConfig& config)
+    : config_(config)
+    , routes_(ROUTE_CACHE_SIZE)
+    , running_(false)
+    , snapshotJob_(nullptr) {
+    config_.shardCount = std::min(std::max<size_t>(config_.shardCount, 1), MAX_SHARDS);
+    if (!config_.symbolHash) {
+        config_.symbolHash = std::hash<std::string>();
+    }
+    
+    shards_.reserve(config_.shardCount);
+    for (size_t i = 0; i < config_.shardCount; ++i) {
+        shards_.push_back(std::make_unique<Shard>(config_.queueCapacity, config_.expiry));
+        shards_.back()->index = i;
+    }
+}
+
+ShardedEngine::~ShardedEngine() {
+    stop();
+}
+
+void ShardedEngine::start() {
+    if (running_) {
+        return;
+    }
+    
+    reserveIssuedIds();
+    running_ = true;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        Shard& shard = *shards_[i];
+        shard.thread = std::thread(&ShardedEngine::runShard, this, std::ref(shard));
+        if (i < config_.shardCpus.size()) {
+            pinThreadToCpu(shard.thread, config_.shardCpus[i]);
+        }
+    }
+}
+
+void ShardedEngine::stop() {
+    if (!running_) {
+        return;
+    }
+    
+    running_ = false;
+    for (auto& shard : shards_) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+}
+
+OrderId ShardedEngine::submitOrder(
+    const std::string& symbol,
+    Side side,
+    OrderType type,
+    Price price,
+    Quantity quantity,
+    const std::string& clientId,
+    Price stopPrice) {
+    
+    return submit(EngineCommand::newOrder(0, symbolInterner().intern(symbol), side, type, price,
+                                          quantity, clientInterner().intern(clientId),
+                                          stopPrice));
+}
+
+bool ShardedEngine::cancelOrder(OrderId orderId) {
+    return submit(EngineCommand::cancel(orderId)) != 0;
+}
+
+bool ShardedEngine::modifyOrder(OrderId orderId, Price newPrice, Quantity newQuantity) {
+    return submit(EngineCommand::modify(orderId, newPrice, newQuantity)) != 0;
+}
+
+size_t ShardedEngine::route(EngineCommand& command) {
+    if (command.type == CommandType::NEW_ORDER) {
+        size_t shardIndex = shardFor(command.symbolId);
+        uint64_t sequence =
+            shards_[shardIndex]->nextSequence.fetch_add(1, std::memory_order_relaxed);
+        command.orderId = (OrderId(config_.nodeId) << NODE_SHIFT) | (sequence << SHARD_BITS) |
+                          shardIndex;
+        return shardIndex;
+    }
+    if (command.type == CommandType::MASS_CANCEL) {
+        command.orderId = shardFor(command.symbolId);
+    }
+    return shardOf(command.orderId);
+}
+
+OrderId ShardedEngine::submit(EngineCommand command) {
+    if (command.type == CommandType::MASS_CANCEL && !(command.scope & MASS_CANCEL_BY_SYMBOL)) {
+        // Every shard holds some of the orders; each acknowledges its share
+        command.batchSize = static_cast<uint16_t>(shards_.size());
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            command.orderId = i;
+            command.batchIndex = static_cast<uint16_t>(i);
+            if (!enqueue(*shards_[i], command)) {
+                return 0;
+            }
+        }
+        return shards_.size();
+    }
+    
+    size_t shardIndex = route(command);
+    if (shardIndex >= shards_.size()) {
+        return 0;
+    }
+    if (!enqueue(*shards_[shardIndex], command)) {
+        return 0;
+    }
+    return command.type == CommandType::MASS_CANCEL ? 1 : command.orderId;
+}
+
+bool ShardedEngine::submitBatch(EngineCommand* commands, size_t count) {
+    // Members whose id names no shard go to shard 0, which reports them not found
+    thread_local std::vector<uint16_t> shardOfMember;
+    thread_local std::vector<EngineCommand> group;
+    shardOfMember.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t shardIndex = route(commands[i]);
+        shardOfMember[i] = static_cast<uint16_t>(shardIndex < shards_.size() ? shardIndex : 0);
+    }
+    
+    // One contiguous push per shard the batch touches - usually just one
+    bool queued = true;
+    thread_local std::vector<bool> done;
+    done.assign(shards_.size(), false);
+    for (size_t i = 0; i < count; ++i) {
+        size_t shardIndex = shardOfMember[i];
+        if (done[shardIndex]) {
+            continue;
+        }
+        done[shardIndex] = true;
+        group.clear();
+        for (size_t j = i; j < count; ++j) {
+            if (shardOfMember[j] == shardIndex) {
+                group.push_back(commands[j]);
+            }
+        }
+        queued = enqueueBatch(*shards_[shardIndex], group.data(), group.size()) && queued;
+    }
+    return queued;
+}
+
+void ShardedEngine::flush() {
+    for (auto& shard : shards_) {
+        uint64_t target = shard->enqueued.load(std::memory_order_acquire);
+        while (running_ && shard->processed.load(std::memory_order_acquire) < target) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+size_t ShardedEngine::shardFor(const std::string& symbol) const {
+    return config_.symbolHash(symbol) % shards_.size();
+}
+
+size_t ShardedEngine::shardFor(SymbolId symbolId) {
+    if (symbolId >= routes_.size()) {
+        return shardFor(symbolInterner().name(symbolId));
+    }
+    uint16_t route = routes_[symbolId].load(std::memory_order_relaxed);
+    if (route == 0) {
+        route = static_cast<uint16_t>(shardFor(symbolInterner().name(symbolId)) + 1);
+        routes_[symbolId].store(route, std::memory_order_relaxed);
+    }
+    return route - 1;
+}
+
+Price ShardedEngine::getBestBid(const std::string& symbol) {
+    return shards_[shardFor(symbol)]->core.getBestBid(symbol);
+}
+
+Price ShardedEngine::getBestAsk(const std::string& symbol) {
+    return shards_[shardFor(symbol)]->core.getBestAsk(symbol);
+}
+
+void ShardedEngine::setDefaultBookConfig(const OrderBookConfig& config) {
+    for (auto& shard : shards_) {
+        shard->core.setDefaultBookConfig(config);
+    }
+}
+
+void ShardedEngine::setRiskLimits(const RiskLimits& limits) {
+    for (auto& shard : shards_) {
+        shard->core.getRiskCheck().setDefaultLimits(limits);
+    }
+}
+
+void ShardedEngine::setClientRiskLimits(ClientKey clientKey, const RiskLimits& limits) {
+    for (auto& shard : shards_) {
+        shard->core.getRiskCheck().setClientLimits(clientKey, limits);
+    }
+}
+
+void ShardedEngine::setBookConfig(const std::string& symbol, const OrderBookConfig& config) {
+    shards_[shardFor(symbol)]->core.setBookConfig(symbol, config);
+}
+
+void ShardedEngine::setEventRing(EventRing* events) {
+    for (auto& shard : shards_) {
+        shard->core.setEventRing(events);
+    }
+}
+
+void ShardedEngine::setOrderCallback(OrderCallback callback) {
+    for (auto& shard : shards_) {
+        shard->core.setOrderCallback(callback);
+    }
+}
+
+void ShardedEngine::setTradeCallback(TradeCallback callback) {
+    for (auto& shard : shards_) {
+        shard->core.setTradeCallback(callback);
+    }
+}
+
+void ShardedEngine::setCommandHook(CommandHook hook) {
+    for (auto& shard : shards_) {
+        shard->core.setCommandHook(hook);
+    }
+}
+
+size_t ShardedEngine::getTotalOrders() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->core.getTotalOrders();
+    }
+    return total;
+}
+
+size_t ShardedEngine::getTotalTrades() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->core.getTotalTrades();
+    }
+    return total;
+}
+
+bool ShardedEngine::enqueueBatch(Shard& shard, const EngineCommand* commands, size_t count) {
+    // A batch larger than the ring can't be placed in one piece
+    size_t capacity = shard.queue.capacity();
+    while (count > 0) {
+        size_t piece = std::min(count, capacity);
+        while (!shard.queue.tryPushBatch(commands, piece)) {
+            if (!running_) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        shard.enqueued.fetch_add(piece, std::memory_order_release);
+        commands += piece;
+        count -= piece;
+    }
+    return true;
+}
+
+bool ShardedEngine::enqueue(Shard& shard, const EngineCommand& command) {
+    // Back-pressure: wait for the shard to make room rather than drop
+    while (!shard.queue.tryPush(command)) {
+        if (!running_) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    shard.enqueued.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+void ShardedEngine::runShard(Shard& shard) {
+    EngineCommand batch[SHARD_BATCH_SIZE];
+    size_t idlePolls = 0;
+    metrics().nameThread("shard-" + std::to_string(shard.index));
+    
+    while (running_.load(std::memory_order_acquire)) {
+        if (shard.snapshotPending.load(std::memory_order_acquire)) {
+            captureShard(shard);
+        }
+        expireDue(shard);
+        if (drain(shard, batch) > 0) {
+            idlePolls = 0;
+            continue;
+        }
+        
+        // Spin first so a burst is picked up immediately, then back off
+        if (++idlePolls < config_.spinIterations) {
+            cpuRelax();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    
+    // Apply whatever was queued before stop()
+    while (drain(shard, batch) > 0) {
+    }
+    if (shard.snapshotPending.load(std::memory_order_acquire)) {
+        captureShard(shard);
+    }
+}
+
+void ShardedEngine::expireDue(Shard& shard) {
+    // The clock is only read while something is scheduled
+    uint64_t check = shard.core.nextExpiryCheck();
+    if (check == UINT64_MAX) {
+        return;
+    }
+    uint64_t now = timestampToNanos(getCurrentTimestamp());
+    if (now >= check) {
+        shard.core.expireOrders(now, config_.expiryBatch);
+    }
+}
+
+void ShardedEngine::captureShard(Shard& shard) {
+    SnapshotJob& job = *snapshotJob_;
+    shard.core.captureSnapshot(job.shards[shard.index]);
+    shard.snapshotPending.store(false, std::memory_order_relaxed);
+    
+    std::lock_guard<std::mutex> lock(job.mutex);
+    if (--job.remaining == 0) {
+        job.done.notify_one();
+    }
+}
+
+bool ShardedEngine::snapshot(const std::string& path, uint64_t* coveredSequence) {
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+    SnapshotJob job;
+    job.shards.resize(shards_.size());
+    
+    if (!running_) {
+        for (auto& shard : shards_) {
+            shard->core.captureSnapshot(job.shards[shard->index]);
+        }
+    } else {
+        job.remaining = shards_.size();
+        snapshotJob_ = &job;
+        for (auto& shard : shards_) {
+            shard->snapshotPending.store(true, std::memory_order_release);
+        }
+        std::unique_lock<std::mutex> jobLock(job.mutex);
+        job.done.wait(jobLock, [&job]() { return job.remaining == 0; });
+        snapshotJob_ = nullptr;
+    }
+    
+    if (coveredSequence) {
+        *coveredSequence = job.shards[0].journalSequence;
+        for (const EngineSnapshot& shard : job.shards) {
+            *coveredSequence = std::min(*coveredSequence, shard.journalSequence);
+        }
+    }
+    return writeSnapshot(path, job.shards);
+}
+
+bool ShardedEngine::recover(const std::string& snapshotPath,
+                            const std::string& journalDirectory) {
+    if (running_) {
+        return false;
+    }
+    
+    std::vector<EngineSnapshot> snapshots;
+    std::error_code error;
+    if (!snapshotPath.empty() && std::filesystem::exists(snapshotPath, error)) {
+        if (!readSnapshot(snapshotPath, snapshots) || snapshots.size() != shards_.size()) {
+            std::cerr << "Snapshot " << snapshotPath << " is damaged or was taken with a "
+                      << "different shard count" << std::endl;
+            return false;
+        }
+        for (auto& shard : shards_) {
+            if (!shard->core.loadSnapshot(snapshots[shard->index])) {
+                return false;
+            }
+        }
+    }
+    
+    // Each shard journals its own commands in order, so a record is already
+    // reflected exactly when it is at or below its shard's snapshot point
+    if (!journalDirectory.empty()) {
+        std::vector<uint64_t> covered;
+        uint64_t after = UINT64_MAX;
+        for (auto& shard : shards_) {
+            covered.push_back(shard->core.getJournalSequence());
+            after = std::min(after, covered.back());
+        }
+        bool read = Journal::read(journalDirectory, after,
+                                  [&](uint64_t sequence, const EngineCommand& command) {
+                                      size_t index = shardOf(command.orderId);
+                                      if (index < shards_.size() && sequence > covered[index]) {
+                                          shards_[index]->core.replay(command, sequence);
+                                      }
+                                  });
+        if (!read) {
+            return false;
+        }
+    }
+    
+    reserveIssuedIds();
+    return true;
+}
+
+bool ShardedEngine::applySequenced(const EngineCommand& command) {
+    if (running_) {
+        return false;
+    }
+    size_t index = shardOf(command.orderId);
+    if (index >= shards_.size()) {
+        return false;
+    }
+    MatchingEngineCore& core = shards_[index]->core;
+    if (command.type == CommandType::MASS_CANCEL) {
+        core.massCancel(command);
+        return true;
+    }
+    return core.execute(command);
+}
+
+void ShardedEngine::reserveIssuedIds() {
+    // Never hand out an id that was issued before - by this process before
+    // a restart, or by the primary this engine took over from
+    for (auto& shard : shards_) {
+        OrderId next = shard->core.getNextOrderId();
+        if (next > 1) {
+            uint64_t sequence = (((next - 1) & ~(~OrderId(0) << NODE_SHIFT)) >> SHARD_BITS) + 1;
+            if (sequence > shard->nextSequence) {
+                shard->nextSequence = sequence;
+            }
+        }
+    }
+}
+
+size_t ShardedEngine::drain(Shard& shard, EngineCommand* batch) {
+    size_t count = shard.queue.popBatch(batch, SHARD_BATCH_SIZE);
+    Order report(0, SymbolId(0), Side::BUY, OrderType::LIMIT, 0, 0);
+    for (size_t i = 0; i < count; ++i) {
+        EngineCommand& command = batch[i];
+        if (command.receivedAt != 0) {
+            stageEnd(Stage::QUEUE, command.receivedAt);
+        }
+        bool success = true;
+        if (command.type == CommandType::MASS_CANCEL) {
+            command.quantity = shard.core.massCancel(command);
+        } else if ((command.type == CommandType::NEW_ORDER ||
+                    command.type == CommandType::MODIFY_ORDER) &&
+                   (command.reject = shard.core.checkRisk(command)) != RejectReason::NONE) {
+            success = false;  // Refused before it reached the book or the journal
+        } else {
+            success = shard.core.execute(command, &report);
+        }
+        if (commandCallback_) {
+            StageTimer timer(Stage::DISPATCH);
+            bool reported = command.type == CommandType::NEW_ORDER && success;
+            commandCallback_(command, success, reported ? &report : nullptr);
+        }
+    }
+    if (count > 0) {
+        uint64_t processed = shard.processed.fetch_add(count, std::memory_order_release) + count;
+        if (metrics().isEnabled()) {
+            ThreadMetrics& local = metrics().local();
+            local.add(Counter::COMMANDS, count);
+            // A producer counts its push after making it, so this can lag
+            uint64_t enqueued = shard.enqueued.load(std::memory_order_relaxed);
+            local.set(Gauge::QUEUE_DEPTH, enqueued > processed ? static_cast<int64_t>(enqueued - processed) : 0);
+            local.set(Gauge::RESTING_ORDERS, static_cast<int64_t>(shard.core.getLiveOrders()));
+            local.set(Gauge::BOOKS, static_cast<int64_t>(shard.core.getBookCount()));
+            local.set(Gauge::ORDER_CAPACITY, static_cast<int64_t>(shard.core.getOrderCapacity()));
+        }
+    }
+    return count;
+}
+
+} // namespace MatchingEngine
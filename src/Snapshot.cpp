@@ -0,0 +1,247 @@
+#include "Snapshot.h"
+#include "Interner.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace MatchingEngine {
+
+namespace {
+
+// The last byte is the format version; version 1 orders had no expiry
+constexpr char SNAPSHOT_MAGIC[8] = {'M', 'E', 'S', 'N', 'A', 'P', 0, 2};
+constexpr size_t MAGIC_PREFIX = 7;
+constexpr size_t SYMBOL_SIZE = 16;
+constexpr size_t CLIENT_SIZE = 32;
+constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+struct FileHeader {
+    char magic[8];
+    uint64_t engineCount;
+};
+
+struct SectionHeader {
+    uint64_t journalSequence;
+    uint64_t nextOrderId;
+    uint64_t orderCount;
+};
+
+// One resting order on disk
+struct SnapshotOrder {
+    OrderId orderId;
+    Price price;
+    Quantity quantity;
+    Quantity remainingQuantity;
+    Price stopPrice;
+    uint8_t side;
+    uint8_t type;
+    uint8_t status;
+    uint8_t timeInForce;
+    uint8_t reserved[4];
+    char symbol[SYMBOL_SIZE];
+    char clientId[CLIENT_SIZE];
+    uint64_t expireTime;  // 0 for GTC
+};
+
+static_assert(sizeof(SnapshotOrder) == 104, "SnapshotOrder is a fixed on-disk layout");
+
+// Version 1 records stop before expireTime
+constexpr size_t VERSION_1_ORDER_SIZE = offsetof(SnapshotOrder, expireTime);
+
+// FNV-1a over everything before the trailer
+class Checksum {
+public:
+    void update(const void* data, size_t length) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < length; ++i) {
+            hash_ = (hash_ ^ bytes[i]) * 1099511628211ULL;
+        }
+    }
+    uint64_t value() const { return hash_; }
+
+private:
+    uint64_t hash_ = 14695981039346656037ULL;
+};
+
+void copyName(char* out, size_t size, const std::string& name) {
+    std::memset(out, 0, size);
+    std::memcpy(out, name.data(), name.size() < size ? name.size() : size);
+}
+
+bool writeAll(std::FILE* file, Checksum& checksum, const void* data, size_t length) {
+    checksum.update(data, length);
+    return std::fwrite(data, 1, length, file) == length;
+}
+
+// Interns names read back, skipping the lookup for runs of the same name
+class NameCache {
+public:
+    explicit NameCache(StringInterner& interner) : interner_(interner), id_(0) {}
+
+    uint32_t intern(const char* data, size_t size) {
+        size_t length = strnlen(data, size);
+        if (last_.size() != length || last_.compare(0, length, data, length) != 0) {
+            last_.assign(data, length);
+            id_ = interner_.intern(last_);
+        }
+        return id_;
+    }
+
+private:
+    StringInterner& interner_;
+    std::string last_;
+    uint32_t id_;
+};
+
+} // namespace
+
+bool writeSnapshot(const std::string& path, const std::vector<EngineSnapshot>& engines) {
+    std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to create snapshot " << temporary << std::endl;
+        return false;
+    }
+    std::unique_ptr<char[]> buffer(new char[WRITE_BUFFER_SIZE]);
+    std::setvbuf(file, buffer.get(), _IOFBF, WRITE_BUFFER_SIZE);
+
+    Checksum checksum;
+    FileHeader header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.engineCount = engines.size();
+    bool ok = writeAll(file, checksum, &header, sizeof(header));
+
+    for (const EngineSnapshot& engine : engines) {
+        SectionHeader section{engine.journalSequence, engine.nextOrderId, engine.orders.size()};
+        ok = ok && writeAll(file, checksum, &section, sizeof(section));
+
+        bool expiring = engine.expireTimes.size() == engine.orders.size();
+        for (size_t i = 0; i < engine.orders.size(); ++i) {
+            const Order& order = engine.orders[i];
+            SnapshotOrder record;
+            std::memset(&record, 0, sizeof(record));
+            record.orderId = order.getOrderId();
+            record.price = order.getPrice();
+            record.quantity = order.getQuantity();
+            record.remainingQuantity = order.getRemainingQuantity();
+            record.stopPrice = order.getStopPrice();
+            record.side = static_cast<uint8_t>(order.getSide());
+            record.type = static_cast<uint8_t>(order.getType());
+            record.status = static_cast<uint8_t>(order.getStatus());
+            if (expiring && engine.expireTimes[i] != 0) {
+                record.timeInForce = static_cast<uint8_t>(order.getTimeInForce());
+                record.expireTime = engine.expireTimes[i];
+            }
+            copyName(record.symbol, SYMBOL_SIZE, order.getSymbol());
+            copyName(record.clientId, CLIENT_SIZE, order.getClientId());
+            ok = ok && writeAll(file, checksum, &record, sizeof(record));
+        }
+    }
+
+    uint64_t trailer = checksum.value();
+    ok = ok && std::fwrite(&trailer, sizeof(trailer), 1, file) == 1;
+    ok = std::fflush(file) == 0 && ok;
+#ifndef _WIN32
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    std::fclose(file);
+
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write snapshot " << path << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readSnapshot(const std::string& path, std::vector<EngineSnapshot>& engines) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    // One read of the whole file; sections are then decoded from memory
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    if (size < static_cast<long>(sizeof(FileHeader) + sizeof(uint64_t))) {
+        std::fclose(file);
+        return false;
+    }
+    std::vector<char> data(static_cast<size_t>(size));
+    bool complete = std::fread(data.data(), 1, data.size(), file) == data.size();
+    std::fclose(file);
+    if (!complete) {
+        return false;
+    }
+
+    size_t bodySize = data.size() - sizeof(uint64_t);
+    Checksum checksum;
+    checksum.update(data.data(), bodySize);
+    uint64_t trailer;
+    std::memcpy(&trailer, data.data() + bodySize, sizeof(trailer));
+    FileHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (trailer != checksum.value() ||
+        std::memcmp(header.magic, SNAPSHOT_MAGIC, MAGIC_PREFIX) != 0 ||
+        header.magic[MAGIC_PREFIX] < 1 || header.magic[MAGIC_PREFIX] > SNAPSHOT_MAGIC[MAGIC_PREFIX]) {
+        return false;
+    }
+    size_t recordSize = header.magic[MAGIC_PREFIX] == 1 ? VERSION_1_ORDER_SIZE
+                                                        : sizeof(SnapshotOrder);
+
+    NameCache symbols(symbolInterner());
+    NameCache clients(clientInterner());
+    size_t offset = sizeof(FileHeader);
+    engines.assign(header.engineCount, EngineSnapshot());
+    for (EngineSnapshot& engine : engines) {
+        SectionHeader section;
+        if (bodySize - offset < sizeof(section)) {
+            return false;
+        }
+        std::memcpy(&section, data.data() + offset, sizeof(section));
+        offset += sizeof(section);
+        if ((bodySize - offset) / recordSize < section.orderCount) {
+            return false;
+        }
+
+        engine.journalSequence = section.journalSequence;
+        engine.nextOrderId = section.nextOrderId;
+        engine.orders.reserve(section.orderCount);
+        bool expiring = false;
+        for (uint64_t i = 0; i < section.orderCount; ++i) {
+            SnapshotOrder record;
+            std::memset(&record, 0, sizeof(record));
+            std::memcpy(&record, data.data() + offset, recordSize);
+            offset += recordSize;
+
+            engine.orders.emplace_back(record.orderId, symbols.intern(record.symbol, SYMBOL_SIZE),
+                                       static_cast<Side>(record.side),
+                                       static_cast<OrderType>(record.type), record.price,
+                                       record.quantity, record.stopPrice,
+                                       clients.intern(record.clientId, CLIENT_SIZE));
+            Order& order = engine.orders.back();
+            order.fill(record.quantity - record.remainingQuantity);
+            order.setStatus(static_cast<OrderStatus>(record.status));
+            if (record.expireTime != 0) {
+                order.setTimeInForce(static_cast<TimeInForce>(record.timeInForce));
+                if (!expiring) {
+                    engine.expireTimes.assign(i, 0);
+                    expiring = true;
+                }
+            }
+            if (expiring) {
+                engine.expireTimes.push_back(record.expireTime);
+            }
+        }
+    }
+    return offset == bodySize;
+}
+
+} // namespace MatchingEngine
@@ -0,0 +1,233 @@
+#include "TimingWheel.h"
+#include <algorithm>
+#include <limits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace MatchingEngine {
+
+namespace {
+
+constexpr uint32_t NIL = std::numeric_limits<uint32_t>::max();
+
+unsigned lowestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+}
+
+unsigned highestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+}
+
+size_t digitOf(uint64_t tick, size_t level) {
+    return static_cast<size_t>((tick >> (level * TimingWheel::LEVEL_BITS)) &
+                               (TimingWheel::SLOTS - 1));
+}
+
+// Tick bits below level's own byte
+uint64_t lowerBits(size_t level) {
+    return (uint64_t(1) << (level * TimingWheel::LEVEL_BITS)) - 1;
+}
+
+} // namespace
+
+TimingWheel::TimingWheel(uint64_t tickNanos)
+    : tickNanos_(std::max<uint64_t>(tickNanos, 1))
+    , current_(0)
+    , freeList_(NIL) {
+    heads_.fill(NIL);
+    for (auto& level : occupied_) {
+        level.fill(0);
+    }
+}
+
+void TimingWheel::schedule(OrderId orderId, uint64_t expireTime) {
+    cancel(orderId);
+    uint32_t node;
+    if (freeList_ != NIL) {
+        node = freeList_;
+        freeList_ = nodes_[node].next;
+    } else {
+        node = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+    }
+    nodes_[node].orderId = orderId;
+    nodes_[node].expireTime = expireTime;
+    index_.insert(orderId, node);
+    place(node);
+}
+
+bool TimingWheel::cancel(OrderId orderId) {
+    const uint32_t* node = index_.find(orderId);
+    if (!node) {
+        return false;
+    }
+    uint32_t found = *node;
+    index_.erase(orderId);
+    unlink(found);
+    release(found);
+    return true;
+}
+
+size_t TimingWheel::advance(uint64_t now, size_t limit, std::vector<OrderId>& due) {
+    uint64_t nowTick = now / tickNanos_;
+    size_t taken = 0;
+    while (taken < limit) {
+        uint64_t tick;
+        size_t level;
+        if (!nextEvent(tick, level) || tick > nowTick) {
+            // Nothing else has passed; later schedules place against now
+            moveTo(std::max(current_, nowTick + 1));
+            break;
+        }
+        if (level > 0) {
+            moveTo(tick);  // Which cascades the slot
+            continue;
+        }
+        current_ = tick;
+        size_t slot = digitOf(tick, level);
+
+        uint32_t& head = heads_[slot];
+        while (head != NIL && taken < limit) {
+            uint32_t node = head;
+            due.push_back(nodes_[node].orderId);
+            index_.erase(nodes_[node].orderId);
+            unlink(node);
+            release(node);
+            ++taken;
+        }
+        if (head != NIL) {
+            break;  // The rest of this tick goes first next time
+        }
+        moveTo(tick + 1);
+    }
+    return taken;
+}
+
+uint64_t TimingWheel::nextCheck() const {
+    uint64_t tick;
+    size_t level;
+    if (!nextEvent(tick, level)) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    if (tick > std::numeric_limits<uint64_t>::max() / tickNanos_) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return tick * tickNanos_;
+}
+
+uint64_t TimingWheel::expireTimeOf(OrderId orderId) const {
+    const uint32_t* node = index_.find(orderId);
+    return node ? nodes_[*node].expireTime : 0;
+}
+
+uint64_t TimingWheel::dueTick(uint64_t expireTime) const {
+    // Rounded up, so an order never leaves before its time
+    uint64_t tick = expireTime / tickNanos_ + (expireTime % tickNanos_ != 0 ? 1 : 0);
+    return std::max(tick, current_);
+}
+
+void TimingWheel::place(uint32_t node) {
+    uint64_t tick = dueTick(nodes_[node].expireTime);
+    uint64_t differ = tick ^ current_;
+    size_t level = differ == 0 ? 0 : highestBit(differ) / LEVEL_BITS;
+    size_t slot = digitOf(tick, level);
+    size_t bucket = level * SLOTS + slot;
+
+    Node& entry = nodes_[node];
+    entry.slot = static_cast<uint32_t>(bucket);
+    entry.prev = NIL;
+    entry.next = heads_[bucket];
+    if (entry.next != NIL) {
+        nodes_[entry.next].prev = node;
+    }
+    heads_[bucket] = node;
+    occupied_[level][slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+void TimingWheel::unlink(uint32_t node) {
+    Node& entry = nodes_[node];
+    if (entry.prev != NIL) {
+        nodes_[entry.prev].next = entry.next;
+    } else {
+        heads_[entry.slot] = entry.next;
+    }
+    if (entry.next != NIL) {
+        nodes_[entry.next].prev = entry.prev;
+    }
+    if (heads_[entry.slot] == NIL) {
+        size_t level = entry.slot / SLOTS;
+        size_t slot = entry.slot % SLOTS;
+        occupied_[level][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    }
+}
+
+void TimingWheel::release(uint32_t node) {
+    nodes_[node].next = freeList_;
+    freeList_ = node;
+}
+
+void TimingWheel::cascade(size_t level, size_t slot) {
+    size_t bucket = level * SLOTS + slot;
+    uint32_t node = heads_[bucket];
+    heads_[bucket] = NIL;
+    occupied_[level][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+
+    // current_ is now at this slot's start, so each order lands lower down
+    while (node != NIL) {
+        uint32_t next = nodes_[node].next;
+        place(node);
+        node = next;
+    }
+}
+
+void TimingWheel::moveTo(uint64_t tick) {
+    current_ = tick;
+    for (size_t level = LEVELS - 1; level > 0; --level) {
+        size_t slot = digitOf(current_, level);
+        if ((current_ & lowerBits(level)) == 0 && heads_[level * SLOTS + slot] != NIL) {
+            cascade(level, slot);
+        }
+    }
+}
+
+bool TimingWheel::nextEvent(uint64_t& tick, size_t& level) const {
+    // The lowest level with anything left in its current rotation comes
+    // first: higher levels only hold ticks past the end of that rotation
+    for (size_t at = 0; at < LEVELS; ++at) {
+        // A higher level's current slot was cascaded on the way in
+        size_t start = digitOf(current_, at) + (at > 0 ? 1 : 0);
+        if (start == SLOTS) {
+            continue;
+        }
+        for (size_t word = start / 64; word < BITMAP_WORDS; ++word) {
+            uint64_t bits = occupied_[at][word];
+            if (word == start / 64) {
+                bits &= ~uint64_t(0) << (start % 64);
+            }
+            if (bits != 0) {
+                size_t slot = word * 64 + lowestBit(bits);
+                uint64_t above = at + 1 < LEVELS ? ~lowerBits(at + 1) : 0;
+                tick = (current_ & above) | (uint64_t(slot) << (at * LEVEL_BITS));
+                level = at;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace MatchingEngine
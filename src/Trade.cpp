@@ -1,14 +1,19 @@
 #include "Trade.h"
+#include "Interner.h"
 #include <sstream>
 #include <iomanip>
 
 namespace MatchingEngine {
 
+const std::string& Trade::getSymbol() const {
+    return symbolInterner().name(symbolId_);
+}
+
 std::string Trade::toString() const {
     std::ostringstream oss;
     oss << "Trade[Buy=" << buyOrderId_ 
         << ", Sell=" << sellOrderId_
-        << ", Symbol=" << symbol_
+        << ", Symbol=" << getSymbol()
         << ", Price=" << std::fixed << std::setprecision(4) << priceToDouble(price_)
         << ", Qty=" << quantity_
         << "]";
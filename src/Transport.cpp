@@ -0,0 +1,162 @@
+#include "Transport.h"
+
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+
+namespace MatchingEngine {
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;  // A peer going away is an error, not SIGPIPE
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// BSD sockets; the calls are qualified since the members share their names
+class KernelTransport : public Transport {
+public:
+    explicit KernelTransport(const LowLatencyOptions& options) : Transport(options) {}
+
+    SocketType listen(uint16_t& port) override {
+        SocketType listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listener == INVALID_SOCKET) {
+            return INVALID_SOCKET;
+        }
+        int opt = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = htons(port);
+        if (::bind(listener, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+            ::listen(listener, SOMAXCONN) == SOCKET_ERROR) {
+            ::closesocket(listener);
+            return INVALID_SOCKET;
+        }
+
+        // Report the port actually bound when asked for any
+        sockaddr_in bound{};
+#ifdef _WIN32
+        int boundLength = sizeof(bound);
+#else
+        socklen_t boundLength = sizeof(bound);
+#endif
+        if (getsockname(listener, (sockaddr*)&bound, &boundLength) == 0) {
+            port = ntohs(bound.sin_port);
+        }
+        return listener;
+    }
+
+    SocketType accept(SocketType listener, std::string* peerAddress) override {
+        sockaddr_in peer{};
+#ifdef _WIN32
+        int peerLength = sizeof(peer);
+#else
+        socklen_t peerLength = sizeof(peer);
+#endif
+        SocketType socket = ::accept(listener, (sockaddr*)&peer, &peerLength);
+        if (socket != INVALID_SOCKET && peerAddress) {
+            char text[INET_ADDRSTRLEN] = {};
+            inet_ntop(AF_INET, &peer.sin_addr, text, sizeof(text));
+            *peerAddress = text;
+        }
+        return socket;
+    }
+
+    SocketType connect(const std::string& host, uint16_t port) override {
+        SocketType socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (socket == INVALID_SOCKET) {
+            return INVALID_SOCKET;
+        }
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+#ifdef _WIN32
+        address.sin_addr.s_addr = inet_addr(host.c_str());
+#else
+        inet_pton(AF_INET, host.c_str(), &address.sin_addr);
+#endif
+        if (::connect(socket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
+            ::closesocket(socket);
+            return INVALID_SOCKET;
+        }
+        return socket;
+    }
+
+    int receive(SocketType socket, void* buffer, size_t length) override {
+        return static_cast<int>(::recv(socket, static_cast<char*>(buffer),
+                                       static_cast<int>(length), 0));
+    }
+
+    int send(SocketType socket, const void* data, size_t length) override {
+        return static_cast<int>(::send(socket, static_cast<const char*>(data),
+                                       static_cast<int>(length), SEND_FLAGS));
+    }
+
+    void shutdown(SocketType socket) override {
+#ifdef _WIN32
+        ::shutdown(socket, SD_BOTH);
+#else
+        ::shutdown(socket, SHUT_RDWR);
+#endif
+    }
+
+    void close(SocketType socket) override {
+        ::closesocket(socket);
+    }
+
+    void setReceiveTimeout(SocketType socket, uint32_t timeoutMs) override {
+#ifdef _WIN32
+        DWORD timeout = timeoutMs;
+#else
+        timeval timeout{static_cast<time_t>(timeoutMs / 1000),
+                        static_cast<suseconds_t>((timeoutMs % 1000) * 1000)};
+#endif
+        setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    }
+
+    bool configure(SocketType socket, int cpu) override {
+        if (!options_.enabled) {
+            return true;
+        }
+
+        int noDelay = 1;
+        bool applied = setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay,
+                                  sizeof(noDelay)) == 0;
+#ifdef SO_BUSY_POLL
+        int busyPoll = static_cast<int>(options_.busyPollMicros);
+        applied = setsockopt(socket, SOL_SOCKET, SO_BUSY_POLL, &busyPoll, sizeof(busyPoll)) == 0 &&
+                  applied;
+#else
+        applied = false;
+#endif
+#ifdef SO_INCOMING_CPU
+        if (cpu >= 0) {
+            applied = setsockopt(socket, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == 0 &&
+                      applied;
+        }
+#else
+        (void)cpu;
+#endif
+        return applied;
+    }
+
+    std::unique_ptr<Poller> createPoller(PollerType type) override {
+        return Poller::create(type);
+    }
+};
+
+} // namespace
+
+std::unique_ptr<Transport> Transport::create(TransportType type, const LowLatencyOptions& options) {
+    switch (type) {
+        case TransportType::KERNEL:
+            return std::make_unique<KernelTransport>(options);
+    }
+    return nullptr;
+}
+
+} // namespace MatchingEngine
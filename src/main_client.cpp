@@ -11,8 +11,8 @@ using namespace MatchingEngine;
 
 void printUsage() {
     std::cout << "\nAvailable Commands:" << std::endl;
-    std::cout << "  buy <symbol> <quantity> <price>       - Submit a buy limit order" << std::endl;
-    std::cout << "  sell <symbol> <quantity> <price>      - Submit a sell limit order" << std::endl;
+    std::cout << "  buy <symbol> <quantity> <price> [day] - Submit a buy limit order (day: until the close)" << std::endl;
+    std::cout << "  sell <symbol> <quantity> <price> [day] - Submit a sell limit order" << std::endl;
     std::cout << "  market-buy <symbol> <quantity>        - Submit a market buy order" << std::endl;
     std::cout << "  market-sell <symbol> <quantity>       - Submit a market sell order" << std::endl;
     std::cout << "  cancel <order_id>                     - Cancel an order" << std::endl;
@@ -76,7 +76,10 @@ void runInteractiveMode(Client& client) {
                     Quantity quantity = std::stoull(tokens[2]);
                     Price price = doubleToPrice(std::stod(tokens[3]));
                     
-                    client.submitOrder(symbol, Side::BUY, OrderType::LIMIT, price, quantity);
+                    TimeInForce timeInForce = tokens.size() > 4 && tokens[4] == "day"
+                                                  ? TimeInForce::DAY : TimeInForce::GTC;
+                    client.submitOrder(symbol, Side::BUY, OrderType::LIMIT, price, quantity, 0,
+                                       timeInForce);
                 }
             }
             else if (command == "sell") {
@@ -87,7 +90,10 @@ void runInteractiveMode(Client& client) {
                     Quantity quantity = std::stoull(tokens[2]);
                     Price price = doubleToPrice(std::stod(tokens[3]));
                     
-                    client.submitOrder(symbol, Side::SELL, OrderType::LIMIT, price, quantity);
+                    TimeInForce timeInForce = tokens.size() > 4 && tokens[4] == "day"
+                                                  ? TimeInForce::DAY : TimeInForce::GTC;
+                    client.submitOrder(symbol, Side::SELL, OrderType::LIMIT, price, quantity, 0,
+                                       timeInForce);
                 }
             }
             else if (command == "market-buy") {
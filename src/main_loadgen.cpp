@@ -0,0 +1,140 @@
+#include "LoadGenerator.h"
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace MatchingEngine;
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [options]" << std::endl;
+    std::cout << "  --host <addr>          Server address (default: 127.0.0.1)" << std::endl;
+    std::cout << "  --port <port>          Server port (default: " << SERVER_PORT << ")" << std::endl;
+    std::cout << "  --connections <n>      Client connections (default: 4)" << std::endl;
+    std::cout << "  --rate <msgs/s>        Messages per second on each connection (default: 1000)" << std::endl;
+    std::cout << "  --duration <seconds>   Recorded run time (default: 10)" << std::endl;
+    std::cout << "  --warmup <seconds>     Unrecorded lead-in at full rate (default: 1)" << std::endl;
+    std::cout << "  --market <pct>         Market orders, percent of messages (default: 5)" << std::endl;
+    std::cout << "  --cancel <pct>         Cancels (default: 25)" << std::endl;
+    std::cout << "  --modify <pct>         Modifies (default: 10); limit orders make up the rest" << std::endl;
+    std::cout << "  --symbols <n>          Symbols to spread orders over (default: 8)" << std::endl;
+    std::cout << "  --skew <s>             Zipf exponent of symbol popularity, 0 = uniform (default: 1)" << std::endl;
+    std::cout << "  --levels <n>           Ticks off mid that limit prices range over (default: 5)" << std::endl;
+    std::cout << "  --seed <n>             Random seed (default: 1)" << std::endl;
+    std::cout << "  --replay <file>        Replay client commands from file instead" << std::endl;
+    std::cout << "  --low-latency          Busy-poll the client sockets" << std::endl;
+}
+
+void printLatency(const std::string& name, const LatencyHistogram& histogram) {
+    if (histogram.count() == 0) {
+        return;
+    }
+    auto micros = [](uint64_t nanos) { return nanos / 1000.0; };
+    std::cout << "  " << std::left << std::setw(14) << name << std::right
+              << std::setw(10) << histogram.count()
+              << std::fixed << std::setprecision(1)
+              << std::setw(10) << micros(histogram.percentile(50.0))
+              << std::setw(10) << micros(histogram.percentile(99.0))
+              << std::setw(10) << micros(histogram.percentile(99.9))
+              << std::setw(12) << micros(histogram.max()) << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig config;
+    std::string replayPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+
+        try {
+            bool hasValue = i + 1 < argc;
+            if (arg == "--host" && hasValue) {
+                config.host = argv[++i];
+            } else if (arg == "--port" && hasValue) {
+                config.port = static_cast<uint16_t>(std::stoi(argv[++i]));
+            } else if (arg == "--connections" && hasValue) {
+                config.connections = static_cast<size_t>(std::stoul(argv[++i]));
+            } else if (arg == "--rate" && hasValue) {
+                config.ratePerConnection = std::stod(argv[++i]);
+            } else if (arg == "--duration" && hasValue) {
+                config.durationSeconds = std::stod(argv[++i]);
+            } else if (arg == "--warmup" && hasValue) {
+                config.warmupSeconds = std::stod(argv[++i]);
+            } else if (arg == "--market" && hasValue) {
+                config.mix.marketPercent = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (arg == "--cancel" && hasValue) {
+                config.mix.cancelPercent = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (arg == "--modify" && hasValue) {
+                config.mix.modifyPercent = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (arg == "--symbols" && hasValue) {
+                config.symbols = static_cast<size_t>(std::stoul(argv[++i]));
+            } else if (arg == "--skew" && hasValue) {
+                config.symbolSkew = std::stod(argv[++i]);
+            } else if (arg == "--levels" && hasValue) {
+                config.priceLevels = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (arg == "--seed" && hasValue) {
+                config.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--replay" && hasValue) {
+                replayPath = argv[++i];
+            } else if (arg == "--low-latency") {
+                config.lowLatency.enabled = true;
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (config.mix.marketPercent + config.mix.cancelPercent + config.mix.modifyPercent > 100) {
+        std::cerr << "Market, cancel and modify percentages add up to more than 100" << std::endl;
+        return 1;
+    }
+
+    LoadGenerator generator(config);
+    if (!replayPath.empty()) {
+        ReplayFlow replay;
+        std::string error;
+        if (!replay.load(replayPath, error)) {
+            std::cerr << "Cannot replay " << replayPath << ": " << error << std::endl;
+            return 1;
+        }
+        generator.setReplay(std::move(replay));
+    }
+
+    std::cout << "Driving " << config.connections << " connections at "
+              << config.ratePerConnection << " msgs/s each for " << config.durationSeconds
+              << "s (+" << config.warmupSeconds << "s warmup)" << std::endl;
+
+    LoadReport report;
+    if (!generator.run(report)) {
+        std::cerr << "Could not connect to " << config.host << ":" << config.port << std::endl;
+        return 1;
+    }
+
+    double seconds = std::max(report.sendSeconds - config.warmupSeconds, 1e-9);
+    std::cout << "\nConnections: " << report.connected
+              << "  Sent: " << report.sent
+              << " (" << static_cast<uint64_t>(report.sent / seconds) << " msgs/s)"
+              << "  Answered: " << report.answered
+              << "  Rejected: " << report.rejected
+              << "  Skipped: " << report.skipped
+              << "  Unanswered: " << report.unanswered << std::endl;
+    std::cout << "\nLatency from scheduled send, microseconds" << std::endl;
+    std::cout << "  " << std::left << std::setw(14) << "" << std::right
+              << std::setw(10) << "count" << std::setw(10) << "p50" << std::setw(10) << "p99"
+              << std::setw(10) << "p99.9" << std::setw(12) << "max" << std::endl;
+    printLatency("new order ack", report.newOrderAck);
+    printLatency("first fill", report.firstFill);
+    printLatency("cancel ack", report.cancelAck);
+    printLatency("modify ack", report.modifyAck);
+    printLatency("send lag", report.sendLag);
+    return report.unanswered == 0 ? 0 : 2;
+}
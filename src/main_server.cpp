@@ -1,10 +1,14 @@
 #include "Server.h"
 #include "Common.h"
+#include "Metrics.h"
 #include <iostream>
 #include <csignal>
 #include <memory>
 #include <thread>
 #include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 using namespace MatchingEngine;
 
@@ -20,8 +24,100 @@ void signalHandler(int signal) {
 }
 
 void printUsage(const char* programName) {
-    std::cout << "Usage: " << programName << " [port]" << std::endl;
+    std::cout << "Usage: " << programName << " [port] [options]" << std::endl;
     std::cout << "  port: Server port (default: " << SERVER_PORT << ")" << std::endl;
+    std::cout << "  --io <threads|epoll|io_uring>  Connection handling (default: epoll on Linux)" << std::endl;
+    std::cout << "  --io-threads <n>               Event loop threads (default: 2)" << std::endl;
+    std::cout << "  --shards <n>                   Matching shards behind the event loops (default: 2)" << std::endl;
+    std::cout << "  --quiet                        Don't print commands, order updates and trades" << std::endl;
+    std::cout << "  --journal <dir>                Journal every command to segment files in dir" << std::endl;
+    std::cout << "  --fsync <batch|interval|async> When journal writes are synced (default: batch)" << std::endl;
+    std::cout << "  --snapshot <file>              Restore from and periodically save state to file" << std::endl;
+    std::cout << "  --snapshot-interval <seconds>  Time between snapshots (default: 60)" << std::endl;
+    std::cout << "  --feed                         Publish L2 updates over UDP multicast (239.255.0.1:15000," << std::endl;
+    std::cout << "                                 snapshots on 239.255.0.2:15001)" << std::endl;
+    std::cout << "  --feed-interface <addr>        Local interface to multicast the feed on" << std::endl;
+    std::cout << "  --metrics                      Time each stage of the order path and serve the" << std::endl;
+    std::cout << "                                 results for Prometheus on http://<host>:9100/" << std::endl;
+    std::cout << "  --metrics-port <port>          As --metrics, on another port" << std::endl;
+    std::cout << "  --session-close <HH:MM>        UTC time DAY orders lapse at (default: 00:00)" << std::endl;
+    std::cout << "  --max-order-qty <n>            Pre-trade risk: refuse larger orders" << std::endl;
+    std::cout << "  --max-open-notional <value>    ...open orders worth more than this per client" << std::endl;
+    std::cout << "  --max-position <n>             ...a potential position past n per client and symbol" << std::endl;
+    std::cout << "  --max-order-rate <n>           ...more than n orders a second per client" << std::endl;
+    std::cout << "  --price-band <bps>             ...limit prices this far from the last trade" << std::endl;
+    std::cout << "  --node-id <n>                  This server's position in a gateway's node list" << std::endl;
+    std::cout << "  --gateway <host:port,...>      Route orders to these engine nodes instead of" << std::endl;
+    std::cout << "                                 matching locally (node n = --node-id n)" << std::endl;
+    std::cout << "  --link-peers <addr,...>        Gateway addresses a node takes routed commands from" << std::endl;
+    std::cout << "  --replicate <port>             Stream every command to a standby connecting here" << std::endl;
+    std::cout << "  --standby-of <host:port>       Follow that primary's stream and take over its" << std::endl;
+    std::cout << "                                 clients when it fails" << std::endl;
+    std::cout << "  --failover-timeout <ms>        Primary silence a standby takes as failure (default: 50)" << std::endl;
+    std::cout << "  --low-latency                  Busy-poll sockets and spin the event loops and shards" << std::endl;
+    std::cout << "                                 instead of sleeping" << std::endl;
+    std::cout << "  --busy-poll <us>               Driver busy-poll time per read (default: 50)" << std::endl;
+    std::cout << "  --io-cpus <cpu,...>            Pin the event loops, in order" << std::endl;
+    std::cout << "  --shard-cpus <cpu,...>         Pin the matching shards, in order" << std::endl;
+}
+
+// cpu,cpu,... - throws on a malformed entry
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        cpus.push_back(std::stoi(list.substr(start, end == std::string::npos ? std::string::npos
+                                                                              : end - start)));
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return cpus;
+}
+
+// addr,addr,... - throws on an empty entry
+std::vector<std::string> parseAddressList(const std::string& list) {
+    std::vector<std::string> addresses;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        addresses.push_back(list.substr(start, end == std::string::npos ? std::string::npos
+                                                                         : end - start));
+        if (addresses.back().empty()) {
+            throw std::invalid_argument(list);
+        }
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return addresses;
+}
+
+// host:port,host:port,... - throws on a malformed entry
+std::vector<GatewayNode> parseGatewayNodes(const std::string& list) {
+    std::vector<GatewayNode> nodes;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        std::string entry = list.substr(start, end == std::string::npos ? std::string::npos
+                                                                         : end - start);
+        size_t colon = entry.rfind(':');
+        if (colon == std::string::npos || colon == 0) {
+            throw std::invalid_argument(entry);
+        }
+        GatewayNode node;
+        node.host = entry.substr(0, colon);
+        node.port = static_cast<uint16_t>(std::stoi(entry.substr(colon + 1)));
+        nodes.push_back(node);
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return nodes;
 }
 
 void printServerStats(Server* server) {
@@ -32,6 +128,9 @@ void printServerStats(Server* server) {
         std::cout << "Active Connections: " << server->getActiveConnections() << std::endl;
         std::cout << "Total Orders: " << server->getTotalOrders() << std::endl;
         std::cout << "Total Trades: " << server->getTotalTrades() << std::endl;
+        if (metrics().isEnabled()) {
+            std::cout << "Stage latency:\n" << metrics().snapshot().toText();
+        }
         std::cout << "=========================\n" << std::endl;
     }
 }
@@ -42,18 +141,122 @@ int main(int argc, char* argv[]) {
     std::cout << "========================================" << std::endl;
     
     // Parse command line arguments
-    uint16_t port = SERVER_PORT;
+    ServerConfig config;
     
-    if (argc > 1) {
-        if (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
             printUsage(argv[0]);
             return 0;
         }
         
         try {
-            port = static_cast<uint16_t>(std::stoi(argv[1]));
+            if (arg == "--io" && i + 1 < argc) {
+                std::string mode = argv[++i];
+                if (mode == "threads") {
+                    config.ioMode = ServerIoMode::THREAD_PER_CLIENT;
+                } else if (mode == "epoll") {
+                    config.ioMode = ServerIoMode::EPOLL;
+                } else if (mode == "io_uring") {
+                    config.ioMode = ServerIoMode::IO_URING;
+                } else {
+                    std::cerr << "Unknown I/O mode: " << mode << std::endl;
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            } else if (arg == "--io-threads" && i + 1 < argc) {
+                config.ioThreads = static_cast<size_t>(std::stoul(argv[++i]));
+            } else if (arg == "--shards" && i + 1 < argc) {
+                config.engineShards = static_cast<size_t>(std::stoul(argv[++i]));
+            } else if (arg == "--quiet") {
+                config.logEvents = false;
+            } else if (arg == "--journal" && i + 1 < argc) {
+                config.journal.directory = argv[++i];
+            } else if (arg == "--snapshot" && i + 1 < argc) {
+                config.snapshotPath = argv[++i];
+            } else if (arg == "--snapshot-interval" && i + 1 < argc) {
+                config.snapshotIntervalSeconds = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--feed") {
+                config.feedEnabled = true;
+            } else if (arg == "--feed-interface" && i + 1 < argc) {
+                config.feed.interfaceAddress = argv[++i];
+            } else if (arg == "--metrics") {
+                config.metricsEnabled = true;
+            } else if (arg == "--metrics-port" && i + 1 < argc) {
+                config.metricsEnabled = true;
+                config.metricsPort = static_cast<uint16_t>(std::stoi(argv[++i]));
+            } else if (arg == "--session-close" && i + 1 < argc) {
+                std::string close = argv[++i];
+                size_t colon = close.find(':');
+                if (colon == std::string::npos) {
+                    throw std::invalid_argument(close);
+                }
+                uint64_t hours = std::stoull(close.substr(0, colon));
+                uint64_t minutes = std::stoull(close.substr(colon + 1));
+                if (hours > 23 || minutes > 59) {
+                    throw std::invalid_argument(close);
+                }
+                config.expiry.sessionCloseNanos = (hours * 60 + minutes) * 60 * 1000000000ULL;
+            } else if (arg == "--max-order-qty" && i + 1 < argc) {
+                config.riskLimits.maxOrderQuantity = std::stoull(argv[++i]);
+            } else if (arg == "--max-open-notional" && i + 1 < argc) {
+                config.riskLimits.maxOpenNotional =
+                    static_cast<uint64_t>(doubleToPrice(std::stod(argv[++i])));
+            } else if (arg == "--max-position" && i + 1 < argc) {
+                config.riskLimits.maxPosition = std::stoull(argv[++i]);
+            } else if (arg == "--max-order-rate" && i + 1 < argc) {
+                config.riskLimits.maxOrdersPerSecond = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--price-band" && i + 1 < argc) {
+                config.riskLimits.priceBandBps = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--node-id" && i + 1 < argc) {
+                unsigned long nodeId = std::stoul(argv[++i]);
+                if (nodeId >= ShardedEngine::MAX_NODES) {
+                    throw std::out_of_range(arg);
+                }
+                config.nodeId = static_cast<uint8_t>(nodeId);
+            } else if (arg == "--link-peers" && i + 1 < argc) {
+                config.linkPeers = parseAddressList(argv[++i]);
+            } else if (arg == "--gateway" && i + 1 < argc) {
+                config.gatewayNodes = parseGatewayNodes(argv[++i]);
+            } else if (arg == "--replicate" && i + 1 < argc) {
+                config.replicationEnabled = true;
+                config.replicationPort = static_cast<uint16_t>(std::stoi(argv[++i]));
+            } else if (arg == "--standby-of" && i + 1 < argc) {
+                std::vector<GatewayNode> primary = parseGatewayNodes(argv[++i]);
+                if (primary.size() != 1) {
+                    throw std::invalid_argument(arg);
+                }
+                config.primaryHost = primary[0].host;
+                config.primaryPort = primary[0].port;
+            } else if (arg == "--failover-timeout" && i + 1 < argc) {
+                config.failoverTimeoutMs = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--low-latency") {
+                config.lowLatency.enabled = true;
+            } else if (arg == "--busy-poll" && i + 1 < argc) {
+                config.lowLatency.enabled = true;
+                config.lowLatency.busyPollMicros = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--io-cpus" && i + 1 < argc) {
+                config.ioCpus = parseCpuList(argv[++i]);
+            } else if (arg == "--shard-cpus" && i + 1 < argc) {
+                config.shardCpus = parseCpuList(argv[++i]);
+            } else if (arg == "--fsync" && i + 1 < argc) {
+                std::string policy = argv[++i];
+                if (policy == "batch") {
+                    config.journal.fsyncPolicy = FsyncPolicy::PER_BATCH;
+                } else if (policy == "interval") {
+                    config.journal.fsyncPolicy = FsyncPolicy::INTERVAL;
+                } else if (policy == "async") {
+                    config.journal.fsyncPolicy = FsyncPolicy::ASYNC;
+                } else {
+                    std::cerr << "Unknown fsync policy: " << policy << std::endl;
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            } else {
+                config.port = static_cast<uint16_t>(std::stoi(arg));
+            }
         } catch (const std::exception& e) {
-            std::cerr << "Invalid port number: " << argv[1] << std::endl;
+            std::cerr << "Invalid argument: " << arg << std::endl;
             printUsage(argv[0]);
             return 1;
         }
@@ -64,7 +267,7 @@ int main(int argc, char* argv[]) {
     std::signal(SIGTERM, signalHandler);
     
     // Create and start server
-    g_server = std::make_unique<Server>(port);
+    g_server = std::make_unique<Server>(config);
     
     if (!g_server->start()) {
         std::cerr << "Failed to start server" << std::endl;
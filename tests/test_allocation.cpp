@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include "MatchingEngine.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace MatchingEngine;
+
+// Count every heap allocation made by this test binary
+namespace {
+std::atomic<size_t> g_allocations{0};
+}
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+class AllocationTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        OrderBookConfig config;
+        config.ladderType = PriceLadderType::ARRAY;
+        config.tickSize = doubleToPrice(0.01);
+        
+        engine = std::make_unique<MatchingEngineCore>();
+        engine->setDefaultBookConfig(config);
+        engine->setTradeCallback([this](const Trade& trade) {
+            tradedQuantity += trade.getQuantity();
+        });
+    }
+    
+    // Quote both sides, trade through some of it, amend and pull the rest
+    void runFlow() {
+        OrderId ids[20];
+        for (int i = 0; i < 10; i++) {
+            ids[i] = engine->submitOrder("AAPL", Side::BUY, OrderType::LIMIT,
+                                         doubleToPrice(150.00 - i * 0.01), 100, "mm1");
+            ids[10 + i] = engine->submitOrder("AAPL", Side::SELL, OrderType::LIMIT,
+                                              doubleToPrice(150.05 + i * 0.01), 100, "mm1");
+        }
+        
+        engine->submitOrder("AAPL", Side::BUY, OrderType::LIMIT, doubleToPrice(150.07), 250, "taker");
+        engine->submitOrder("AAPL", Side::SELL, OrderType::MARKET, 0, 150, "taker");
+        engine->submitOrder("AAPL", Side::SELL, OrderType::IOC, doubleToPrice(149.98), 500, "taker");
+        engine->submitOrder("AAPL", Side::BUY, OrderType::FOK, doubleToPrice(150.20), 100, "taker");
+        engine->submitOrder("AAPL", Side::SELL, OrderType::FOK, doubleToPrice(149.95), 5000, "taker");
+        
+        engine->modifyOrder(ids[19], doubleToPrice(150.30), 50);
+        for (OrderId id : ids) {
+            engine->cancelOrder(id);
+        }
+    }
+    
+    std::unique_ptr<MatchingEngineCore> engine;
+    Quantity tradedQuantity = 0;
+};
+
+// Test order entry, matching and cancel don't allocate once warmed up
+TEST_F(AllocationTest, SteadyStateOrderFlowIsAllocationFree) {
+    for (int i = 0; i < 10; i++) {
+        runFlow();
+    }
+    ASSERT_EQ(engine->getLiveOrders(), 0);
+    
+    Quantity warmupTraded = tradedQuantity;
+    size_t before = g_allocations.load();
+    for (int i = 0; i < 1000; i++) {
+        runFlow();
+    }
+    size_t allocations = g_allocations.load() - before;
+    
+    EXPECT_EQ(allocations, 0);
+    EXPECT_EQ(tradedQuantity, warmupTraded * 101);
+    EXPECT_EQ(engine->getLiveOrders(), 0);
+}
+
+// Test pooled order records are recycled rather than accumulated
+TEST_F(AllocationTest, OrderRecordsAreRecycled) {
+    for (int i = 0; i < 100; i++) {
+        OrderId id = engine->submitOrder("AAPL", Side::BUY, OrderType::LIMIT,
+                                         doubleToPrice(150.00), 100);
+        EXPECT_EQ(engine->getLiveOrders(), 1);
+        EXPECT_TRUE(engine->cancelOrder(id));
+        EXPECT_EQ(engine->getLiveOrders(), 0);
+    }
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include "Client.h"
+#include "Server.h"
+#include <chrono>
+#include <map>
+#include <vector>
+
+using namespace MatchingEngine;
+
+#ifdef __linux__
+
+// A client submitting through pipelines to an epoll server
+class PipelineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ServerConfig config;
+        config.port = 0;
+        config.ioMode = ServerIoMode::EPOLL;
+        config.logEvents = false;
+        config.riskLimits.maxOrderQuantity = 1000;
+        server = std::make_unique<Server>(config);
+        ASSERT_TRUE(server->start());
+        client = std::make_unique<Client>("127.0.0.1", server->getPort());
+        client->setVerbose(false);
+    }
+
+    void TearDown() override {
+        client->disconnect();
+        server->stop();
+    }
+
+    // Poll until count replies have arrived or five seconds have passed
+    std::vector<OrderCompletion> collect(size_t count) {
+        std::vector<OrderCompletion> all;
+        std::vector<OrderCompletion> batch;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (all.size() < count && std::chrono::steady_clock::now() < deadline) {
+            client->pollCompletions(batch, std::chrono::milliseconds(10));
+            all.insert(all.end(), batch.begin(), batch.end());
+        }
+        return all;
+    }
+
+    std::unique_ptr<Server> server;
+    std::unique_ptr<Client> client;
+};
+
+TEST_F(PipelineTest, CoalescedOrdersCompleteByHandle) {
+    ASSERT_TRUE(client->connect());
+    OrderPipeline& pipeline = client->openPipeline();
+
+    // Pairs that cross: each buy fills the sell queued just before it
+    constexpr size_t PAIRS = 500;
+    std::vector<OrderId> sells;
+    std::vector<OrderId> buys;
+    for (size_t i = 0; i < PAIRS; ++i) {
+        sells.push_back(pipeline.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 10));
+        buys.push_back(pipeline.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 10));
+        ASSERT_NE(sells.back(), 0);
+        ASSERT_NE(buys.back(), 0);
+    }
+    EXPECT_GT(pipeline.pendingBytes(), 0);
+    ASSERT_TRUE(pipeline.flush());
+    EXPECT_EQ(pipeline.pendingBytes(), 0);
+
+    // An ack per order, and the fill reported to each buy that took a sell
+    std::vector<OrderCompletion> completions = collect(3 * PAIRS);
+    ASSERT_EQ(completions.size(), 3 * PAIRS);
+    std::map<OrderId, size_t> acks;
+    std::map<OrderId, size_t> fills;
+    for (const OrderCompletion& completion : completions) {
+        ASSERT_NE(completion.clientOrderId, 0);
+        if (completion.kind == OrderCompletion::Kind::ACK) {
+            EXPECT_EQ(completion.status, OrderStatus::PENDING);
+            ++acks[completion.clientOrderId];
+        } else {
+            ASSERT_EQ(completion.kind, OrderCompletion::Kind::EXECUTION);
+            EXPECT_EQ(completion.status, OrderStatus::FILLED);
+            EXPECT_EQ(completion.quantity, 10);
+            EXPECT_EQ(completion.price, 1500000);
+            ++fills[completion.clientOrderId];
+        }
+    }
+    for (size_t i = 0; i < PAIRS; ++i) {
+        EXPECT_EQ(acks[sells[i]], 1);
+        EXPECT_EQ(acks[buys[i]], 1);
+        EXPECT_EQ(fills[sells[i]], 0);
+        EXPECT_EQ(fills[buys[i]], 1);
+    }
+    EXPECT_EQ(server->getTotalTrades(), PAIRS);
+}
+
+TEST_F(PipelineTest, FlushTimerSendsWhatWasLeftQueued) {
+    client->setFlushInterval(std::chrono::milliseconds(1));
+    ASSERT_TRUE(client->connect());
+    OrderPipeline& pipeline = client->openPipeline();
+
+    OrderId order = pipeline.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1490000, 10);
+    ASSERT_NE(order, 0);
+    std::vector<OrderCompletion> completions = collect(1);
+    ASSERT_EQ(completions.size(), 1);
+    EXPECT_EQ(completions[0].clientOrderId, order);
+
+    // The cancel's ack names only the server's id, and resolves to the handle
+    ASSERT_TRUE(pipeline.cancelOrder(completions[0].orderId));
+    completions = collect(1);
+    ASSERT_EQ(completions.size(), 1);
+    EXPECT_EQ(completions[0].kind, OrderCompletion::Kind::ACK);
+    EXPECT_EQ(completions[0].status, OrderStatus::CANCELLED);
+    EXPECT_EQ(completions[0].clientOrderId, order);
+}
+
+TEST_F(PipelineTest, OnlyRecentAcksAreTracked) {
+    client->setTrackedOrderLimit(2);
+    ASSERT_TRUE(client->connect());
+    OrderPipeline& pipeline = client->openPipeline();
+
+    // Resting orders the server never reports on again
+    std::vector<OrderId> handles;
+    for (Price price : {Price(1490000), Price(1480000), Price(1470000)}) {
+        handles.push_back(pipeline.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, price, 10));
+    }
+    ASSERT_TRUE(pipeline.flush());
+    std::vector<OrderCompletion> acks = collect(3);
+    ASSERT_EQ(acks.size(), 3);
+
+    // The oldest has dropped out; the other two still resolve
+    for (const OrderCompletion& ack : acks) {
+        ASSERT_TRUE(pipeline.cancelOrder(ack.orderId));
+    }
+    ASSERT_TRUE(pipeline.flush());
+    std::vector<OrderCompletion> cancels = collect(3);
+    ASSERT_EQ(cancels.size(), 3);
+    EXPECT_EQ(cancels[0].clientOrderId, 0);
+    EXPECT_EQ(cancels[1].clientOrderId, handles[1]);
+    EXPECT_EQ(cancels[2].clientOrderId, handles[2]);
+}
+
+TEST_F(PipelineTest, VersionOneRejectsCarryTheHandle) {
+    client->setProtocolVersion(1);
+    ASSERT_TRUE(client->connect());
+    ASSERT_EQ(client->getProtocolVersion(), 1);
+    OrderPipeline& pipeline = client->openPipeline();
+
+    OrderId order = pipeline.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1490000, 5000);
+    ASSERT_NE(order, 0);
+    ASSERT_TRUE(pipeline.flush());
+    std::vector<OrderCompletion> completions = collect(1);
+    ASSERT_EQ(completions.size(), 1);
+    EXPECT_EQ(completions[0].kind, OrderCompletion::Kind::REJECT);
+    EXPECT_EQ(completions[0].clientOrderId, order);
+}
+
+TEST(PipelineLifecycleTest, NothingQueuesWhileDisconnected) {
+    Client client("127.0.0.1", 1);
+    client.setVerbose(false);
+    OrderPipeline& pipeline = client.openPipeline();
+    EXPECT_EQ(pipeline.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1490000, 10), 0);
+    EXPECT_FALSE(pipeline.cancelOrder(1));
+    EXPECT_TRUE(pipeline.flush());
+    std::vector<OrderCompletion> completions;
+    EXPECT_EQ(client.pollCompletions(completions), 0);
+}
+
+#endif
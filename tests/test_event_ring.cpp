@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include "EventRing.h"
+#include "MatchingEngine.h"
+#include "ShardedEngine.h"
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace MatchingEngine;
+
+namespace {
+
+EngineEvent tradeEvent(OrderId id) {
+    EngineEvent event{};
+    event.type = EventType::TRADE;
+    event.orderId = id;
+    return event;
+}
+
+} // namespace
+
+TEST(EventRingTest, EveryConsumerSeesEveryEventInOrder) {
+    EventRing ring(8, 4);  // Small enough that publishers wrap many times
+    std::vector<OrderId> first;
+    std::vector<OrderId> second;
+    size_t batches = 0;
+    ring.addConsumer([&](const EngineEvent* events, size_t count) {
+        EXPECT_LE(count, 4);
+        ++batches;
+        for (size_t i = 0; i < count; ++i) {
+            first.push_back(events[i].orderId);
+        }
+    });
+    ring.addConsumer([&](const EngineEvent* events, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            second.push_back(events[i].orderId);
+        }
+    });
+
+    ring.start();
+    const OrderId count = 1000;
+    for (OrderId id = 1; id <= count; ++id) {
+        ring.publish(tradeEvent(id));
+    }
+    ring.stop();
+
+    ASSERT_EQ(first.size(), count);
+    EXPECT_EQ(first, second);
+    for (OrderId id = 1; id <= count; ++id) {
+        EXPECT_EQ(first[id - 1], id);
+    }
+    EXPECT_GE(batches, count / 4);
+}
+
+TEST(EventRingTest, ConcurrentPublishers) {
+    EventRing ring(64);
+    const size_t publishers = 4;
+    const OrderId perPublisher = 5000;
+    std::vector<OrderId> next(publishers, 0);
+    size_t received = 0;
+    bool ordered = true;
+    ring.addConsumer([&](const EngineEvent* events, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            size_t publisher = events[i].otherOrderId;
+            ordered = ordered && events[i].orderId == next[publisher];
+            next[publisher] = events[i].orderId + 1;
+            ++received;
+        }
+    });
+    ring.start();
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < publishers; ++p) {
+        threads.emplace_back([&ring, p, perPublisher]() {
+            for (OrderId id = 0; id < perPublisher; ++id) {
+                EngineEvent event = tradeEvent(id);
+                event.otherOrderId = p;
+                ring.publish(event);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ring.stop();
+
+    EXPECT_EQ(received, publishers * perPublisher);
+    EXPECT_TRUE(ordered);  // Each publisher's events arrive in its own order
+}
+
+TEST(EventRingTest, IgnoresEventsWhileStopped) {
+    EventRing ring(16);
+    size_t received = 0;
+    ring.addConsumer([&](const EngineEvent*, size_t count) { received += count; });
+
+    ring.publish(tradeEvent(1));
+    ring.start();
+    ring.publish(tradeEvent(2));
+    ring.stop();
+    ring.publish(tradeEvent(3));
+
+    EXPECT_EQ(received, 1);
+    EXPECT_EQ(ring.getPublished(), 1);
+}
+
+TEST(EventRingTest, EnginePublishesTradesAndOrderUpdates) {
+    EventRing ring;
+    std::vector<EngineEvent> events;
+    ring.addConsumer([&](const EngineEvent* batch, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (batch[i].type != EventType::LEVEL) {
+                events.push_back(batch[i]);
+            }
+        }
+    });
+    ring.start();
+
+    MatchingEngineCore engine;
+    engine.setEventRing(&ring);
+    OrderId sell = engine.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 100, "alice");
+    OrderId buy = engine.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 40, "bob");
+    ring.stop();
+
+    // Resting sell, then the trade and the filled buy
+    ASSERT_EQ(events.size(), 3);
+    EXPECT_EQ(events[0].type, EventType::ORDER);
+    EXPECT_EQ(events[0].orderId, sell);
+    EXPECT_EQ(static_cast<OrderStatus>(events[0].status), OrderStatus::PENDING);
+
+    EXPECT_EQ(events[1].type, EventType::TRADE);
+    EXPECT_EQ(events[1].orderId, buy);
+    EXPECT_EQ(events[1].otherOrderId, sell);
+    EXPECT_EQ(events[1].price, 1500000);
+    EXPECT_EQ(events[1].quantity, 40);
+    EXPECT_NE(events[1].toString().find("AAPL"), std::string::npos);
+
+    EXPECT_EQ(events[2].orderId, buy);
+    EXPECT_EQ(static_cast<OrderStatus>(events[2].status), OrderStatus::FILLED);
+    EXPECT_EQ(events[2].remaining, 0);
+}
+
+TEST(EventRingTest, ShardsPublishIntoOneRing) {
+    EventRing ring(128);
+    std::mutex mutex;
+    size_t trades = 0;
+    size_t orders = 0;
+    ring.addConsumer([&](const EngineEvent* events, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < count; ++i) {
+            if (events[i].type != EventType::LEVEL) {
+                (events[i].type == EventType::TRADE ? trades : orders)++;
+            }
+        }
+    });
+    ring.start();
+
+    ShardedEngineConfig config;
+    config.shardCount = 2;
+    ShardedEngine engine(config);
+    engine.setEventRing(&ring);
+    engine.start();
+    for (int i = 0; i < 100; ++i) {
+        const char* symbol = i % 2 ? "AAPL" : "MSFT";
+        engine.submitOrder(symbol, Side::SELL, OrderType::LIMIT, 100000, 10);
+        engine.submitOrder(symbol, Side::BUY, OrderType::LIMIT, 100000, 10);
+    }
+    engine.stop();
+    ring.stop();
+
+    EXPECT_EQ(orders, 200);
+    EXPECT_EQ(trades, 100);
+}
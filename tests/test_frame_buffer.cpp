@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include "FrameBuffer.h"
+#include <vector>
+
+using namespace MatchingEngine;
+
+namespace {
+
+// Append raw bytes as if they had been received
+void feed(FrameBuffer& buffer, const void* data, size_t length) {
+    const char* bytes = static_cast<const char*>(data);
+    while (length > 0) {
+        char* target = buffer.writePtr();
+        size_t chunk = std::min(length, buffer.writable());
+        std::memcpy(target, bytes, chunk);
+        buffer.commit(chunk);
+        bytes += chunk;
+        length -= chunk;
+    }
+}
+
+NewOrderMessage makeOrder(OrderId clientOrderId) {
+    NewOrderMessage msg;
+    msg.clientOrderId = clientOrderId;
+    msg.setSymbol("AAPL");
+    msg.quantity = 100;
+    return msg;
+}
+
+} // namespace
+
+TEST(FrameBufferTest, FramesPipelinedMessagesInPlace) {
+    FrameBuffer buffer;
+    std::vector<NewOrderMessage> orders;
+    for (OrderId i = 1; i <= 50; ++i) {
+        orders.push_back(makeOrder(i));
+    }
+    feed(buffer, orders.data(), orders.size() * sizeof(NewOrderMessage));
+    
+    Frame frame;
+    OrderId expected = 1;
+    while (buffer.nextFrame(frame)) {
+        ASSERT_EQ(frame.type, MessageType::NEW_ORDER);
+        MessageScratch<NewOrderMessage> scratch;
+        const NewOrderMessage* msg = viewMessage(frame, scratch);
+        ASSERT_NE(msg, nullptr);
+        EXPECT_EQ(reinterpret_cast<const char*>(msg), frame.data);  // No copy
+        EXPECT_EQ(msg->clientOrderId, expected++);
+    }
+    EXPECT_EQ(expected, 51);
+    EXPECT_EQ(buffer.buffered(), 0);
+    EXPECT_FALSE(buffer.malformed());
+}
+
+TEST(FrameBufferTest, WaitsForPartialFrame) {
+    FrameBuffer buffer;
+    NewOrderMessage msg = makeOrder(7);
+    const char* bytes = reinterpret_cast<const char*>(&msg);
+    
+    Frame frame;
+    feed(buffer, bytes, 10);  // Not even a full header
+    EXPECT_FALSE(buffer.nextFrame(frame));
+    feed(buffer, bytes + 10, sizeof(msg) - 20);
+    EXPECT_FALSE(buffer.nextFrame(frame));
+    feed(buffer, bytes + sizeof(msg) - 10, 10);
+    ASSERT_TRUE(buffer.nextFrame(frame));
+    
+    MessageScratch<NewOrderMessage> scratch;
+    EXPECT_EQ(viewMessage(frame, scratch)->clientOrderId, 7);
+    EXPECT_FALSE(buffer.malformed());
+}
+
+TEST(FrameBufferTest, CompactsAcrossManyReads) {
+    FrameBuffer buffer(MAX_MESSAGE_SIZE * 2);
+    const OrderId count = 5000;
+    
+    // Split the stream at an awkward stride so frames straddle reads
+    std::vector<NewOrderMessage> orders;
+    for (OrderId i = 1; i <= count; ++i) {
+        orders.push_back(makeOrder(i));
+    }
+    const char* stream = reinterpret_cast<const char*>(orders.data());
+    size_t total = orders.size() * sizeof(NewOrderMessage);
+    
+    OrderId expected = 1;
+    Frame frame;
+    for (size_t offset = 0; offset < total;) {
+        char* target = buffer.writePtr();
+        size_t chunk = std::min<size_t>({997, total - offset, buffer.writable()});
+        std::memcpy(target, stream + offset, chunk);
+        buffer.commit(chunk);
+        offset += chunk;
+        while (buffer.nextFrame(frame)) {
+            MessageScratch<NewOrderMessage> scratch;
+            const NewOrderMessage* msg = viewMessage(frame, scratch);
+            ASSERT_NE(msg, nullptr);
+            ASSERT_EQ(msg->clientOrderId, expected++);
+        }
+    }
+    EXPECT_EQ(expected, count + 1);
+}
+
+TEST(FrameBufferTest, RejectsBadLength) {
+    FrameBuffer buffer;
+    MessageHeader header(MessageType::NEW_ORDER, 4);  // Shorter than a header
+    feed(buffer, &header, sizeof(header));
+    
+    Frame frame;
+    EXPECT_FALSE(buffer.nextFrame(frame));
+    EXPECT_TRUE(buffer.malformed());
+}
+
+TEST(FrameBufferTest, ViewRejectsWrongSize) {
+    FrameBuffer buffer;
+    HeartbeatMessage heartbeat;
+    feed(buffer, &heartbeat, sizeof(heartbeat));
+    
+    Frame frame;
+    ASSERT_TRUE(buffer.nextFrame(frame));
+    MessageScratch<NewOrderMessage> scratch;
+    EXPECT_EQ(viewMessage(frame, scratch), nullptr);
+}
@@ -0,0 +1,265 @@
+#include <gtest/gtest.h>
+#include "Server.h"
+#include "Client.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace MatchingEngine;
+
+#ifdef __linux__
+
+// Two engine nodes behind a gateway, with a client on the gateway
+class GatewayTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        for (uint8_t i = 0; i < 2; ++i) {
+            ServerConfig config;
+            config.port = 0;
+            config.ioMode = ServerIoMode::EPOLL;
+            config.logEvents = false;
+            config.nodeId = i;
+            config.linkPeers.push_back("127.0.0.1");
+            nodes.push_back(std::make_unique<Server>(config));
+            ASSERT_TRUE(nodes.back()->start());
+        }
+
+        ServerConfig config;
+        config.port = 0;
+        config.ioMode = ServerIoMode::EPOLL;
+        config.logEvents = false;
+        for (auto& node : nodes) {
+            GatewayNode address;
+            address.port = node->getPort();
+            config.gatewayNodes.push_back(address);
+        }
+        gateway = std::make_unique<Server>(config);
+        ASSERT_TRUE(gateway->start());
+
+        client = std::make_unique<Client>("127.0.0.1", gateway->getPort());
+        client->setVerbose(false);
+        client->setOrderAckCallback([this](const OrderAckMessage& msg) {
+            std::lock_guard<std::mutex> lock(mutex);
+            acks.push_back(msg);
+            changed.notify_all();
+        });
+        client->setExecutionReportCallback([this](const ExecutionReportMessage& msg) {
+            std::lock_guard<std::mutex> lock(mutex);
+            reports.push_back(msg);
+            changed.notify_all();
+        });
+        client->setBatchAckCallback([this](const ProtocolV2::BatchAck& ack) {
+            std::lock_guard<std::mutex> lock(mutex);
+            batchAcks.push_back(ack);
+            changed.notify_all();
+        });
+        client->setMassCancelAckCallback([this](const ProtocolV2::MassCancelAck& ack) {
+            std::lock_guard<std::mutex> lock(mutex);
+            massCancelAcks.push_back(ack);
+            changed.notify_all();
+        });
+        ASSERT_TRUE(client->connect());
+
+        // One symbol owned by each node, by the gateway's default hash
+        for (int i = 0; symbols[0].empty() || symbols[1].empty(); ++i) {
+            std::string symbol = "SYM" + std::to_string(i);
+            std::string& owned = symbols[std::hash<std::string>()(symbol) % 2];
+            if (owned.empty()) {
+                owned = symbol;
+            }
+        }
+    }
+
+    void TearDown() override {
+        if (client) {
+            client->disconnect();
+        }
+        if (gateway) {
+            gateway->stop();
+        }
+        for (auto& node : nodes) {
+            node->stop();
+        }
+    }
+
+    bool waitFor(size_t ackCount, size_t reportCount, size_t batchCount = 0,
+                 size_t massCancelCount = 0) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, std::chrono::seconds(5), [&]() {
+            return acks.size() >= ackCount && reports.size() >= reportCount &&
+                   batchAcks.size() >= batchCount && massCancelAcks.size() >= massCancelCount;
+        });
+    }
+
+    std::vector<std::unique_ptr<Server>> nodes;
+    std::unique_ptr<Server> gateway;
+    std::unique_ptr<Client> client;
+    std::string symbols[2];
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<OrderAckMessage> acks;
+    std::vector<ExecutionReportMessage> reports;
+    std::vector<ProtocolV2::BatchAck> batchAcks;
+    std::vector<ProtocolV2::MassCancelAck> massCancelAcks;
+};
+
+TEST_F(GatewayTest, OrdersMatchOnTheNodeOwningTheirSymbol) {
+    client->submitOrder(symbols[1], Side::SELL, OrderType::LIMIT, 1500000, 100);
+    client->submitOrder(symbols[1], Side::BUY, OrderType::LIMIT, 1500000, 60);
+    client->submitOrder(symbols[0], Side::BUY, OrderType::LIMIT, 1000000, 10);
+    ASSERT_TRUE(waitFor(3, 1));
+    OrderId resting;
+    OrderId other;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ASSERT_EQ(acks.size(), 3);
+        std::vector<OrderId> ids[2];
+        for (const OrderAckMessage& ack : acks) {
+            EXPECT_EQ(ack.status, OrderStatus::PENDING);
+            ids[ShardedEngine::nodeOf(ack.orderId) % 2].push_back(ack.orderId);
+        }
+        ASSERT_EQ(ids[0].size(), 1);
+        ASSERT_EQ(ids[1].size(), 2);
+        resting = ids[1][0];
+        other = ids[0][0];
+
+        // The node's execution report, relayed under the gateway's symbol
+        EXPECT_EQ(reports[0].orderId, ids[1][1]);
+        EXPECT_EQ(reports[0].getSymbol(), symbols[1]);
+        EXPECT_EQ(reports[0].executionQuantity, 60);
+        EXPECT_EQ(reports[0].remainingQuantity, 0);
+        EXPECT_EQ(reports[0].status, OrderStatus::FILLED);
+    }
+    EXPECT_EQ(nodes[1]->getTotalTrades(), 1);
+    EXPECT_EQ(nodes[0]->getTotalTrades(), 0);
+    EXPECT_EQ(gateway->getTotalOrders(), 3);
+
+    // Cancels and modifies find the node from the id alone. Each node's
+    // results come back in order, but the nodes race each other.
+    OrderId stray = (OrderId(7) << ShardedEngine::NODE_SHIFT) | 0x100;  // No such node
+    client->modifyOrder(resting, 1510000, 40);
+    client->cancelOrder(other);
+    client->cancelOrder(other);
+    client->cancelOrder(stray);
+    ASSERT_TRUE(waitFor(7, 1));
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<OrderStatus> restingStatus;
+    std::vector<OrderStatus> otherStatus;
+    std::vector<OrderStatus> strayStatus;
+    for (size_t i = 3; i < acks.size(); ++i) {
+        OrderId id = acks[i].orderId;
+        (id == resting ? restingStatus : id == other ? otherStatus : strayStatus)
+            .push_back(acks[i].status);
+    }
+    EXPECT_EQ(restingStatus, std::vector<OrderStatus>{OrderStatus::PENDING});
+    EXPECT_EQ(otherStatus, (std::vector<OrderStatus>{OrderStatus::CANCELLED,
+                                                     OrderStatus::REJECTED}));
+    EXPECT_EQ(strayStatus, std::vector<OrderStatus>{OrderStatus::REJECTED});
+}
+
+TEST_F(GatewayTest, BatchesAndMassCancelsSpanNodes) {
+    std::vector<ProtocolV2::NewOrderBatch::Entry> ladder;
+    for (Price price : {1500000, 1490000, 1480000}) {
+        ladder.push_back({Side::BUY, OrderType::LIMIT, price, 100});
+    }
+    OrderId reference = client->submitOrderBatch(symbols[0], ladder);
+    client->submitOrder(symbols[1], Side::SELL, OrderType::LIMIT, 2000000, 10);
+    ASSERT_TRUE(waitFor(1, 0, 1));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ASSERT_EQ(batchAcks[0].reference, reference);
+        ASSERT_EQ(batchAcks[0].count, 3);
+        for (size_t i = 0; i < 3; ++i) {
+            EXPECT_EQ(batchAcks[0].entries[i].status, OrderStatus::PENDING);
+            EXPECT_EQ(ShardedEngine::nodeOf(batchAcks[0].entries[i].orderId), 0);
+        }
+    }
+
+    // Summed over both nodes into one acknowledgement
+    client->massCancel(symbols[0], Side::SELL);
+    client->massCancel();
+    ASSERT_TRUE(waitFor(1, 0, 1, 2));
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(massCancelAcks[0].cancelled, 0);
+    EXPECT_EQ(massCancelAcks[1].cancelled, 4);
+}
+
+TEST(GatewayLifecycleTest, NodesRefuseLinksFromUntrustedPeers) {
+    ServerConfig config;
+    config.port = 0;
+    config.ioMode = ServerIoMode::EPOLL;
+    config.logEvents = false;
+    Server node(config);  // No linkPeers
+    ASSERT_TRUE(node.start());
+    Client owner("127.0.0.1", node.getPort());
+    owner.setClientId("alice");
+    owner.setVerbose(false);
+    ASSERT_TRUE(owner.connect());
+    owner.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 100);
+
+    // A plain client after logging on at v2 tries a mass cancel of everyone
+    SocketType sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_NE(sock, INVALID_SOCKET);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(node.getPort());
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    ASSERT_EQ(::connect(sock, (sockaddr*)&addr, sizeof(addr)), 0);
+    LogonMessage logon;
+    logon.protocolVersion = ProtocolV2::VERSION;
+    logon.setClientId("mallory");
+    ASSERT_EQ(send(sock, (const char*)&logon, sizeof(logon), 0), static_cast<ssize_t>(sizeof(logon)));
+    LogonAckMessage ack;
+    ASSERT_EQ(recv(sock, (char*)&ack, sizeof(ack), MSG_WAITALL), static_cast<ssize_t>(sizeof(ack)));
+    EXPECT_EQ(ack.protocolVersion, ProtocolV2::VERSION);
+
+    ProtocolV2::LinkCommand link;
+    link.type = static_cast<uint8_t>(CommandType::MASS_CANCEL);
+    link.scope = 0;
+    char out[ProtocolV2::LinkCommand::SIZE];
+    size_t length = link.encode(out);
+    ASSERT_EQ(send(sock, out, length, 0), static_cast<ssize_t>(length));
+
+    // Dropped without an answer
+    char reply[64];
+    EXPECT_EQ(recv(sock, reply, sizeof(reply), 0), 0);
+    closesocket(sock);
+
+    // Alice's order is still there to trade against
+    owner.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 100);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (node.getTotalTrades() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(node.getTotalTrades(), 1);
+    owner.disconnect();
+    node.stop();
+}
+
+TEST(GatewayLifecycleTest, StartFailsWithoutItsNodes) {
+    ServerConfig node;
+    node.port = 0;
+    node.ioMode = ServerIoMode::EPOLL;
+    node.logEvents = false;
+    Server unreachable(node);
+    ASSERT_TRUE(unreachable.start());
+    uint16_t port = unreachable.getPort();
+    unreachable.stop();
+
+    ServerConfig config;
+    config.port = 0;
+    config.ioMode = ServerIoMode::EPOLL;
+    config.logEvents = false;
+    GatewayNode address;
+    address.port = port;
+    config.gatewayNodes.push_back(address);
+    Server gateway(config);
+    EXPECT_FALSE(gateway.start());
+    EXPECT_FALSE(gateway.isRunning());
+}
+
+#endif
@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+#include "HistoricalReplay.h"
+#include "Interner.h"
+#include "MatchingEngine.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace MatchingEngine;
+
+#ifndef _WIN32
+
+class HistoricalReplayTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        const ::testing::TestInfo* info = ::testing::UnitTest::GetInstance()->current_test_info();
+        directory = std::filesystem::temp_directory_path() /
+                    (std::string("replay_test_") + info->name());
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::string path(const std::string& name) const {
+        return (directory / name).string();
+    }
+
+    // Random flow over a few symbols: limit and market orders around a mid
+    // price, with cancels and modifies of earlier orders
+    void generate(OrderFileWriter& writer, size_t rows) {
+        const std::vector<std::string> symbols = {"AAPL", "MSFT", "GOOG", "AMZN", "TSLA"};
+        std::mt19937 random(7);
+        std::vector<std::vector<OrderId>> placed(symbols.size());
+        for (size_t row = 0; row < rows; ++row) {
+            size_t symbol = random() % symbols.size();
+            uint64_t timestamp = 1000000 + row * 10;
+            unsigned roll = random() % 100;
+            if (roll < 20 && !placed[symbol].empty()) {
+                writer.addCancel(timestamp, symbols[symbol],
+                                 placed[symbol][random() % placed[symbol].size()]);
+            } else if (roll < 30 && !placed[symbol].empty()) {
+                writer.addModify(timestamp, symbols[symbol],
+                                 placed[symbol][random() % placed[symbol].size()],
+                                 1000000 + (random() % 10) * 100, 1 + random() % 50);
+            } else {
+                Side side = random() % 2 ? Side::BUY : Side::SELL;
+                OrderType type = roll < 35 ? OrderType::MARKET : OrderType::LIMIT;
+                OrderId orderId = row + 1;
+                writer.addOrder(timestamp, symbols[symbol], orderId, side, type,
+                                1000000 + (random() % 10) * 100, 1 + random() % 100);
+                placed[symbol].push_back(orderId);
+            }
+        }
+    }
+
+    std::filesystem::path directory;
+};
+
+TEST_F(HistoricalReplayTest, OrderFileRoundTrips) {
+    OrderFileWriter writer;
+    writer.addOrder(100, "AAPL", 1, Side::BUY, OrderType::STOP_LIMIT, 1500000, 10, 1490000);
+    writer.addCancel(200, "MSFT", 2);
+    writer.addModify(300, "AAPL", 1, 1510000, 5);
+    std::string error;
+    ASSERT_TRUE(writer.write(path("orders"), error)) << error;
+
+    OrderFile file;
+    ASSERT_TRUE(file.open(path("orders"), error)) << error;
+    ASSERT_EQ(file.rows(), 3);
+    EXPECT_EQ(file.symbols(), (std::vector<std::string>{"AAPL", "MSFT"}));
+    const OrderColumns& columns = file.columns();
+    EXPECT_EQ(columns.timestamp[0], 100);
+    EXPECT_EQ(columns.stopPrice[0], 1490000);
+    EXPECT_EQ(columns.orderType[0], static_cast<uint8_t>(OrderType::STOP_LIMIT));
+    EXPECT_EQ(columns.symbol[1], 1);
+    EXPECT_EQ(columns.action[1], static_cast<uint8_t>(OrderAction::CANCEL));
+    EXPECT_EQ(columns.orderId[1], 2);
+    EXPECT_EQ(columns.action[2], static_cast<uint8_t>(OrderAction::MODIFY));
+    EXPECT_EQ(columns.price[2], 1510000);
+    EXPECT_EQ(columns.quantity[2], 5);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(columns.orderId) % 64, 0);
+
+    // Cut short, it no longer opens
+    file.close();
+    std::filesystem::resize_file(path("orders"), std::filesystem::file_size(path("orders")) - 64);
+    EXPECT_FALSE(file.open(path("orders"), error));
+    std::ofstream(path("junk")) << "not an order file, but long enough to have a header of 64 bytes.";
+    EXPECT_FALSE(file.open(path("junk"), error));
+}
+
+TEST_F(HistoricalReplayTest, ImplausibleHeadersAreRefused) {
+    OrderFileWriter writer;
+    writer.addOrder(100, "AAPL", 1, Side::BUY, OrderType::LIMIT, 1500000, 10);
+    std::string error;
+    ASSERT_TRUE(writer.write(path("orders"), error)) << error;
+
+    auto rewriteHeader = [&](uint32_t symbolCount, uint64_t rowCount) {
+        OrderFileHeader header;
+        std::fstream file(path("orders"), std::ios::in | std::ios::out | std::ios::binary);
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        header.symbolCount = symbolCount;
+        header.rowCount = rowCount;
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    };
+
+    OrderFile file;
+    // Column sizes that wrap around to fit inside the file
+    rewriteHeader(1, uint64_t(1) << 61);
+    EXPECT_FALSE(file.open(path("orders"), error));
+    rewriteHeader(UINT32_MAX, 1);
+    EXPECT_FALSE(file.open(path("orders"), error));
+    rewriteHeader(1, 1);
+    EXPECT_TRUE(file.open(path("orders"), error)) << error;
+}
+
+TEST_F(HistoricalReplayTest, ParallelReplayMatchesSerialMatching) {
+    OrderFileWriter writer;
+    generate(writer, 20000);
+    std::string error;
+    ASSERT_TRUE(writer.write(path("orders"), error)) << error;
+    OrderFile file;
+    ASSERT_TRUE(file.open(path("orders"), error)) << error;
+
+    // The same rows, in file order, through one ordinary engine
+    MatchingEngineCore serial;
+    std::vector<Trade> trades;
+    serial.setTradeCallback([&](const Trade& trade) { trades.push_back(trade); });
+    const OrderColumns& columns = file.columns();
+    for (size_t row = 0; row < file.rows(); ++row) {
+        OrderId orderId = columns.orderId[row];
+        EngineCommand command;
+        switch (static_cast<OrderAction>(columns.action[row])) {
+            case OrderAction::NEW:
+                command = EngineCommand::newOrder(
+                    orderId, symbolInterner().intern(file.symbols()[columns.symbol[row]]),
+                    static_cast<Side>(columns.side[row]),
+                    static_cast<OrderType>(columns.orderType[row]), columns.price[row],
+                    columns.quantity[row]);
+                break;
+            case OrderAction::CANCEL:
+                command = EngineCommand::cancel(orderId);
+                break;
+            case OrderAction::MODIFY:
+                command = EngineCommand::modify(orderId, columns.price[row], columns.quantity[row]);
+                break;
+        }
+        command.timestamp = columns.timestamp[row];
+        serial.execute(command);
+    }
+    ASSERT_GT(trades.size(), 100);
+
+    std::vector<std::vector<FillRecord>> runs;
+    for (size_t threads : {1, 4}) {
+        ReplayConfig config;
+        config.threads = threads;
+        HistoricalReplay replay(config);
+        ReplayReport report;
+        ASSERT_TRUE(replay.run(file, path("fills"), report, error)) << error;
+        EXPECT_EQ(report.partitions, 5);
+        EXPECT_EQ(report.orders + report.cancels + report.modifies, file.rows());
+        EXPECT_EQ(report.fills, trades.size());
+
+        std::vector<std::string> symbols;
+        std::vector<FillRecord> fills;
+        ASSERT_TRUE(readFillFile(path("fills"), symbols, fills, error)) << error;
+        EXPECT_EQ(symbols, file.symbols());
+        ASSERT_EQ(fills.size(), trades.size());
+        runs.push_back(fills);
+    }
+
+    // Every serial trade appears, with its time from the file, and thread
+    // count doesn't change the output
+    ASSERT_EQ(std::memcmp(runs[0].data(), runs[1].data(), runs[0].size() * sizeof(FillRecord)), 0);
+    std::vector<FillRecord> expected;
+    for (size_t symbol = 0; symbol < file.symbols().size(); ++symbol) {
+        for (const Trade& trade : trades) {
+            if (trade.getSymbol() == file.symbols()[symbol]) {
+                expected.push_back(FillRecord{timestampToNanos(trade.getTimestamp()),
+                                              trade.getBuyOrderId(), trade.getSellOrderId(),
+                                              trade.getPrice(), trade.getQuantity(),
+                                              static_cast<uint32_t>(symbol), 0});
+            }
+        }
+    }
+    ASSERT_EQ(expected.size(), runs[0].size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(runs[0][i].timestamp, expected[i].timestamp);
+        EXPECT_EQ(runs[0][i].buyOrderId, expected[i].buyOrderId);
+        EXPECT_EQ(runs[0][i].sellOrderId, expected[i].sellOrderId);
+        EXPECT_EQ(runs[0][i].price, expected[i].price);
+        EXPECT_EQ(runs[0][i].quantity, expected[i].quantity);
+        EXPECT_EQ(runs[0][i].symbol, expected[i].symbol);
+    }
+}
+
+TEST_F(HistoricalReplayTest, RowsWithoutATimeAreRefused) {
+    OrderFileWriter writer;
+    writer.addOrder(100, "AAPL", 1, Side::BUY, OrderType::LIMIT, 1500000, 10);
+    writer.addOrder(0, "AAPL", 2, Side::SELL, OrderType::LIMIT, 1500000, 10);
+    std::string error;
+    ASSERT_TRUE(writer.write(path("orders"), error)) << error;
+    OrderFile file;
+    ASSERT_TRUE(file.open(path("orders"), error)) << error;
+
+    HistoricalReplay replay;
+    ReplayReport report;
+    EXPECT_FALSE(replay.run(file, path("fills"), report, error));
+    EXPECT_NE(error.find("row 1"), std::string::npos);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include "Interner.h"
+#include "ProtocolV2.h"
+
+using namespace MatchingEngine;
+
+TEST(StringInternerTest, FindDoesNotAssign) {
+    StringInterner interner;
+    EXPECT_EQ(interner.find("AAPL"), 0);
+    EXPECT_EQ(interner.size(), 1);  // Just the empty string
+
+    uint32_t id = interner.intern("AAPL");
+    EXPECT_NE(id, 0);
+    EXPECT_EQ(interner.find("AAPL"), id);
+    EXPECT_EQ(interner.intern("AAPL"), id);
+    EXPECT_EQ(interner.name(id), "AAPL");
+}
+
+TEST(SymbolDirectoryTest, WireSymbolsResolveToInternedIds) {
+    SymbolDirectory directory;
+    char symbol[SymbolDirectory::WIDTH];
+    ProtocolV2::setSymbol(symbol, "DIRTEST");
+
+    SymbolId id = directory.lookup(symbol);
+    EXPECT_EQ(id, symbolInterner().find("DIRTEST"));
+    EXPECT_EQ(directory.lookup(symbol), id);
+    EXPECT_EQ(directory.load("DIRTEST"), id);
+
+    // Junk after the terminator names the same symbol
+    symbol[10] = 'x';
+    EXPECT_EQ(directory.lookup(symbol), id);
+    EXPECT_EQ(directory.size(), 1);
+
+    // All 16 bytes in use
+    ProtocolV2::setSymbol(symbol, "ABCDEFGHIJKLMNOP");
+    EXPECT_EQ(symbolInterner().name(directory.lookup(symbol)), "ABCDEFGHIJKLMNOP");
+
+    SymbolId loaded = directory.load("DIRLOADED");
+    ProtocolV2::setSymbol(symbol, "DIRLOADED");
+    EXPECT_EQ(directory.lookup(symbol), loaded);
+}
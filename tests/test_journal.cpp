@@ -0,0 +1,318 @@
+#include <gtest/gtest.h>
+#include "Journal.h"
+#include "MatchingEngine.h"
+#include "Interner.h"
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using namespace MatchingEngine;
+
+namespace {
+
+struct JournalEntry {
+    uint64_t sequence;
+    EngineCommand command;
+};
+
+std::vector<JournalEntry> readAll(const std::string& directory, uint64_t after = 0) {
+    std::vector<JournalEntry> entries;
+    EXPECT_TRUE(Journal::read(directory, after, [&](uint64_t sequence, const EngineCommand& command) {
+        entries.push_back({sequence, command});
+    }));
+    return entries;
+}
+
+} // namespace
+
+class JournalTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        const ::testing::TestInfo* info = ::testing::UnitTest::GetInstance()->current_test_info();
+        directory = (std::filesystem::temp_directory_path() /
+                     (std::string("journal_test_") + info->name())).string();
+        std::filesystem::remove_all(directory);
+        config.directory = directory;
+        config.segmentSize = 64 * sizeof(JournalRecord);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::string directory;
+    JournalConfig config;
+};
+
+TEST_F(JournalTest, RecordsEngineCommandsThroughHook) {
+    Journal journal(config);
+    ASSERT_TRUE(journal.open());
+
+    MatchingEngineCore engine;
+    engine.setCommandHook([&](const EngineCommand& command) { return journal.append(command); });
+    OrderId sell = engine.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 100, "alice");
+    engine.modifyOrder(sell, 1510000, 80);
+    engine.cancelOrder(sell);
+    engine.cancelOrder(12345);  // Journaled even though it finds nothing
+    journal.close();
+
+    auto entries = readAll(directory);
+    ASSERT_EQ(entries.size(), 4);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        EXPECT_EQ(entries[i].sequence, i + 1);
+    }
+
+    const EngineCommand& order = entries[0].command;
+    EXPECT_EQ(order.type, CommandType::NEW_ORDER);
+    EXPECT_EQ(order.orderId, sell);
+    EXPECT_EQ(symbolInterner().name(order.symbolId), "AAPL");
+    EXPECT_EQ(clientInterner().name(order.clientKey), "alice");
+    EXPECT_EQ(order.side, Side::SELL);
+    EXPECT_EQ(order.price, 1500000);
+    EXPECT_EQ(order.quantity, 100);
+
+    EXPECT_EQ(entries[1].command.type, CommandType::MODIFY_ORDER);
+    EXPECT_EQ(entries[1].command.price, 1510000);
+    EXPECT_EQ(entries[1].command.quantity, 80);
+    EXPECT_EQ(entries[2].command.type, CommandType::CANCEL_ORDER);
+    EXPECT_EQ(entries[3].command.orderId, 12345);
+}
+
+TEST_F(JournalTest, MassCancelReplays) {
+    Journal journal(config);
+    ASSERT_TRUE(journal.open());
+
+    MatchingEngineCore engine;
+    engine.setCommandHook([&](const EngineCommand& command) { return journal.append(command); });
+    engine.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1490000, 100, "alice");
+    engine.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1510000, 100, "alice");
+    engine.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1480000, 100, "bob");
+    EngineCommand cancel = EngineCommand::massCancel(
+        MASS_CANCEL_BY_SYMBOL | MASS_CANCEL_BY_SIDE | MASS_CANCEL_BY_CLIENT,
+        symbolInterner().intern("AAPL"), Side::BUY, clientInterner().intern("alice"));
+    EXPECT_EQ(engine.massCancel(cancel), 1);
+    journal.close();
+
+    auto entries = readAll(directory);
+    ASSERT_EQ(entries.size(), 4);
+    const EngineCommand& record = entries[3].command;
+    EXPECT_EQ(record.type, CommandType::MASS_CANCEL);
+    EXPECT_EQ(record.scope, cancel.scope);
+    EXPECT_EQ(record.symbolId, cancel.symbolId);
+    EXPECT_EQ(record.clientKey, cancel.clientKey);
+    EXPECT_EQ(record.side, Side::BUY);
+
+    MatchingEngineCore restored;
+    for (const auto& entry : entries) {
+        ASSERT_TRUE(restored.replay(entry.command, entry.sequence));
+    }
+    EXPECT_EQ(restored.getLiveOrders(), 2);
+    EXPECT_EQ(restored.getBestBid("AAPL"), 1480000);
+    EXPECT_EQ(restored.getBestAsk("AAPL"), 1510000);
+}
+
+TEST_F(JournalTest, ReplayReproducesSequencedTimes) {
+    Journal journal(config);
+    ASSERT_TRUE(journal.open());
+
+    MatchingEngineCore engine;
+    std::vector<Timestamp> tradeTimes;
+    engine.setCommandHook([&](const EngineCommand& command) { return journal.append(command); });
+    engine.setTradeCallback([&](const Trade& trade) { tradeTimes.push_back(trade.getTimestamp()); });
+    OrderId sell = engine.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 100, "alice");
+    engine.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 60, "bob");
+    journal.close();
+
+    auto entries = readAll(directory);
+    ASSERT_EQ(entries.size(), 2);
+    EXPECT_NE(entries[0].command.timestamp, 0);
+    EXPECT_EQ(engine.getOrder(sell)->getTimestamp(), nanosToTimestamp(entries[0].command.timestamp));
+
+    // Applied again later, the commands keep the times they were sequenced at
+    MatchingEngineCore replica;
+    std::vector<Timestamp> replicaTimes;
+    replica.setTradeCallback([&](const Trade& trade) { replicaTimes.push_back(trade.getTimestamp()); });
+    for (const auto& entry : entries) {
+        ASSERT_TRUE(replica.execute(entry.command));
+    }
+    ASSERT_EQ(tradeTimes.size(), 1);
+    EXPECT_EQ(replicaTimes, tradeTimes);
+    EXPECT_EQ(tradeTimes[0], nanosToTimestamp(entries[1].command.timestamp));
+    EXPECT_EQ(replica.getOrder(sell)->getTimestamp(), engine.getOrder(sell)->getTimestamp());
+}
+
+TEST_F(JournalTest, KeepsTimeInForce) {
+    Journal journal(config);
+    ASSERT_TRUE(journal.open());
+    EngineCommand order = EngineCommand::newOrder(7, symbolInterner().intern("AAPL"), Side::BUY,
+                                                  OrderType::LIMIT, 1500000, 100);
+    order.timeInForce = TimeInForce::GTD;
+    order.expireTime = 123456789;
+    order.timestamp = 1000;
+    EXPECT_EQ(journal.append(order), 1);
+    journal.close();
+
+    auto entries = readAll(directory);
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_EQ(entries[0].command.timeInForce, TimeInForce::GTD);
+    EXPECT_EQ(entries[0].command.expireTime, 123456789);
+
+    // Replayed, the order is back on the wheel
+    MatchingEngineCore restored;
+    ASSERT_TRUE(restored.replay(entries[0].command, entries[0].sequence));
+    EXPECT_EQ(restored.getScheduledExpiries(), 1);
+}
+
+TEST_F(JournalTest, ReopenContinuesSequence) {
+    {
+        Journal journal(config);
+        ASSERT_TRUE(journal.open());
+        for (int i = 0; i < 3; ++i) {
+            journal.append(EngineCommand::cancel(i));
+        }
+    }
+
+    Journal journal(config);
+    ASSERT_TRUE(journal.open());
+    EXPECT_EQ(journal.getDurableSequence(), 3);
+    EXPECT_EQ(journal.append(EngineCommand::cancel(99)), 4);
+    journal.close();
+
+    auto entries = readAll(directory);
+    ASSERT_EQ(entries.size(), 4);
+    EXPECT_EQ(entries[3].sequence, 4);
+    EXPECT_EQ(entries[3].command.orderId, 99);
+
+    // Only the tail after a given sequence
+    EXPECT_EQ(readAll(directory, 2).size(), 2);
+}
+
+TEST_F(JournalTest, RollsIntoNewSegments) {
+    Journal journal(config);
+    ASSERT_TRUE(journal.open());
+    const size_t count = 200;  // A bit over three 64-record segments
+    for (size_t i = 1; i <= count; ++i) {
+        journal.append(EngineCommand::cancel(i));
+    }
+    journal.close();
+
+    size_t segments = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        (void)entry;
+        ++segments;
+    }
+    EXPECT_EQ(segments, 4);
+
+    auto entries = readAll(directory);
+    ASSERT_EQ(entries.size(), count);
+    for (size_t i = 0; i < count; ++i) {
+        EXPECT_EQ(entries[i].sequence, i + 1);
+        EXPECT_EQ(entries[i].command.orderId, i + 1);
+    }
+}
+
+TEST_F(JournalTest, StopsAtTornRecord) {
+    {
+        Journal journal(config);
+        ASSERT_TRUE(journal.open());
+        for (int i = 1; i <= 5; ++i) {
+            journal.append(EngineCommand::cancel(i));
+        }
+    }
+
+    // Flip a byte inside the fourth record
+    std::string segment;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        segment = entry.path().string();
+    }
+    std::fstream file(segment, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(3 * sizeof(JournalRecord) + offsetof(JournalRecord, orderId));
+    file.put(0x7f);
+    file.close();
+
+    auto entries = readAll(directory);
+    EXPECT_EQ(entries.size(), 3);
+
+    // A reopened journal continues after the last intact record
+    Journal journal(config);
+    ASSERT_TRUE(journal.open());
+    EXPECT_EQ(journal.append(EngineCommand::cancel(6)), 4);
+}
+
+TEST_F(JournalTest, GroupCommitUnderEveryPolicy) {
+    for (FsyncPolicy policy : {FsyncPolicy::PER_BATCH, FsyncPolicy::INTERVAL, FsyncPolicy::ASYNC}) {
+        std::filesystem::remove_all(directory);
+        config.fsyncPolicy = policy;
+        config.fsyncIntervalMicros = 200;
+
+        Journal journal(config);
+        ASSERT_TRUE(journal.open());
+        uint64_t last = 0;
+        for (int i = 0; i < 100; ++i) {
+            last = journal.append(EngineCommand::cancel(i));
+        }
+        journal.waitDurable(last);
+        EXPECT_GE(journal.getDurableSequence(), last);
+        journal.close();
+        EXPECT_EQ(readAll(directory).size(), 100);
+    }
+}
+
+TEST_F(JournalTest, FailedRotationReleasesWaiters) {
+    config.segmentSize = 2 * sizeof(JournalRecord);
+    Journal journal(config);
+    ASSERT_TRUE(journal.open());
+    // The third record's segment cannot be created
+    std::string blocked = directory + "/journal-00000000000000000003.seg";
+    std::filesystem::create_directories(blocked);
+
+    uint64_t last = 0;
+    for (int i = 1; i <= 4; ++i) {
+        last = journal.append(EngineCommand::cancel(i));
+    }
+    EXPECT_EQ(last, 4);
+    EXPECT_FALSE(journal.waitDurable(last));
+    EXPECT_TRUE(journal.hasFailed());
+    EXPECT_EQ(journal.getDurableSequence(), 2);
+
+    // Later appends are drained without being written or reported durable
+    uint64_t after = journal.append(EngineCommand::cancel(5));
+    EXPECT_EQ(after, 5);
+    EXPECT_FALSE(journal.waitDurable(after));
+    journal.close();
+    std::filesystem::remove_all(blocked);
+    auto entries = readAll(directory);
+    ASSERT_EQ(entries.size(), 2);
+    EXPECT_EQ(entries[1].sequence, 2);
+}
+
+TEST_F(JournalTest, ConcurrentAppendersStayContiguous) {
+    config.segmentSize = 1024 * sizeof(JournalRecord);
+    Journal journal(config);
+    ASSERT_TRUE(journal.open());
+
+    const size_t threads = 4;
+    const size_t perThread = 1000;
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < threads; ++t) {
+        writers.emplace_back([&journal, t]() {
+            for (size_t i = 0; i < perThread; ++i) {
+                journal.append(EngineCommand::cancel(t * perThread + i));
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    journal.close();
+
+    auto entries = readAll(directory);
+    ASSERT_EQ(entries.size(), threads * perThread);
+    std::vector<bool> seen(threads * perThread, false);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        EXPECT_EQ(entries[i].sequence, i + 1);
+        seen[entries[i].command.orderId] = true;
+    }
+    EXPECT_EQ(std::count(seen.begin(), seen.end(), true), threads * perThread);
+}
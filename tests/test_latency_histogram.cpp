@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include "LatencyHistogram.h"
+#include <limits>
+
+using namespace MatchingEngine;
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 100; ++value) {
+        histogram.record(value);
+    }
+    EXPECT_EQ(histogram.count(), 100);
+    EXPECT_EQ(histogram.min(), 1);
+    EXPECT_EQ(histogram.max(), 100);
+    EXPECT_DOUBLE_EQ(histogram.mean(), 50.5);
+    EXPECT_EQ(histogram.percentile(50.0), 50);
+    EXPECT_EQ(histogram.percentile(99.0), 99);
+    EXPECT_EQ(histogram.percentile(100.0), 100);
+}
+
+TEST(LatencyHistogramTest, LargeValuesStayWithinPrecision) {
+    LatencyHistogram histogram(8);
+    for (uint64_t value = 1000; value <= 1000000; value += 1000) {
+        histogram.record(value);
+    }
+
+    // 1/128 relative error at 8 bits of precision
+    auto near = [](uint64_t reported, uint64_t actual) {
+        return reported >= actual && reported <= actual + actual / 128;
+    };
+    EXPECT_TRUE(near(histogram.percentile(50.0), 500000)) << histogram.percentile(50.0);
+    EXPECT_TRUE(near(histogram.percentile(99.0), 990000)) << histogram.percentile(99.0);
+    EXPECT_TRUE(near(histogram.percentile(99.9), 999000)) << histogram.percentile(99.9);
+    EXPECT_EQ(histogram.percentile(100.0), 1000000);  // Clamped to the recorded max
+
+    histogram.record(std::numeric_limits<uint64_t>::max());
+    EXPECT_EQ(histogram.percentile(100.0), std::numeric_limits<uint64_t>::max());
+}
+
+TEST(LatencyHistogramTest, MergeAndReset) {
+    LatencyHistogram fast;
+    LatencyHistogram slow;
+    for (int i = 0; i < 90; ++i) {
+        fast.record(10);
+    }
+    for (int i = 0; i < 10; ++i) {
+        slow.record(5000);
+    }
+
+    fast.merge(slow);
+    EXPECT_EQ(fast.count(), 100);
+    EXPECT_EQ(fast.percentile(90.0), 10);
+    EXPECT_GE(fast.percentile(91.0), 5000);
+    EXPECT_EQ(fast.max(), 5000);
+
+    fast.reset();
+    EXPECT_EQ(fast.count(), 0);
+    EXPECT_EQ(fast.percentile(50.0), 0);
+    EXPECT_EQ(fast.min(), 0);
+}
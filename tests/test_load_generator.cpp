@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "LoadGenerator.h"
+#include "Server.h"
+#include <sstream>
+
+using namespace MatchingEngine;
+
+namespace {
+
+std::unique_ptr<Server> startServer() {
+    ServerConfig config;
+    config.port = 0;
+    config.logEvents = false;
+    auto server = std::make_unique<Server>(config);
+    return server->start() ? std::move(server) : nullptr;
+}
+
+LoadConfig shortRun(uint16_t port) {
+    LoadConfig config;
+    config.port = port;
+    config.connections = 2;
+    config.ratePerConnection = 2000;
+    config.durationSeconds = 0.3;
+    config.warmupSeconds = 0.05;
+    return config;
+}
+
+} // namespace
+
+TEST(ReplayFlowTest, ParsesClientCommands) {
+    std::istringstream file(
+        "# quotes\n"
+        "buy AAPL 100 150.00\n"
+        "sell MSFT 50 300.25\n"
+        "\n"
+        "market-sell AAPL 20   # hits the bid\n"
+        "modify 2 300.50 40\n"
+        "cancel 1\n");
+    ReplayFlow flow;
+    std::string error;
+    ASSERT_TRUE(flow.parse(file, error)) << error;
+
+    ASSERT_EQ(flow.steps.size(), 5);
+    EXPECT_EQ(flow.orders, 3);
+    ASSERT_EQ(flow.symbols.size(), 2);
+    EXPECT_EQ(flow.symbols[flow.steps[1].symbol], "MSFT");
+    EXPECT_EQ(flow.steps[0].price, doubleToPrice(150.00));
+    EXPECT_EQ(flow.steps[2].type, OrderType::MARKET);
+    EXPECT_EQ(flow.steps[2].side, Side::SELL);
+    EXPECT_EQ(flow.steps[3].kind, FlowStep::Kind::MODIFY);
+    EXPECT_EQ(flow.steps[3].target, 2);
+    EXPECT_EQ(flow.steps[3].quantity, 40);
+    EXPECT_EQ(flow.steps[4].kind, FlowStep::Kind::CANCEL);
+
+    std::istringstream bad("buy AAPL lots\n");
+    ReplayFlow rejected;
+    EXPECT_FALSE(rejected.parse(bad, error));
+    EXPECT_NE(error.find("line 1"), std::string::npos);
+}
+
+TEST(LoadGeneratorTest, MatchesEveryReplyToItsMessage) {
+    auto server = startServer();
+    ASSERT_TRUE(server);
+
+    LoadConfig config = shortRun(server->getPort());
+    config.mix.marketPercent = 10;
+    LoadGenerator generator(config);
+    LoadReport report;
+    ASSERT_TRUE(generator.run(report));
+
+    EXPECT_EQ(report.connected, 2);
+    EXPECT_GT(report.sent, 500);
+    EXPECT_EQ(report.unanswered, 0);
+    EXPECT_EQ(report.answered, report.sent);
+    EXPECT_GT(report.newOrderAck.count(), 0);
+    EXPECT_GT(report.cancelAck.count(), 0);
+    EXPECT_GT(report.modifyAck.count(), 0);
+    EXPECT_GT(report.firstFill.count(), 0);
+    EXPECT_EQ(report.sendLag.count(), report.sent + report.skipped);
+    server->stop();
+}
+
+TEST(LoadGeneratorTest, ReplaysFileAcrossPasses) {
+    auto server = startServer();
+    ASSERT_TRUE(server);
+
+    // Each pass rests two orders, amends one and pulls both
+    std::istringstream file(
+        "buy IBM 10 99.00\n"
+        "sell IBM 10 101.00\n"
+        "modify 1 98.50 20\n"
+        "cancel 1\n"
+        "cancel 2\n");
+    ReplayFlow flow;
+    std::string error;
+    ASSERT_TRUE(flow.parse(file, error)) << error;
+
+    LoadConfig config = shortRun(server->getPort());
+    config.connections = 1;
+    config.ratePerConnection = 500;
+    LoadGenerator generator(config);
+    generator.setReplay(std::move(flow));
+    LoadReport report;
+    ASSERT_TRUE(generator.run(report));
+
+    EXPECT_EQ(report.unanswered, 0);
+    EXPECT_EQ(report.rejected, 0);  // Later passes name their own orders
+    EXPECT_GT(report.cancelAck.count(), 20);
+    EXPECT_NEAR(static_cast<double>(report.cancelAck.count()),
+                static_cast<double>(report.newOrderAck.count()), 4);
+    EXPECT_GT(report.modifyAck.count(), 0);
+    server->stop();
+}
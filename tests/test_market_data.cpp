@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include "MarketDataPublisher.h"
+#include "MatchingEngine.h"
+#include "Interner.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace MatchingEngine;
+
+namespace {
+
+// The publisher runs on the ring's consumer thread; wait for it to catch up
+template <typename Predicate>
+bool waitUntil(Predicate predicate) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(BookLevelEventsTest, MatchPublishesEachTouchedLevelOnce) {
+    EventRing events;
+    std::vector<EngineEvent> levels;
+    events.addConsumer([&](const EngineEvent* batch, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (batch[i].type == EventType::LEVEL) {
+                levels.push_back(batch[i]);
+            }
+        }
+    });
+    events.start();
+
+    MatchingEngineCore engine;
+    engine.setEventRing(&events);
+    engine.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 10);
+    engine.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 10);
+    OrderId far = engine.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1510000, 30);
+    engine.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1510000, 25);  // Sweeps 150, 5 @ 151
+    engine.cancelOrder(far);
+    events.stop();
+
+    // Three rests, then the sweep touches each level once, then the cancel
+    ASSERT_EQ(levels.size(), 6);
+    EXPECT_EQ(levels[1].quantity, 20);
+    EXPECT_EQ(levels[1].orderCount, 2);
+    EXPECT_EQ(static_cast<Side>(levels[3].side), Side::SELL);
+    EXPECT_EQ(levels[3].price, 1500000);
+    EXPECT_EQ(levels[3].quantity, 0);  // Level consumed
+    EXPECT_EQ(levels[4].price, 1510000);
+    EXPECT_EQ(levels[4].quantity, 25);
+    EXPECT_EQ(levels[4].orderCount, 1);
+    EXPECT_EQ(levels[5].price, 1510000);
+    EXPECT_EQ(levels[5].quantity, 0);  // Cancelled
+}
+
+TEST(MarketDataPublisherTest, NewSubscriberGetsImageThenIncrements) {
+    EventRing events;
+    MarketDataPublisher publisher(events);
+    events.start();
+
+    MatchingEngineCore engine;
+    engine.setEventRing(&events);
+    engine.submitOrder("MSFT", Side::BUY, OrderType::LIMIT, 300000, 100);
+    engine.submitOrder("MSFT", Side::BUY, OrderType::LIMIT, 299000, 50);
+    engine.submitOrder("MSFT", Side::SELL, OrderType::LIMIT, 301000, 70);
+    engine.submitOrder("IBM", Side::SELL, OrderType::LIMIT, 100000, 5);
+
+    SymbolId msft = symbolInterner().intern("MSFT");
+    SymbolId ibm = symbolInterner().intern("IBM");
+    ASSERT_TRUE(waitUntil([&]() { return publisher.getDepth(ibm, Side::SELL).size() == 1; }));
+    std::atomic<int> ready{0};
+    auto id = publisher.subscribe(msft, [&](MarketDataPublisher::SubscriptionId) { ++ready; });
+    EXPECT_EQ(ready, 1);
+
+    std::vector<LevelUpdate> updates;
+    ASSERT_TRUE(publisher.poll(id, updates));
+    ASSERT_EQ(updates.size(), 3);  // IBM filtered out
+    EXPECT_EQ(updates[0].price, 300000);  // Bids best first, then asks
+    EXPECT_EQ(updates[1].price, 299000);
+    EXPECT_EQ(updates[2].side, Side::SELL);
+    EXPECT_EQ(updates[2].quantity, 70);
+
+    updates.clear();
+    engine.submitOrder("MSFT", Side::SELL, OrderType::LIMIT, 300000, 40);
+    ASSERT_TRUE(waitUntil([&]() { return ready == 2; }));
+    ASSERT_TRUE(publisher.poll(id, updates));
+    ASSERT_EQ(updates.size(), 1);
+    EXPECT_EQ(updates[0].side, Side::BUY);
+    EXPECT_EQ(updates[0].quantity, 60);
+
+    auto depth = publisher.getDepth(msft, Side::BUY);
+    ASSERT_EQ(depth.size(), 2);
+    EXPECT_EQ(depth[0].quantity, 60);
+
+    publisher.unsubscribe(id);
+    EXPECT_FALSE(publisher.poll(id, updates));
+    events.stop();
+}
+
+TEST(MarketDataPublisherTest, ConflatesForSlowSubscriber) {
+    EventRing events;
+    MarketDataPublisher publisher(events);
+    events.start();
+
+    MatchingEngineCore engine;
+    engine.setEventRing(&events);
+    auto slow = publisher.subscribe(0, nullptr);
+    for (int i = 0; i < 100; ++i) {
+        engine.submitOrder("GOOGL", Side::BUY, OrderType::LIMIT, 2800000, 1);
+    }
+    engine.submitOrder("GOOGL", Side::SELL, OrderType::LIMIT, 2810000, 3);
+    SymbolId googl = symbolInterner().intern("GOOGL");
+    ASSERT_TRUE(waitUntil([&]() { return publisher.getDepth(googl, Side::SELL).size() == 1; }));
+
+    // One entry per level, carrying the latest aggregate
+    std::vector<LevelUpdate> updates;
+    ASSERT_TRUE(publisher.poll(slow, updates));
+    ASSERT_EQ(updates.size(), 2);
+    EXPECT_EQ(updates[0].price, 2800000);
+    EXPECT_EQ(updates[0].quantity, 100);
+    EXPECT_EQ(updates[0].orderCount, 100);
+    EXPECT_EQ(updates[1].price, 2810000);
+    EXPECT_EQ(publisher.getConflated(), 99);
+    events.stop();
+}
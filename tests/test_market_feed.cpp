@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include "FeedPublisher.h"
+#include "FeedReceiver.h"
+#include "MatchingEngine.h"
+#include <chrono>
+#include <thread>
+
+using namespace MatchingEngine;
+
+namespace {
+
+FeedProtocol::Entry level(const char* symbol, Side side, Price price, Quantity quantity) {
+    FeedProtocol::Entry entry;
+    ProtocolV2::setSymbol(entry.symbol, symbol);
+    entry.side = side;
+    entry.price = price;
+    entry.quantity = quantity;
+    entry.orderCount = quantity > 0 ? 1 : 0;
+    return entry;
+}
+
+std::vector<char> packet(FeedProtocol::PacketKind kind, uint64_t sequence,
+                         std::vector<FeedProtocol::Entry> entries, uint16_t part = 0,
+                         uint16_t parts = 1) {
+    FeedProtocol::PacketHeader header;
+    header.kind = kind;
+    header.sequence = sequence;
+    header.part = part;
+    header.parts = parts;
+    std::vector<char> out(FeedProtocol::packetSize(entries.size()));
+    FeedProtocol::encode(out.data(), header, entries.data(), entries.size());
+    return out;
+}
+
+std::vector<char> incremental(uint64_t sequence, std::vector<FeedProtocol::Entry> entries) {
+    return packet(FeedProtocol::PacketKind::INCREMENTAL, sequence, std::move(entries));
+}
+
+void deliver(FeedReceiver& receiver, const std::vector<char>& datagram) {
+    receiver.onPacket(datagram.data(), datagram.size());
+}
+
+template <typename Predicate>
+bool waitUntil(Predicate predicate) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(FeedProtocolTest, RoundTripsAndRejectsMalformedPackets) {
+    auto datagram = incremental(7, {level("AAPL", Side::SELL, 1500000, 30)});
+    EXPECT_EQ(datagram.size(), FeedProtocol::HEADER_SIZE + FeedProtocol::ENTRY_SIZE);
+
+    FeedProtocol::PacketHeader header;
+    std::vector<FeedProtocol::Entry> entries;
+    ASSERT_TRUE(FeedProtocol::decode(datagram.data(), datagram.size(), header, entries));
+    EXPECT_EQ(header.kind, FeedProtocol::PacketKind::INCREMENTAL);
+    EXPECT_EQ(header.sequence, 7);
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_EQ(ProtocolV2::getSymbol(entries[0].symbol), "AAPL");
+    EXPECT_EQ(entries[0].side, Side::SELL);
+    EXPECT_EQ(entries[0].price, 1500000);
+    EXPECT_EQ(entries[0].quantity, 30);
+
+    EXPECT_FALSE(FeedProtocol::decode(datagram.data(), datagram.size() - 1, header, entries));
+    datagram[0] = 9;
+    EXPECT_FALSE(FeedProtocol::decode(datagram.data(), datagram.size(), header, entries));
+}
+
+TEST(FeedReceiverTest, SyncsFromSnapshotThenAppliesHeldIncrementals) {
+    FeedReceiver receiver{FeedConfig()};
+    deliver(receiver, incremental(4, {level("MSFT", Side::BUY, 300000, 10)}));
+    deliver(receiver, incremental(5, {level("MSFT", Side::BUY, 300000, 25)}));
+    EXPECT_FALSE(receiver.isSynced());
+    EXPECT_TRUE(receiver.getDepth("MSFT", Side::BUY).empty());
+
+    // Image as of packet 4, split over two parts
+    deliver(receiver, packet(FeedProtocol::PacketKind::SNAPSHOT, 4,
+                             {level("MSFT", Side::BUY, 300000, 10)}, 0, 2));
+    EXPECT_FALSE(receiver.isSynced());
+    deliver(receiver, packet(FeedProtocol::PacketKind::SNAPSHOT, 4,
+                             {level("MSFT", Side::SELL, 301000, 5)}, 1, 2));
+    EXPECT_TRUE(receiver.isSynced());
+    EXPECT_EQ(receiver.getSequence(), 5);
+
+    auto bids = receiver.getDepth("MSFT", Side::BUY);
+    ASSERT_EQ(bids.size(), 1);
+    EXPECT_EQ(bids[0].quantity, 25);  // Packet 5 replayed over the image
+    EXPECT_EQ(receiver.getDepth("MSFT", Side::SELL).size(), 1);
+
+    deliver(receiver, incremental(6, {level("MSFT", Side::SELL, 301000, 0)}));
+    deliver(receiver, incremental(6, {level("MSFT", Side::SELL, 301000, 9)}));  // Duplicate
+    EXPECT_TRUE(receiver.getDepth("MSFT", Side::SELL).empty());
+    EXPECT_EQ(receiver.getGaps(), 0);
+}
+
+TEST(FeedReceiverTest, RecoversFromGapWithNextSnapshot) {
+    FeedReceiver receiver{FeedConfig()};
+    deliver(receiver, packet(FeedProtocol::PacketKind::SNAPSHOT, 0, {}));
+    ASSERT_TRUE(receiver.isSynced());
+    deliver(receiver, incremental(1, {level("IBM", Side::BUY, 100000, 10)}));
+
+    // Packet 2 is lost
+    deliver(receiver, incremental(3, {level("IBM", Side::BUY, 99000, 7)}));
+    EXPECT_FALSE(receiver.isSynced());
+    EXPECT_EQ(receiver.getGaps(), 1);
+
+    // A snapshot from before the gap can't fill it
+    deliver(receiver, packet(FeedProtocol::PacketKind::SNAPSHOT, 1,
+                             {level("IBM", Side::BUY, 100000, 10)}));
+    EXPECT_FALSE(receiver.isSynced());
+
+    // Out-of-order parts are discarded until a whole cycle arrives
+    deliver(receiver, packet(FeedProtocol::PacketKind::SNAPSHOT, 2,
+                             {level("IBM", Side::BUY, 100000, 4)}, 1, 2));
+    EXPECT_FALSE(receiver.isSynced());
+    deliver(receiver, packet(FeedProtocol::PacketKind::SNAPSHOT, 2,
+                             {level("IBM", Side::BUY, 100000, 4)}));
+    ASSERT_TRUE(receiver.isSynced());
+    EXPECT_EQ(receiver.getSequence(), 3);
+
+    auto bids = receiver.getDepth("IBM", Side::BUY);
+    ASSERT_EQ(bids.size(), 2);
+    EXPECT_EQ(bids[0].price, 100000);
+    EXPECT_EQ(bids[0].quantity, 4);
+    EXPECT_EQ(bids[1].price, 99000);
+}
+
+TEST(MarketFeedTest, ReceiverReplicatesEngineBooksOverUdp) {
+    // Unicast on loopback stands in for the multicast groups
+    FeedConfig config;
+    config.incrementalAddress = "127.0.0.1";
+    config.incrementalPort = 0;
+    config.snapshotAddress = "127.0.0.1";
+    config.snapshotPort = 0;
+    config.snapshotIntervalMs = 20;
+
+    FeedReceiver receiver(config);
+    ASSERT_TRUE(receiver.start());
+    config.incrementalPort = receiver.getIncrementalPort();
+    config.snapshotPort = receiver.getSnapshotPort();
+
+    EventRing events;
+    FeedPublisher publisher(events, config);
+    ASSERT_TRUE(publisher.start());
+    events.start();
+
+    MatchingEngineCore engine;
+    engine.setEventRing(&events);
+
+    // More levels than one packet holds, so snapshots span several parts
+    const int levels = static_cast<int>(FeedProtocol::MAX_ENTRIES) + 10;
+    for (int i = 0; i < levels; ++i) {
+        engine.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1400000 - i * 100, 10);
+    }
+    engine.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 20);
+    engine.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1400000, 15);  // Hits the best bid
+
+    ASSERT_TRUE(waitUntil([&]() {
+        return receiver.isSynced() && receiver.getSequence() == publisher.getSequence() &&
+               receiver.getDepth("AAPL", Side::SELL).size() == 2;
+    }));
+    auto bids = receiver.getDepth("AAPL", Side::BUY, levels);
+    ASSERT_EQ(bids.size(), static_cast<size_t>(levels - 1));
+    EXPECT_EQ(bids[0].price, 1399900);
+    auto asks = receiver.getDepth("AAPL", Side::SELL);
+    EXPECT_EQ(asks[0].price, 1400000);
+    EXPECT_EQ(asks[0].quantity, 5);
+    EXPECT_GT(publisher.getSnapshotCycles(), 0);
+
+    events.stop();
+    publisher.stop();
+    receiver.stop();
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "MatchingEngine.h"
+#include "Interner.h"
 #include <vector>
 #include <thread>
 #include <chrono>
@@ -15,7 +16,7 @@ protected:
         orders.clear();
         trades.clear();
         
-        engine->setOrderCallback([this](const OrderPtr& order) {
+        engine->setOrderCallback([this](const Order& order) {
             orders.push_back(order);
         });
         
@@ -25,7 +26,7 @@ protected:
     }
     
     std::unique_ptr<MatchingEngineCore> engine;
-    std::vector<OrderPtr> orders;
+    std::vector<Order> orders;
     std::vector<Trade> trades;
 };
 
@@ -231,6 +232,32 @@ TEST_F(MatchingEngineTest, ClientId) {
     EXPECT_EQ(order->getClientId(), "client123");
 }
 
+TEST_F(MatchingEngineTest, MassCancelBySymbolSideAndClient) {
+    engine->submitOrder("AAPL", Side::BUY, OrderType::LIMIT, doubleToPrice(149.00), 100, "alice");
+    engine->submitOrder("AAPL", Side::SELL, OrderType::LIMIT, doubleToPrice(151.00), 100, "alice");
+    engine->submitOrder("MSFT", Side::BUY, OrderType::LIMIT, doubleToPrice(299.00), 100, "alice");
+    OrderId bob = engine->submitOrder("AAPL", Side::BUY, OrderType::LIMIT,
+                                      doubleToPrice(149.00), 100, "bob");
+    ClientKey alice = clientInterner().intern("alice");
+    SymbolId aapl = symbolInterner().intern("AAPL");
+    
+    EXPECT_EQ(engine->massCancel(EngineCommand::massCancel(
+                  MASS_CANCEL_BY_SYMBOL | MASS_CANCEL_BY_SIDE | MASS_CANCEL_BY_CLIENT,
+                  aapl, Side::BUY, alice)), 1);
+    EXPECT_EQ(engine->getBestAsk("AAPL"), doubleToPrice(151.00));
+    EXPECT_EQ(engine->getBestBid("AAPL"), doubleToPrice(149.00));  // Bob's
+    
+    // Every symbol, both sides
+    EXPECT_EQ(engine->massCancel(EngineCommand::massCancel(MASS_CANCEL_BY_CLIENT, 0, Side::BUY,
+                                                           alice)), 2);
+    EXPECT_EQ(engine->getLiveOrders(), 1);
+    EXPECT_NE(engine->getOrder(bob), nullptr);
+    
+    // Nothing left of alice's; a mass cancel still succeeds
+    EXPECT_TRUE(engine->execute(EngineCommand::massCancel(MASS_CANCEL_BY_CLIENT, 0, Side::BUY,
+                                                          alice)));
+}
+
 // Test market data queries
 TEST_F(MatchingEngineTest, MarketData) {
     engine->submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 
@@ -261,7 +288,7 @@ TEST_F(MatchingEngineTest, OrderCallbacks) {
                        doubleToPrice(150.00), 100);
     
     ASSERT_EQ(orders.size(), 1);
-    EXPECT_EQ(orders[0]->getSymbol(), "AAPL");
+    EXPECT_EQ(orders[0].getSymbol(), "AAPL");
 }
 
 // Test trade callbacks
@@ -316,6 +343,45 @@ TEST_F(MatchingEngineTest, StopLimitOrder) {
     EXPECT_EQ(stopOrder->getPrice(), doubleToPrice(152.00));
 }
 
+// Elected stops are reported after the order whose trades elected them
+TEST_F(MatchingEngineTest, ElectedStopIsReported) {
+    OrderId stopId = engine->submitOrder("AAPL", Side::SELL, OrderType::STOP_LOSS, 0, 30, "",
+                                         doubleToPrice(149.00));
+    engine->submitOrder("AAPL", Side::BUY, OrderType::LIMIT, doubleToPrice(149.00), 100);
+    orders.clear();
+    trades.clear();
+    
+    OrderId sellId = engine->submitOrder("AAPL", Side::SELL, OrderType::LIMIT,
+                                         doubleToPrice(149.00), 20);
+    ASSERT_EQ(trades.size(), 2);
+    ASSERT_EQ(orders.size(), 2);
+    EXPECT_EQ(orders[0].getOrderId(), sellId);
+    EXPECT_EQ(orders[1].getOrderId(), stopId);
+    EXPECT_EQ(orders[1].getStatus(), OrderStatus::FILLED);
+    EXPECT_EQ(engine->getOrder(stopId), nullptr);
+    EXPECT_EQ(engine->getLiveOrders(), 1);
+    EXPECT_EQ(engine->getBidDepth("AAPL")[0].second, 50);
+}
+
+// Parked stops survive a snapshot and still trigger afterwards
+TEST_F(MatchingEngineTest, ParkedStopsInSnapshot) {
+    engine->submitOrder("AAPL", Side::BUY, OrderType::STOP_LIMIT, doubleToPrice(152.00), 10, "",
+                        doubleToPrice(151.00));
+    engine->submitOrder("AAPL", Side::SELL, OrderType::LIMIT, doubleToPrice(151.00), 15);
+    
+    EngineSnapshot snapshot;
+    engine->captureSnapshot(snapshot);
+    ASSERT_EQ(snapshot.orders.size(), 2);
+    EXPECT_EQ(snapshot.orders[1].getType(), OrderType::STOP_LIMIT);
+    
+    MatchingEngineCore restored;
+    ASSERT_TRUE(restored.loadSnapshot(snapshot));
+    EXPECT_EQ(restored.getAskDepth("AAPL")[0].second, 15);
+    restored.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, doubleToPrice(151.00), 1);
+    EXPECT_EQ(restored.getAskDepth("AAPL")[0].second, 4);  // 1 + the stop's 10
+    EXPECT_TRUE(restored.getBidDepth("AAPL").empty());
+}
+
 // Test large order matching
 TEST_F(MatchingEngineTest, LargeOrderMatch) {
     // Add many small orders
@@ -417,3 +483,150 @@ TEST_F(MatchingEngineTest, Statistics) {
     EXPECT_EQ(engine->getTotalTrades(), 1);
 }
 
+
+// Test per-symbol book configuration
+TEST_F(MatchingEngineTest, ArrayBookPerSymbol) {
+    OrderBookConfig config;
+    config.ladderType = PriceLadderType::ARRAY;
+    config.tickSize = doubleToPrice(0.01);
+    engine->setBookConfig("AAPL", config);
+    
+    engine->submitOrder("AAPL", Side::SELL, OrderType::LIMIT, doubleToPrice(150.00), 100);
+    engine->submitOrder("MSFT", Side::SELL, OrderType::LIMIT, doubleToPrice(300.0001), 100);
+    engine->submitOrder("AAPL", Side::BUY, OrderType::LIMIT, doubleToPrice(150.00), 40);
+    
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(engine->getAskDepth("AAPL", 1)[0].second, 60);
+    
+    // MSFT keeps the default map book, so sub-tick prices still rest
+    EXPECT_EQ(engine->getBestAsk("MSFT"), doubleToPrice(300.0001));
+}
+
+// Time in force
+namespace {
+
+EngineCommand timedOrder(OrderId orderId, Side side, OrderType type, Price price, Quantity quantity,
+                         TimeInForce timeInForce, uint64_t entered, uint64_t expireTime = 0) {
+    EngineCommand command = EngineCommand::newOrder(orderId, symbolInterner().intern("AAPL"), side,
+                                                    type, price, quantity);
+    command.timeInForce = timeInForce;
+    command.expireTime = expireTime;
+    command.timestamp = entered;
+    return command;
+}
+
+} // namespace
+
+TEST_F(MatchingEngineTest, GoodTillDateExpiresAsCancel) {
+    std::vector<EngineCommand> recorded;
+    engine->setCommandHook([&](const EngineCommand& command) {
+        recorded.push_back(command);
+        return uint64_t(recorded.size());
+    });
+    ASSERT_TRUE(engine->execute(timedOrder(1001, Side::BUY, OrderType::LIMIT, doubleToPrice(150.00),
+                                           100, TimeInForce::GTD, 1000000, 5000000)));
+    ASSERT_TRUE(engine->execute(timedOrder(1002, Side::BUY, OrderType::LIMIT, doubleToPrice(149.00),
+                                           100, TimeInForce::GTC, 1000000)));
+    EXPECT_EQ(engine->getScheduledExpiries(), 1);
+    EXPECT_EQ(engine->getOrder(1001)->getTimeInForce(), TimeInForce::GTD);
+    EXPECT_LE(engine->nextExpiryCheck(), 5000000);
+
+    EXPECT_EQ(engine->expireOrders(4999999), 0);
+    ASSERT_NE(engine->getOrder(1001), nullptr);
+    orders.clear();
+    EXPECT_EQ(engine->expireOrders(5000000), 1);
+    EXPECT_EQ(engine->getOrder(1001), nullptr);
+    EXPECT_EQ(engine->getBestBid("AAPL"), doubleToPrice(149.00));
+    EXPECT_EQ(engine->nextExpiryCheck(), UINT64_MAX);
+
+    ASSERT_EQ(orders.size(), 1);
+    EXPECT_EQ(orders[0].getOrderId(), 1001);
+    EXPECT_EQ(orders[0].getStatus(), OrderStatus::CANCELLED);
+
+    // Journaled as a plain cancel stamped with the expiry pass's time
+    ASSERT_EQ(recorded.size(), 3);
+    EXPECT_EQ(recorded[0].timeInForce, TimeInForce::GTD);
+    EXPECT_EQ(recorded[0].expireTime, 5000000);
+    EXPECT_EQ(recorded[2].type, CommandType::CANCEL_ORDER);
+    EXPECT_EQ(recorded[2].orderId, 1001);
+    EXPECT_EQ(recorded[2].timestamp, 5000000);
+}
+
+TEST_F(MatchingEngineTest, DayOrdersLapseAtSessionClose) {
+    const uint64_t day = 86400ULL * 1000000000ULL;
+    const uint64_t close = 16ULL * 3600 * 1000000000ULL;
+    EngineConfig config;
+    config.expiry.sessionCloseNanos = close;
+    MatchingEngineCore core(config);
+
+    uint64_t morning = 10 * day + 9ULL * 3600 * 1000000000ULL;
+    uint64_t evening = 10 * day + 17ULL * 3600 * 1000000000ULL;
+    auto expiry = [&](TimeInForce timeInForce, uint64_t entered) {
+        return core.expiryTimeOf(timedOrder(1, Side::BUY, OrderType::LIMIT, 1, 1, timeInForce, entered));
+    };
+    EXPECT_EQ(expiry(TimeInForce::DAY, morning), 10 * day + close);
+    // Entered after the close, it lives through the next session
+    EXPECT_EQ(expiry(TimeInForce::DAY, evening), 11 * day + close);
+    EXPECT_EQ(expiry(TimeInForce::GTC, morning), 0);
+
+    ASSERT_TRUE(core.execute(timedOrder(1, Side::SELL, OrderType::LIMIT, doubleToPrice(150.00), 100,
+                                        TimeInForce::DAY, morning)));
+    ASSERT_TRUE(core.execute(timedOrder(2, Side::SELL, OrderType::LIMIT, doubleToPrice(151.00), 100,
+                                        TimeInForce::DAY, evening)));
+    EXPECT_EQ(core.expireOrders(10 * day + close), 1);
+    EXPECT_EQ(core.getOrder(1), nullptr);
+    ASSERT_NE(core.getOrder(2), nullptr);
+    EXPECT_EQ(core.expireOrders(11 * day + close), 1);
+    EXPECT_EQ(core.getLiveOrders(), 0);
+}
+
+TEST_F(MatchingEngineTest, RetiredOrdersLeaveTheWheel) {
+    uint64_t later = 9000000;
+    // Filled on entry, cancelled, or never resting: nothing stays scheduled
+    ASSERT_TRUE(engine->execute(timedOrder(1, Side::SELL, OrderType::LIMIT, doubleToPrice(150.00), 100,
+                                           TimeInForce::GTD, 1000, later)));
+    ASSERT_TRUE(engine->execute(timedOrder(2, Side::BUY, OrderType::LIMIT, doubleToPrice(150.00), 100,
+                                           TimeInForce::GTD, 2000, later)));
+    ASSERT_TRUE(engine->execute(timedOrder(3, Side::BUY, OrderType::IOC, doubleToPrice(150.00), 100,
+                                           TimeInForce::GTD, 3000, later)));
+    ASSERT_TRUE(engine->execute(timedOrder(4, Side::BUY, OrderType::LIMIT, doubleToPrice(140.00), 100,
+                                           TimeInForce::GTD, 4000, later)));
+    EXPECT_EQ(engine->getScheduledExpiries(), 1);
+    EXPECT_TRUE(engine->cancelOrder(4));
+    EXPECT_EQ(engine->getScheduledExpiries(), 0);
+    EXPECT_EQ(engine->expireOrders(later), 0);
+}
+
+TEST_F(MatchingEngineTest, ExpiriesRunInBatches) {
+    for (OrderId id = 1; id <= 10; ++id) {
+        ASSERT_TRUE(engine->execute(timedOrder(id, id % 2 ? Side::BUY : Side::SELL, OrderType::LIMIT,
+                                               doubleToPrice(id % 2 ? 140.00 : 160.00), 100,
+                                               TimeInForce::GTD, 1000, 5000000)));
+    }
+    EXPECT_EQ(engine->expireOrders(6000000, 4), 4);
+    EXPECT_EQ(engine->getLiveOrders(), 6);
+    EXPECT_LE(engine->nextExpiryCheck(), 6000000);  // More is overdue
+    EXPECT_EQ(engine->expireOrders(6000000, 4), 4);
+    EXPECT_EQ(engine->expireOrders(6000000, 4), 2);
+    EXPECT_EQ(engine->getLiveOrders(), 0);
+    EXPECT_EQ(engine->getBestBid("AAPL"), 0);
+    EXPECT_EQ(engine->getBestAsk("AAPL"), 0);
+}
+
+TEST_F(MatchingEngineTest, SnapshotKeepsExpiries) {
+    ASSERT_TRUE(engine->execute(timedOrder(1, Side::BUY, OrderType::LIMIT, doubleToPrice(150.00), 100,
+                                           TimeInForce::GTD, 1000, 5000000)));
+    ASSERT_TRUE(engine->execute(timedOrder(2, Side::BUY, OrderType::LIMIT, doubleToPrice(149.00), 100,
+                                           TimeInForce::GTC, 1000)));
+    EngineSnapshot snapshot;
+    engine->captureSnapshot(snapshot);
+    ASSERT_EQ(snapshot.expireTimes.size(), 2);
+
+    MatchingEngineCore restored;
+    ASSERT_TRUE(restored.loadSnapshot(snapshot));
+    EXPECT_EQ(restored.getScheduledExpiries(), 1);
+    EXPECT_EQ(restored.getOrder(1)->getTimeInForce(), TimeInForce::GTD);
+    EXPECT_EQ(restored.expireOrders(5000000), 1);
+    EXPECT_EQ(restored.getOrder(1), nullptr);
+    EXPECT_NE(restored.getOrder(2), nullptr);
+}
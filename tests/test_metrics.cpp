@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include "Metrics.h"
+#include "Server.h"
+#include "Client.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace MatchingEngine;
+
+namespace {
+
+// Metrics are process-wide; every test starts from a clean, enabled registry
+class MetricsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        metrics().setEnabled(true);
+        metrics().reset();
+    }
+    void TearDown() override {
+        metrics().setEnabled(false);
+        metrics().reset();
+    }
+};
+
+const MetricsSnapshot::Thread* findThread(const MetricsSnapshot& snapshot, const std::string& name) {
+    for (const auto& thread : snapshot.threads) {
+        if (thread.name == name) {
+            return &thread;
+        }
+    }
+    return nullptr;
+}
+
+std::string scrape(uint16_t port) {
+    SocketType sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (connect(sock, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
+        closesocket(sock);
+        return "";
+    }
+    const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+    send(sock, request, sizeof(request) - 1, 0);
+
+    std::string response;
+    char buffer[4096];
+    int received;
+    while ((received = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, static_cast<size_t>(received));
+    }
+    closesocket(sock);
+    return response;
+}
+
+} // namespace
+
+TEST_F(MetricsTest, RecordsPerThreadAndKeepsExitedThreads) {
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool recorded = false;
+    bool release = false;
+
+    std::thread worker([&]() {
+        metrics().nameThread("worker");
+        for (int i = 0; i < 100; ++i) {
+            StageTimer timer(Stage::MATCH);
+        }
+        countMetric(Counter::FRAMES, 5);
+        setMetric(Gauge::BOOKS, 3);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        recorded = true;
+        changed.notify_all();
+        changed.wait(lock, [&]() { return release; });
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return recorded; });
+    }
+    MetricsSnapshot live = metrics().snapshot();
+    const MetricsSnapshot::Thread* thread = findThread(live, "worker");
+    ASSERT_NE(thread, nullptr);
+    EXPECT_EQ(thread->stages[static_cast<size_t>(Stage::MATCH)].count(), 100);
+    EXPECT_EQ(thread->stages[static_cast<size_t>(Stage::DECODE)].count(), 0);
+    EXPECT_EQ(thread->counters[static_cast<size_t>(Counter::FRAMES)], 5);
+    EXPECT_TRUE(thread->hasGauge[static_cast<size_t>(Gauge::BOOKS)]);
+    EXPECT_EQ(thread->gauges[static_cast<size_t>(Gauge::BOOKS)], 3);
+    EXPECT_GT(live.ticksPerNanosecond, 0.0);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+        changed.notify_all();
+    }
+    worker.join();
+
+    // The thread is gone but its samples are not
+    MetricsSnapshot after = metrics().snapshot();
+    EXPECT_EQ(findThread(after, "worker"), nullptr);
+    EXPECT_EQ(after.stage(Stage::MATCH).count(), 100);
+    EXPECT_EQ(after.counter(Counter::FRAMES), 5);
+}
+
+TEST_F(MetricsTest, DisabledRecordsNothing) {
+    metrics().setEnabled(false);
+    uint64_t start = stageStart();
+    EXPECT_EQ(start, 0);
+    EXPECT_EQ(stageEnd(Stage::SEND, start), 0);
+    {
+        StageTimer timer(Stage::SEND);
+    }
+    countMetric(Counter::BYTES_SENT, 10);
+    EXPECT_EQ(metrics().snapshot().stage(Stage::SEND).count(), 0);
+    EXPECT_EQ(metrics().snapshot().counter(Counter::BYTES_SENT), 0);
+}
+
+TEST_F(MetricsTest, ExportsPrometheusSummaries) {
+    metrics().nameThread("exporter");
+    uint64_t stamp = stageStart();
+    stamp = stageEnd(Stage::BOOK_LOOKUP, stamp);
+    stageEnd(Stage::MATCH, stamp);
+    countMetric(Counter::COMMANDS, 1);
+
+    std::string text = metrics().snapshot().toPrometheus();
+    EXPECT_NE(text.find("# TYPE matching_stage_latency_ns summary"), std::string::npos);
+    EXPECT_NE(text.find("matching_stage_latency_ns{thread=\"exporter\",stage=\"book_lookup\",quantile=\"0.99\"}"),
+              std::string::npos);
+    EXPECT_NE(text.find("matching_stage_latency_ns_count{thread=\"exporter\",stage=\"match\"} 1"),
+              std::string::npos);
+    EXPECT_NE(text.find("matching_commands_total{thread=\"exporter\"} 1"), std::string::npos);
+    EXPECT_EQ(text.find("stage=\"send\""), std::string::npos);  // Nothing recorded
+
+    std::string table = metrics().snapshot().toText();
+    EXPECT_NE(table.find("book_lookup"), std::string::npos);
+    EXPECT_NE(table.find("commands=1"), std::string::npos);
+}
+
+#ifdef __linux__
+TEST_F(MetricsTest, ServerTimesEveryStageAndServesThem) {
+    ServerConfig config;
+    config.port = 0;
+    config.ioMode = ServerIoMode::EPOLL;
+    config.logEvents = false;
+    config.metricsEnabled = true;
+    config.metricsPort = 0;
+    Server server(config);
+    ASSERT_TRUE(server.start());
+    ASSERT_NE(server.getMetricsPort(), 0);
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t acks = 0;
+    Client client("127.0.0.1", server.getPort());
+    client.setVerbose(false);
+    client.setOrderAckCallback([&](const OrderAckMessage&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++acks;
+        changed.notify_all();
+    });
+    ASSERT_TRUE(client.connect());
+    client.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 100);
+    client.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 100);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(changed.wait_for(lock, std::chrono::seconds(5), [&]() { return acks >= 2; }));
+    }
+
+    // The shard closes DISPATCH after the reply is queued, so allow it a moment
+    std::string response;
+    for (int attempt = 0; attempt < 50; ++attempt) {
+        response = scrape(server.getMetricsPort());
+        if (response.find("stage=\"dispatch\"") != std::string::npos &&
+            response.find("stage=\"send\"") != std::string::npos) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    EXPECT_EQ(response.rfind("HTTP/1.0 200 OK\r\n", 0), 0);
+    for (const char* stage : {"receive", "decode", "queue", "book_lookup", "match", "dispatch", "send"}) {
+        EXPECT_NE(response.find(std::string("stage=\"") + stage + "\""), std::string::npos) << stage;
+    }
+    EXPECT_NE(response.find("thread=\"shard-"), std::string::npos);
+    EXPECT_NE(response.find("thread=\"io-"), std::string::npos);
+    EXPECT_NE(response.find("matching_resting_orders{thread=\"shard-"), std::string::npos);
+
+    client.disconnect();
+    server.stop();
+}
+#endif
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include "OrderIndex.h"
+#include "OrderSlab.h"
+
+using namespace MatchingEngine;
+
+// Test basic insert / find / erase
+TEST(OrderIdMapTest, InsertFindErase) {
+    OrderIdMap<uint32_t> index;
+    
+    index.insert(1, 10);
+    index.insert(2, 20);
+    index.insert(1, 11);  // Overwrite
+    
+    ASSERT_NE(index.find(1), nullptr);
+    EXPECT_EQ(*index.find(1), 11);
+    EXPECT_EQ(*index.find(2), 20);
+    EXPECT_EQ(index.find(3), nullptr);
+    EXPECT_EQ(index.size(), 2);
+    
+    EXPECT_TRUE(index.erase(1));
+    EXPECT_FALSE(index.erase(1));
+    EXPECT_EQ(index.find(1), nullptr);
+    EXPECT_EQ(index.size(), 1);
+}
+
+// Test erase keeps probe chains reachable while the table grows
+TEST(OrderIdMapTest, ManyKeysWithErase) {
+    OrderIdMap<uint64_t> index(4);
+    
+    for (OrderId id = 1; id <= 10000; ++id) {
+        index.insert(id, id * 2);
+    }
+    for (OrderId id = 1; id <= 10000; id += 2) {
+        EXPECT_TRUE(index.erase(id));
+    }
+    
+    EXPECT_EQ(index.size(), 5000);
+    for (OrderId id = 1; id <= 10000; ++id) {
+        const uint64_t* value = index.find(id);
+        if (id % 2 == 0) {
+            ASSERT_NE(value, nullptr);
+            EXPECT_EQ(*value, id * 2);
+        } else {
+            EXPECT_EQ(value, nullptr);
+        }
+    }
+}
+
+// Test slab recycles released records
+TEST(OrderSlabTest, ReuseReleasedSlots) {
+    OrderSlab slab(4);
+    auto order = std::make_shared<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT,
+                                         doubleToPrice(150.00), 100);
+    
+    OrderSlot a = slab.allocate(order.get());
+    OrderSlot b = slab.allocate(order.get());
+    EXPECT_NE(a, b);
+    EXPECT_EQ(slab.size(), 2);
+    
+    slab.release(a);
+    EXPECT_EQ(slab.size(), 1);
+    EXPECT_EQ(slab[a].order, nullptr);
+    
+    OrderSlot c = slab.allocate(order.get());
+    EXPECT_EQ(c, a);
+    EXPECT_EQ(slab[c].order, order.get());
+}
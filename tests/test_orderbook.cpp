@@ -1,13 +1,17 @@
 #include <gtest/gtest.h>
 #include "OrderBook.h"
+#include <atomic>
+#include <limits>
 #include <memory>
+#include <thread>
 
 using namespace MatchingEngine;
 
-class OrderBookTest : public ::testing::Test {
+// Every book test runs against both price ladder implementations
+class OrderBookTest : public ::testing::TestWithParam<OrderBookConfig> {
 protected:
     void SetUp() override {
-        orderBook = std::make_unique<OrderBook>("AAPL");
+        orderBook = std::make_unique<OrderBook>("AAPL", GetParam());
         nextOrderId = 1;
     }
     
@@ -20,8 +24,25 @@ protected:
     OrderId nextOrderId;
 };
 
+OrderBookConfig arrayBookConfig(size_t levels = 4096) {
+    OrderBookConfig config;
+    config.ladderType = PriceLadderType::ARRAY;
+    config.tickSize = doubleToPrice(0.01);
+    config.ladderLevels = levels;
+    return config;
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    PriceLadders,
+    OrderBookTest,
+    ::testing::Values(OrderBookConfig(), arrayBookConfig()),
+    [](const ::testing::TestParamInfo<OrderBookConfig>& info) {
+        return info.param.ladderType == PriceLadderType::ARRAY ? "Array" : "Map";
+    }
+);
+
 // Test empty order book
-TEST_F(OrderBookTest, EmptyOrderBook) {
+TEST_P(OrderBookTest, EmptyOrderBook) {
     EXPECT_EQ(orderBook->getBestBid(), 0);
     EXPECT_EQ(orderBook->getBestAsk(), 0);
     
@@ -32,7 +53,7 @@ TEST_F(OrderBookTest, EmptyOrderBook) {
 }
 
 // Test adding buy orders
-TEST_F(OrderBookTest, AddBuyOrders) {
+TEST_P(OrderBookTest, AddBuyOrders) {
     auto order1 = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 100);
     auto order2 = createOrder(Side::BUY, OrderType::LIMIT, 149.50, 200);
     auto order3 = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 50);
@@ -47,7 +68,7 @@ TEST_F(OrderBookTest, AddBuyOrders) {
 }
 
 // Test adding sell orders
-TEST_F(OrderBookTest, AddSellOrders) {
+TEST_P(OrderBookTest, AddSellOrders) {
     auto order1 = createOrder(Side::SELL, OrderType::LIMIT, 151.00, 100);
     auto order2 = createOrder(Side::SELL, OrderType::LIMIT, 151.50, 200);
     auto order3 = createOrder(Side::SELL, OrderType::LIMIT, 151.00, 50);
@@ -62,7 +83,7 @@ TEST_F(OrderBookTest, AddSellOrders) {
 }
 
 // Test order book spread
-TEST_F(OrderBookTest, OrderBookSpread) {
+TEST_P(OrderBookTest, OrderBookSpread) {
     auto buyOrder = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 100);
     auto sellOrder = createOrder(Side::SELL, OrderType::LIMIT, 151.00, 100);
     
@@ -77,7 +98,7 @@ TEST_F(OrderBookTest, OrderBookSpread) {
 }
 
 // Test simple limit order matching
-TEST_F(OrderBookTest, SimpleLimitOrderMatch) {
+TEST_P(OrderBookTest, SimpleLimitOrderMatch) {
     auto sellOrder = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 100);
     orderBook->addOrder(sellOrder);
     
@@ -96,7 +117,7 @@ TEST_F(OrderBookTest, SimpleLimitOrderMatch) {
 }
 
 // Test partial fill scenario
-TEST_F(OrderBookTest, PartialFill) {
+TEST_P(OrderBookTest, PartialFill) {
     auto sellOrder = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 100);
     orderBook->addOrder(sellOrder);
     
@@ -112,7 +133,7 @@ TEST_F(OrderBookTest, PartialFill) {
 }
 
 // Test aggressive order fills multiple levels
-TEST_F(OrderBookTest, MultiLevelFill) {
+TEST_P(OrderBookTest, MultiLevelFill) {
     // Add sell orders at different levels
     auto sell1 = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 50);
     auto sell2 = createOrder(Side::SELL, OrderType::LIMIT, 150.50, 50);
@@ -140,7 +161,7 @@ TEST_F(OrderBookTest, MultiLevelFill) {
 }
 
 // Test price-time priority
-TEST_F(OrderBookTest, PriceTimePriority) {
+TEST_P(OrderBookTest, PriceTimePriority) {
     // Add three sell orders at same price
     auto sell1 = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 100);
     auto sell2 = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 100);
@@ -165,7 +186,7 @@ TEST_F(OrderBookTest, PriceTimePriority) {
 }
 
 // Test market order
-TEST_F(OrderBookTest, MarketOrder) {
+TEST_P(OrderBookTest, MarketOrder) {
     auto sell1 = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 50);
     auto sell2 = createOrder(Side::SELL, OrderType::LIMIT, 151.00, 50);
     
@@ -183,7 +204,7 @@ TEST_F(OrderBookTest, MarketOrder) {
 }
 
 // Test IOC (Immediate or Cancel) order
-TEST_F(OrderBookTest, IOCOrder) {
+TEST_P(OrderBookTest, IOCOrder) {
     auto sell = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 50);
     orderBook->addOrder(sell);
     
@@ -199,7 +220,7 @@ TEST_F(OrderBookTest, IOCOrder) {
 }
 
 // Test FOK (Fill or Kill) order - successful fill
-TEST_F(OrderBookTest, FOKOrderSuccess) {
+TEST_P(OrderBookTest, FOKOrderSuccess) {
     auto sell1 = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 50);
     auto sell2 = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 50);
     
@@ -218,7 +239,7 @@ TEST_F(OrderBookTest, FOKOrderSuccess) {
 }
 
 // Test FOK (Fill or Kill) order - rejected
-TEST_F(OrderBookTest, FOKOrderRejected) {
+TEST_P(OrderBookTest, FOKOrderRejected) {
     auto sell = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 50);
     orderBook->addOrder(sell);
     
@@ -235,7 +256,7 @@ TEST_F(OrderBookTest, FOKOrderRejected) {
 }
 
 // Test order cancellation
-TEST_F(OrderBookTest, CancelOrder) {
+TEST_P(OrderBookTest, CancelOrder) {
     auto order = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 100);
     orderBook->addOrder(order);
     
@@ -248,13 +269,13 @@ TEST_F(OrderBookTest, CancelOrder) {
 }
 
 // Test cancel non-existent order
-TEST_F(OrderBookTest, CancelNonExistentOrder) {
+TEST_P(OrderBookTest, CancelNonExistentOrder) {
     bool cancelled = orderBook->cancelOrder(12345);
     EXPECT_FALSE(cancelled);
 }
 
 // Test order modification
-TEST_F(OrderBookTest, ModifyOrder) {
+TEST_P(OrderBookTest, ModifyOrder) {
     auto order = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 100);
     orderBook->addOrder(order);
     
@@ -269,14 +290,64 @@ TEST_F(OrderBookTest, ModifyOrder) {
 }
 
 // Test modify non-existent order
-TEST_F(OrderBookTest, ModifyNonExistentOrder) {
+TEST_P(OrderBookTest, ModifyNonExistentOrder) {
     bool modified = orderBook->modifyOrder(12345, 
                                           doubleToPrice(150.00), 100);
     EXPECT_FALSE(modified);
 }
 
+TEST_P(OrderBookTest, ModifyDownKeepsQueuePriority) {
+    auto first = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 100);
+    auto second = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 100);
+    orderBook->addOrder(first);
+    orderBook->addOrder(second);
+    
+    // Partly fill the head of the queue, then amend what is left of it
+    auto buy = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 30);
+    ASSERT_EQ(orderBook->matchOrder(buy).size(), 1);
+    EXPECT_TRUE(orderBook->modifyOrder(first->getOrderId(), doubleToPrice(150.00), 40));
+    EXPECT_EQ(first->getRemainingQuantity(), 40);
+    EXPECT_EQ(first->getFilledQuantity(), 30);
+    EXPECT_EQ(first->getStatus(), OrderStatus::PARTIAL_FILL);
+    EXPECT_EQ(orderBook->getAskQuantityAtLevel(doubleToPrice(150.00)), 140);
+    EXPECT_EQ(orderBook->getSideQuantity(Side::SELL), 140);
+    
+    auto sweep = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 50);
+    auto trades = orderBook->matchOrder(sweep);
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].getSellOrderId(), first->getOrderId());
+    EXPECT_EQ(trades[0].getQuantity(), 40);
+    EXPECT_EQ(first->getStatus(), OrderStatus::FILLED);
+    EXPECT_EQ(trades[1].getSellOrderId(), second->getOrderId());
+    
+    // Zero quantity is a cancel, not an amend
+    EXPECT_FALSE(orderBook->modifyOrder(second->getOrderId(), doubleToPrice(150.00), 0));
+}
+
+TEST_P(OrderBookTest, ModifyUpOrRepriceLosesQueuePriority) {
+    auto first = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 100);
+    auto second = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 100);
+    auto third = createOrder(Side::BUY, OrderType::LIMIT, 149.00, 100);
+    orderBook->addOrder(first);
+    orderBook->addOrder(second);
+    orderBook->addOrder(third);
+    
+    EXPECT_TRUE(orderBook->modifyOrder(first->getOrderId(), doubleToPrice(150.00), 120));
+    EXPECT_EQ(orderBook->getBidQuantityAtLevel(doubleToPrice(150.00)), 220);
+    EXPECT_TRUE(orderBook->modifyOrder(third->getOrderId(), doubleToPrice(150.00), 100));
+    EXPECT_EQ(orderBook->getBidQuantityAtLevel(doubleToPrice(149.00)), 0);
+    EXPECT_EQ(orderBook->getSideQuantity(Side::BUY), 320);
+    
+    auto sell = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 320);
+    auto trades = orderBook->matchOrder(sell);
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[0].getBuyOrderId(), second->getOrderId());
+    EXPECT_EQ(trades[1].getBuyOrderId(), first->getOrderId());
+    EXPECT_EQ(trades[2].getBuyOrderId(), third->getOrderId());
+}
+
 // Test order retrieval
-TEST_F(OrderBookTest, GetOrder) {
+TEST_P(OrderBookTest, GetOrder) {
     auto order = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 100);
     orderBook->addOrder(order);
     
@@ -288,13 +359,13 @@ TEST_F(OrderBookTest, GetOrder) {
 }
 
 // Test get non-existent order
-TEST_F(OrderBookTest, GetNonExistentOrder) {
+TEST_P(OrderBookTest, GetNonExistentOrder) {
     auto retrieved = orderBook->getOrder(12345);
     EXPECT_EQ(retrieved, nullptr);
 }
 
 // Test book depth
-TEST_F(OrderBookTest, BookDepth) {
+TEST_P(OrderBookTest, BookDepth) {
     // Add multiple levels
     for (int i = 0; i < 10; i++) {
         auto buy = createOrder(Side::BUY, OrderType::LIMIT, 150.00 - i, 100);
@@ -317,7 +388,7 @@ TEST_F(OrderBookTest, BookDepth) {
 }
 
 // Test aggressive sell matching buy orders
-TEST_F(OrderBookTest, AggressiveSellMatch) {
+TEST_P(OrderBookTest, AggressiveSellMatch) {
     auto buy1 = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 50);
     auto buy2 = createOrder(Side::BUY, OrderType::LIMIT, 149.50, 50);
     
@@ -336,7 +407,7 @@ TEST_F(OrderBookTest, AggressiveSellMatch) {
 }
 
 // Test that passive order price is used
-TEST_F(OrderBookTest, PassiveOrderPriceUsed) {
+TEST_P(OrderBookTest, PassiveOrderPriceUsed) {
     auto sellOrder = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 100);
     orderBook->addOrder(sellOrder);
     
@@ -349,7 +420,7 @@ TEST_F(OrderBookTest, PassiveOrderPriceUsed) {
 }
 
 // Test multiple orders at same price level
-TEST_F(OrderBookTest, MultipleOrdersSamePriceLevel) {
+TEST_P(OrderBookTest, MultipleOrdersSamePriceLevel) {
     for (int i = 0; i < 5; i++) {
         auto order = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 20);
         orderBook->addOrder(order);
@@ -366,3 +437,361 @@ TEST_F(OrderBookTest, MultipleOrdersSamePriceLevel) {
     EXPECT_EQ(orderBook->getBestBid(), 0);
 }
 
+// Test array ladder re-centers as prices drift out of its window
+TEST(ArrayOrderBookTest, RecenterOnPriceDrift) {
+    OrderBook book("AAPL", arrayBookConfig(16));
+    OrderId id = 1;
+    
+    auto near = std::make_shared<Order>(id++, "AAPL", Side::BUY, OrderType::LIMIT,
+                                        doubleToPrice(100.00), 10);
+    auto far = std::make_shared<Order>(id++, "AAPL", Side::BUY, OrderType::LIMIT,
+                                       doubleToPrice(100.50), 20);
+    book.addOrder(near);
+    book.addOrder(far);
+    
+    EXPECT_EQ(book.getBestBid(), doubleToPrice(100.50));
+    EXPECT_EQ(book.getBidQuantityAtLevel(doubleToPrice(100.00)), 10);
+    EXPECT_EQ(book.getBidQuantityAtLevel(doubleToPrice(100.50)), 20);
+    
+    auto bidDepth = book.getBidDepth();
+    ASSERT_EQ(bidDepth.size(), 2);
+    EXPECT_EQ(bidDepth[1].first, doubleToPrice(100.00));
+    
+    // Sweep both levels after the window moved
+    auto sell = std::make_shared<Order>(id++, "AAPL", Side::SELL, OrderType::LIMIT,
+                                        doubleToPrice(99.00), 30);
+    auto trades = book.matchOrder(sell);
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].getPrice(), doubleToPrice(100.50));
+    EXPECT_EQ(trades[1].getPrice(), doubleToPrice(100.00));
+    EXPECT_EQ(book.getBestBid(), 0);
+    
+    // Empty ladder re-centers on the next order wherever it lands
+    auto lower = std::make_shared<Order>(id++, "AAPL", Side::SELL, OrderType::LIMIT,
+                                         doubleToPrice(50.00), 5);
+    book.addOrder(lower);
+    EXPECT_EQ(book.getBestAsk(), doubleToPrice(50.00));
+}
+
+// Test array book rejects prices off the tick grid
+TEST(ArrayOrderBookTest, RejectOffTickPrice) {
+    OrderBook book("AAPL", arrayBookConfig());
+    
+    auto order = std::make_shared<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT,
+                                         doubleToPrice(150.005), 100);
+    auto trades = book.matchOrder(order);
+    
+    EXPECT_TRUE(trades.empty());
+    EXPECT_EQ(order->getStatus(), OrderStatus::REJECTED);
+    EXPECT_EQ(book.getBestBid(), 0);
+}
+
+// Test cancelling from the middle of a level keeps FIFO order intact
+TEST_P(OrderBookTest, CancelMiddleOfQueue) {
+    auto sell1 = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 10);
+    auto sell2 = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 20);
+    auto sell3 = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 30);
+    
+    orderBook->addOrder(sell1);
+    orderBook->addOrder(sell2);
+    orderBook->addOrder(sell3);
+    
+    EXPECT_TRUE(orderBook->cancelOrder(sell2->getOrderId()));
+    EXPECT_EQ(orderBook->getAskQuantityAtLevel(doubleToPrice(150.00)), 40);
+    
+    // Freed record is reused by the next resting order
+    auto sell4 = createOrder(Side::SELL, OrderType::LIMIT, 150.00, 40);
+    orderBook->addOrder(sell4);
+    
+    auto buyOrder = createOrder(Side::BUY, OrderType::LIMIT, 150.00, 80);
+    auto trades = orderBook->matchOrder(buyOrder);
+    
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[0].getSellOrderId(), sell1->getOrderId());
+    EXPECT_EQ(trades[1].getSellOrderId(), sell3->getOrderId());
+    EXPECT_EQ(trades[2].getSellOrderId(), sell4->getOrderId());
+    EXPECT_EQ(orderBook->getBestAsk(), 0);
+    EXPECT_EQ(orderBook->getOrder(sell2->getOrderId()), nullptr);
+}
+
+// Stop orders wait off the book until a trade reaches their stop price
+TEST_P(OrderBookTest, StopOrdersParkUntilElected) {
+    auto stop = std::make_shared<Order>(nextOrderId++, "AAPL", Side::SELL, OrderType::STOP_LOSS,
+                                        0, 50, doubleToPrice(149.00));
+    EXPECT_TRUE(orderBook->matchOrder(stop).empty());
+    EXPECT_EQ(orderBook->getStopCount(), 1);
+    EXPECT_EQ(orderBook->getBestAsk(), 0);
+    
+    orderBook->addOrder(createOrder(Side::BUY, OrderType::LIMIT, 149.50, 100));
+    orderBook->addOrder(createOrder(Side::BUY, OrderType::LIMIT, 148.00, 100));
+    
+    // A trade above the stop price leaves it parked
+    auto sell = createOrder(Side::SELL, OrderType::LIMIT, 149.50, 10);
+    EXPECT_EQ(orderBook->matchOrder(sell).size(), 1);
+    EXPECT_EQ(orderBook->getStopCount(), 1);
+    
+    // Sweeping through 149.00 elects it; it sells at market into the bids
+    auto sweep = createOrder(Side::SELL, OrderType::LIMIT, 148.00, 100);
+    auto trades = orderBook->matchOrder(sweep);
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[2].getSellOrderId(), stop->getOrderId());
+    EXPECT_EQ(trades[2].getPrice(), doubleToPrice(148.00));
+    EXPECT_EQ(trades[2].getQuantity(), 50);
+    EXPECT_EQ(stop->getType(), OrderType::MARKET);
+    EXPECT_EQ(stop->getStatus(), OrderStatus::FILLED);
+    EXPECT_EQ(orderBook->getStopCount(), 0);
+    EXPECT_EQ(orderBook->getBidQuantityAtLevel(doubleToPrice(148.00)), 40);
+}
+
+TEST_P(OrderBookTest, ElectedStopsCascade) {
+    std::vector<OrderId> elected;
+    orderBook->setStopTriggerHandler([&](const Order& order) {
+        elected.push_back(order.getOrderId());
+    });
+    
+    orderBook->addOrder(createOrder(Side::SELL, OrderType::LIMIT, 150.00, 10));
+    orderBook->addOrder(createOrder(Side::SELL, OrderType::LIMIT, 151.00, 10));
+    orderBook->addOrder(createOrder(Side::SELL, OrderType::LIMIT, 152.00, 10));
+    
+    // The first stop's fill at 151 elects the second; the stop limit rests
+    auto first = std::make_shared<Order>(nextOrderId++, "AAPL", Side::BUY, OrderType::STOP_LOSS,
+                                         0, 10, doubleToPrice(150.00));
+    auto second = std::make_shared<Order>(nextOrderId++, "AAPL", Side::BUY, OrderType::STOP_LIMIT,
+                                          doubleToPrice(151.50), 20, doubleToPrice(151.00));
+    auto untouched = std::make_shared<Order>(nextOrderId++, "AAPL", Side::BUY,
+                                             OrderType::STOP_LOSS, 0, 5, doubleToPrice(153.00));
+    orderBook->matchOrder(first);
+    orderBook->matchOrder(second);
+    orderBook->matchOrder(untouched);
+    
+    auto trades = orderBook->matchOrder(createOrder(Side::BUY, OrderType::LIMIT, 150.00, 10));
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[1].getBuyOrderId(), first->getOrderId());
+    EXPECT_EQ(trades[1].getPrice(), doubleToPrice(151.00));
+    ASSERT_EQ(elected.size(), 2);
+    EXPECT_EQ(elected[0], first->getOrderId());
+    EXPECT_EQ(elected[1], second->getOrderId());
+    
+    EXPECT_EQ(second->getType(), OrderType::LIMIT);
+    EXPECT_EQ(second->getStatus(), OrderStatus::PENDING);
+    EXPECT_EQ(orderBook->getBestBid(), doubleToPrice(151.50));
+    EXPECT_EQ(orderBook->getStopCount(), 1);
+}
+
+TEST_P(OrderBookTest, CancelAndModifyParkedStop) {
+    auto stop = std::make_shared<Order>(nextOrderId++, "AAPL", Side::BUY, OrderType::STOP_LIMIT,
+                                        doubleToPrice(151.00), 10, doubleToPrice(150.50));
+    orderBook->matchOrder(stop);
+    EXPECT_TRUE(orderBook->modifyOrder(stop->getOrderId(), doubleToPrice(151.50), 20));
+    
+    auto copy = orderBook->getOrderCopy(stop->getOrderId());
+    ASSERT_NE(copy, nullptr);
+    EXPECT_EQ(copy->getPrice(), doubleToPrice(151.50));
+    EXPECT_EQ(copy->getQuantity(), 20);
+    
+    EXPECT_TRUE(orderBook->cancelOrder(stop->getOrderId()));
+    EXPECT_EQ(stop->getStatus(), OrderStatus::CANCELLED);
+    EXPECT_EQ(orderBook->getStopCount(), 0);
+    EXPECT_FALSE(orderBook->cancelOrder(stop->getOrderId()));
+}
+
+TEST_P(OrderBookTest, CancelOrdersByFilter) {
+    auto add = [&](Side side, double price, ClientKey clientKey) {
+        auto order = createOrder(side, OrderType::LIMIT, price, 10);
+        order->setClientKey(clientKey);
+        orderBook->addOrder(order);
+        return order;
+    };
+    auto bidA = add(Side::BUY, 149.00, 1);
+    auto bidB = add(Side::BUY, 149.00, 2);
+    auto askA = add(Side::SELL, 151.00, 1);
+    auto stopA = std::make_shared<Order>(nextOrderId++, "AAPL", Side::SELL, OrderType::STOP_LOSS,
+                                         0, 10, doubleToPrice(148.00));
+    stopA->setClientKey(1);
+    orderBook->matchOrder(stopA);
+    
+    // Client 1's bids only
+    OrderFilter filter;
+    filter.byClient = true;
+    filter.clientKey = 1;
+    filter.bySide = true;
+    filter.side = Side::BUY;
+    EXPECT_EQ(orderBook->cancelOrders(filter), 1);
+    EXPECT_EQ(bidA->getStatus(), OrderStatus::CANCELLED);
+    EXPECT_EQ(orderBook->getBidQuantityAtLevel(doubleToPrice(149.00)), 10);
+    
+    // Then the rest of client 1's, parked stop included
+    filter.bySide = false;
+    EXPECT_EQ(orderBook->cancelOrders(filter), 2);
+    EXPECT_EQ(askA->getStatus(), OrderStatus::CANCELLED);
+    EXPECT_EQ(orderBook->getStopCount(), 0);
+    EXPECT_EQ(orderBook->getBestAsk(), 0);
+    
+    // An empty filter takes everything left
+    EXPECT_EQ(orderBook->cancelOrders(OrderFilter()), 1);
+    EXPECT_EQ(bidB->getStatus(), OrderStatus::CANCELLED);
+    EXPECT_EQ(orderBook->getBestBid(), 0);
+}
+
+// The FOK check uses side totals and walks only levels within the limit
+TEST_P(OrderBookTest, FOKChecksDepthWithinLimit) {
+    orderBook->addOrder(createOrder(Side::SELL, OrderType::LIMIT, 150.00, 30));
+    orderBook->addOrder(createOrder(Side::SELL, OrderType::LIMIT, 150.50, 30));
+    orderBook->addOrder(createOrder(Side::SELL, OrderType::LIMIT, 152.00, 100));
+    EXPECT_EQ(orderBook->getSideQuantity(Side::SELL), 160);
+    
+    // Enough on the side, but not at or below 150.50
+    auto limited = createOrder(Side::BUY, OrderType::FOK, 150.50, 70);
+    EXPECT_TRUE(orderBook->matchOrder(limited).empty());
+    EXPECT_EQ(limited->getStatus(), OrderStatus::CANCELLED);
+    
+    // More than the whole side
+    auto huge = createOrder(Side::BUY, OrderType::FOK, 160.00, 161);
+    EXPECT_TRUE(orderBook->matchOrder(huge).empty());
+    
+    // Priced through every level
+    auto sweep = createOrder(Side::BUY, OrderType::FOK, 160.00, 100);
+    EXPECT_EQ(orderBook->matchOrder(sweep).size(), 3);
+    EXPECT_EQ(sweep->getStatus(), OrderStatus::FILLED);
+    EXPECT_EQ(orderBook->getSideQuantity(Side::SELL), 60);
+    
+    auto resting = createOrder(Side::SELL, OrderType::LIMIT, 151.00, 10);
+    orderBook->addOrder(resting);
+    EXPECT_TRUE(orderBook->modifyOrder(resting->getOrderId(), doubleToPrice(151.00), 25));
+    EXPECT_EQ(orderBook->getSideQuantity(Side::SELL), 85);
+    EXPECT_TRUE(orderBook->cancelOrder(resting->getOrderId()));
+    EXPECT_EQ(orderBook->getSideQuantity(Side::SELL), 60);
+    EXPECT_EQ(orderBook->getSideQuantity(Side::BUY), 0);
+}
+
+// The published top matches a walk of the ladder after every kind of change
+TEST_P(OrderBookTest, TopOfBookTracksTheBestLevels) {
+    auto expectTopMatchesBook = [this]() {
+        BookTop top = orderBook->getTop();
+        auto bids = orderBook->getBidDepth(BookTop::DEPTH + 10);  // Walks under the lock
+        auto asks = orderBook->getAskDepth(BookTop::DEPTH + 10);
+        ASSERT_EQ(top.bidLevels, std::min(bids.size(), BookTop::DEPTH));
+        ASSERT_EQ(top.askLevels, std::min(asks.size(), BookTop::DEPTH));
+        for (size_t i = 0; i < top.bidLevels; ++i) {
+            EXPECT_EQ(top.bids[i].price, bids[i].first);
+            EXPECT_EQ(top.bids[i].quantity, bids[i].second);
+        }
+        for (size_t i = 0; i < top.askLevels; ++i) {
+            EXPECT_EQ(top.asks[i].price, asks[i].first);
+            EXPECT_EQ(top.asks[i].quantity, asks[i].second);
+        }
+    };
+    
+    // Fifteen bid levels, arriving out of price order
+    std::vector<OrderPtr> bids;
+    for (int i = 0; i < 15; ++i) {
+        int level = (i * 7) % 15;
+        bids.push_back(createOrder(Side::BUY, OrderType::LIMIT, 150.00 - level * 0.01, 10 + level));
+        orderBook->addOrder(bids.back());
+    }
+    orderBook->addOrder(createOrder(Side::SELL, OrderType::LIMIT, 150.05, 100));
+    expectTopMatchesBook();
+    EXPECT_EQ(orderBook->getBestBid(), doubleToPrice(150.00));
+    EXPECT_EQ(orderBook->getBestAsk(), doubleToPrice(150.05));
+    EXPECT_EQ(orderBook->getBidQuantityAtLevel(doubleToPrice(149.88)), 22);  // Below the top
+    
+    // Changes below the top publish nothing
+    uint64_t version = orderBook->getTopOfBook().getVersion();
+    orderBook->addOrder(createOrder(Side::BUY, OrderType::LIMIT, 140.00, 5));
+    EXPECT_EQ(orderBook->getTopOfBook().getVersion(), version);
+    
+    // Losing a top level pulls the next one up
+    EXPECT_TRUE(orderBook->cancelOrder(bids[0]->getOrderId()));
+    expectTopMatchesBook();
+    EXPECT_GT(orderBook->getTopOfBook().getVersion(), version);
+    
+    // Amend in place, then sweep several levels at once
+    EXPECT_TRUE(orderBook->modifyOrder(bids[1]->getOrderId(), bids[1]->getPrice(), 1));
+    expectTopMatchesBook();
+    auto sweep = createOrder(Side::SELL, OrderType::LIMIT, 149.95, 60);
+    EXPECT_FALSE(orderBook->matchOrder(sweep).empty());
+    expectTopMatchesBook();
+    
+    OrderFilter everything;
+    orderBook->cancelOrders(everything);
+    expectTopMatchesBook();
+    EXPECT_EQ(orderBook->getBestBid(), 0);
+    EXPECT_EQ(orderBook->getBestAsk(), 0);
+}
+
+TEST(TopOfBookTest, ReadersNeverSeeATornTop) {
+    TopOfBook topOfBook;
+    std::atomic<bool> done{false};
+    std::atomic<size_t> reads{0};
+    std::atomic<bool> torn{false};
+    
+    // Every field of each published top holds the same value
+    std::thread reader([&]() {
+        while (!done.load(std::memory_order_relaxed)) {
+            BookTop top = topOfBook.read();
+            Price expected = top.bestBid();
+            bool consistent = top.bidLevels == top.askLevels;
+            for (size_t i = 0; i < top.bidLevels; ++i) {
+                consistent = consistent && top.bids[i].price == expected &&
+                             top.bids[i].quantity == static_cast<Quantity>(expected) &&
+                             top.asks[i].price == expected;
+            }
+            if (!consistent) {
+                torn = true;
+            }
+            reads.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    
+    BookTop top;
+    for (Price value = 1; value <= 200000 || reads.load() < 1000; ++value) {
+        top.bidLevels = top.askLevels = static_cast<size_t>(value % BookTop::DEPTH) + 1;
+        for (size_t i = 0; i < BookTop::DEPTH; ++i) {
+            top.bids[i].price = top.asks[i].price = value;
+            top.bids[i].quantity = top.asks[i].quantity = static_cast<Quantity>(value);
+        }
+        topOfBook.publish(top);
+    }
+    done = true;
+    reader.join();
+    EXPECT_FALSE(torn);
+    EXPECT_EQ(topOfBook.best(Side::SELL), topOfBook.read().bestAsk());
+}
+
+// A price far outside the book can't blow the array window up; the map
+// ladder takes any price
+TEST_P(OrderBookTest, OutlierPricesAreBounded) {
+    bool bounded = GetParam().ladderType == PriceLadderType::ARRAY;
+    Price tick = doubleToPrice(0.01);
+    auto limit = [&](Side side, Price price) {
+        return std::make_shared<Order>(nextOrderId++, "AAPL", side, OrderType::LIMIT, price, 10);
+    };
+    auto ask = limit(Side::SELL, doubleToPrice(151.00));
+    orderBook->addOrder(ask);
+
+    // Well within the cap, it rests either way
+    auto wide = limit(Side::SELL, doubleToPrice(151.00) + 100000 * tick);
+    orderBook->matchOrder(wide);
+    EXPECT_EQ(wide->getStatus(), OrderStatus::PENDING);
+
+    for (Price far : {Price(doubleToPrice(151.00) + 1000000000000LL * tick),
+                      std::numeric_limits<Price>::max() / tick * tick}) {
+        auto outlier = limit(Side::SELL, far);
+        EXPECT_TRUE(orderBook->matchOrder(outlier).empty());
+        EXPECT_EQ(outlier->getStatus(), bounded ? OrderStatus::REJECTED : OrderStatus::PENDING);
+        auto added = limit(Side::SELL, far - tick);
+        orderBook->addOrder(added);
+        EXPECT_EQ(added->getStatus(), bounded ? OrderStatus::REJECTED : OrderStatus::PENDING);
+    }
+    EXPECT_EQ(orderBook->getAskDepth(10).size(), bounded ? 2 : 6);
+    EXPECT_EQ(orderBook->getBestAsk(), doubleToPrice(151.00));
+
+    // Nor can a modify move an order out there
+    EXPECT_EQ(orderBook->modifyOrder(ask->getOrderId(), Price(-1000000000000LL * tick), 10), !bounded);
+    EXPECT_EQ(ask->getPrice(), bounded ? doubleToPrice(151.00) : Price(-1000000000000LL * tick));
+
+    // The bids are a ladder of their own
+    auto bid = limit(Side::BUY, doubleToPrice(10.00));
+    orderBook->addOrder(bid);
+    EXPECT_EQ(bid->getStatus(), OrderStatus::PENDING);
+}
@@ -0,0 +1,339 @@
+#include <gtest/gtest.h>
+#include "ProtocolV2.h"
+#include "Message.h"
+#include <vector>
+
+using namespace MatchingEngine;
+
+namespace {
+
+// Frame the bytes the way a version 2 receiver would
+bool frameOne(FrameBuffer& buffer, const char* data, size_t length, Frame& frame) {
+    char* target = buffer.writePtr();
+    std::memcpy(target, data, length);
+    buffer.commit(length);
+    return buffer.nextFrame(frame);
+}
+
+} // namespace
+
+TEST(ProtocolV2Test, MessagesAreSmallerThanVersionOne) {
+    EXPECT_EQ(ProtocolV2::NewOrder::SIZE, 54);
+    EXPECT_EQ(ProtocolV2::CancelOrder::SIZE, 12);
+    EXPECT_EQ(ProtocolV2::ModifyOrder::SIZE, 28);
+    EXPECT_EQ(ProtocolV2::OrderAck::SIZE, 22);
+    EXPECT_EQ(ProtocolV2::ExecutionReport::SIZE, 62);
+    EXPECT_LT(ProtocolV2::NewOrder::SIZE, sizeof(NewOrderMessage));
+    EXPECT_LT(ProtocolV2::OrderAck::SIZE, sizeof(OrderAckMessage));
+}
+
+TEST(ProtocolV2Test, FieldsAreLittleEndian) {
+    ProtocolV2::CancelOrder cancel;
+    cancel.orderId = 0x0102030405060708ULL;
+    char out[ProtocolV2::CancelOrder::SIZE];
+    ASSERT_EQ(cancel.encode(out), ProtocolV2::CancelOrder::SIZE);
+    
+    // Header: length 12, type, no flags
+    EXPECT_EQ(static_cast<uint8_t>(out[0]), 12);
+    EXPECT_EQ(static_cast<uint8_t>(out[1]), 0);
+    EXPECT_EQ(static_cast<uint8_t>(out[2]), static_cast<uint8_t>(MessageType::CANCEL_ORDER));
+    EXPECT_EQ(static_cast<uint8_t>(out[3]), 0);
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(static_cast<uint8_t>(out[4 + i]), 8 - i);
+    }
+}
+
+TEST(ProtocolV2Test, NewOrderRoundTrips) {
+    ProtocolV2::NewOrder order;
+    order.clientOrderId = 42;
+    ProtocolV2::setSymbol(order.symbol, "AAPL");
+    order.side = Side::SELL;
+    order.orderType = OrderType::STOP_LIMIT;
+    order.price = -1500000;
+    order.quantity = 250;
+    order.stopPrice = 1490000;
+    char out[ProtocolV2::NewOrder::SIZE];
+    size_t length = order.encode(out);
+    
+    FrameBuffer buffer;
+    buffer.setProtocolVersion(ProtocolV2::VERSION);
+    Frame frame;
+    ASSERT_TRUE(frameOne(buffer, out, length, frame));
+    EXPECT_EQ(frame.type, MessageType::NEW_ORDER);
+    EXPECT_EQ(frame.version, ProtocolV2::VERSION);
+    
+    ProtocolV2::NewOrder decoded;
+    ASSERT_TRUE(decoded.decode(frame));
+    EXPECT_EQ(decoded.clientOrderId, 42);
+    EXPECT_EQ(ProtocolV2::getSymbol(decoded.symbol), "AAPL");
+    EXPECT_EQ(decoded.side, Side::SELL);
+    EXPECT_EQ(decoded.orderType, OrderType::STOP_LIMIT);
+    EXPECT_EQ(decoded.price, -1500000);
+    EXPECT_EQ(decoded.quantity, 250);
+    EXPECT_EQ(decoded.stopPrice, 1490000);
+}
+
+TEST(ProtocolV2Test, NewOrderCarriesTimeInForce) {
+    ProtocolV2::NewOrder order;
+    ProtocolV2::setSymbol(order.symbol, "AAPL");
+    order.quantity = 10;
+    char out[ProtocolV2::NewOrder::EXTENDED_SIZE];
+    EXPECT_EQ(order.encode(out), ProtocolV2::NewOrder::SIZE);  // GTC keeps the short form
+
+    order.timeInForce = TimeInForce::GTD;
+    order.expireTime = 0x0102030405060708ULL;
+    size_t length = order.encode(out);
+    EXPECT_EQ(length, ProtocolV2::NewOrder::EXTENDED_SIZE);
+
+    FrameBuffer buffer;
+    buffer.setProtocolVersion(ProtocolV2::VERSION);
+    Frame frame;
+    ASSERT_TRUE(frameOne(buffer, out, length, frame));
+    ProtocolV2::NewOrder decoded;
+    ASSERT_TRUE(decoded.decode(frame));
+    EXPECT_EQ(decoded.timeInForce, TimeInForce::GTD);
+    EXPECT_EQ(decoded.expireTime, 0x0102030405060708ULL);
+    EXPECT_EQ(decoded.quantity, 10);
+
+    out[ProtocolV2::NewOrder::SIZE] = 7;  // Not a time in force
+    ASSERT_TRUE(frameOne(buffer, out, length, frame));
+    EXPECT_FALSE(decoded.decode(frame));
+}
+
+TEST(ProtocolV2Test, AckCarriesRejectCode) {
+    ProtocolV2::OrderAck ack;
+    ack.orderId = 7;
+    ack.status = OrderStatus::REJECTED;
+    ack.reason = RejectReason::ORDER_NOT_FOUND;
+    char out[ProtocolV2::OrderAck::SIZE];
+    
+    FrameBuffer buffer;
+    buffer.setProtocolVersion(ProtocolV2::VERSION);
+    Frame frame;
+    ASSERT_TRUE(frameOne(buffer, out, ack.encode(out), frame));
+    
+    ProtocolV2::OrderAck decoded;
+    ASSERT_TRUE(decoded.decode(frame));
+    EXPECT_EQ(decoded.orderId, 7);
+    EXPECT_EQ(decoded.status, OrderStatus::REJECTED);
+    EXPECT_EQ(decoded.reason, RejectReason::ORDER_NOT_FOUND);
+    EXPECT_EQ(rejectReasonToString(decoded.reason), "Order not found");
+}
+
+TEST(ProtocolV2Test, CancelReplaceRoundTrips) {
+    ProtocolV2::CancelReplace replace;
+    replace.reference = 9;
+    replace.orderId = 0x0102030405060708ULL;
+    replace.newPrice = 1495000;
+    replace.newQuantity = 40;
+    char out[ProtocolV2::CancelReplace::SIZE];
+    
+    FrameBuffer buffer;
+    buffer.setProtocolVersion(ProtocolV2::VERSION);
+    Frame frame;
+    ASSERT_TRUE(frameOne(buffer, out, replace.encode(out), frame));
+    EXPECT_EQ(frame.length, ProtocolV2::CancelReplace::SIZE);
+    
+    ProtocolV2::CancelReplace decoded;
+    ASSERT_TRUE(decoded.decode(frame));
+    EXPECT_EQ(decoded.reference, 9);
+    EXPECT_EQ(decoded.orderId, 0x0102030405060708ULL);
+    EXPECT_EQ(decoded.newPrice, 1495000);
+    EXPECT_EQ(decoded.newQuantity, 40);
+    
+    // A plain modify is not a cancel/replace
+    ProtocolV2::ModifyOrder modify;
+    ASSERT_TRUE(frameOne(buffer, out, modify.encode(out), frame));
+    EXPECT_FALSE(decoded.decode(frame));
+}
+
+TEST(ProtocolV2Test, LinkMessagesRoundTrip) {
+    ProtocolV2::LinkCommand command;
+    command.tag = 77;
+    command.type = static_cast<uint8_t>(CommandType::MASS_CANCEL);
+    command.side = Side::SELL;
+    command.scope = MASS_CANCEL_BY_CLIENT | MASS_CANCEL_BY_SIDE;
+    command.quantity = 5;
+    ProtocolV2::setSymbol(command.symbol, "AAPL");
+    ProtocolV2::setClientId(command.clientId, "client-id-exactly-32-bytes-long!");  // No terminator
+    char out[ProtocolV2::LinkCommand::SIZE];
+    
+    FrameBuffer buffer;
+    buffer.setProtocolVersion(ProtocolV2::VERSION);
+    Frame frame;
+    ASSERT_TRUE(frameOne(buffer, out, command.encode(out), frame));
+    ProtocolV2::LinkCommand decoded;
+    ASSERT_TRUE(decoded.decode(frame));
+    EXPECT_EQ(decoded.tag, 77);
+    EXPECT_EQ(decoded.type, static_cast<uint8_t>(CommandType::MASS_CANCEL));
+    EXPECT_EQ(decoded.side, Side::SELL);
+    EXPECT_EQ(decoded.scope, MASS_CANCEL_BY_CLIENT | MASS_CANCEL_BY_SIDE);
+    EXPECT_EQ(decoded.quantity, 5);
+    EXPECT_EQ(ProtocolV2::getSymbol(decoded.symbol), "AAPL");
+    EXPECT_EQ(ProtocolV2::getClientId(decoded.clientId), "client-id-exactly-32-bytes-long!");
+    
+    // A command type past the last is malformed
+    out[ProtocolV2::HEADER_SIZE + 8] = 9;
+    ASSERT_TRUE(frameOne(buffer, out, ProtocolV2::LinkCommand::SIZE, frame));
+    EXPECT_FALSE(decoded.decode(frame));
+    
+    ProtocolV2::LinkResult result;
+    result.tag = 77;
+    result.success = true;
+    result.orderId = (OrderId(1) << 56) | 0x101;
+    result.hasReport = true;
+    result.status = OrderStatus::PARTIAL_FILL;
+    result.price = 1500000;
+    result.filledQuantity = 60;
+    result.remainingQuantity = 40;
+    char resultOut[ProtocolV2::LinkResult::SIZE];
+    ASSERT_TRUE(frameOne(buffer, resultOut, result.encode(resultOut), frame));
+    ProtocolV2::LinkResult decodedResult;
+    ASSERT_TRUE(decodedResult.decode(frame));
+    EXPECT_EQ(decodedResult.tag, 77);
+    EXPECT_TRUE(decodedResult.success);
+    EXPECT_EQ(decodedResult.orderId, (OrderId(1) << 56) | 0x101);
+    EXPECT_TRUE(decodedResult.hasReport);
+    EXPECT_EQ(decodedResult.status, OrderStatus::PARTIAL_FILL);
+    EXPECT_EQ(decodedResult.price, 1500000);
+    EXPECT_EQ(decodedResult.filledQuantity, 60);
+    EXPECT_EQ(decodedResult.remainingQuantity, 40);
+}
+
+TEST(ProtocolV2Test, RejectsWrongSizeOrBadEnums) {
+    ProtocolV2::NewOrder order;
+    char out[ProtocolV2::NewOrder::SIZE + 1];
+    size_t length = order.encode(out);
+    out[4 + 8 + ProtocolV2::SYMBOL_SIZE] = 9;  // Not a Side
+    
+    FrameBuffer buffer;
+    buffer.setProtocolVersion(ProtocolV2::VERSION);
+    Frame frame;
+    ASSERT_TRUE(frameOne(buffer, out, length, frame));
+    ProtocolV2::NewOrder decoded;
+    EXPECT_FALSE(decoded.decode(frame));
+    
+    // A cancel frame is not a new order
+    ProtocolV2::CancelOrder cancel;
+    ASSERT_TRUE(frameOne(buffer, out, cancel.encode(out), frame));
+    EXPECT_FALSE(decoded.decode(frame));
+}
+
+TEST(ProtocolV2Test, BatchesRoundTrip) {
+    FrameBuffer buffer;
+    buffer.setProtocolVersion(ProtocolV2::VERSION);
+    char out[MAX_MESSAGE_SIZE];
+    Frame frame;
+    
+    ProtocolV2::NewOrderBatch orders;
+    orders.reference = 42;
+    ProtocolV2::setSymbol(orders.symbol, "AAPL");
+    orders.count = ProtocolV2::MAX_BATCH;
+    for (size_t i = 0; i < orders.count; ++i) {
+        orders.entries[i].side = i % 2 ? Side::SELL : Side::BUY;
+        orders.entries[i].orderType = OrderType::IOC;
+        orders.entries[i].price = 1500000 + static_cast<Price>(i);
+        orders.entries[i].quantity = 10 + i;
+    }
+    ASSERT_TRUE(frameOne(buffer, out, orders.encode(out), frame));
+    EXPECT_EQ(frame.length, orders.size());
+    ProtocolV2::NewOrderBatch decodedOrders;
+    ASSERT_TRUE(decodedOrders.decode(frame));
+    EXPECT_EQ(decodedOrders.reference, 42);
+    EXPECT_EQ(ProtocolV2::getSymbol(decodedOrders.symbol), "AAPL");
+    ASSERT_EQ(decodedOrders.count, ProtocolV2::MAX_BATCH);
+    EXPECT_EQ(decodedOrders.entries[63].side, Side::SELL);
+    EXPECT_EQ(decodedOrders.entries[63].orderType, OrderType::IOC);
+    EXPECT_EQ(decodedOrders.entries[63].price, 1500063);
+    EXPECT_EQ(decodedOrders.entries[63].quantity, 73);
+    
+    ProtocolV2::ModifyBatch modifies;
+    modifies.reference = 43;
+    modifies.count = 2;
+    modifies.entries[1] = {9, 1510000, 5};
+    ASSERT_TRUE(frameOne(buffer, out, modifies.encode(out), frame));
+    ProtocolV2::ModifyBatch decodedModifies;
+    ASSERT_TRUE(decodedModifies.decode(frame));
+    EXPECT_EQ(decodedModifies.entries[1].orderId, 9);
+    EXPECT_EQ(decodedModifies.entries[1].newPrice, 1510000);
+    EXPECT_EQ(decodedModifies.entries[1].newQuantity, 5);
+    
+    ProtocolV2::BatchAck ack;
+    ack.reference = 44;
+    ack.count = 1;
+    ack.entries[0] = {7, OrderStatus::REJECTED, RejectReason::ORDER_NOT_FOUND};
+    ASSERT_TRUE(frameOne(buffer, out, ack.encode(out), frame));
+    ProtocolV2::BatchAck decodedAck;
+    ASSERT_TRUE(decodedAck.decode(frame));
+    EXPECT_EQ(decodedAck.entries[0].orderId, 7);
+    EXPECT_EQ(decodedAck.entries[0].reason, RejectReason::ORDER_NOT_FOUND);
+    
+    ProtocolV2::MassCancel massCancel;
+    massCancel.reference = 45;
+    massCancel.side = static_cast<uint8_t>(Side::SELL);
+    ASSERT_TRUE(frameOne(buffer, out, massCancel.encode(out), frame));
+    ProtocolV2::MassCancel decodedMassCancel;
+    ASSERT_TRUE(decodedMassCancel.decode(frame));
+    EXPECT_EQ(decodedMassCancel.reference, 45);
+    EXPECT_EQ(decodedMassCancel.symbol[0], '\0');
+    EXPECT_EQ(decodedMassCancel.side, static_cast<uint8_t>(Side::SELL));
+}
+
+TEST(ProtocolV2Test, RejectsBadBatches) {
+    FrameBuffer buffer;
+    buffer.setProtocolVersion(ProtocolV2::VERSION);
+    char out[MAX_MESSAGE_SIZE];
+    Frame frame;
+    
+    // Stops need a stop price, which a batch entry doesn't have
+    ProtocolV2::NewOrderBatch orders;
+    orders.count = 1;
+    orders.entries[0].orderType = OrderType::STOP_LIMIT;
+    ASSERT_TRUE(frameOne(buffer, out, orders.encode(out), frame));
+    ProtocolV2::NewOrderBatch decoded;
+    EXPECT_FALSE(decoded.decode(frame));
+    
+    // A count that disagrees with the length
+    ProtocolV2::CancelBatch cancels;
+    cancels.count = 2;
+    size_t length = cancels.encode(out);
+    out[ProtocolV2::HEADER_SIZE + 8] = 3;
+    ASSERT_TRUE(frameOne(buffer, out, length, frame));
+    ProtocolV2::CancelBatch decodedCancels;
+    EXPECT_FALSE(decodedCancels.decode(frame));
+    
+    // Empty batches are not sent
+    cancels.count = 0;
+    ASSERT_TRUE(frameOne(buffer, out, cancels.encode(out), frame));
+    EXPECT_FALSE(decodedCancels.decode(frame));
+}
+
+TEST(ProtocolV2Test, SwitchesVersionBetweenFrames) {
+    // A logon ack in version 1 followed by version 2 frames in one read
+    std::vector<char> bytes;
+    LogonAckMessage logonAck;
+    logonAck.protocolVersion = ProtocolV2::VERSION;
+    const char* raw = reinterpret_cast<const char*>(&logonAck);
+    bytes.insert(bytes.end(), raw, raw + sizeof(logonAck));
+    ProtocolV2::Heartbeat heartbeat;
+    heartbeat.sequenceNumber = 5;
+    char out[ProtocolV2::Heartbeat::SIZE];
+    bytes.insert(bytes.end(), out, out + heartbeat.encode(out));
+    
+    FrameBuffer buffer;
+    char* target = buffer.writePtr();
+    std::memcpy(target, bytes.data(), bytes.size());
+    buffer.commit(bytes.size());
+    
+    Frame frame;
+    ASSERT_TRUE(buffer.nextFrame(frame));
+    EXPECT_EQ(frame.type, MessageType::LOGON_ACK);
+    EXPECT_EQ(frame.version, 1);
+    buffer.setProtocolVersion(ProtocolV2::VERSION);
+    
+    ASSERT_TRUE(buffer.nextFrame(frame));
+    ProtocolV2::Heartbeat decoded;
+    ASSERT_TRUE(decoded.decode(frame));
+    EXPECT_EQ(decoded.sequenceNumber, 5);
+    EXPECT_FALSE(buffer.nextFrame(frame));
+}
@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+#include "Replication.h"
+#include "Server.h"
+#include "Client.h"
+#include "Interner.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace MatchingEngine;
+
+#ifdef __linux__
+
+namespace {
+
+bool eventually(const std::function<bool()>& condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(ReplicationTest, StandbyAppliesTheStreamInOrder) {
+    ReplicationPublisher publisher(0);
+    ASSERT_TRUE(publisher.start());
+
+    std::mutex mutex;
+    std::vector<EngineCommand> applied;
+    std::atomic<bool> failedOver{false};
+    ReplicationReceiver receiver("127.0.0.1", publisher.getPort(), 50);
+    ASSERT_TRUE(receiver.start(
+        [&](const EngineCommand& command) {
+            std::lock_guard<std::mutex> lock(mutex);
+            applied.push_back(command);
+        },
+        [&]() { failedOver = true; }));
+    ASSERT_TRUE(eventually([&]() { return publisher.hasStandby(); }));
+
+    SymbolId symbol = symbolInterner().intern("AAPL");
+    for (OrderId id = 1; id <= 3; ++id) {
+        EngineCommand command = EngineCommand::newOrder(id << 8, symbol, Side::BUY,
+                                                        OrderType::LIMIT, 1500000, 10 * id);
+        command.timestamp = 1000 + id;
+        EXPECT_EQ(publisher.publish(command), id);
+    }
+    ASSERT_TRUE(eventually([&]() { return publisher.getAckedSequence() == 3; }));
+    EXPECT_EQ(receiver.getAppliedSequence(), 3);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ASSERT_EQ(applied.size(), 3);
+        for (size_t i = 0; i < applied.size(); ++i) {
+            EXPECT_EQ(applied[i].orderId, (i + 1) << 8);
+            EXPECT_EQ(applied[i].quantity, 10 * (i + 1));
+            EXPECT_EQ(applied[i].timestamp, 1001 + i);
+            EXPECT_EQ(applied[i].symbolId, symbol);
+        }
+    }
+
+    // Heartbeats keep a quiet primary alive well past the failover timeout
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_FALSE(failedOver);
+
+    // One standby only
+    ReplicationReceiver second("127.0.0.1", publisher.getPort(), 50);
+    EXPECT_FALSE(second.start([](const EngineCommand&) {}, []() {}));
+
+    publisher.stop();
+    EXPECT_TRUE(eventually([&]() { return failedOver.load(); }));
+    receiver.stop();
+}
+
+TEST(ReplicationTest, LateStandbyIsRefused) {
+    ReplicationPublisher publisher(0);
+    ASSERT_TRUE(publisher.start());
+
+    // Sequenced without a standby, so none can be consistent with the primary
+    EXPECT_EQ(publisher.publish(EngineCommand::cancel(1)), 0);
+    ReplicationReceiver receiver("127.0.0.1", publisher.getPort(), 50);
+    EXPECT_FALSE(receiver.start([](const EngineCommand&) {}, []() {}));
+    EXPECT_FALSE(publisher.hasStandby());
+}
+
+// A primary replicating to a standby, with a client on each in turn
+class FailoverTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ServerConfig config;
+        config.port = 0;
+        config.ioMode = ServerIoMode::EPOLL;
+        config.logEvents = false;
+        config.replicationEnabled = true;
+        config.replicationPort = 0;
+        primary = std::make_unique<Server>(config);
+        ASSERT_TRUE(primary->start());
+
+        config.replicationEnabled = false;
+        config.primaryPort = primary->getReplicationPort();
+        config.failoverTimeoutMs = 50;
+        standby = std::make_unique<Server>(config);
+        ASSERT_TRUE(standby->start());
+        EXPECT_TRUE(standby->isStandby());
+    }
+
+    void TearDown() override {
+        if (client) {
+            client->disconnect();
+        }
+        if (primary) {
+            primary->stop();
+        }
+        if (standby) {
+            standby->stop();
+        }
+    }
+
+    void connect(uint16_t port) {
+        if (client) {
+            client->disconnect();
+        }
+        client = std::make_unique<Client>("127.0.0.1", port);
+        client->setVerbose(false);
+        client->setOrderAckCallback([this](const OrderAckMessage& msg) {
+            std::lock_guard<std::mutex> lock(mutex);
+            acks.push_back(msg);
+            changed.notify_all();
+        });
+        client->setExecutionReportCallback([this](const ExecutionReportMessage& msg) {
+            std::lock_guard<std::mutex> lock(mutex);
+            reports.push_back(msg);
+            changed.notify_all();
+        });
+        ASSERT_TRUE(client->connect());
+    }
+
+    bool waitFor(size_t ackCount, size_t reportCount) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, std::chrono::seconds(5), [&]() {
+            return acks.size() >= ackCount && reports.size() >= reportCount;
+        });
+    }
+
+    std::unique_ptr<Server> primary;
+    std::unique_ptr<Server> standby;
+    std::unique_ptr<Client> client;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<OrderAckMessage> acks;
+    std::vector<ExecutionReportMessage> reports;
+};
+
+TEST_F(FailoverTest, StandbyTakesOverWithTheBooks) {
+    connect(primary->getPort());
+    client->submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 100);
+    client->submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 60);
+    ASSERT_TRUE(waitFor(2, 1));
+    OrderId resting;
+    OrderId filled;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        resting = acks[0].orderId;
+        filled = acks[1].orderId;
+    }
+
+    // Acknowledged by the primary only once the standby had it too
+    EXPECT_EQ(standby->getTotalTrades(), 1);
+    EXPECT_EQ(standby->getTotalOrders(), 2);
+
+    primary->stop();
+    ASSERT_TRUE(eventually([&]() { return !standby->isStandby(); }));
+    EXPECT_TRUE(standby->isRunning());
+
+    // The resting remainder is there, and ids carry on past the primary's
+    connect(standby->getPort());
+    client->cancelOrder(resting);
+    client->submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1490000, 10);
+    ASSERT_TRUE(waitFor(4, 1));
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(acks[2].orderId, resting);
+    EXPECT_EQ(acks[2].status, OrderStatus::CANCELLED);
+    EXPECT_EQ(acks[3].status, OrderStatus::PENDING);
+    EXPECT_NE(acks[3].orderId, resting);
+    EXPECT_NE(acks[3].orderId, filled);
+}
+
+TEST(FailoverLifecycleTest, StandbyNeedsItsPrimary) {
+    ServerConfig config;
+    config.port = 0;
+    config.ioMode = ServerIoMode::EPOLL;
+    config.logEvents = false;
+    config.replicationEnabled = true;
+    config.replicationPort = 0;
+    Server primary(config);
+    ASSERT_TRUE(primary.start());
+    uint16_t replicationPort = primary.getReplicationPort();
+    primary.stop();
+
+    config.replicationEnabled = false;
+    config.primaryPort = replicationPort;
+    Server standby(config);
+    EXPECT_FALSE(standby.start());
+    EXPECT_FALSE(standby.isRunning());
+}
+
+#endif
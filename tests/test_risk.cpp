@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include "RiskCheck.h"
+#include "MatchingEngine.h"
+#include "Interner.h"
+
+using namespace MatchingEngine;
+
+namespace {
+
+EngineCommand order(const char* client, Side side, Price price, Quantity quantity,
+                    OrderType type = OrderType::LIMIT) {
+    return EngineCommand::newOrder(0, symbolInterner().intern("RISK"), side, type, price,
+                                   quantity, clientInterner().intern(client));
+}
+
+} // namespace
+
+TEST(RiskCheckTest, DisabledUntilALimitIsSet) {
+    RiskCheck risk;
+    EXPECT_FALSE(risk.isEnabled());
+    EXPECT_EQ(risk.check(order("alice", Side::BUY, 1000000, 1000000000)), RejectReason::NONE);
+
+    risk.setDefaultLimits(RiskLimits());
+    EXPECT_FALSE(risk.isEnabled());
+}
+
+TEST(RiskCheckTest, OrderSizeNotionalAndRate) {
+    RiskCheck risk;
+    RiskLimits limits;
+    limits.maxOrderQuantity = 100;
+    limits.maxOrderNotional = 100 * 1000000;
+    limits.maxOrdersPerSecond = 3;
+    risk.setDefaultLimits(limits);
+
+    EXPECT_EQ(risk.check(order("alice", Side::BUY, 1000000, 101)), RejectReason::RISK_ORDER_SIZE);
+    EXPECT_EQ(risk.check(order("alice", Side::BUY, 1100000, 100)),
+              RejectReason::RISK_ORDER_NOTIONAL);
+    EXPECT_EQ(risk.check(order("alice", Side::BUY, 1000000, 100)), RejectReason::NONE);
+    // Refused orders used up the rate too
+    EXPECT_EQ(risk.check(order("alice", Side::BUY, 1000000, 100)), RejectReason::RISK_ORDER_RATE);
+
+    // Per-client limits replace the defaults, and rates are per client
+    RiskLimits generous;
+    generous.maxOrderQuantity = 1000;
+    risk.setClientLimits(clientInterner().intern("bob"), generous);
+    EXPECT_EQ(risk.check(order("bob", Side::SELL, 1100000, 500)), RejectReason::NONE);
+}
+
+TEST(RiskCheckTest, PriceBandFollowsTrades) {
+    RiskCheck risk;
+    RiskLimits limits;
+    limits.priceBandBps = 500;  // 5%
+    risk.setDefaultLimits(limits);
+    SymbolId symbol = symbolInterner().intern("RISK");
+
+    // No reference yet: anything goes
+    EXPECT_EQ(risk.check(order("alice", Side::BUY, 9990000, 1)), RejectReason::NONE);
+
+    risk.setReferencePrice(symbol, 1000000);
+    EXPECT_EQ(risk.check(order("alice", Side::BUY, 1050000, 1)), RejectReason::NONE);
+    EXPECT_EQ(risk.check(order("alice", Side::BUY, 1050001, 1)), RejectReason::RISK_PRICE_BAND);
+    EXPECT_EQ(risk.check(order("alice", Side::SELL, 940000, 1)), RejectReason::RISK_PRICE_BAND);
+    EXPECT_EQ(risk.check(order("alice", Side::SELL, 0, 1, OrderType::MARKET)), RejectReason::NONE);
+
+    risk.onTrade(symbol, 1200000);
+    EXPECT_EQ(risk.getReferencePrice(symbol), 1200000);
+    EXPECT_EQ(risk.check(order("alice", Side::BUY, 1250000, 1)), RejectReason::NONE);
+}
+
+TEST(RiskCheckTest, EngineTracksOpenNotionalAndPosition) {
+    MatchingEngineCore engine;
+    RiskLimits limits;
+    limits.maxOpenNotional = 300 * 1000000;
+    limits.maxPosition = 150;
+    engine.getRiskCheck().setDefaultLimits(limits);
+    ClientKey alice = clientInterner().intern("alice");
+    SymbolId symbol = symbolInterner().intern("RISK");
+
+    OrderId first = engine.submitOrder("RISK", Side::BUY, OrderType::LIMIT, 1000000, 100, "alice");
+    ASSERT_NE(first, 0);
+    EXPECT_EQ(engine.getRiskCheck().getOpenNotional(alice), 100 * 1000000);
+
+    // Two working buys of 100 could take the position to 200
+    EXPECT_EQ(engine.submitOrder("RISK", Side::BUY, OrderType::LIMIT, 1000000, 100, "alice"), 0);
+    EXPECT_EQ(engine.getLiveOrders(), 1);
+
+    // A fill turns working quantity into position
+    ASSERT_NE(engine.submitOrder("RISK", Side::SELL, OrderType::LIMIT, 1000000, 100, "bob"), 0);
+    EXPECT_EQ(engine.getRiskCheck().getPosition(alice, symbol), 100);
+    EXPECT_EQ(engine.getRiskCheck().getOpenNotional(alice), 0);
+    EXPECT_EQ(engine.getRiskCheck().getPosition(clientInterner().intern("bob"), symbol), -100);
+    EXPECT_EQ(engine.submitOrder("RISK", Side::BUY, OrderType::LIMIT, 1000000, 60, "alice"), 0);
+    OrderId second = engine.submitOrder("RISK", Side::BUY, OrderType::LIMIT, 1000000, 50, "alice");
+    ASSERT_NE(second, 0);
+
+    // Selling reduces it, and open notional follows modify and cancel
+    OrderId sell = engine.submitOrder("RISK", Side::SELL, OrderType::LIMIT, 1010000, 200, "alice");
+    ASSERT_NE(sell, 0);
+    EXPECT_EQ(engine.getRiskCheck().getOpenNotional(alice), 50 * 1000000 + 200 * 1010000);
+    EXPECT_TRUE(engine.modifyOrder(sell, 1010000, 100));
+    EXPECT_EQ(engine.getRiskCheck().getOpenNotional(alice), 50 * 1000000 + 100 * 1010000);
+    EXPECT_TRUE(engine.cancelOrder(second));
+    EXPECT_TRUE(engine.cancelOrder(sell));
+    EXPECT_EQ(engine.getRiskCheck().getOpenNotional(alice), 0);
+    EXPECT_EQ(engine.getRiskCheck().getPosition(alice, symbol), 100);
+}
+
+TEST(RiskCheckTest, AmendsAreCheckedBeforeTheBook) {
+    MatchingEngineCore engine;
+    RiskLimits limits;
+    limits.maxOrderQuantity = 100;
+    limits.maxOpenNotional = 150 * 1000000;
+    limits.priceBandBps = 500;
+    engine.getRiskCheck().setDefaultLimits(limits);
+    engine.getRiskCheck().setReferencePrice(symbolInterner().intern("AMEND"), 1000000);
+    ClientKey carol = clientInterner().intern("carol");
+
+    OrderId order = engine.submitOrder("AMEND", Side::BUY, OrderType::LIMIT, 1000000, 1, "carol");
+    ASSERT_NE(order, 0);
+
+    // Grown past the size limit, moved out of the band, or past open notional
+    EXPECT_FALSE(engine.modifyOrder(order, 1000000, 101));
+    EXPECT_FALSE(engine.modifyOrder(order, 1100000, 1));
+    ASSERT_NE(engine.submitOrder("AMEND", Side::BUY, OrderType::LIMIT, 1000000, 60, "carol"), 0);
+    EXPECT_FALSE(engine.modifyOrder(order, 1000000, 91));
+    OrderPtr unchanged = engine.getOrder(order);
+    ASSERT_TRUE(unchanged);
+    EXPECT_EQ(unchanged->getRemainingQuantity(), 1);
+    EXPECT_EQ(engine.getRiskCheck().getOpenNotional(carol), 61 * 1000000);
+
+    // Within every limit, measured against what the order already holds
+    EXPECT_TRUE(engine.modifyOrder(order, 1000000, 90));
+    EXPECT_EQ(engine.getRiskCheck().getOpenNotional(carol), 150 * 1000000);
+
+    // Through the command path too, with the risk stage's reason
+    EngineCommand grow = EngineCommand::modify(order, 1000000, 500);
+    EXPECT_EQ(engine.checkRisk(grow), RejectReason::RISK_ORDER_SIZE);
+}
+
+TEST(RiskCheckTest, RetiresQueuedByMatchingAllCount) {
+    MatchingEngineCore engine;
+    RiskLimits limits;
+    limits.maxPosition = 100000;
+    engine.getRiskCheck().setDefaultLimits(limits);
+    ClientKey dave = clientInterner().intern("dave");
+    SymbolId symbol = symbolInterner().intern("SWEEP");
+
+    // More resting orders than the retire queue holds, all filled at once
+    const Quantity orders = 6000;
+    for (Quantity i = 0; i < orders; ++i) {
+        ASSERT_NE(engine.submitOrder("SWEEP", Side::SELL, OrderType::LIMIT, 1000000, 1, "dave"), 0);
+    }
+    EXPECT_EQ(engine.getRiskCheck().getOpenNotional(dave), orders * 1000000);
+    ASSERT_NE(engine.submitOrder("SWEEP", Side::BUY, OrderType::MARKET, 0, orders, "erin"), 0);
+    EXPECT_EQ(engine.getLiveOrders(), 0);
+    EXPECT_EQ(engine.getRiskCheck().getOpenNotional(dave), 0);
+    EXPECT_EQ(engine.getRiskCheck().getPosition(dave, symbol), -static_cast<int64_t>(orders));
+    EXPECT_EQ(engine.getRiskCheck().getPosition(clientInterner().intern("erin"), symbol), orders);
+}
@@ -0,0 +1,501 @@
+#include <gtest/gtest.h>
+#include "Server.h"
+#include "Client.h"
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+using namespace MatchingEngine;
+
+// Runs the same client conversation against every server I/O mode
+class ServerTest : public ::testing::TestWithParam<ServerIoMode> {
+protected:
+    void SetUp() override {
+        ServerConfig config;
+        config.port = 0;
+        config.ioMode = GetParam();
+        config.ioThreads = 2;
+        config.engineShards = 2;
+        server = std::make_unique<Server>(config);
+        ASSERT_TRUE(server->start());
+        
+        client = std::make_unique<Client>("127.0.0.1", server->getPort());
+        client->setOrderAckCallback([this](const OrderAckMessage& msg) {
+            std::lock_guard<std::mutex> lock(mutex);
+            acks.push_back(msg);
+            changed.notify_all();
+        });
+        client->setExecutionReportCallback([this](const ExecutionReportMessage& msg) {
+            std::lock_guard<std::mutex> lock(mutex);
+            reports.push_back(msg);
+            changed.notify_all();
+        });
+        ASSERT_TRUE(client->connect());
+    }
+    
+    void TearDown() override {
+        if (client) {
+            client->disconnect();
+        }
+        if (server) {
+            server->stop();
+        }
+    }
+    
+    bool waitFor(size_t ackCount, size_t reportCount) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, std::chrono::seconds(5), [&]() {
+            return acks.size() >= ackCount && reports.size() >= reportCount;
+        });
+    }
+    
+    std::unique_ptr<Server> server;
+    std::unique_ptr<Client> client;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<OrderAckMessage> acks;
+    std::vector<ExecutionReportMessage> reports;
+};
+
+TEST_P(ServerTest, OrdersAreAcknowledgedAndReported) {
+    OrderId sellRef = client->submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 100);
+    OrderId buyRef = client->submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 150);
+    
+    ASSERT_TRUE(waitFor(2, 1));
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(acks[0].clientOrderId, sellRef);
+    EXPECT_EQ(acks[1].clientOrderId, buyRef);
+    EXPECT_NE(acks[0].orderId, acks[1].orderId);
+    EXPECT_EQ(acks[1].status, OrderStatus::PENDING);
+    
+    // The buy traded 100 and rests with 50
+    const ExecutionReportMessage& report = reports.back();
+    EXPECT_EQ(report.orderId, acks[1].orderId);
+    EXPECT_EQ(report.getSymbol(), "AAPL");
+    EXPECT_EQ(report.executionQuantity, 100);
+    EXPECT_EQ(report.remainingQuantity, 50);
+    EXPECT_EQ(report.status, OrderStatus::PARTIAL_FILL);
+    EXPECT_EQ(server->getTotalTrades(), 1);
+}
+
+TEST_P(ServerTest, CancelAndModify) {
+    client->submitOrder("MSFT", Side::BUY, OrderType::LIMIT, 3000000, 100);
+    ASSERT_TRUE(waitFor(1, 0));
+    OrderId orderId;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        orderId = acks[0].orderId;
+    }
+    
+    EXPECT_TRUE(client->modifyOrder(orderId, 3010000, 100));
+    EXPECT_TRUE(client->cancelOrder(orderId));
+    EXPECT_TRUE(client->cancelOrder(orderId));
+    ASSERT_TRUE(waitFor(4, 0));
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(acks[1].status, OrderStatus::PENDING);
+    EXPECT_EQ(acks[1].getMessage(), "Order modified");
+    EXPECT_EQ(acks[2].status, OrderStatus::CANCELLED);
+    EXPECT_EQ(acks[3].status, OrderStatus::REJECTED);
+}
+
+TEST_P(ServerTest, CancelReplaceIsAcknowledgedUnderItsReference) {
+    client->submitOrder("MSFT", Side::SELL, OrderType::LIMIT, 3000000, 100);
+    ASSERT_TRUE(waitFor(1, 0));
+    OrderId orderId;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        orderId = acks[0].orderId;
+    }
+    
+    OrderId down = client->replaceOrder(orderId, 3000000, 60);
+    OrderId up = client->replaceOrder(orderId, 3000000, 80);
+    OrderId missing = client->replaceOrder(orderId + 1024, 3000000, 80);
+    ASSERT_NE(down, 0);
+    ASSERT_TRUE(waitFor(4, 0));
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_EQ(acks[1].clientOrderId, down);
+        EXPECT_EQ(acks[1].orderId, orderId);
+        EXPECT_EQ(acks[1].status, OrderStatus::PENDING);
+        EXPECT_EQ(acks[2].clientOrderId, up);
+        EXPECT_EQ(acks[3].clientOrderId, missing);
+        EXPECT_EQ(acks[3].status, OrderStatus::REJECTED);
+    }
+    
+    // What rests is the last amend
+    client->submitOrder("MSFT", Side::BUY, OrderType::IOC, 3000000, 100);
+    ASSERT_TRUE(waitFor(5, 1));
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(reports.back().executionQuantity, 80);
+}
+
+TEST_P(ServerTest, NegotiatesProtocolVersion) {
+    EXPECT_EQ(client->getProtocolVersion(), 2);
+    
+    // A client that only speaks version 1 still gets text acks
+    Client legacy("127.0.0.1", server->getPort());
+    legacy.setProtocolVersion(1);
+    std::mutex legacyMutex;
+    std::condition_variable legacyChanged;
+    std::vector<OrderAckMessage> legacyAcks;
+    legacy.setOrderAckCallback([&](const OrderAckMessage& msg) {
+        std::lock_guard<std::mutex> lock(legacyMutex);
+        legacyAcks.push_back(msg);
+        legacyChanged.notify_all();
+    });
+    ASSERT_TRUE(legacy.connect());
+    EXPECT_EQ(legacy.getProtocolVersion(), 1);
+    
+    OrderId ref = legacy.submitOrder("IBM", Side::BUY, OrderType::LIMIT, 1000000, 10);
+    legacy.cancelOrder(999999);
+    {
+        std::unique_lock<std::mutex> lock(legacyMutex);
+        ASSERT_TRUE(legacyChanged.wait_for(lock, std::chrono::seconds(5),
+                                           [&]() { return legacyAcks.size() >= 2; }));
+        EXPECT_EQ(legacyAcks[0].clientOrderId, ref);
+        EXPECT_EQ(legacyAcks[0].getMessage(), "Order accepted");
+        EXPECT_EQ(legacyAcks[1].status, OrderStatus::REJECTED);
+        EXPECT_EQ(legacyAcks[1].getMessage(), "Order not found");
+    }
+    legacy.disconnect();
+}
+
+TEST_P(ServerTest, BatchesAreAcknowledgedOnce) {
+    std::vector<ProtocolV2::BatchAck> batchAcks;
+    std::vector<ProtocolV2::MassCancelAck> massCancelAcks;
+    client->setBatchAckCallback([&](const ProtocolV2::BatchAck& ack) {
+        std::lock_guard<std::mutex> lock(mutex);
+        batchAcks.push_back(ack);
+        changed.notify_all();
+    });
+    client->setMassCancelAckCallback([&](const ProtocolV2::MassCancelAck& ack) {
+        std::lock_guard<std::mutex> lock(mutex);
+        massCancelAcks.push_back(ack);
+        changed.notify_all();
+    });
+    auto waitForBatch = [&](size_t batchCount, size_t massCancelCount) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, std::chrono::seconds(5), [&]() {
+            return batchAcks.size() >= batchCount && massCancelAcks.size() >= massCancelCount;
+        });
+    };
+    
+    // A bid ladder, then an ask that trades with the top of it
+    std::vector<ProtocolV2::NewOrderBatch::Entry> ladder;
+    for (Price price : {1500000, 1490000, 1480000}) {
+        ladder.push_back({Side::BUY, OrderType::LIMIT, price, 100});
+    }
+    ladder.push_back({Side::SELL, OrderType::LIMIT, 1500000, 40});
+    OrderId reference = client->submitOrderBatch("AAPL", ladder);
+    ASSERT_NE(reference, 0);
+    ASSERT_TRUE(waitForBatch(1, 0));
+    ASSERT_TRUE(waitFor(0, 1));
+    std::vector<OrderId> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_TRUE(acks.empty());  // No per-order acks
+        ASSERT_EQ(batchAcks[0].reference, reference);
+        ASSERT_EQ(batchAcks[0].count, 4);
+        for (size_t i = 0; i < 4; ++i) {
+            EXPECT_EQ(batchAcks[0].entries[i].status, OrderStatus::PENDING);
+            ids.push_back(batchAcks[0].entries[i].orderId);
+        }
+        EXPECT_EQ(reports[0].orderId, ids[3]);
+        EXPECT_EQ(reports[0].status, OrderStatus::FILLED);
+    }
+    
+    client->modifyOrders({{ids[1], 1495000, 100}, {ids[3], 1500000, 10}});
+    client->cancelOrders({ids[2], ids[2]});
+    ASSERT_TRUE(waitForBatch(3, 0));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_EQ(batchAcks[1].entries[0].status, OrderStatus::PENDING);
+        EXPECT_EQ(batchAcks[1].entries[1].reason, RejectReason::MODIFY_REJECTED);  // Filled
+        EXPECT_EQ(batchAcks[2].entries[0].status, OrderStatus::CANCELLED);
+        EXPECT_EQ(batchAcks[2].entries[1].reason, RejectReason::ORDER_NOT_FOUND);
+    }
+    
+    // Another client's order survives this client's mass cancel
+    Client other("127.0.0.1", server->getPort());
+    other.setVerbose(false);
+    other.setClientId("other");
+    ASSERT_TRUE(other.connect());
+    other.submitOrder("MSFT", Side::BUY, OrderType::LIMIT, 3000000, 10);
+    client->submitOrder("MSFT", Side::SELL, OrderType::LIMIT, 3100000, 10);
+    ASSERT_TRUE(waitFor(1, 0));
+    
+    client->massCancel("AAPL", Side::SELL);
+    client->massCancel();
+    ASSERT_TRUE(waitForBatch(3, 2));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_EQ(massCancelAcks[0].cancelled, 0);
+        EXPECT_EQ(massCancelAcks[1].cancelled, 3);  // Two AAPL bids and the MSFT ask
+    }
+    other.disconnect();
+}
+
+TEST_P(ServerTest, RiskRefusesOrdersWithACode) {
+    ServerConfig config;
+    config.port = 0;
+    config.ioMode = GetParam();
+    config.logEvents = false;
+    config.riskLimits.maxOrderQuantity = 100;
+    Server guarded(config);
+    ASSERT_TRUE(guarded.start());
+    
+    for (uint8_t version : {1, 2}) {
+        Client limited("127.0.0.1", guarded.getPort());
+        limited.setVerbose(false);
+        limited.setProtocolVersion(version);
+        std::vector<OrderRejectMessage> rejects;
+        std::vector<OrderAckMessage> accepted;
+        limited.setOrderRejectCallback([&](const OrderRejectMessage& msg) {
+            std::lock_guard<std::mutex> lock(mutex);
+            rejects.push_back(msg);
+            changed.notify_all();
+        });
+        limited.setOrderAckCallback([&](const OrderAckMessage& msg) {
+            std::lock_guard<std::mutex> lock(mutex);
+            accepted.push_back(msg);
+            changed.notify_all();
+        });
+        ASSERT_TRUE(limited.connect());
+        
+        OrderId refused = limited.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 101);
+        OrderId allowed = limited.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 100);
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(changed.wait_for(lock, std::chrono::seconds(5), [&]() {
+            return rejects.size() >= 1 && accepted.size() >= 1;
+        }));
+        EXPECT_EQ(rejects[0].clientOrderId, refused);
+        EXPECT_EQ(rejects[0].getReason(), "Order quantity over limit");
+        EXPECT_EQ(accepted[0].clientOrderId, allowed);
+        
+        // Nor can an accepted order be amended past the limit
+        OrderId placed = accepted[0].orderId;
+        lock.unlock();
+        ASSERT_TRUE(limited.modifyOrder(placed, 1500000, 101));
+        lock.lock();
+        ASSERT_TRUE(changed.wait_for(lock, std::chrono::seconds(5), [&]() {
+            return accepted.size() >= 2;
+        }));
+        EXPECT_EQ(accepted[1].orderId, placed);
+        EXPECT_EQ(accepted[1].status, OrderStatus::REJECTED);
+        EXPECT_EQ(accepted[1].getMessage(), "Order quantity over limit");
+        lock.unlock();
+        limited.disconnect();
+    }
+    EXPECT_EQ(guarded.getTotalOrders(), 2);  // Refused orders never reach a book
+    guarded.stop();
+}
+
+TEST_P(ServerTest, TracksConnections) {
+    Client second("127.0.0.1", server->getPort());
+    ASSERT_TRUE(second.connect());
+    
+    auto waitConnections = [&](size_t expected) {
+        for (int i = 0; i < 500 && server->getActiveConnections() != expected; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return server->getActiveConnections();
+    };
+    EXPECT_EQ(waitConnections(2), 2);
+    
+    second.disconnect();
+    EXPECT_EQ(waitConnections(1), 1);
+}
+
+TEST_P(ServerTest, PipelinedBurstInOneWrite) {
+    // Raw connection so the whole burst goes out in a single send
+    SocketType sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_NE(sock, INVALID_SOCKET);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(server->getPort());
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    ASSERT_EQ(::connect(sock, (sockaddr*)&addr, sizeof(addr)), 0);
+    
+    const size_t count = 1000;
+    std::vector<NewOrderMessage> burst(count);
+    for (size_t i = 0; i < count; ++i) {
+        burst[i].clientOrderId = i + 1;
+        burst[i].setSymbol("BURST");
+        burst[i].side = Side::BUY;
+        burst[i].price = 1000000 - static_cast<Price>(i);  // Never crosses
+        burst[i].quantity = 10;
+    }
+    const char* bytes = reinterpret_cast<const char*>(burst.data());
+    size_t total = count * sizeof(NewOrderMessage);
+    for (size_t sent = 0; sent < total;) {
+        ssize_t n = send(sock, bytes + sent, total - sent, 0);
+        ASSERT_GT(n, 0);
+        sent += static_cast<size_t>(n);
+    }
+    
+    // Resting orders draw exactly one ack each, in submission order
+    std::vector<OrderAckMessage> received(count);
+    char* in = reinterpret_cast<char*>(received.data());
+    size_t wanted = count * sizeof(OrderAckMessage);
+    for (size_t got = 0; got < wanted;) {
+        ssize_t n = recv(sock, in + got, wanted - got, 0);
+        ASSERT_GT(n, 0);
+        got += static_cast<size_t>(n);
+    }
+    closesocket(sock);
+    
+    for (size_t i = 0; i < count; ++i) {
+        EXPECT_EQ(received[i].header.type, MessageType::ORDER_ACK);
+        EXPECT_EQ(received[i].clientOrderId, i + 1);
+    }
+    EXPECT_EQ(server->getTotalOrders(), count);
+}
+
+TEST_P(ServerTest, VersionOneOrdersTradeAsTheLoggedOnClient) {
+    SocketType sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ASSERT_NE(sock, INVALID_SOCKET);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(server->getPort());
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    ASSERT_EQ(::connect(sock, (sockaddr*)&addr, sizeof(addr)), 0);
+    auto receiveExactly = [&](void* out, size_t length) {
+        char* in = static_cast<char*>(out);
+        for (size_t got = 0; got < length;) {
+            ssize_t n = recv(sock, in + got, length - got, 0);
+            if (n <= 0) {
+                return false;
+            }
+            got += static_cast<size_t>(n);
+        }
+        return true;
+    };
+
+    LogonMessage logon;
+    logon.protocolVersion = 1;
+    logon.setClientId("alice");
+    ASSERT_EQ(send(sock, reinterpret_cast<const char*>(&logon), sizeof(logon), 0),
+              static_cast<ssize_t>(sizeof(logon)));
+    LogonAckMessage logonAck;
+    ASSERT_TRUE(receiveExactly(&logonAck, sizeof(logonAck)));
+
+    // Another client's name is refused; the logon's, or none, trades
+    NewOrderMessage orders[3];
+    const char* names[3] = {"mallory", "alice", ""};
+    for (size_t i = 0; i < 3; ++i) {
+        orders[i].clientOrderId = i + 1;
+        orders[i].setSymbol("AAPL");
+        orders[i].setClientId(names[i]);
+        orders[i].side = Side::BUY;
+        orders[i].price = 1490000;
+        orders[i].quantity = 10;
+    }
+    ASSERT_EQ(send(sock, reinterpret_cast<const char*>(orders), sizeof(orders), 0),
+              static_cast<ssize_t>(sizeof(orders)));
+    OrderRejectMessage reject;
+    ASSERT_TRUE(receiveExactly(&reject, sizeof(reject)));
+    EXPECT_EQ(reject.header.type, MessageType::ORDER_REJECT);
+    EXPECT_EQ(reject.clientOrderId, 1);
+    OrderAckMessage acks[2];
+    ASSERT_TRUE(receiveExactly(acks, sizeof(acks)));
+    EXPECT_EQ(acks[0].clientOrderId, 2);
+    EXPECT_EQ(acks[0].status, OrderStatus::PENDING);
+    EXPECT_EQ(acks[1].clientOrderId, 3);
+    EXPECT_EQ(acks[1].status, OrderStatus::PENDING);
+    closesocket(sock);
+    EXPECT_EQ(server->getTotalOrders(), 2);
+}
+
+TEST_P(ServerTest, StreamsBookUpdatesToSubscribers) {
+    if (GetParam() == ServerIoMode::THREAD_PER_CLIENT) {
+        GTEST_SKIP() << "Market data needs an event loop I/O mode";
+    }
+    
+    // Resting before the subscription, so it arrives as the initial image
+    client->submitOrder("NVDA", Side::SELL, OrderType::LIMIT, 5000000, 30);
+    ASSERT_TRUE(waitFor(1, 0));
+    
+    Client watcher("127.0.0.1", server->getPort());
+    std::vector<BookUpdateMessage> updates;
+    watcher.setBookUpdateCallback([&](const BookUpdateMessage& msg) {
+        std::lock_guard<std::mutex> lock(mutex);
+        updates.push_back(msg);
+        changed.notify_all();
+    });
+    ASSERT_TRUE(watcher.connect());
+    ASSERT_TRUE(watcher.subscribeMarketData("NVDA"));
+    
+    client->submitOrder("NVDA", Side::BUY, OrderType::LIMIT, 5000000, 10);
+    client->submitOrder("AMD", Side::BUY, OrderType::LIMIT, 1000000, 10);
+    
+    // Conflation may merge updates, but the ask must end at 20
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(changed.wait_for(lock, std::chrono::seconds(5), [&]() {
+        return !updates.empty() && updates.back().quantity == 20;
+    }));
+    EXPECT_EQ(updates.front().getSymbol(), "NVDA");
+    EXPECT_EQ(updates.front().price, 5000000);
+    for (const auto& update : updates) {
+        EXPECT_EQ(update.getSymbol(), "NVDA");
+        EXPECT_EQ(update.side, Side::SELL);
+    }
+    lock.unlock();
+    watcher.disconnect();
+}
+
+TEST_P(ServerTest, AcksWaitForTheJournalSync) {
+    std::string directory = (std::filesystem::temp_directory_path() /
+                             ("server_journal_" + std::to_string(static_cast<int>(GetParam())))).string();
+    std::filesystem::remove_all(directory);
+    ServerConfig config;
+    config.port = 0;
+    config.ioMode = GetParam();
+    config.logEvents = false;
+    config.journal.directory = directory;
+    config.journal.fsyncPolicy = FsyncPolicy::INTERVAL;
+    config.journal.fsyncIntervalMicros = 400000;
+
+    // The journal's first sync is an interval after it starts
+    auto started = std::chrono::steady_clock::now();
+    Server journaled(config);
+    ASSERT_TRUE(journaled.start());
+    Client writer("127.0.0.1", journaled.getPort());
+    writer.setVerbose(false);
+    std::mutex ackMutex;
+    std::condition_variable acked;
+    std::chrono::steady_clock::time_point ackedAt;
+    bool gotAck = false;
+    writer.setOrderAckCallback([&](const OrderAckMessage&) {
+        std::lock_guard<std::mutex> lock(ackMutex);
+        ackedAt = std::chrono::steady_clock::now();
+        gotAck = true;
+        acked.notify_all();
+    });
+    ASSERT_TRUE(writer.connect());
+    writer.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 100);
+    {
+        std::unique_lock<std::mutex> lock(ackMutex);
+        ASSERT_TRUE(acked.wait_for(lock, std::chrono::seconds(5), [&]() { return gotAck; }));
+        EXPECT_GE(ackedAt - started, std::chrono::milliseconds(400));
+    }
+    writer.disconnect();
+    journaled.stop();
+    std::filesystem::remove_all(directory);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    IoModes, ServerTest,
+    ::testing::Values(ServerIoMode::THREAD_PER_CLIENT, ServerIoMode::EPOLL,
+                      ServerIoMode::IO_URING),
+    [](const ::testing::TestParamInfo<ServerIoMode>& info) {
+        switch (info.param) {
+            case ServerIoMode::THREAD_PER_CLIENT: return std::string("ThreadPerClient");
+            case ServerIoMode::EPOLL: return std::string("Epoll");
+            case ServerIoMode::IO_URING: return std::string("IoUring");
+        }
+        return std::string("Unknown");
+    });
@@ -0,0 +1,333 @@
+#include <gtest/gtest.h>
+#include "ShardedEngine.h"
+#include "Interner.h"
+#include "RingBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace MatchingEngine;
+
+// Ring buffers
+TEST(RingBufferTest, SpscFifoAndFull) {
+    SpscRing<int> ring(4);
+    EXPECT_EQ(ring.capacity(), 4);
+    
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ring.tryPush(i));
+    }
+    EXPECT_FALSE(ring.tryPush(99));
+    
+    int value = -1;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(ring.tryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(ring.tryPop(value));
+}
+
+TEST(RingBufferTest, SpscAcrossThreads) {
+    SpscRing<uint64_t> ring(64);
+    const uint64_t count = 100000;
+    
+    std::thread producer([&]() {
+        for (uint64_t i = 1; i <= count; ++i) {
+            while (!ring.tryPush(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    
+    uint64_t expected = 1;
+    uint64_t batch[16];
+    while (expected <= count) {
+        size_t n = ring.popBatch(batch, 16);
+        if (n == 0) {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < n; ++i) {
+            ASSERT_EQ(batch[i], expected++);
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(RingBufferTest, MpscDeliversEveryItemInProducerOrder) {
+    MpscRing<uint64_t> ring(128);
+    const int producers = 4;
+    const uint64_t perProducer = 20000;
+    
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&ring, p, perProducer]() {
+            for (uint64_t i = 0; i < perProducer; ++i) {
+                uint64_t value = (static_cast<uint64_t>(p) << 32) | i;
+                while (!ring.tryPush(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    
+    std::vector<uint64_t> next(producers, 0);
+    uint64_t received = 0;
+    uint64_t value;
+    while (received < producers * perProducer) {
+        if (ring.tryPop(value)) {
+            size_t p = value >> 32;
+            ASSERT_EQ(value & 0xffffffff, next[p]);
+            ++next[p];
+            ++received;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_FALSE(ring.tryPop(value));
+}
+
+TEST(RingBufferTest, MpscBatchIsContiguousAndAllOrNothing) {
+    MpscRing<uint64_t> ring(8);
+    const uint64_t first[] = {1, 2, 3, 4, 5};
+    const uint64_t second[] = {6, 7, 8, 9};
+    ASSERT_TRUE(ring.tryPush(0));
+    ASSERT_TRUE(ring.tryPushBatch(first, 5));
+    EXPECT_FALSE(ring.tryPushBatch(second, 4));  // Only 2 free
+    
+    uint64_t value;
+    ASSERT_TRUE(ring.tryPop(value));
+    ASSERT_TRUE(ring.tryPop(value));
+    ASSERT_TRUE(ring.tryPushBatch(second, 4));
+    for (uint64_t expected = 2; expected <= 9; ++expected) {
+        ASSERT_TRUE(ring.tryPop(value));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_FALSE(ring.tryPop(value));
+}
+
+// Sharded engine
+class ShardedEngineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ShardedEngineConfig config;
+        config.shardCount = 2;
+        config.spinIterations = 100;
+        // Route by first letter so tests know where each symbol lands
+        config.symbolHash = [](const std::string& symbol) {
+            return symbol.empty() ? 0 : static_cast<size_t>(symbol[0] == 'M');
+        };
+        engine = std::make_unique<ShardedEngine>(config);
+        
+        engine->setTradeCallback([this](const Trade& trade) {
+            std::lock_guard<std::mutex> lock(mutex);
+            trades.push_back(trade);
+        });
+        engine->start();
+    }
+    
+    void TearDown() override {
+        engine->stop();
+    }
+    
+    std::unique_ptr<ShardedEngine> engine;
+    std::mutex mutex;
+    std::vector<Trade> trades;
+};
+
+TEST_F(ShardedEngineTest, SymbolsRouteByConfiguredHash) {
+    EXPECT_EQ(engine->shardFor("AAPL"), 0);
+    EXPECT_EQ(engine->shardFor("MSFT"), 1);
+    
+    OrderId aapl = engine->submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 15000, 100);
+    OrderId msft = engine->submitOrder("MSFT", Side::BUY, OrderType::LIMIT, 30000, 100);
+    EXPECT_EQ(ShardedEngine::shardOf(aapl), 0);
+    EXPECT_EQ(ShardedEngine::shardOf(msft), 1);
+    
+    engine->flush();
+    EXPECT_EQ(engine->getShard(0).getBestBid("AAPL"), 15000);
+    EXPECT_EQ(engine->getShard(0).getBestBid("MSFT"), 0);
+    EXPECT_EQ(engine->getShard(1).getBestBid("MSFT"), 30000);
+}
+
+TEST_F(ShardedEngineTest, SymbolIdsRouteLikeTheirNames) {
+    SymbolId aapl = symbolInterner().intern("AAPL");
+    SymbolId msft = symbolInterner().intern("MSFT");
+    for (int pass = 0; pass < 2; ++pass) {  // Hashed, then remembered
+        EXPECT_EQ(engine->shardFor(aapl), 0);
+        EXPECT_EQ(engine->shardFor(msft), 1);
+    }
+}
+
+TEST_F(ShardedEngineTest, MatchesWithinShard) {
+    OrderId sellId = engine->submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 15000, 100);
+    OrderId buyId = engine->submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 15000, 60);
+    engine->flush();
+    
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].getBuyOrderId(), buyId);
+    EXPECT_EQ(trades[0].getSellOrderId(), sellId);
+    EXPECT_EQ(trades[0].getQuantity(), 60);
+    EXPECT_EQ(engine->getTotalOrders(), 2);
+    EXPECT_EQ(engine->getTotalTrades(), 1);
+    EXPECT_EQ(engine->getBestAsk("AAPL"), 15000);
+}
+
+TEST_F(ShardedEngineTest, CancelAndModifyRouteById) {
+    OrderId bid = engine->submitOrder("MSFT", Side::BUY, OrderType::LIMIT, 30000, 100);
+    OrderId ask = engine->submitOrder("MSFT", Side::SELL, OrderType::LIMIT, 31000, 100);
+    
+    EXPECT_TRUE(engine->modifyOrder(ask, 30500, 100));
+    EXPECT_TRUE(engine->cancelOrder(bid));
+    engine->flush();
+    
+    EXPECT_EQ(engine->getBestBid("MSFT"), 0);
+    EXPECT_EQ(engine->getBestAsk("MSFT"), 30500);
+    EXPECT_EQ(engine->getShard(1).getLiveOrders(), 1);
+    
+    // Id naming a shard that doesn't exist
+    EXPECT_FALSE(engine->cancelOrder((OrderId(1) << ShardedEngine::SHARD_BITS) | 7));
+}
+
+TEST_F(ShardedEngineTest, BatchesAndMassCancelAcrossShards) {
+    ClientKey alice = clientInterner().intern("alice");
+    std::vector<EngineCommand> batch;
+    for (const char* symbol : {"AAPL", "MSFT", "AMZN"}) {
+        batch.push_back(EngineCommand::newOrder(0, symbolInterner().intern(symbol), Side::BUY,
+                                                OrderType::LIMIT, 10000, 10, alice));
+    }
+    ASSERT_TRUE(engine->submitBatch(batch.data(), batch.size()));
+    EXPECT_EQ(ShardedEngine::shardOf(batch[0].orderId), 0);
+    EXPECT_EQ(ShardedEngine::shardOf(batch[1].orderId), 1);
+    EXPECT_EQ(ShardedEngine::shardOf(batch[2].orderId), 0);
+    engine->submitOrder("MSFT", Side::BUY, OrderType::LIMIT, 10000, 10, "bob");
+    engine->flush();
+    EXPECT_EQ(engine->getShard(0).getLiveOrders(), 2);
+    EXPECT_EQ(engine->getShard(1).getLiveOrders(), 2);
+    
+    // Without a symbol every shard gets a copy
+    EXPECT_EQ(engine->submit(EngineCommand::massCancel(MASS_CANCEL_BY_CLIENT, 0, Side::BUY,
+                                                       alice)), 2);
+    engine->flush();
+    EXPECT_EQ(engine->getShard(0).getLiveOrders(), 0);
+    EXPECT_EQ(engine->getShard(1).getLiveOrders(), 1);  // Bob's
+}
+
+TEST_F(ShardedEngineTest, ConcurrentProducers) {
+    const int producers = 4;
+    const int perProducer = 2000;
+    std::vector<std::thread> threads;
+    std::mutex idMutex;
+    std::set<OrderId> ids;
+    
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            const char* symbol = (p % 2 == 0) ? "AAPL" : "MSFT";
+            for (int i = 0; i < perProducer; ++i) {
+                Side side = (i % 2 == 0) ? Side::BUY : Side::SELL;
+                OrderId id = engine->submitOrder(symbol, side, OrderType::LIMIT, 10000, 10);
+                std::lock_guard<std::mutex> lock(idMutex);
+                ids.insert(id);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    engine->flush();
+    
+    EXPECT_EQ(ids.size(), static_cast<size_t>(producers * perProducer));
+    EXPECT_EQ(ids.count(0), 0);
+    EXPECT_EQ(engine->getTotalOrders(), static_cast<size_t>(producers * perProducer));
+    
+    // Every buy crosses a resting sell at the same price (or vice versa)
+    EXPECT_EQ(engine->getTotalTrades(), static_cast<size_t>(producers * perProducer / 2));
+    EXPECT_EQ(engine->getShard(0).getLiveOrders() + engine->getShard(1).getLiveOrders(), 0);
+}
+
+TEST(ShardedEngineLifecycleTest, StopDrainsQueuedCommands) {
+    ShardedEngineConfig config;
+    config.shardCount = 3;
+    ShardedEngine engine(config);
+    
+    // Queued before start and applied once the shards run
+    engine.submitOrder("IBM", Side::BUY, OrderType::LIMIT, 12000, 100);
+    engine.start();
+    for (int i = 0; i < 100; ++i) {
+        engine.submitOrder("IBM", Side::SELL, OrderType::LIMIT, 12100 + i, 10);
+    }
+    engine.stop();
+    
+    EXPECT_FALSE(engine.isRunning());
+    EXPECT_EQ(engine.getTotalOrders(), 101);
+    EXPECT_EQ(engine.getBestBid("IBM"), 12000);
+    EXPECT_EQ(engine.getBestAsk("IBM"), 12100);
+}
+
+TEST(ShardedEngineLifecycleTest, NodeIdTagsEveryOrderId) {
+    ShardedEngineConfig config;
+    config.shardCount = 2;
+    config.nodeId = 3;
+    ShardedEngine engine(config);
+    engine.start();
+    
+    OrderId bid = engine.submitOrder("IBM", Side::BUY, OrderType::LIMIT, 12000, 100);
+    OrderId ask = engine.submitOrder("MSFT", Side::SELL, OrderType::LIMIT, 30000, 100);
+    EXPECT_EQ(ShardedEngine::nodeOf(bid), 3);
+    EXPECT_EQ(ShardedEngine::nodeOf(ask), 3);
+    EXPECT_EQ(ShardedEngine::shardOf(bid), engine.shardFor("IBM"));
+    
+    // The node bits don't get in the way of routing by shard
+    EXPECT_TRUE(engine.cancelOrder(bid));
+    EXPECT_TRUE(engine.modifyOrder(ask, 30500, 100));
+    engine.flush();
+    EXPECT_EQ(engine.getBestBid("IBM"), 0);
+    EXPECT_EQ(engine.getBestAsk("MSFT"), 30500);
+    engine.stop();
+}
+
+TEST(ShardedEngineLifecycleTest, ShardsExpireOrdersOnTheirOwn) {
+    ShardedEngineConfig config;
+    config.shardCount = 2;
+    config.expiry.tickNanos = 100000;
+    config.expiryBatch = 2;
+    ShardedEngine engine(config);
+    std::atomic<int> cancelled{0};
+    engine.setOrderCallback([&](const Order& order) {
+        if (order.getStatus() == OrderStatus::CANCELLED) {
+            cancelled.fetch_add(1);
+        }
+    });
+    engine.start();
+
+    uint64_t expireTime = timestampToNanos(getCurrentTimestamp()) + 20000000;
+    for (int i = 0; i < 5; ++i) {
+        EngineCommand command = EngineCommand::newOrder(
+            0, symbolInterner().intern(i % 2 ? "AAPL" : "MSFT"), Side::BUY, OrderType::LIMIT,
+            10000 + i, 10);
+        command.timeInForce = TimeInForce::GTD;
+        command.expireTime = expireTime;
+        EXPECT_NE(engine.submit(command), 0);
+    }
+    OrderId kept = engine.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 9000, 10);
+    engine.flush();
+    EXPECT_EQ(engine.getShard(0).getLiveOrders() + engine.getShard(1).getLiveOrders(), 6);
+
+    // Past the time, the shards cancel them a batch at a time with no prompting
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (cancelled.load() < 5 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(cancelled.load(), 5);
+    EXPECT_GE(timestampToNanos(getCurrentTimestamp()), expireTime);
+    engine.flush();
+    EXPECT_EQ(engine.getShard(0).getLiveOrders() + engine.getShard(1).getLiveOrders(), 1);
+    EXPECT_EQ(engine.getBestBid("AAPL"), 9000);
+    EXPECT_TRUE(engine.cancelOrder(kept));
+    engine.stop();
+}
@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include "Snapshot.h"
+#include "Journal.h"
+#include "Interner.h"
+#include "MatchingEngine.h"
+#include "ShardedEngine.h"
+#include <filesystem>
+#include <fstream>
+
+using namespace MatchingEngine;
+
+class SnapshotTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        const ::testing::TestInfo* info = ::testing::UnitTest::GetInstance()->current_test_info();
+        directory = (std::filesystem::temp_directory_path() /
+                     (std::string("snapshot_test_") + info->name())).string();
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        snapshotPath = directory + "/engine.snap";
+        journalConfig.directory = directory + "/journal";
+        journalConfig.segmentSize = 64 * sizeof(JournalRecord);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::string directory;
+    std::string snapshotPath;
+    JournalConfig journalConfig;
+};
+
+TEST_F(SnapshotTest, RoundTripKeepsDepthAndPriority) {
+    MatchingEngineCore engine;
+    OrderId first = engine.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 100, "alice");
+    OrderId second = engine.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 50, "bob");
+    engine.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1490000, 70, "carol");
+    OrderId ask = engine.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1510000, 200, "dave");
+    engine.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1510000, 80, "erin");  // Partially fills ask below
+
+    std::vector<EngineSnapshot> snapshot(1);
+    engine.captureSnapshot(snapshot[0]);
+    ASSERT_EQ(snapshot[0].orders.size(), 5);
+    ASSERT_TRUE(writeSnapshot(snapshotPath, snapshot));
+
+    std::vector<EngineSnapshot> loaded;
+    ASSERT_TRUE(readSnapshot(snapshotPath, loaded));
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(loaded[0].nextOrderId, engine.getNextOrderId());
+
+    MatchingEngineCore restored;
+    ASSERT_TRUE(restored.loadSnapshot(loaded[0]));
+    EXPECT_EQ(restored.getLiveOrders(), 5);
+    EXPECT_EQ(restored.getBidDepth("AAPL"), engine.getBidDepth("AAPL"));
+    EXPECT_EQ(restored.getAskDepth("AAPL"), engine.getAskDepth("AAPL"));
+    EXPECT_EQ(restored.getOrder(ask)->getClientId(), "dave");
+
+    // Time priority at 150.00 survives: alice fills before bob
+    restored.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 100, "frank");
+    EXPECT_EQ(restored.getOrder(first), nullptr);
+    ASSERT_NE(restored.getOrder(second), nullptr);
+    EXPECT_EQ(restored.getOrder(second)->getRemainingQuantity(), 50);
+
+    // New ids continue past the snapshot's
+    OrderId next = restored.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1400000, 10);
+    EXPECT_GE(next, loaded[0].nextOrderId);
+}
+
+TEST_F(SnapshotTest, RoundTripKeepsExpiries) {
+    MatchingEngineCore engine;
+    EngineCommand order = EngineCommand::newOrder(1, symbolInterner().intern("AAPL"), Side::SELL,
+                                                  OrderType::LIMIT, 1510000, 100);
+    order.timeInForce = TimeInForce::GTD;
+    order.expireTime = 5000000;
+    order.timestamp = 1000;
+    ASSERT_TRUE(engine.execute(order));
+    engine.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1490000, 100, "bob");
+
+    std::vector<EngineSnapshot> snapshot(1);
+    engine.captureSnapshot(snapshot[0]);
+    ASSERT_TRUE(writeSnapshot(snapshotPath, snapshot));
+    std::vector<EngineSnapshot> loaded;
+    ASSERT_TRUE(readSnapshot(snapshotPath, loaded));
+    ASSERT_EQ(loaded[0].expireTimes.size(), 2);
+
+    MatchingEngineCore restored;
+    ASSERT_TRUE(restored.loadSnapshot(loaded[0]));
+    EXPECT_EQ(restored.getScheduledExpiries(), 1);
+    EXPECT_EQ(restored.getOrder(1)->getTimeInForce(), TimeInForce::GTD);
+    EXPECT_EQ(restored.expireOrders(4999999), 0);
+    EXPECT_EQ(restored.expireOrders(5000000), 1);
+    EXPECT_EQ(restored.getBestAsk("AAPL"), 0);
+    EXPECT_EQ(restored.getBestBid("AAPL"), 1490000);
+}
+
+TEST_F(SnapshotTest, RecoversFromSnapshotAndJournalTail) {
+    OrderId bid;
+    OrderId ask;
+    {
+        Journal journal(journalConfig);
+        ASSERT_TRUE(journal.open());
+        MatchingEngineCore engine;
+        engine.setCommandHook([&](const EngineCommand& command) { return journal.append(command); });
+
+        bid = engine.submitOrder("MSFT", Side::BUY, OrderType::LIMIT, 300000, 100, "alice");
+        ask = engine.submitOrder("MSFT", Side::SELL, OrderType::LIMIT, 310000, 100, "bob");
+
+        std::vector<EngineSnapshot> snapshot(1);
+        engine.captureSnapshot(snapshot[0]);
+        EXPECT_EQ(snapshot[0].journalSequence, 2);
+        ASSERT_TRUE(writeSnapshot(snapshotPath, snapshot));
+
+        // Tail the snapshot doesn't cover
+        engine.cancelOrder(bid);
+        engine.modifyOrder(ask, 305000, 60);
+        engine.submitOrder("MSFT", Side::BUY, OrderType::LIMIT, 299000, 40, "carol");
+    }
+
+    MatchingEngineCore restored;
+    ASSERT_TRUE(restored.recover(snapshotPath, journalConfig.directory));
+    EXPECT_EQ(restored.getJournalSequence(), 5);
+    EXPECT_EQ(restored.getOrder(bid), nullptr);
+    EXPECT_EQ(restored.getBestAsk("MSFT"), 305000);
+    EXPECT_EQ(restored.getBestBid("MSFT"), 299000);
+    EXPECT_EQ(restored.getLiveOrders(), 2);
+
+    // Ids drawn after recovery don't collide with replayed ones
+    OrderId next = restored.submitOrder("MSFT", Side::BUY, OrderType::LIMIT, 298000, 10);
+    EXPECT_GT(next, ask + 1);
+}
+
+TEST_F(SnapshotTest, RecoversFromJournalAlone) {
+    {
+        Journal journal(journalConfig);
+        ASSERT_TRUE(journal.open());
+        MatchingEngineCore engine;
+        engine.setCommandHook([&](const EngineCommand& command) { return journal.append(command); });
+        engine.submitOrder("GOOGL", Side::SELL, OrderType::LIMIT, 2800000, 30);
+        engine.submitOrder("GOOGL", Side::BUY, OrderType::LIMIT, 2800000, 10);  // Trades
+    }
+
+    MatchingEngineCore restored;
+    ASSERT_TRUE(restored.recover(snapshotPath, journalConfig.directory));
+    EXPECT_EQ(restored.getLiveOrders(), 1);
+    auto depth = restored.getAskDepth("GOOGL");
+    ASSERT_EQ(depth.size(), 1);
+    EXPECT_EQ(depth[0].second, 20);
+}
+
+TEST_F(SnapshotTest, ShardedSnapshotWhileRunning) {
+    ShardedEngineConfig config;
+    config.shardCount = 2;
+    Journal journal(journalConfig);
+    ASSERT_TRUE(journal.open());
+
+    OrderId cancelled;
+    uint64_t covered = 0;
+    {
+        ShardedEngine engine(config);
+        engine.setCommandHook([&](const EngineCommand& command) { return journal.append(command); });
+        engine.start();
+        for (int i = 0; i < 20; ++i) {
+            engine.submitOrder(i % 2 ? "AAPL" : "MSFT", Side::BUY, OrderType::LIMIT, 100000 + i, 10);
+        }
+        cancelled = engine.submitOrder("MSFT", Side::SELL, OrderType::LIMIT, 200000, 10);
+        engine.flush();
+        ASSERT_TRUE(engine.snapshot(snapshotPath, &covered));
+        // Shards journal concurrently; covered is what every shard has passed
+        EXPECT_GT(covered, 0);
+        EXPECT_LE(covered, 21);
+
+        engine.cancelOrder(cancelled);
+        engine.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 150000, 10);
+        engine.stop();
+    }
+    journal.close();
+
+    ShardedEngine restored(config);
+    ASSERT_TRUE(restored.recover(snapshotPath, journalConfig.directory));
+    restored.start();
+    restored.flush();
+    EXPECT_EQ(restored.getBestBid("MSFT"), 100018);
+    EXPECT_EQ(restored.getBestAsk("MSFT"), 0);
+    EXPECT_EQ(restored.getBestAsk("AAPL"), 150000);
+    restored.stop();
+
+    // A snapshot taken with a different shard count doesn't fit
+    config.shardCount = 4;
+    ShardedEngine mismatched(config);
+    EXPECT_FALSE(mismatched.recover(snapshotPath, journalConfig.directory));
+}
+
+TEST_F(SnapshotTest, TruncateDropsCoveredSegments) {
+    Journal journal(journalConfig);
+    ASSERT_TRUE(journal.open());
+    for (int i = 1; i <= 200; ++i) {
+        journal.append(EngineCommand::cancel(i));
+    }
+    journal.close();
+
+    // Segments start at 1, 65, 129 and 193; the first two are fully covered
+    journal.truncate(150);
+    size_t segments = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(journalConfig.directory)) {
+        (void)entry;
+        ++segments;
+    }
+    EXPECT_EQ(segments, 2);
+
+    uint64_t first = 0;
+    ASSERT_TRUE(Journal::read(journalConfig.directory, 150, [&](uint64_t sequence, const EngineCommand&) {
+        if (first == 0) {
+            first = sequence;
+        }
+    }));
+    EXPECT_EQ(first, 151);
+}
+
+TEST_F(SnapshotTest, RejectsDamagedSnapshot) {
+    MatchingEngineCore engine;
+    engine.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 100);
+    std::vector<EngineSnapshot> snapshot(1);
+    engine.captureSnapshot(snapshot[0]);
+    ASSERT_TRUE(writeSnapshot(snapshotPath, snapshot));
+
+    std::fstream file(snapshotPath, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(64);
+    file.put(0x5a);
+    file.close();
+
+    std::vector<EngineSnapshot> loaded;
+    EXPECT_FALSE(readSnapshot(snapshotPath, loaded));
+    MatchingEngineCore restored;
+    EXPECT_FALSE(restored.recover(snapshotPath, ""));
+}
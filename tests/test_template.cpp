@@ -36,7 +36,7 @@ protected:
         engine = std::make_unique<MatchingEngineCore>();
         
         // Setup callbacks if needed
-        engine->setOrderCallback([this](const OrderPtr& order) {
+        engine->setOrderCallback([this](const Order& order) {
             receivedOrders.push_back(order);
         });
         
@@ -65,7 +65,7 @@ protected:
     
     // Member variables available to all tests
     std::unique_ptr<MatchingEngineCore> engine;
-    std::vector<OrderPtr> receivedOrders;
+    std::vector<Order> receivedOrders;
     std::vector<Trade> receivedTrades;
     OrderId nextOrderId = 1;
 };
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "TimingWheel.h"
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace MatchingEngine;
+
+TEST(TimingWheelTest, ScheduleAndCancel) {
+    TimingWheel wheel(1000);
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_EQ(wheel.nextCheck(), UINT64_MAX);
+
+    wheel.schedule(1, 5000);
+    wheel.schedule(2, 7000);
+    wheel.schedule(1, 9000);  // Replaces the first schedule
+    EXPECT_EQ(wheel.size(), 2);
+    EXPECT_EQ(wheel.expireTimeOf(1), 9000);
+    EXPECT_EQ(wheel.expireTimeOf(3), 0);
+
+    EXPECT_TRUE(wheel.cancel(2));
+    EXPECT_FALSE(wheel.cancel(2));
+    EXPECT_EQ(wheel.size(), 1);
+
+    std::vector<OrderId> due;
+    EXPECT_EQ(wheel.advance(8999, SIZE_MAX, due), 0);
+    EXPECT_EQ(wheel.advance(9000, SIZE_MAX, due), 1);
+    EXPECT_EQ(due, std::vector<OrderId>{1});
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimingWheelTest, NoneLeavesEarlyOrMoreThanATickLate) {
+    const uint64_t tick = 1000;
+    TimingWheel wheel(tick);
+    std::mt19937_64 random(11);
+    std::unordered_map<OrderId, uint64_t> expireTimes;
+    // Spread over several levels: up to ~2^30 ticks out
+    for (OrderId id = 1; id <= 20000; ++id) {
+        uint64_t expireTime = random() % (tick << (random() % 31));
+        expireTimes[id] = expireTime;
+        wheel.schedule(id, expireTime);
+    }
+    for (OrderId id = 1; id <= 20000; id += 7) {
+        ASSERT_TRUE(wheel.cancel(id));
+        expireTimes.erase(id);
+    }
+
+    std::vector<OrderId> due;
+    uint64_t now = 0;
+    size_t seen = 0;
+    while (!wheel.empty()) {
+        uint64_t next = wheel.nextCheck();
+        ASSERT_NE(next, UINT64_MAX);
+        // Jump either by a random step or straight to the next event
+        now = random() % 2 ? std::max(now, next) : now + random() % (tick << (random() % 24));
+        due.clear();
+        wheel.advance(now, SIZE_MAX, due);
+        for (OrderId id : due) {
+            auto it = expireTimes.find(id);
+            ASSERT_NE(it, expireTimes.end());
+            EXPECT_LE(it->second, now);
+            expireTimes.erase(it);
+        }
+        // Whatever is left has not passed the tick before now
+        if (!wheel.empty()) {
+            EXPECT_GE(wheel.nextCheck(), now / tick * tick);
+        }
+        seen += due.size();
+    }
+    EXPECT_TRUE(expireTimes.empty());
+    EXPECT_GT(seen, 0);
+}
+
+TEST(TimingWheelTest, ExpiresWithinATickWhenAdvancedEachTick) {
+    const uint64_t tick = 100;
+    TimingWheel wheel(tick);
+    std::mt19937_64 random(5);
+    std::unordered_map<OrderId, uint64_t> expireTimes;
+    for (OrderId id = 1; id <= 2000; ++id) {
+        expireTimes[id] = 1 + random() % (tick * 100000);
+        wheel.schedule(id, expireTimes[id]);
+    }
+    std::vector<OrderId> due;
+    for (uint64_t now = 0; !wheel.empty(); now += tick) {
+        due.clear();
+        wheel.advance(now, SIZE_MAX, due);
+        for (OrderId id : due) {
+            EXPECT_LE(expireTimes[id], now);
+            EXPECT_GT(expireTimes[id] + tick, now);
+        }
+    }
+}
+
+TEST(TimingWheelTest, LimitHoldsTheRestForNextTime) {
+    TimingWheel wheel(1000);
+    for (OrderId id = 1; id <= 10; ++id) {
+        wheel.schedule(id, 5000);
+    }
+    wheel.schedule(11, 6000);
+
+    std::vector<OrderId> due;
+    EXPECT_EQ(wheel.advance(10000, 4, due), 4);
+    EXPECT_EQ(wheel.size(), 7);
+    EXPECT_LE(wheel.nextCheck(), 5000);  // Still overdue
+    EXPECT_EQ(wheel.advance(10000, 4, due), 4);
+    EXPECT_EQ(wheel.advance(10000, 4, due), 3);
+    ASSERT_EQ(due.size(), 11);
+    EXPECT_EQ(due.back(), 11);  // The held-back tick drains before a later one
+
+    std::sort(due.begin(), due.end());
+    for (OrderId id = 1; id <= 11; ++id) {
+        EXPECT_EQ(due[id - 1], id);
+    }
+}
+
+TEST(TimingWheelTest, PastTimesAreDueAtTheNextTick) {
+    TimingWheel wheel(1000);
+    wheel.schedule(1, 50000);
+    std::vector<OrderId> due;
+    EXPECT_EQ(wheel.advance(40000, SIZE_MAX, due), 0);
+
+    // Already behind the wheel's position
+    wheel.schedule(2, 10);
+    EXPECT_EQ(wheel.nextCheck(), 41000);
+    EXPECT_EQ(wheel.advance(41000, SIZE_MAX, due), 1);
+    EXPECT_EQ(due, std::vector<OrderId>{2});
+    EXPECT_EQ(wheel.nextCheck(), 50000);
+}
+
+TEST(TimingWheelTest, IdleAdvanceOntoASlotBoundaryCascadesIt) {
+    TimingWheel wheel(1);
+    std::vector<OrderId> due;
+    wheel.schedule(1, 300);
+    EXPECT_EQ(wheel.advance(255, SIZE_MAX, due), 0);  // Stops at tick 256
+
+    // A nearer order must not hide the level 1 slot tick 256 starts
+    wheel.schedule(2, 400);
+    EXPECT_EQ(wheel.nextCheck(), 300);
+    EXPECT_EQ(wheel.advance(256, SIZE_MAX, due), 0);
+    EXPECT_EQ(wheel.advance(450, SIZE_MAX, due), 2);
+    std::sort(due.begin(), due.end());
+    EXPECT_EQ(due, (std::vector<OrderId>{1, 2}));
+    EXPECT_TRUE(wheel.empty());
+}
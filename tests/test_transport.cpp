@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "Transport.h"
+#include "Server.h"
+#include "Client.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+
+using namespace MatchingEngine;
+
+#ifdef __linux__
+
+namespace {
+
+// Busy polling that doesn't exceed net.core.busy_read needs no privileges
+LowLatencyOptions unprivilegedLowLatency() {
+    LowLatencyOptions options;
+    options.enabled = true;
+    options.busyPollMicros = 0;
+    return options;
+}
+
+} // namespace
+
+TEST(TransportTest, KernelSocketsCarryAStream) {
+    auto transport = Transport::create(TransportType::KERNEL, unprivilegedLowLatency());
+    ASSERT_TRUE(transport);
+
+    uint16_t port = 0;
+    SocketType listener = transport->listen(port);
+    ASSERT_NE(listener, INVALID_SOCKET);
+    EXPECT_NE(port, 0);
+
+    SocketType client = transport->connect("127.0.0.1", port);
+    ASSERT_NE(client, INVALID_SOCKET);
+    SocketType server = transport->accept(listener);
+    ASSERT_NE(server, INVALID_SOCKET);
+    EXPECT_TRUE(transport->configure(client));
+    EXPECT_TRUE(transport->configure(server, 0));
+
+    int noDelay = 0;
+    socklen_t length = sizeof(noDelay);
+    ASSERT_EQ(getsockopt(client, IPPROTO_TCP, TCP_NODELAY, &noDelay, &length), 0);
+    EXPECT_NE(noDelay, 0);
+
+    const char message[] = "ping";
+    EXPECT_EQ(transport->send(client, message, sizeof(message)), static_cast<int>(sizeof(message)));
+    char buffer[16] = {};
+    EXPECT_EQ(transport->receive(server, buffer, sizeof(buffer)), static_cast<int>(sizeof(message)));
+    EXPECT_STREQ(buffer, "ping");
+
+    // A timed-out read fails; a shut-down peer reads as the end of the stream
+    transport->setReceiveTimeout(server, 10);
+    EXPECT_LT(transport->receive(server, buffer, sizeof(buffer)), 0);
+    transport->shutdown(client);
+    EXPECT_EQ(transport->receive(server, buffer, sizeof(buffer)), 0);
+
+    transport->close(client);
+    transport->close(server);
+    transport->close(listener);
+}
+
+TEST(TransportTest, LowLatencyServerPinsAndServes) {
+    ServerConfig config;
+    config.port = 0;
+    config.ioMode = ServerIoMode::EPOLL;
+    config.logEvents = false;
+    config.lowLatency = unprivilegedLowLatency();
+    config.ioThreads = 1;
+    config.engineShards = 1;
+    config.ioCpus = {0};
+    config.shardCpus = {0};
+    Server server(config);
+    ASSERT_TRUE(server.start());
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<OrderAckMessage> acks;
+    std::vector<ExecutionReportMessage> reports;
+    Client client("127.0.0.1", server.getPort());
+    client.setVerbose(false);
+    client.setTransport(TransportType::KERNEL, unprivilegedLowLatency());
+    client.setOrderAckCallback([&](const OrderAckMessage& msg) {
+        std::lock_guard<std::mutex> lock(mutex);
+        acks.push_back(msg);
+        changed.notify_all();
+    });
+    client.setExecutionReportCallback([&](const ExecutionReportMessage& msg) {
+        std::lock_guard<std::mutex> lock(mutex);
+        reports.push_back(msg);
+        changed.notify_all();
+    });
+    ASSERT_TRUE(client.connect());
+
+    client.submitOrder("AAPL", Side::SELL, OrderType::LIMIT, 1500000, 100);
+    client.submitOrder("AAPL", Side::BUY, OrderType::LIMIT, 1500000, 100);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(changed.wait_for(lock, std::chrono::seconds(5), [&]() {
+            return acks.size() >= 2 && reports.size() >= 1;
+        }));
+        EXPECT_EQ(reports[0].status, OrderStatus::FILLED);
+    }
+    EXPECT_EQ(server.getTotalTrades(), 1);
+
+    client.disconnect();
+    server.stop();
+}
+
+#endif